@@ -0,0 +1,918 @@
+// CPU SIDE MICROBENCHMARKS, NO GPU NEEDED
+// RUN BEFORE AND AFTER ANY LOADER OR DATA LAYOUT CHANGE AND COMPARE
+//
+// Benchmarks.exe [--repeat=N] [--model=file.obj] [--textures=dir] [--csv=file]
+//
+// EVERY CASE RUNS ONCE TO WARM UP, THEN --repeat TIMES, THE BEST TIME IS REPORTED
+// ALLOCATIONS ARE operator new CALLS DURING ONE RUN
+
+#include "../VulkanRenderer/AssetLoading.h"
+#include "../VulkanRenderer/Culling.h"
+#include "../VulkanRenderer/JobSystem.h"
+#include "../VulkanRenderer/SoftwareRasterizer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// COUNT EVERY HEAP ALLOCATION IN THE PROCESS
+static std::atomic<size_t> allocationCount{ 0 };
+
+void* operator new(size_t size) {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* memory = std::malloc(size ? size : 1)) {
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+	std::free(memory);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// RESULTS GO HERE SO THE OPTIMIZER CAN NOT DROP THE WORK
+volatile float sink = 0.0f;
+
+struct Options {
+	int repeat = 5;
+	std::string modelPath = "../Models/karanbit.obj";
+	std::string texturePath = "../Textures/";
+	std::string csvPath;
+};
+
+struct Measurement {
+	double seconds = 0.0;
+	size_t allocations = 0;
+};
+
+// BEST OF repeat RUNS AFTER ONE WARM UP RUN
+template<typename Function>
+Measurement measure(int repeat, Function&& function) {
+	function();
+
+	Measurement best;
+	best.seconds = 1e30;
+	for (int i = 0; i < repeat; i++) {
+		size_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+		auto begin = Clock::now();
+		function();
+		double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+		size_t allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+
+		if (seconds < best.seconds) {
+			best.seconds = seconds;
+			best.allocations = allocations;
+		}
+	}
+	return best;
+}
+
+class Report {
+public:
+	explicit Report(const std::string& csvPath) {
+		if (!csvPath.empty()) {
+			csv.open(csvPath);
+			if (!csv) {
+				throw std::runtime_error("failed to open " + csvPath);
+			}
+			csv << "benchmark,case,threads,ms,MB/s,Mvertices/s,allocations\n";
+		}
+
+		std::cout << std::left << std::setw(22) << "benchmark" << std::setw(34) << "case" << std::right
+			<< std::setw(8) << "threads" << std::setw(12) << "ms" << std::setw(12) << "MB/s"
+			<< std::setw(14) << "Mvertices/s" << std::setw(12) << "allocs" << "\n";
+	}
+
+	// bytes / vertices OF 0 LEAVE THAT COLUMN EMPTY
+	void add(const std::string& benchmark, const std::string& name, uint32_t threads, const Measurement& result, size_t bytes, size_t vertices) {
+		double ms = result.seconds * 1000.0;
+		double megabytesPerSecond = bytes ? bytes / result.seconds / (1024.0 * 1024.0) : 0.0;
+		double megaverticesPerSecond = vertices ? vertices / result.seconds / 1e6 : 0.0;
+
+		std::cout << std::left << std::setw(22) << benchmark << std::setw(34) << name << std::right
+			<< std::setw(8) << threads << std::fixed << std::setprecision(3) << std::setw(12) << ms
+			<< std::setprecision(1);
+		if (bytes) std::cout << std::setw(12) << megabytesPerSecond; else std::cout << std::setw(12) << "-";
+		if (vertices) std::cout << std::setw(14) << megaverticesPerSecond; else std::cout << std::setw(14) << "-";
+		std::cout << std::setw(12) << result.allocations << "\n";
+
+		if (csv) {
+			csv << benchmark << "," << name << "," << threads << "," << ms << ","
+				<< megabytesPerSecond << "," << megaverticesPerSecond << "," << result.allocations << "\n";
+		}
+	}
+
+private:
+	std::ofstream csv;
+};
+
+std::string sizeName(size_t bytes) {
+	if (bytes >= 1024 * 1024) return std::to_string(bytes / (1024 * 1024)) + " MiB";
+	return std::to_string(bytes / 1024) + " KiB";
+}
+
+// size x size QUADS, TWO TRIANGLES EACH, POSITIONS AND UVS
+std::string makeGridObj(uint32_t size) {
+	std::ostringstream obj;
+	obj << std::fixed << std::setprecision(6);
+	for (uint32_t y = 0; y <= size; y++) {
+		for (uint32_t x = 0; x <= size; x++) {
+			obj << "v " << x / float(size) << " " << 0.25f * std::sin(x * 0.1f + y * 0.07f) << " " << y / float(size) << "\n";
+		}
+	}
+	for (uint32_t y = 0; y <= size; y++) {
+		for (uint32_t x = 0; x <= size; x++) {
+			obj << "vt " << x / float(size) << " " << y / float(size) << "\n";
+		}
+	}
+	for (uint32_t y = 0; y < size; y++) {
+		for (uint32_t x = 0; x < size; x++) {
+			// OBJ INDICES START AT 1
+			uint32_t a = y * (size + 1) + x + 1;
+			uint32_t b = a + 1;
+			uint32_t c = a + size + 1;
+			uint32_t d = c + 1;
+			obj << "f " << a << "/" << a << " " << b << "/" << b << " " << d << "/" << d << "\n";
+			obj << "f " << a << "/" << a << " " << d << "/" << d << " " << c << "/" << c << "\n";
+		}
+	}
+	return obj.str();
+}
+
+std::filesystem::path writeTemporary(const std::string& name, const std::string& contents) {
+	auto path = std::filesystem::temp_directory_path() / ("VulkanRendererBenchmarks_" + name);
+	std::ofstream file(path, std::ios::binary);
+	file.write(contents.data(), contents.size());
+	if (!file) {
+		throw std::runtime_error("failed to write " + path.string());
+	}
+	return path;
+}
+
+struct ParsedObj {
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+};
+
+// SAME CALL AS VulkanRenderer::loadModel
+void parseObj(const std::string& path, ParsedObj& parsed) {
+	std::string warn, err;
+	parsed = ParsedObj();
+	if (!tinyobj::LoadObj(&parsed.attrib, &parsed.shapes, &parsed.materials, &warn, &err, path.c_str())) {
+		throw std::runtime_error(warn + err);
+	}
+}
+
+size_t cornerCount(const ParsedObj& parsed) {
+	size_t corners = 0;
+	for (const auto& shape : parsed.shapes) {
+		corners += shape.mesh.indices.size();
+	}
+	return corners;
+}
+
+void benchmarkReadFile(const Options& options, Report& report) {
+	for (size_t size : { size_t(64) * 1024, size_t(4) * 1024 * 1024, size_t(64) * 1024 * 1024 }) {
+		auto path = writeTemporary("read_" + std::to_string(size), std::string(size, 'x'));
+		auto result = measure(options.repeat, [&]() {
+			auto data = readFile(path.string());
+			if (data.size() != size) throw std::runtime_error("short read");
+		});
+		report.add("readFile", "synthetic " + sizeName(size), 1, result, size, 0);
+		std::filesystem::remove(path);
+	}
+
+	// WHATEVER REAL ASSETS ARE AROUND
+	std::vector<std::filesystem::path> assets;
+	if (std::filesystem::is_directory(options.texturePath)) {
+		for (const auto& entry : std::filesystem::directory_iterator(options.texturePath)) {
+			if (entry.is_regular_file()) assets.push_back(entry.path());
+		}
+	}
+	if (std::filesystem::is_regular_file(options.modelPath)) {
+		assets.push_back(options.modelPath);
+	}
+	for (const auto& asset : assets) {
+		size_t size = static_cast<size_t>(std::filesystem::file_size(asset));
+		auto result = measure(options.repeat, [&]() { readFile(asset.string()); });
+		report.add("readFile", asset.filename().string(), 1, result, size, 0);
+	}
+}
+
+void benchmarkObj(const std::string& name, const std::string& path, const Options& options, Report& report) {
+	size_t size = static_cast<size_t>(std::filesystem::file_size(path));
+
+	ParsedObj parsed;
+	auto parse = measure(options.repeat, [&]() { parseObj(path, parsed); });
+	size_t corners = cornerCount(parsed);
+	report.add("obj parse", name, 1, parse, size, corners);
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	auto dedup = measure(options.repeat, [&]() {
+		vertices.clear();
+		indices.clear();
+		vertices.shrink_to_fit();
+		indices.shrink_to_fit();
+		buildIndexedMesh(parsed.attrib, parsed.shapes, vertices, indices);
+	});
+	// VERTICES/S COUNTS THE CORNERS GOING IN
+	report.add("vertex dedup", name, 1, dedup, 0, corners);
+
+	// PARSE AND DEDUP IN ONE, SINGLE THREADED AND ON EVERY CORE
+	JobSystem jobs;
+	for (int pass = 0; pass < 2; pass++) {
+		auto native = measure(options.repeat, [&]() {
+			vertices.clear();
+			indices.clear();
+			vertices.shrink_to_fit();
+			indices.shrink_to_fit();
+			loadObj(path, jobs, vertices, indices);
+		});
+		report.add("native obj load", name, jobs.workerCount() + 1, native, size, corners);
+		jobs.start();
+	}
+	jobs.stop();
+}
+
+// THE SAME MESH AS A GLB, ONE INTERLEAVED VIEW LIKE MOST EXPORTERS WRITE
+std::string makeGlb(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+	size_t vertexBytes = vertices.size() * sizeof(Vertex);
+	size_t indexBytes = indices.size() * sizeof(uint32_t);
+
+	glm::vec3 boundsMin(0.0f), boundsMax(0.0f);
+	if (!vertices.empty()) boundsMin = boundsMax = vertices[0].pos;
+	for (const auto& vertex : vertices) {
+		boundsMin = glm::min(boundsMin, vertex.pos);
+		boundsMax = glm::max(boundsMax, vertex.pos);
+	}
+
+	std::ostringstream json;
+	json << "{\"asset\":{\"version\":\"2.0\"},"
+		<< "\"buffers\":[{\"byteLength\":" << vertexBytes + indexBytes << "}],"
+		<< "\"bufferViews\":[{\"buffer\":0,\"byteLength\":" << vertexBytes << ",\"byteStride\":" << sizeof(Vertex) << "},"
+		<< "{\"buffer\":0,\"byteOffset\":" << vertexBytes << ",\"byteLength\":" << indexBytes << "}],"
+		<< "\"accessors\":["
+		<< "{\"bufferView\":0,\"byteOffset\":" << offsetof(Vertex, pos) << ",\"componentType\":5126,\"count\":" << vertices.size() << ",\"type\":\"VEC3\","
+		<< "\"min\":[" << boundsMin.x << "," << boundsMin.y << "," << boundsMin.z << "],\"max\":[" << boundsMax.x << "," << boundsMax.y << "," << boundsMax.z << "]},"
+		<< "{\"bufferView\":0,\"byteOffset\":" << offsetof(Vertex, color) << ",\"componentType\":5126,\"count\":" << vertices.size() << ",\"type\":\"VEC3\"},"
+		<< "{\"bufferView\":0,\"byteOffset\":" << offsetof(Vertex, texCoord) << ",\"componentType\":5126,\"count\":" << vertices.size() << ",\"type\":\"VEC2\"},"
+		<< "{\"bufferView\":1,\"componentType\":5125,\"count\":" << indices.size() << ",\"type\":\"SCALAR\"}],"
+		<< "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"COLOR_0\":1,\"TEXCOORD_0\":2},\"indices\":3}]}]}";
+
+	// CHUNKS ARE 4 BYTE ALIGNED, JSON IS PADDED WITH SPACES
+	std::string text = json.str();
+	text.resize((text.size() + 3) / 4 * 4, ' ');
+
+	auto u32 = [](std::string& out, uint32_t value) { out.append(reinterpret_cast<const char*>(&value), sizeof(value)); };
+	std::string glb;
+	u32(glb, 0x46546C67);
+	u32(glb, 2);
+	u32(glb, static_cast<uint32_t>(12 + 8 + text.size() + 8 + vertexBytes + indexBytes));
+	u32(glb, static_cast<uint32_t>(text.size()));
+	u32(glb, 0x4E4F534A);
+	glb += text;
+	u32(glb, static_cast<uint32_t>(vertexBytes + indexBytes));
+	u32(glb, 0x004E4942);
+	glb.append(reinterpret_cast<const char*>(vertices.data()), vertexBytes);
+	glb.append(reinterpret_cast<const char*>(indices.data()), indexBytes);
+	return glb;
+}
+
+// OPEN + EVERY COPY createVertexBuffer / createIndexBuffer DO, INTO PLAIN MEMORY
+void benchmarkGlb(const std::string& name, const std::string& path, const Options& options, Report& report) {
+	size_t size = static_cast<size_t>(std::filesystem::file_size(path));
+	size_t vertexCount = 0;
+	std::vector<char> staging;
+	auto load = measure(options.repeat, [&]() {
+		GlbFile file(path);
+		const MeshSource& mesh = file.mesh();
+		staging.resize(static_cast<size_t>(mesh.vertexBufferSize + mesh.indexBufferSize));
+		for (const auto& range : mesh.vertexRanges) {
+			std::memcpy(staging.data() + range.offset, range.data, range.size);
+		}
+		for (const auto& range : mesh.indexRanges) {
+			std::memcpy(staging.data() + mesh.vertexBufferSize + range.offset, range.data, range.size);
+		}
+		vertexCount = mesh.indexCount;
+	});
+	report.add("glb load + copy", name, 1, load, size, vertexCount);
+}
+
+void benchmarkLoaders(const Options& options, Report& report) {
+	for (uint32_t grid : { 32u, 128u, 512u }) {
+		std::string name = "grid " + std::to_string(grid) + "x" + std::to_string(grid);
+		auto path = writeTemporary("grid_" + std::to_string(grid) + ".obj", makeGridObj(grid));
+		benchmarkObj(name, path.string(), options, report);
+
+		JobSystem jobs;
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		loadObj(path.string(), jobs, vertices, indices);
+		auto glbPath = writeTemporary("grid_" + std::to_string(grid) + ".glb", makeGlb(vertices, indices));
+		benchmarkGlb(name, glbPath.string(), options, report);
+
+		std::filesystem::remove(path);
+		std::filesystem::remove(glbPath);
+	}
+
+	if (std::filesystem::is_regular_file(options.modelPath)) {
+		std::string name = std::filesystem::path(options.modelPath).filename().string();
+		if (isGlbPath(options.modelPath)) {
+			benchmarkGlb(name, options.modelPath, options, report);
+		}
+		else {
+			benchmarkObj(name, options.modelPath, options, report);
+		}
+	}
+}
+
+// THE COPY INTO MAPPED STAGING MEMORY IN createVertexBuffer / createTextureImage
+void benchmarkStagingCopy(const Options& options, Report& report) {
+	for (size_t size : { size_t(64) * 1024, size_t(4) * 1024 * 1024, size_t(64) * 1024 * 1024 }) {
+		std::vector<char> source(size, 1);
+		std::vector<char> staging(size);
+		auto result = measure(options.repeat, [&]() { std::memcpy(staging.data(), source.data(), size); });
+		report.add("staging memcpy", sizeName(size), 1, result, size, 0);
+	}
+}
+
+// THE MATRIX SETUP AT THE TOP OF VulkanRenderer::updateUniformBuffer
+void benchmarkMatrixSetup(const Options& options, Report& report) {
+	const int iterations = 100000;
+	glm::vec3 cameraPos(2.0f, 2.0f, 2.0f);
+	glm::vec3 cameraFront(-0.577f, -0.577f, -0.577f);
+	glm::vec3 cameraUp(0.0f, 1.0f, 0.0f);
+	float checksum = 0.0f;
+
+	auto result = measure(options.repeat, [&]() {
+		for (int i = 0; i < iterations; i++) {
+			float pitch = i * 0.01f;
+			float yaw = i * 0.02f;
+			glm::mat4 model = glm::rotate(glm::mat4(1.0f), glm::radians(pitch), glm::normalize(glm::cross(cameraFront, cameraUp)));
+			model = glm::rotate(model, glm::radians(yaw), cameraUp);
+			glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+			glm::mat4 proj = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
+			proj[1][1] *= -1;
+			glm::mat4 inverseProj = glm::inverse(proj);
+			Frustum frustum = Frustum::fromViewProjection(proj * view);
+			checksum += model[0][0] + inverseProj[3][2] + frustum.planes[4].w;
+		}
+	});
+	report.add("matrix setup", std::to_string(iterations) + " frames", 1, result, 0, 0);
+	sink = checksum;
+}
+
+// A PREREQUISITE THAT THROWS MUST STOP EVERYTHING DEPENDING ON IT: THE DEPENDENTS NEVER RUN,
+// THEIR COUNTERS RETHROW THE SAME EXCEPTION AND UNRELATED COUNTERS STAY CLEAN
+// WITH AND WITHOUT WORKERS, AND FOR DEPENDENTS ADDED BEFORE AND AFTER THE FAILURE
+void checkJobErrors() {
+	for (uint32_t workers : { 0u, 3u }) {
+		JobSystem jobs;
+		if (workers > 0) {
+			jobs.start(workers);
+		}
+
+		JobCounter prerequisite, dependents, chained, unrelated;
+		std::atomic<int> ran{ 0 };
+		jobs.run([]() { throw std::runtime_error("prerequisite failed"); }, &prerequisite);
+		for (int i = 0; i < 8; i++) {
+			jobs.run([&ran]() { ran++; }, &dependents, &prerequisite);
+			jobs.run([]() {}, &unrelated);
+		}
+		// TWO LEVELS DOWN, HELD BACK BY A COUNTER THAT ONLY FAILS BECAUSE OF ITS OWN DEPENDENCY
+		jobs.run([&ran]() { ran++; }, &chained, &dependents);
+
+		auto failsWithPrerequisite = [&](JobCounter& counter) {
+			try {
+				jobs.wait(counter);
+			}
+			catch (const std::runtime_error& error) {
+				return std::string(error.what()) == "prerequisite failed";
+			}
+			return false;
+		};
+
+		jobs.wait(unrelated);
+		if (!failsWithPrerequisite(dependents) || !failsWithPrerequisite(chained)) {
+			throw std::runtime_error("job system: dependents of a failed job did not fail with it");
+		}
+		// NOBODY HAS WAITED FOR prerequisite YET, A LATE DEPENDENT IS SKIPPED TOO
+		JobCounter late;
+		jobs.run([&ran]() { ran++; }, &late, &prerequisite);
+		if (!failsWithPrerequisite(late) || !failsWithPrerequisite(prerequisite)) {
+			throw std::runtime_error("job system: a dependent added after the failure still ran");
+		}
+		if (ran != 0) {
+			throw std::runtime_error("job system: " + std::to_string(ran.load()) + " dependents of a failed job ran");
+		}
+
+		jobs.stop();
+	}
+}
+
+// THE SAME RANDOM SCENE EVERY CALL: ROTATED, SCALED BOXES WITH EVERY SEVENTH ONE REMOVED
+void buildCullingScene(CullingScene& scene, uint32_t objects) {
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.1f, 4.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+	std::uniform_real_distribution<float> scale(0.25f, 3.0f);
+
+	for (uint32_t i = 0; i < objects; i++) {
+		glm::vec3 half(size(random), size(random), size(random));
+		glm::vec3 offset(position(random), position(random), position(random));
+		glm::mat4 world = glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random), position(random)));
+		world = glm::rotate(world, angle(random), glm::normalize(glm::vec3(position(random), position(random), position(random)) + glm::vec3(0.001f)));
+		world = glm::scale(world, glm::vec3(scale(random), scale(random), scale(random)));
+		scene.add(offset * 0.01f - half, offset * 0.01f + half, world);
+	}
+	for (uint32_t i = 0; i < objects; i += 7) {
+		scene.remove(i);
+	}
+}
+
+Frustum cullingFrustum() {
+	glm::mat4 view = glm::lookAt(glm::vec3(-20.0f, 10.0f, -30.0f), glm::vec3(10.0f, 0.0f, 20.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 proj = glm::perspective(glm::radians(60.0f), 1280.0f / 720.0f, 0.1f, 150.0f);
+	proj[1][1] *= -1;
+	return Frustum::fromViewProjection(proj * view);
+}
+
+// THE VECTOR KERNELS MUST MATCH THE SCALAR ONES (SIMD_FORCE_SCALAR) BEFORE ANY OF THEM IS TIMED
+// FMA ROUNDS DIFFERENTLY, SO BOUNDS ONLY HAVE TO BE CLOSE AND AN OBJECT MAY ONLY
+// CHANGE SIDES WHEN IT IS TOUCHING A PLANE
+void checkCulling() {
+	const uint32_t objects = 20000;
+	const float tolerance = 1e-4f;
+	Frustum frustum = cullingFrustum();
+
+	CullingScene reference;
+	reference.setKernels(scalarCullingKernels());
+	buildCullingScene(reference, objects);
+	reference.updateBounds();
+
+	std::vector<const CullingKernels*> candidates = { &defaultCullingKernels() };
+	if (&bestCullingKernels() != &defaultCullingKernels()) {
+		candidates.push_back(&bestCullingKernels());
+	}
+
+	for (const CullingKernels* kernels : candidates) {
+		CullingScene scene;
+		scene.setKernels(*kernels);
+		buildCullingScene(scene, objects);
+		scene.updateBounds();
+
+		auto close = [&](float a, float b) { return std::fabs(a - b) <= tolerance * (1.0f + std::fabs(b)); };
+		for (uint32_t object = 0; object < objects; object++) {
+			glm::vec3 center = scene.worldCenter(object);
+			glm::vec3 extent = scene.worldExtent(object);
+			glm::vec3 expectedCenter = reference.worldCenter(object);
+			glm::vec3 expectedExtent = reference.worldExtent(object);
+			bool same = close(scene.worldRadius(object), reference.worldRadius(object));
+			for (int i = 0; i < 3; i++) {
+				same = same && close(center[i], expectedCenter[i]) && close(extent[i], expectedExtent[i]);
+			}
+			if (!same) {
+				throw std::runtime_error(std::string(kernels->name) + " culling bounds differ from scalar for object " + std::to_string(object));
+			}
+		}
+
+		for (CullShape shape : { CullShape::Sphere, CullShape::Box }) {
+			std::vector<uint32_t> visible, expected;
+			scene.cull(frustum, shape, visible);
+			reference.cull(frustum, shape, expected);
+
+			std::vector<uint8_t> seen(objects, 0);
+			for (uint32_t object : visible) seen[object] |= 1;
+			for (uint32_t object : expected) seen[object] |= 2;
+
+			for (uint32_t object = 0; object < objects; object++) {
+				if (seen[object] == 0 || seen[object] == 3) continue;
+
+				// HOW FAR THE OBJECT IS FROM CHANGING SIDES ON THE PLANE THAT DECIDES IT
+				glm::vec3 center = reference.worldCenter(object);
+				glm::vec3 extent = reference.worldExtent(object);
+				float margin = 1e30f;
+				for (const glm::vec4& plane : frustum.planes) {
+					glm::vec3 normal(plane);
+					float reach = shape == CullShape::Sphere ? reference.worldRadius(object) : glm::dot(glm::abs(normal), extent);
+					float distance = glm::dot(normal, center) + plane.w + reach;
+					margin = std::min(margin, distance);
+				}
+				if (std::fabs(margin) > tolerance * (1.0f + glm::length(center) + glm::length(extent))) {
+					throw std::runtime_error(std::string(kernels->name) + " culling differs from scalar for object " + std::to_string(object));
+				}
+			}
+		}
+	}
+}
+
+// RANDOM TRIANGLES OVER RANDOM DEPTH, EVERY BLOCK TESTED BY EACH SET OF RASTER KERNELS THIS CPU
+// CAN RUN AND BY THE SCALAR ONES. A PIXEL MAY ONLY BE DECIDED DIFFERENTLY (FMA ROUNDS ONCE, THE
+// SCALAR CODE TWICE) WHEN IT SITS ON AN EDGE OR AT THE DEPTH ALREADY STORED THERE
+void checkRasterKernels() {
+	const int blocks = 20000;
+	const float tolerance = 1e-4f;
+	// A 16 PIXEL WIDE DEPTH BUFFER, SO THE ROWS ARE NOT BLOCK_SIZE APART
+	const size_t stride = 16;
+
+	std::vector<const RasterKernels*> candidates = { &defaultRasterKernels() };
+	if (&bestRasterKernels() != &defaultRasterKernels()) {
+		candidates.push_back(&bestRasterKernels());
+	}
+
+	std::mt19937 random(4321);
+	std::uniform_real_distribution<float> position(-8.0f, 16.0f);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<float> depth(stride * SoftwareRasterizer::BLOCK_SIZE);
+
+	for (int test = 0; test < blocks; test++) {
+		// SET UP LIKE SoftwareRasterizer::setupTriangle, COUNTER CLOCKWISE ON SCREEN
+		float x[3], y[3];
+		for (int i = 0; i < 3; i++) {
+			x[i] = std::round(position(random) * 16.0f) / 16.0f;
+			y[i] = std::round(position(random) * 16.0f) / 16.0f;
+		}
+		float area = (y[0] - y[1]) * (x[2] - x[0]) + (x[1] - x[0]) * (y[2] - y[0]);
+		if (area == 0.0f) continue;
+		if (area < 0.0f) {
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+			area = -area;
+		}
+		float z[3] = { unit(random), unit(random), unit(random) };
+
+		RasterBlock block;
+		block.left = 0.5f;
+		block.top = 0.5f;
+		for (int i = 0; i < 3; i++) {
+			int j = (i + 1) % 3;
+			block.x[i] = x[i];
+			block.y[i] = y[i];
+			block.edgeA[i] = y[i] - y[j];
+			block.edgeB[i] = x[j] - x[i];
+			bool topLeft = block.edgeA[i] > 0.0f || (block.edgeA[i] == 0.0f && block.edgeB[i] > 0.0f);
+			block.edgeBias[i] = topLeft ? 0.0f : FLT_MIN;
+		}
+		block.z0 = z[0];
+		block.dz1 = (z[1] - z[0]) / area;
+		block.dz2 = (z[2] - z[0]) / area;
+		block.covered = test % 8 == 0;
+		for (float& stored : depth) {
+			stored = unit(random);
+		}
+		block.depth = depth.data();
+		block.stride = stride;
+
+		RasterBlockResult expected;
+		scalarRasterKernels().testBlock(block, expected);
+
+		for (const RasterKernels* kernels : candidates) {
+			RasterBlockResult result;
+			kernels->testBlock(block, result);
+
+			for (uint32_t row = 0; row < SoftwareRasterizer::BLOCK_SIZE; row++) {
+				for (uint32_t column = 0; column < SoftwareRasterizer::BLOCK_SIZE; column++) {
+					bool passed = (result.rows[row] >> column) & 1;
+					bool expectedPassed = (expected.rows[row] >> column) & 1;
+					uint32_t pixel = row * SoftwareRasterizer::BLOCK_SIZE + column;
+
+					auto close = [&](float a, float b, float scale) { return std::fabs(a - b) <= tolerance * (1.0f + scale); };
+					if (passed && expectedPassed) {
+						if (!close(result.e0[pixel], expected.e0[pixel], std::fabs(expected.e0[pixel])) ||
+							!close(result.e2[pixel], expected.e2[pixel], std::fabs(expected.e2[pixel])) ||
+							!close(result.z[pixel], expected.z[pixel], std::fabs(expected.z[pixel]))) {
+							throw std::runtime_error(std::string(kernels->name) + " raster kernels interpolate differently from scalar in block " + std::to_string(test));
+						}
+						continue;
+					}
+					if (passed == expectedPassed) continue;
+
+					// IN DOUBLE, HOW FAR THE PIXEL IS FROM FLIPPING ANY OF ITS TESTS
+					double centerX = block.left + column;
+					double centerY = block.top + row;
+					double e[3];
+					bool onBoundary = false;
+					for (int i = 0; i < 3; i++) {
+						double along = double(block.edgeA[i]) * (centerX - block.x[i]);
+						double across = double(block.edgeB[i]) * (centerY - block.y[i]);
+						e[i] = along + across;
+						onBoundary = onBoundary || (!block.covered && std::fabs(e[i] - block.edgeBias[i]) <= tolerance * (1.0 + std::fabs(along) + std::fabs(across)));
+					}
+					double pixelZ = block.z0 + double(block.dz1) * e[2] + double(block.dz2) * e[0];
+					double storedZ = depth[row * stride + column];
+					onBoundary = onBoundary || std::fabs(pixelZ - storedZ) <= tolerance * (1.0 + std::fabs(double(block.dz1) * e[2]) + std::fabs(double(block.dz2) * e[0]));
+					if (!onBoundary) {
+						throw std::runtime_error(std::string(kernels->name) + " raster kernels differ from scalar in block " + std::to_string(test));
+					}
+				}
+			}
+		}
+	}
+}
+
+// THE SAME SCENE CULLED BY EVERY SET OF KERNELS THIS CPU CAN RUN
+void benchmarkCulling(const Options& options, Report& report) {
+	const uint32_t objects = 100000;
+	Frustum frustum = cullingFrustum();
+
+	std::vector<const CullingKernels*> kernelSets = { &scalarCullingKernels(), &defaultCullingKernels() };
+	if (&bestCullingKernels() != &defaultCullingKernels()) {
+		kernelSets.push_back(&bestCullingKernels());
+	}
+
+	for (const CullingKernels* kernels : kernelSets) {
+		CullingScene scene;
+		scene.setKernels(*kernels);
+		buildCullingScene(scene, objects);
+		scene.updateBounds();
+
+		std::vector<uint32_t> visible;
+		visible.reserve(objects);
+		for (CullShape shape : { CullShape::Sphere, CullShape::Box }) {
+			auto result = measure(options.repeat, [&]() {
+				visible.clear();
+				scene.cull(frustum, shape, visible);
+			});
+			std::string name = std::string(kernels->name) + (shape == CullShape::Sphere ? " sphere " : " box ") + std::to_string(objects);
+			report.add("culling", name, 1, result, 0, 0);
+		}
+	}
+}
+
+// cluster.comp ON THE CPU WITH THE LIGHTS PLACED LIKE VulkanRenderer::createLights AT THE
+// DEFAULT --light-radius, SEEN FROM THE DEFAULT CAMERA AROUND A UNIT MODEL
+// THE FRAGMENT SHADER LOOPS OVER ITS FROXEL'S LIST, SO LIGHTS PER FROXEL IS THE PER-PIXEL COST
+// THE CASE SHOWS THE AVERAGE OVER FROXELS THAT HAVE ANY LIGHT, THE MOST IN ONE FROXEL AND HOW
+// MANY INDICES THE POOL createClusterBuffers STARTS WITH HAD NO ROOM FOR (0 IS NO LIGHT LOST)
+void benchmarkLightBinning(const Options& options, Report& report) {
+	const glm::uvec3 grid(16, 9, 24);
+	const float lightRadius = 0.4f;
+	const glm::vec2 screen(1280.0f, 720.0f);
+	const float nearPlane = 0.1f;
+	const float farPlane = 10.0f;
+
+	glm::vec3 cameraPos(0.5f, 0.5f, 0.5f);
+	glm::mat4 view = glm::lookAt(cameraPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 proj = glm::perspective(glm::radians(45.0f), screen.x / screen.y, nearPlane, farPlane);
+	proj[1][1] *= -1;
+	glm::mat4 inverseProj = glm::inverse(proj);
+
+	// THE VIEW SPACE BOX OF EVERY FROXEL, THE SAME MATH AS cluster.comp
+	auto viewRay = [&](glm::vec2 pixel) {
+		glm::vec2 ndc = pixel / screen * 2.0f - 1.0f;
+		glm::vec4 farPoint = inverseProj * glm::vec4(ndc, 1.0f, 1.0f);
+		glm::vec3 direction = glm::vec3(farPoint) / farPoint.w;
+		return direction / -direction.z;
+	};
+	glm::vec2 tile(std::ceil(screen.x / grid.x), std::ceil(screen.y / grid.y));
+	std::vector<glm::vec3> boxMin, boxMax;
+	for (uint32_t z = 0; z < grid.z; z++) {
+		float sliceNear = nearPlane * std::pow(farPlane / nearPlane, float(z) / float(grid.z));
+		float sliceFar = nearPlane * std::pow(farPlane / nearPlane, float(z + 1) / float(grid.z));
+		for (uint32_t y = 0; y < grid.y; y++) {
+			for (uint32_t x = 0; x < grid.x; x++) {
+				glm::vec2 pixelMin = glm::vec2(x, y) * tile;
+				glm::vec2 pixelMax = glm::vec2(x + 1, y + 1) * tile;
+				glm::vec3 rays[4] = { viewRay(pixelMin), viewRay(pixelMax), viewRay(glm::vec2(pixelMin.x, pixelMax.y)), viewRay(glm::vec2(pixelMax.x, pixelMin.y)) };
+				glm::vec3 low = rays[0] * sliceNear;
+				glm::vec3 high = low;
+				for (const glm::vec3& ray : rays) {
+					low = glm::min(low, glm::min(ray * sliceNear, ray * sliceFar));
+					high = glm::max(high, glm::max(ray * sliceNear, ray * sliceFar));
+				}
+				boxMin.push_back(low);
+				boxMax.push_back(high);
+			}
+		}
+	}
+
+	for (uint32_t lightCount : { 10u, 100u, 1000u, 10000u }) {
+		// SAME SEED AND DRAW ORDER AS createLights
+		glm::vec3 halfSize(0.75f);
+		float radius = lightRadius * glm::length(halfSize);
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<glm::vec3> lights(lightCount);
+		for (glm::vec3& light : lights) {
+			glm::vec3 offset = glm::vec3(unit(random), unit(random), unit(random)) * 2.0f - 1.0f;
+			unit(random); unit(random); unit(random); unit(random);
+			light = glm::vec3(view * glm::vec4(offset * halfSize, 1.0f));
+		}
+
+		// THE SHARED POOL AS createClusterBuffers FIRST SIZES IT, THE CLUSTERS RESERVE THEIR
+		// INDICES IN ORDER AND ONLY KEEP WHAT FITS, LIKE THE atomicAdd IN cluster.comp
+		const uint64_t capacity = boxMin.size() * std::max<uint64_t>(lightCount / 4, 1);
+		std::vector<uint32_t> pool(static_cast<size_t>(capacity));
+		std::vector<uint32_t> counts(boxMin.size());
+		uint64_t needed = 0, dropped = 0;
+		auto result = measure(options.repeat, [&]() {
+			needed = 0;
+			dropped = 0;
+			for (size_t cluster = 0; cluster < boxMin.size(); cluster++) {
+				uint32_t count = 0;
+				for (size_t i = 0; i < lights.size(); i++) {
+					glm::vec3 offset = glm::clamp(lights[i], boxMin[cluster], boxMax[cluster]) - lights[i];
+					if (glm::dot(offset, offset) <= radius * radius) {
+						if (needed + count < capacity) {
+							pool[static_cast<size_t>(needed + count)] = static_cast<uint32_t>(i);
+						}
+						else {
+							dropped++;
+						}
+						count++;
+					}
+				}
+				needed += count;
+				counts[cluster] = count;
+			}
+		});
+
+		size_t lit = 0, most = 0;
+		for (uint32_t count : counts) {
+			lit += count > 0;
+			most = std::max<size_t>(most, count);
+		}
+		std::ostringstream name;
+		name << lightCount << " lights " << std::fixed << std::setprecision(1) << (lit ? double(needed) / lit : 0.0) << " avg " << most << " max " << dropped << " dropped";
+		report.add("light binning", name.str(), 1, result, 0, 0);
+	}
+}
+
+// SAME WORK SPLIT OVER THE JOB SYSTEM WITH MORE AND MORE WORKERS
+// THE CALLING THREAD HELPS, SO N WORKERS MEANS N + 1 THREADS
+void benchmarkScaling(const Options& options, Report& report) {
+	uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<uint32_t> workerCounts = { 0 };
+	for (uint32_t workers = 1; workers < cores; workers *= 2) {
+		workerCounts.push_back(workers);
+	}
+	if (workerCounts.back() != cores - 1 && cores > 1) {
+		workerCounts.push_back(cores - 1);
+	}
+
+	const uint32_t modelCount = 16;
+	auto objPath = writeTemporary("scaling.obj", makeGridObj(128)).string();
+	size_t objSize = static_cast<size_t>(std::filesystem::file_size(objPath));
+	auto bigObjPath = writeTemporary("scaling_big.obj", makeGridObj(1024)).string();
+	size_t bigObjSize = static_cast<size_t>(std::filesystem::file_size(bigObjPath));
+
+	const size_t copySize = size_t(256) * 1024 * 1024;
+	const size_t copyGrain = size_t(1024) * 1024;
+	std::vector<char> source(copySize, 1);
+	std::vector<char> staging(copySize);
+
+	for (uint32_t workers : workerCounts) {
+		JobSystem jobs;
+		if (workers > 0) {
+			jobs.start(workers);
+		}
+
+		std::vector<size_t> corners(modelCount);
+		auto load = measure(options.repeat, [&]() {
+			jobs.parallelFor(modelCount, 1, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++) {
+					ParsedObj parsed;
+					parseObj(objPath, parsed);
+					std::vector<Vertex> vertices;
+					std::vector<uint32_t> indices;
+					buildIndexedMesh(parsed.attrib, parsed.shapes, vertices, indices);
+					corners[i] = cornerCount(parsed);
+				}
+			});
+		});
+		size_t totalCorners = 0;
+		for (size_t count : corners) totalCorners += count;
+		report.add("parallel load", std::to_string(modelCount) + " x grid 128x128", workers + 1, load, objSize * modelCount, totalCorners);
+
+		// ONE BIG FILE SPLIT INTO CHUNKS INSTEAD OF MANY SMALL ONES
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		auto native = measure(options.repeat, [&]() {
+			vertices.clear();
+			indices.clear();
+			loadObj(bigObjPath, jobs, vertices, indices);
+		});
+		report.add("parallel native load", "grid 1024x1024", workers + 1, native, bigObjSize, indices.size());
+
+		// THE SAME GRID DRAWN BY THE CPU RENDERER, FROM BELOW BECAUSE ITS TRIANGLES FACE DOWN
+		SoftwareMesh rasterMesh;
+		for (const Vertex& vertex : vertices) {
+			rasterMesh.positions.push_back(vertex.pos);
+			rasterMesh.texCoords.push_back(vertex.texCoord);
+		}
+		rasterMesh.indices = indices;
+
+		SoftwareRasterizer rasterizer;
+		rasterizer.resize(1280, 720);
+		rasterizer.setMesh(std::move(rasterMesh));
+
+		SoftwareFrame frame;
+		frame.view = glm::lookAt(glm::vec3(0.5f, -1.0f, 1.6f), glm::vec3(0.5f, 0.0f, 0.5f), glm::vec3(0.0f, 1.0f, 0.0f));
+		frame.proj = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 10.0f);
+		frame.proj[1][1] *= -1;
+		frame.cameraPosition = glm::vec3(0.5f, -1.0f, 1.6f);
+		frame.sunDirection = glm::vec4(glm::normalize(glm::vec3(-0.4f, 1.0f, -0.3f)), 1.0f);
+
+		auto raster = measure(options.repeat, [&]() {
+			rasterizer.render(frame, jobs);
+		});
+		report.add("software raster", std::string("grid 1024x1024 at 1280x720 ") + rasterizer.kernelName(), workers + 1, raster, 0, rasterizer.stats().triangles);
+
+		auto copy = measure(options.repeat, [&]() {
+			jobs.parallelFor(copySize, copyGrain, [&](size_t begin, size_t end) {
+				std::memcpy(staging.data() + begin, source.data() + begin, end - begin);
+			});
+		});
+		report.add("parallel memcpy", sizeName(copySize), workers + 1, copy, copySize, 0);
+
+		jobs.stop();
+	}
+
+	std::filesystem::remove(objPath);
+	std::filesystem::remove(bigObjPath);
+}
+
+Options parseOptions(int argc, char* argv[]) {
+	Options options;
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		size_t equals = argument.find('=');
+		std::string name = argument.substr(0, equals);
+		std::string value = equals == std::string::npos ? "" : argument.substr(equals + 1);
+
+		if (name == "--repeat") {
+			options.repeat = std::max(1, std::atoi(value.c_str()));
+		}
+		else if (name == "--model") {
+			options.modelPath = value;
+		}
+		else if (name == "--textures") {
+			options.texturePath = value;
+		}
+		else if (name == "--csv") {
+			options.csvPath = value;
+		}
+		else {
+			throw std::runtime_error("unknown option " + argument);
+		}
+	}
+	return options;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	try {
+		Options options = parseOptions(argc, argv);
+
+		// BEFORE THE TABLE SO A MISMATCH STOPS THE RUN
+		checkJobErrors();
+		checkCulling();
+		checkRasterKernels();
+		std::cout << "culling kernels: " << bestCullingKernels().name << ", raster kernels: " << bestRasterKernels().name << ", match scalar\n" << std::endl;
+
+		Report report(options.csvPath);
+
+		benchmarkReadFile(options, report);
+		benchmarkLoaders(options, report);
+		benchmarkStagingCopy(options, report);
+		benchmarkMatrixSetup(options, report);
+		benchmarkCulling(options, report);
+		benchmarkLightBinning(options, report);
+		benchmarkScaling(options, report);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "AssetLoading.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <fstream>
+#include <initializer_list>
+#include <stdexcept>
+#include <unordered_map>
+
+std::vector<char> readFile(const std::string& filename) {
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open file!");
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+	std::vector<char> buffer(fileSize);
+
+	file.seekg(0);
+	file.read(buffer.data(), fileSize);
+
+	file.close();
+
+	return buffer;
+}
+
+void buildIndexedMesh(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+	std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+
+	for (const auto& shape : shapes) {
+		for (const auto& index : shape.mesh.indices) {
+			Vertex vertex{};
+
+			vertex.pos = {
+				attrib.vertices[3 * index.vertex_index + 0],
+				attrib.vertices[3 * index.vertex_index + 1],
+				attrib.vertices[3 * index.vertex_index + 2]
+			};
+			if (index.texcoord_index > 0)
+				vertex.texCoord = {
+					attrib.texcoords[2 * index.texcoord_index + 0],
+					1 - attrib.texcoords[2 * index.texcoord_index + 1]
+			};
+
+			vertex.color = { 1.0f, 1.0f, 1.0f };
+
+			if (uniqueVertices.count(vertex) == 0) {
+				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(vertex);
+			}
+
+			indices.push_back(uniqueVertices[vertex]);
+		}
+	}
+}
+
+vk::PipelineVertexInputStateCreateInfo VertexLayout::inputState() const {
+	vk::PipelineVertexInputStateCreateInfo vertexInputInfo;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindings.size());
+	vertexInputInfo.pVertexBindingDescriptions = bindings.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+	vertexInputInfo.pVertexAttributeDescriptions = attributes.data();
+	return vertexInputInfo;
+}
+
+// THE ATTRIBUTES AT locations, THEIR STREAMS RENUMBERED FROM 0 IN THE ORDER THEY ARE FIRST NEEDED
+static VertexLayout selectLocations(const VertexLayout& layout, std::initializer_list<uint32_t> locations) {
+	VertexLayout result;
+	std::vector<uint32_t> sourceBindings;
+	for (uint32_t location : locations) {
+		for (const auto& attribute : layout.attributes) {
+			if (attribute.location != location) continue;
+
+			auto found = std::find(sourceBindings.begin(), sourceBindings.end(), attribute.binding);
+			uint32_t binding = static_cast<uint32_t>(found - sourceBindings.begin());
+			if (found == sourceBindings.end()) {
+				for (const auto& source : layout.bindings) {
+					if (source.binding != attribute.binding) continue;
+
+					result.bindings.push_back(source);
+					result.bindings.back().binding = binding;
+					result.offsets.push_back(layout.offsets[attribute.binding]);
+				}
+				sourceBindings.push_back(attribute.binding);
+			}
+
+			result.attributes.push_back(attribute);
+			result.attributes.back().binding = binding;
+		}
+	}
+	return result;
+}
+
+VertexLayout VertexLayout::positionOnly() const {
+	return selectLocations(*this, { 0 });
+}
+
+VertexLayout VertexLayout::positionAndTexCoord() const {
+	return selectLocations(*this, { 0, 2 });
+}
+
+MeshSource meshFromVertices(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+	MeshSource mesh;
+
+	auto attributeDescriptions = Vertex::getAttributeDescriptions();
+	mesh.layout.bindings = { Vertex::getBindingDescription() };
+	mesh.layout.attributes.assign(attributeDescriptions.begin(), attributeDescriptions.end());
+	mesh.layout.offsets = { 0 };
+
+	mesh.vertexBufferSize = sizeof(Vertex) * vertices.size();
+	mesh.vertexRanges = { { vertices.data(), static_cast<size_t>(mesh.vertexBufferSize), 0 } };
+	mesh.indexBufferSize = sizeof(uint32_t) * indices.size();
+	mesh.indexRanges = { { indices.data(), static_cast<size_t>(mesh.indexBufferSize), 0 } };
+	mesh.indexType = vk::IndexType::eUint32;
+	mesh.indexCount = static_cast<uint32_t>(indices.size());
+
+	// LOCAL BOUNDS FOR CULLING
+	if (!vertices.empty()) {
+		mesh.boundsMin = mesh.boundsMax = vertices[0].pos;
+		for (const auto& vertex : vertices) {
+			mesh.boundsMin = glm::min(mesh.boundsMin, vertex.pos);
+			mesh.boundsMax = glm::max(mesh.boundsMax, vertex.pos);
+		}
+	}
+	return mesh;
+}
+
+MeshSource meshFromSplitVertices(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, std::vector<glm::vec3>& positions, std::vector<VertexAttributes>& attributes) {
+	// SAME BOUNDS AND INDICES, ONLY THE VERTEX BUFFER IS LAID OUT DIFFERENTLY
+	MeshSource mesh = meshFromVertices(vertices, indices);
+
+	positions.resize(vertices.size());
+	attributes.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		positions[i] = vertices[i].pos;
+		attributes[i].color = vertices[i].color;
+		attributes[i].texCoord = vertices[i].texCoord;
+	}
+
+	// THE ATTRIBUTES START RIGHT AFTER THE POSITIONS, 16 BYTE ALIGNED
+	vk::DeviceSize positionsSize = sizeof(glm::vec3) * positions.size();
+	vk::DeviceSize attributesOffset = (positionsSize + 15) & ~vk::DeviceSize(15);
+	vk::DeviceSize attributesSize = sizeof(VertexAttributes) * attributes.size();
+
+	mesh.layout.bindings = {
+		vk::VertexInputBindingDescription(0, sizeof(glm::vec3), vk::VertexInputRate::eVertex),
+		vk::VertexInputBindingDescription(1, sizeof(VertexAttributes), vk::VertexInputRate::eVertex),
+	};
+	mesh.layout.attributes = {
+		vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32Sfloat, 0),
+		vk::VertexInputAttributeDescription(1, 1, vk::Format::eR32G32B32Sfloat, offsetof(VertexAttributes, color)),
+		vk::VertexInputAttributeDescription(2, 1, vk::Format::eR32G32Sfloat, offsetof(VertexAttributes, texCoord)),
+	};
+	mesh.layout.offsets = { 0, attributesOffset };
+
+	mesh.vertexBufferSize = attributesOffset + attributesSize;
+	mesh.vertexRanges = {
+		{ positions.data(), static_cast<size_t>(positionsSize), 0 },
+		{ attributes.data(), static_cast<size_t>(attributesSize), attributesOffset },
+	};
+	return mesh;
+}
+
+bool isGlbPath(const std::string& path) {
+	if (path.size() < 4) return false;
+	std::string extension = path.substr(path.size() - 4);
+	for (char& c : extension) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+	return extension == ".glb";
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+// CPU SIDE ASSET LOADING, NO VULKAN DEVICE NEEDED
+// SHARED BY THE RENDERER AND THE BENCHMARKS PROJECT
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include <glm/gtx/hash.hpp>
+#include <vulkan/vulkan.hpp>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "tiny_obj_loader.h"
+#include "VulkanRendererNeededBuildTypes.h"
+
+class JobSystem;
+class MappedFile;
+
+// WHOLE FILE IN MEMORY
+std::vector<char> readFile(const std::string& filename);
+
+// tinyobj GIVES ONE INDEX TRIPLE PER TRIANGLE CORNER, THIS MERGES EQUAL
+// CORNERS INTO ONE VERTEX AND APPENDS TO vertices / indices
+void buildIndexedMesh(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+// NATIVE OBJ LOADER (ObjLoader.cpp), SAME OUTPUT AS tinyobj + buildIndexedMesh
+// THE FILE IS MEMORY MAPPED AND PARSED IN CHUNKS ON jobs (INLINE WITHOUT WORKERS)
+// CORNERS ARE MERGED BY THEIR POSITION / TEXCOORD INDICES, NOT BY VALUE
+void loadObj(const std::string& path, JobSystem& jobs, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+// HOW THE PIPELINES READ THE VERTEX BUFFER
+// ONE BINDING PER STREAM, offsets[i] IS WHERE BINDING i STARTS IN THE BUFFER
+struct VertexLayout {
+	std::vector<vk::VertexInputBindingDescription> bindings;
+	std::vector<vk::VertexInputAttributeDescription> attributes;
+	std::vector<vk::DeviceSize> offsets;
+
+	// POINTS INTO THIS LAYOUT, KEEP IT ALIVE UNTIL THE PIPELINE IS CREATED
+	vk::PipelineVertexInputStateCreateInfo inputState() const;
+
+	// ONLY LOCATION 0 AND ITS STREAM (AS BINDING 0), FOR THE PASSES THAT ONLY WRITE DEPTH
+	VertexLayout positionOnly() const;
+
+	// LOCATIONS 0 AND 2 AND THEIR STREAMS (FROM BINDING 0), FOR THE DEPTH ONLY PASSES OF A CUTOUT TEXTURE
+	VertexLayout positionAndTexCoord() const;
+};
+
+// EVERYTHING IN Vertex BUT THE POSITION, THE SECOND STREAM OF A SPLIT MESH
+struct VertexAttributes {
+	glm::vec3 color;
+	glm::vec2 texCoord;
+};
+
+// size BYTES FROM data GO TO offset IN THE GPU BUFFER
+struct UploadRange {
+	const void* data;
+	size_t size;
+	vk::DeviceSize offset;
+};
+
+// EVERYTHING NEEDED TO CREATE AND DRAW THE MODEL'S BUFFERS
+// THE RANGES DO NOT OWN THEIR BYTES, WHATEVER THEY POINT INTO
+// HAS TO STAY ALIVE UNTIL THE UPLOAD IS DONE
+struct MeshSource {
+	VertexLayout layout;
+	std::vector<UploadRange> vertexRanges;
+	vk::DeviceSize vertexBufferSize = 0;
+	std::vector<UploadRange> indexRanges;
+	vk::DeviceSize indexBufferSize = 0;
+	vk::IndexType indexType = vk::IndexType::eUint32;
+	uint32_t indexCount = 0;
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+};
+
+// INTERLEAVED Vertex + 32 BIT INDICES, WHAT THE OBJ LOADERS PRODUCE
+MeshSource meshFromVertices(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+// THE SAME VERTICES AS TWO STREAMS: PACKED POSITIONS AT BINDING 0, THE REST AT BINDING 1
+// positions / attributes ARE FILLED HERE AND THE RANGES POINT INTO THEM
+MeshSource meshFromSplitVertices(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, std::vector<glm::vec3>& positions, std::vector<VertexAttributes>& attributes);
+
+// glTF 2.0 BINARY (GlbLoader.cpp)
+// THE FILE STAYS MAPPED AND mesh() POINTS STRAIGHT AT ITS BIN CHUNK, THE VERTEX
+// LAYOUT COMES FROM THE ACCESSORS SO NOTHING IS TOUCHED PER VERTEX
+// ONLY THE FIRST TRIANGLE PRIMITIVE OF THE FIRST MESH IS USED, NODE TRANSFORMS ARE IGNORED
+class GlbFile {
+public:
+	explicit GlbFile(const std::string& path);
+	~GlbFile();
+
+	const MeshSource& mesh() const { return source; }
+
+private:
+	std::unique_ptr<MappedFile> file;
+	// ONLY USED FOR 8 BIT INDICES (VULKAN NEEDS AN EXTENSION FOR THEM) AND NON INDEXED PRIMITIVES
+	std::vector<uint32_t> ownedIndices;
+	MeshSource source;
+};
+
+bool isGlbPath(const std::string& path);
@@ -45,31 +45,62 @@ QueueFamilyIndices VulkanRenderer::findQueueFamilies(const vk::PhysicalDevice &d
 	QueueFamilyIndices indices;
 
 	// GET THE TAGS OF THE QUEUES
-	uint32_t queueFamilyCount = 0;
 	auto queueFamilies = device.getQueueFamilyProperties();
 
-	// VERIFY QUEUES FOR OUR NEEDS
-	int i = 0;
-	for (const auto& queueFamily : queueFamilies) {
-		// CHECK GRAPHICS CAPABILITY
-		if (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) {
+	// GRAPHICS AND PRESENT, THE SAME FAMILY IF ONE CAN DO BOTH
+	for (uint32_t i = 0; i < queueFamilies.size(); i++) {
+		if (queueFamilies[i].queueCount == 0) continue;
+
+		bool graphics = static_cast<bool>(queueFamilies[i].queueFlags & vk::QueueFlagBits::eGraphics);
+		bool present = device.getSurfaceSupportKHR(i, surface);
+		if (graphics && present) {
 			indices.graphicsFamily = i;
+			indices.presentFamily = i;
+			break;
 		}
+		if (graphics && !indices.graphicsFamily) indices.graphicsFamily = i;
+		if (present && !indices.presentFamily) indices.presentFamily = i;
+	}
 
-		// CHECK COMPUTE CAPABILITY
-		if (queueFamily.queueFlags & vk::QueueFlagBits::eCompute) {
-			indices.computeFamily = i;
+	if (!indices.graphicsFamily) {
+		return indices;
+	}
+	uint32_t graphicsFamily = indices.graphicsFamily.value();
+
+	// A COMPUTE FAMILY WITHOUT GRAPHICS RUNS NEXT TO THE GRAPHICS QUEUE (ASYNC COMPUTE)
+	// AND ONE WITH ONLY TRANSFER IS THE COPY ENGINE, UPLOADS THERE DO NOT TAKE GRAPHICS TIME
+	if (dedicatedQueues) {
+		for (uint32_t i = 0; i < queueFamilies.size(); i++) {
+			if (queueFamilies[i].queueCount == 0) continue;
+
+			auto flags = queueFamilies[i].queueFlags;
+			bool graphics = static_cast<bool>(flags & vk::QueueFlagBits::eGraphics);
+			bool compute = static_cast<bool>(flags & vk::QueueFlagBits::eCompute);
+			if (compute && !graphics && !indices.computeFamily) {
+				indices.computeFamily = i;
+			}
+			if ((flags & vk::QueueFlagBits::eTransfer) && !graphics && !compute && !indices.transferFamily) {
+				indices.transferFamily = i;
+			}
 		}
+	}
 
-		// CHECK PRESENTATION CAPABILITy
-		if (queueFamily.queueCount > 0 && device.getSurfaceSupportKHR(i, surface)) {
-			indices.presentFamily = i;
+	// OTHERWISE THE GRAPHICS FAMILY, IT CAN ALWAYS COPY BUT DOES NOT HAVE TO COMPUTE
+	if (!indices.computeFamily) {
+		if (queueFamilies[graphicsFamily].queueFlags & vk::QueueFlagBits::eCompute) {
+			indices.computeFamily = graphicsFamily;
 		}
-
-		if (indices.isComplete()) {
-			break;
+		else {
+			for (uint32_t i = 0; i < queueFamilies.size(); i++) {
+				if (queueFamilies[i].queueCount > 0 && (queueFamilies[i].queueFlags & vk::QueueFlagBits::eCompute)) {
+					indices.computeFamily = i;
+					break;
+				}
+			}
 		}
-		i++;
+	}
+	if (!indices.transferFamily) {
+		indices.transferFamily = graphicsFamily;
 	}
 	return indices;
 }
@@ -88,6 +119,15 @@ bool VulkanRenderer::checkDeviceExtensionSupport(const vk::PhysicalDevice &devic
 	return requiredExtensions.empty();
 }
 
+bool VulkanRenderer::isDeviceExtensionAvailable(const vk::PhysicalDevice& device, const char* name) {
+	for (const auto& extension : device.enumerateDeviceExtensionProperties()) {
+		if (std::strcmp(extension.extensionName, name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
 uint32_t VulkanRenderer::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) {
 	// GET MEMORY PROPRIETIES
 	auto  memProperties = physicalDevice.getMemoryProperties();
@@ -109,15 +149,18 @@ void VulkanRenderer::createImage(
 	vk::ImageUsageFlags usage, 
 	vk::MemoryPropertyFlags properties, 
 	vk::Image& image, 
-	vk::DeviceMemory& imageMemory) {
+	vk::DeviceMemory& imageMemory,
+	uint32_t mipLevels,
+	uint32_t arrayLayers,
+	const std::vector<uint32_t>& sharedFamilies) {
 
 	vk::ImageCreateInfo imageInfo;
 	imageInfo.imageType = vk::ImageType::e2D;
 	imageInfo.extent.width = width;
 	imageInfo.extent.height = height;
 	imageInfo.extent.depth = 1;
-	imageInfo.mipLevels = 1;
-	imageInfo.arrayLayers = 1;
+	imageInfo.mipLevels = mipLevels;
+	imageInfo.arrayLayers = arrayLayers;
 	imageInfo.format = format;
 	imageInfo.tiling = tiling;
 	// INITIAL LAYOUT UNDEFINED SO YOU CAN TRANSITION 
@@ -125,7 +168,15 @@ void VulkanRenderer::createImage(
 	imageInfo.initialLayout = vk::ImageLayout::eUndefined;
 	imageInfo.usage = usage;
 	imageInfo.samples = vk::SampleCountFlagBits::e1;
-	imageInfo.sharingMode = vk::SharingMode::eExclusive;
+	// USED BY MORE THAN ONE QUEUE FAMILY WITHOUT OWNERSHIP TRANSFERS (SEE uploadQueueFamilies)
+	if (sharedFamilies.size() > 1) {
+		imageInfo.sharingMode = vk::SharingMode::eConcurrent;
+		imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(sharedFamilies.size());
+		imageInfo.pQueueFamilyIndices = sharedFamilies.data();
+	}
+	else {
+		imageInfo.sharingMode = vk::SharingMode::eExclusive;
+	}
 
 	try {
 		image = device->createImage(imageInfo);
@@ -150,21 +201,22 @@ void VulkanRenderer::createImage(
 	catch (vk::SystemError err) {
 		throw(std::runtime_error("failed to create Image!"));
 	}
+	memoryTracker.recordAllocation(imageMemory, allocInfo.allocationSize, allocInfo.memoryTypeIndex, categorizeImage(usage));
 
 	// THIRD PARAMETER IS OFFSET FROM MEM ADRESS
 	device->bindImageMemory(image, imageMemory, 0);
 }
 
-vk::ImageView VulkanRenderer::createImageView(vk::Image image, vk::Format format, vk::ImageAspectFlags aspectFlags) {
+vk::ImageView VulkanRenderer::createImageView(vk::Image image, vk::Format format, vk::ImageAspectFlags aspectFlags, uint32_t baseMipLevel, uint32_t levelCount, vk::ImageViewType viewType, uint32_t baseArrayLayer, uint32_t layerCount) {
 	vk::ImageViewCreateInfo viewInfo;
 	viewInfo.image = image;
-	viewInfo.viewType = vk::ImageViewType::e2D;
+	viewInfo.viewType = viewType;
 	viewInfo.format = format;
 	viewInfo.subresourceRange.aspectMask = aspectFlags;
-	viewInfo.subresourceRange.baseMipLevel = 0;
-	viewInfo.subresourceRange.levelCount = 1;
-	viewInfo.subresourceRange.baseArrayLayer = 0;
-	viewInfo.subresourceRange.layerCount = 1;
+	viewInfo.subresourceRange.baseMipLevel = baseMipLevel;
+	viewInfo.subresourceRange.levelCount = levelCount;
+	viewInfo.subresourceRange.baseArrayLayer = baseArrayLayer;
+	viewInfo.subresourceRange.layerCount = layerCount;
 
 	vk::ImageView imageView;
 
@@ -183,11 +235,19 @@ void VulkanRenderer::createBuffer(
 	vk::BufferUsageFlags usage,
 	vk::MemoryPropertyFlags properties, 
 	vk::Buffer& buffer, 
-	vk::DeviceMemory& bufferMemory) {
+	vk::DeviceMemory& bufferMemory,
+	const std::vector<uint32_t>& sharedFamilies) {
 	vk::BufferCreateInfo bufferInfo;
 	bufferInfo.size = size;
 	bufferInfo.usage = usage;
-	bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+	if (sharedFamilies.size() > 1) {
+		bufferInfo.sharingMode = vk::SharingMode::eConcurrent;
+		bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(sharedFamilies.size());
+		bufferInfo.pQueueFamilyIndices = sharedFamilies.data();
+	}
+	else {
+		bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+	}
 
 	try {
 		buffer = device->createBuffer(bufferInfo);
@@ -207,9 +267,119 @@ void VulkanRenderer::createBuffer(
 	catch (vk::SystemError err) {
 		throw std::runtime_error("failed to allocate buffer memory!");
 	}
+	memoryTracker.recordAllocation(bufferMemory, allocInfo.allocationSize, allocInfo.memoryTypeIndex, categorizeBuffer(usage));
 	device->bindBufferMemory(buffer, bufferMemory, 0);
 }
 
+void VulkanRenderer::freeMemory(vk::DeviceMemory memory) {
+	// EVERY FREE GOES THROUGH HERE SO THE STATISTICS STAY RIGHT
+	memoryTracker.recordFree(memory);
+	device->freeMemory(memory);
+}
+
+void VulkanRenderer::destroyGpuResource(const GpuResource& resource) {
+	device->destroyImageView(resource.view);
+	device->destroyImage(resource.image);
+	device->destroyBuffer(resource.buffer);
+	if (resource.allocation) {
+		memoryPool.free(resource.allocation);
+	}
+	else {
+		freeMemory(resource.memory);
+	}
+}
+
+void VulkanRenderer::createPooledBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, uint64_t owner, GpuResource& resource, const PoolAllocation& at) {
+	// WRITTEN ON THE TRANSFER QUEUE AND READ ON THE GRAPHICS ONE, LIKE EVERY UPLOAD
+	std::vector<uint32_t> sharedFamilies = uploadQueueFamilies();
+
+	vk::BufferCreateInfo bufferInfo;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	if (sharedFamilies.size() > 1) {
+		bufferInfo.sharingMode = vk::SharingMode::eConcurrent;
+		bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(sharedFamilies.size());
+		bufferInfo.pQueueFamilyIndices = sharedFamilies.data();
+	}
+	else {
+		bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+	}
+
+	try {
+		resource.buffer = device->createBuffer(bufferInfo);
+	}
+	catch (vk::SystemError err) {
+		throw(std::runtime_error("failed to create buffer!"));
+	}
+
+	// THE SAME CREATE INFO GIVES THE SAME REQUIREMENTS, SO A RESERVED RANGE ALWAYS FITS
+	if (at) {
+		resource.allocation = at;
+	}
+	else {
+		auto memRequirements = device->getBufferMemoryRequirements(resource.buffer);
+		uint32_t memoryType = findMemoryType(memRequirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+		resource.allocation = memoryPool.allocate(memRequirements, memoryType, categorizeBuffer(usage), owner);
+	}
+	device->bindBufferMemory(resource.buffer, resource.allocation.memory, resource.allocation.offset);
+	resource.bufferUsage = usage;
+}
+
+void VulkanRenderer::createPooledImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageUsageFlags usage, uint64_t owner, GpuResource& resource, const PoolAllocation& at) {
+	std::vector<uint32_t> sharedFamilies = uploadQueueFamilies();
+
+	vk::ImageCreateInfo imageInfo;
+	imageInfo.imageType = vk::ImageType::e2D;
+	imageInfo.extent.width = width;
+	imageInfo.extent.height = height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = format;
+	imageInfo.tiling = vk::ImageTiling::eOptimal;
+	imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+	imageInfo.usage = usage;
+	imageInfo.samples = vk::SampleCountFlagBits::e1;
+	if (sharedFamilies.size() > 1) {
+		imageInfo.sharingMode = vk::SharingMode::eConcurrent;
+		imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(sharedFamilies.size());
+		imageInfo.pQueueFamilyIndices = sharedFamilies.data();
+	}
+	else {
+		imageInfo.sharingMode = vk::SharingMode::eExclusive;
+	}
+
+	try {
+		resource.image = device->createImage(imageInfo);
+	}
+	catch (vk::SystemError err) {
+		throw(std::runtime_error("failed to create Image!"));
+	}
+
+	if (at) {
+		resource.allocation = at;
+	}
+	else {
+		auto memRequirements = device->getImageMemoryRequirements(resource.image);
+		uint32_t memoryType = findMemoryType(memRequirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+		resource.allocation = memoryPool.allocate(memRequirements, memoryType, categorizeImage(usage), owner);
+	}
+	device->bindImageMemory(resource.image, resource.allocation.memory, resource.allocation.offset);
+	resource.imageUsage = usage;
+	resource.format = format;
+	resource.extent = vk::Extent2D(width, height);
+}
+
+void VulkanRenderer::writeMemoryReport(const std::string& path) {
+	std::ofstream file(path);
+	if (!file) {
+		std::cout << "memory: could not write " << path << "\n";
+		return;
+	}
+	memoryTracker.writeJson(file);
+	std::cout << "memory: statistics written to " << path << "\n";
+}
+
 vk::Format VulkanRenderer::findSupportedFormat(const std::vector<vk::Format>& candidates, vk::ImageTiling tiling, vk::FormatFeatureFlags features) {
 	// CHECK FOR OPTIMAL FORMAT
 	for (vk::Format format : candidates) {
@@ -234,24 +404,6 @@ vk::Format VulkanRenderer::findDepthFormat() {
 	);
 }
 
-std::vector<char> readFile(const std::string& filename) {
-	std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-	if (!file.is_open()) {
-		throw std::runtime_error("failed to open file!");
-	}
-
-	size_t fileSize = (size_t)file.tellg();
-	std::vector<char> buffer(fileSize);
-
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
-
-	file.close();
-
-	return buffer;
-}
-
 vk::ShaderModule VulkanRenderer::createShaderModule(const std::vector<char>& code) {
 	vk::ShaderModuleCreateInfo createInfo;
 	createInfo.codeSize = code.size();
@@ -271,7 +423,7 @@ vk::ShaderModule VulkanRenderer::createShaderModule(const std::vector<char>& cod
 }
 
 void VulkanRenderer::transitionImageLayout(vk::Image image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout) {
-	vk::CommandBuffer commandBuffer = beginSingleTimeCommands();
+	vk::CommandBuffer commandBuffer = beginTransferCommands();
 
 	vk::ImageMemoryBarrier barrier;
 	barrier.oldLayout = oldLayout;
@@ -301,11 +453,13 @@ void VulkanRenderer::transitionImageLayout(vk::Image image, vk::Format format, v
 		destinationStage = vk::PipelineStageFlagBits::eTransfer;
 	}
 	else if (oldLayout == vk::ImageLayout::eTransferDstOptimal && newLayout == vk::ImageLayout::eShaderReadOnlyOptimal) {
+		// THE TRANSFER QUEUE HAS NO SHADER STAGES, SO ONLY MAKE THE WRITE AVAILABLE
+		// THE WAIT IN endTransferCommands COMES BEFORE ANY GRAPHICS SUBMIT THAT READS IT
 		barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-		barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+		barrier.dstAccessMask = {};
 
 		sourceStage = vk::PipelineStageFlagBits::eTransfer;
-		destinationStage = vk::PipelineStageFlagBits::eFragmentShader;
+		destinationStage = vk::PipelineStageFlagBits::eBottomOfPipe;
 	}
 	else {
 		throw std::invalid_argument("unsupported layout transition!");
@@ -318,15 +472,46 @@ void VulkanRenderer::transitionImageLayout(vk::Image image, vk::Format format, v
 		1, &barrier);
 
 
-	endSingleTimeCommands(commandBuffer);
+	endTransferCommands(commandBuffer);
 }
 
 // CREATION OF SMALL COMMAND BUFFERS
 
 vk::CommandBuffer VulkanRenderer::beginSingleTimeCommands() {
+	return beginOneTimeCommands(commandPool);
+}
+
+void VulkanRenderer::endSingleTimeCommands(vk::CommandBuffer commandBuffer) {
+	submitOneTimeCommands(commandBuffer, commandPool, graphicsQueue);
+}
+
+vk::CommandBuffer VulkanRenderer::beginTransferCommands() {
+	return beginOneTimeCommands(transferCommandPool);
+}
+
+void VulkanRenderer::endTransferCommands(vk::CommandBuffer commandBuffer) {
+	submitOneTimeCommands(commandBuffer, transferCommandPool, transferQueue);
+}
+
+std::mutex& VulkanRenderer::queueMutex(vk::Queue queue) {
+	// FAMILIES THAT FELL BACK TO GRAPHICS GOT THE SAME vk::Queue, SO THEY GET THE SAME LOCK
+	if (queue == graphicsQueue) return graphicsQueueMutex;
+	if (queue == computeQueue) return computeQueueMutex;
+	return transferQueueMutex;
+}
+
+std::vector<uint32_t> VulkanRenderer::uploadQueueFamilies() {
+	// EMPTY WHEN THE COPIES RUN ON THE GRAPHICS FAMILY, THE RESOURCE STAYS EXCLUSIVE
+	if (queueFamilies.transferFamily == queueFamilies.graphicsFamily) {
+		return {};
+	}
+	return { queueFamilies.graphicsFamily.value(), queueFamilies.transferFamily.value() };
+}
+
+vk::CommandBuffer VulkanRenderer::beginOneTimeCommands(vk::CommandPool pool) {
 	vk::CommandBufferAllocateInfo allocInfo;
 	allocInfo.level = vk::CommandBufferLevel::ePrimary;
-	allocInfo.commandPool = commandPool;
+	allocInfo.commandPool = pool;
 	allocInfo.commandBufferCount = 1;
 
 
@@ -340,22 +525,25 @@ vk::CommandBuffer VulkanRenderer::beginSingleTimeCommands() {
 	return commandBuffer;
 }
 
-void VulkanRenderer::endSingleTimeCommands(vk::CommandBuffer commandBuffer) {
+void VulkanRenderer::submitOneTimeCommands(vk::CommandBuffer commandBuffer, vk::CommandPool pool, vk::Queue queue) {
 	commandBuffer.end();
 
 	vk::SubmitInfo submitInfo;
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffer;
 
-	graphicsQueue.submit(1, &submitInfo, vk::Fence());
-
-	graphicsQueue.waitIdle();
+	// THE STARTUP JOBS SUBMIT FROM DIFFERENT THREADS AND A QUEUE IS NOT THREAD SAFE
+	{
+		std::lock_guard<std::mutex> lock(queueMutex(queue));
+		queue.submit(1, &submitInfo, vk::Fence());
+		queue.waitIdle();
+	}
 
-	device->freeCommandBuffers(commandPool, 1, &commandBuffer);
+	device->freeCommandBuffers(pool, 1, &commandBuffer);
 }
 
 void VulkanRenderer::copyBufferToImage(vk::Buffer buffer, vk::Image image, uint32_t width, uint32_t height) {
-	vk::CommandBuffer commandBuffer = beginSingleTimeCommands();
+	vk::CommandBuffer commandBuffer = beginTransferCommands();
 
 	vk::BufferImageCopy region;
 	region.bufferOffset = 0;
@@ -382,11 +570,11 @@ void VulkanRenderer::copyBufferToImage(vk::Buffer buffer, vk::Image image, uint3
 		&region
 	);
 
-	endSingleTimeCommands(commandBuffer);
+	endTransferCommands(commandBuffer);
 }
 
 void VulkanRenderer::copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size) {
-	vk::CommandBuffer commandBuffer = beginSingleTimeCommands();
+	vk::CommandBuffer commandBuffer = beginTransferCommands();
 
 	vk::BufferCopy copyRegion{};
 	copyRegion.size = size;
@@ -398,15 +586,22 @@ void VulkanRenderer::copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::
 		&copyRegion
 	);
 
-	endSingleTimeCommands(commandBuffer);
+	endTransferCommands(commandBuffer);
 }
 
 void VulkanRenderer::recreateSwapChain() {
+	PROFILE_FUNCTION();
 	// For window resize
+	// WE ARE ON THE RENDER THREAD SO THE SIZE COMES FROM THE MAIN THREAD
 	int width = 0, height = 0;
 	while (width == 0 || height == 0) {
-		glfwGetFramebufferSize(window, &width, &height);
-		glfwWaitEvents();
+		width = framebufferWidth.load(std::memory_order_relaxed);
+		height = framebufferHeight.load(std::memory_order_relaxed);
+		if (width == 0 || height == 0) {
+			// MINIMIZED, NOTHING TO RECREATE IF WE ARE SHUTTING DOWN
+			if (!running.load(std::memory_order_acquire)) return;
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
 	}
 
 	device->waitIdle();
@@ -417,11 +612,22 @@ void VulkanRenderer::recreateSwapChain() {
 	createImageViews();
 	createRenderPass();
 	createGraphicsPipeline();
+	createDepthPrepassPipeline();
+	createParticleRenderPipeline();
 	createDepthResources();
+	createRenderTarget();
 	createFramebuffers();
+	createDepthPrepassFramebuffer();
+	createHiZResources();
 	createUniformBuffers();
+	createClusterBuffers();
+	createDrawBuffers();
+	createShadowBuffers();
+	createParticleBuffers();
+	createPostResources();
 	createDescriptorPool();
 	createDescriptorSets();
+	createTimestampQueries();
 	createCommandBuffers();
 }
 
@@ -429,20 +635,29 @@ void VulkanRenderer::cleanupSwapChain() {
 	// DESTROY DEPTH BUFFER
 	device->destroyImageView(depthImageView, nullptr);
 	device->destroyImage(depthImage, nullptr);
-	device->freeMemory(depthImageMemory, nullptr);
+	freeMemory(depthImageMemory);
+
+	destroyRenderTarget();
+	destroyTimestampQueries();
+	destroyPostResources();
 
 	// Clean the swapchain for resize
 	for (size_t i = 0; i < swapChainFramebuffers.size(); i++) {
 		device->destroyFramebuffer(swapChainFramebuffers[i], nullptr);
 	}
 
+	if (depthPrepass) {
+		device->destroyFramebuffer(depthPrepassFramebuffer, nullptr);
+		device->destroyPipeline(depthPrepassPipeline, nullptr);
+	}
+	destroyHiZResources();
+
 	// Clean descriptor pool
 	device->destroyDescriptorPool(descriptorPool, nullptr);
 
 	device->freeCommandBuffers(commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
 
-	device->destroyPipeline(graphicsPipeline, nullptr);
-	device->destroyPipelineLayout(pipelineLayout, nullptr);
+	// THE MAIN PIPELINE AND ITS LAYOUT STAY, shaderVariants GIVES IT BACK IF NOTHING CHANGED
 	device->destroyRenderPass(renderPass, nullptr);
 
 	for (size_t i = 0; i < swapChainImageViews.size(); i++) {
@@ -454,23 +669,65 @@ void VulkanRenderer::cleanupSwapChain() {
 	// CLEAN THE UNIFORM BUFFER
 	for (size_t i = 0; i < swapChainImages.size(); i++) {
 		device->destroyBuffer(uniformBuffers[i], nullptr);
-		device->freeMemory(uniformBuffersMemory[i], nullptr);
+		freeMemory(uniformBuffersMemory[i]);
 	}
+
+	destroyClusterBuffers();
+	destroyDrawBuffers();
+	destroyShadowBuffers();
+	destroyParticleBuffers();
 }
 
 void VulkanRenderer::updateUniformBuffer(uint32_t currentImage) {
-	// CHECK THE TIME
-	float currentFrame = glfwGetTime();
-	deltaTime = currentFrame - lastFrame;
-	lastFrame = currentFrame;
+	PROFILE_FUNCTION();
+	// EVERYTHING COMES FROM THE SIMULATION SNAPSHOT
+	const FrameSnapshot& snapshot = frameSnapshot;
 	// MODEL TRANSFORM
 	UniformBufferObject ubo{};
 	ubo.model = glm::identity<glm::mat4>();
-	ubo.model = glm::rotate(glm::mat4(1.0f), glm::radians(pitch), /* glm::vec3(0.0f, 0.0f, 1.0f) */ glm::normalize(glm::cross(cameraFront, cameraUp)));
-	ubo.model = glm::rotate(ubo.model, glm::radians(yaw), /* glm::vec3(0.0f, 1.0f, 0.0f) */ cameraUp);
-	ubo.view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
-	ubo.proj = glm::perspective(glm::radians(fov), swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 10.0f);
+	ubo.model = glm::rotate(glm::mat4(1.0f), glm::radians(snapshot.pitch), /* glm::vec3(0.0f, 0.0f, 1.0f) */ glm::normalize(glm::cross(snapshot.cameraFront, snapshot.cameraUp)));
+	ubo.model = glm::rotate(ubo.model, glm::radians(snapshot.yaw), /* glm::vec3(0.0f, 1.0f, 0.0f) */ snapshot.cameraUp);
+	ubo.view = glm::lookAt(snapshot.cameraPos, snapshot.cameraPos + snapshot.cameraFront, snapshot.cameraUp);
+	ubo.proj = glm::perspective(glm::radians(snapshot.fov), viewExtent.width / (float)viewExtent.height, nearPlane, farPlane);
 	ubo.proj[1][1] *= -1;
+
+	// THE VERTEX SHADER DRAWS WITH THE PER VIEW MATRICES, IN STEREO view / proj
+	// TURN INTO A CAMERA THAT SEES WHAT BOTH EYES SEE
+	float cullNear, cullFar;
+	updateViews(snapshot, ubo, cullNear, cullFar);
+
+	// CLUSTER GRID FOR THE LIGHTING, BUILT FROM THE SAME PROJECTION
+	ubo.inverseProj = glm::inverse(ubo.proj);
+	ubo.cameraPosition = glm::vec4(snapshot.cameraPos, 1.0f);
+	ubo.clusterGrid = glm::uvec4(clusterGrid, static_cast<uint32_t>(lights.size()));
+	// THE TILES COVER WHAT IS ACTUALLY RENDERED, NOT THE WHOLE TARGET
+	ubo.clusterScreen = glm::vec4(
+		static_cast<float>(renderExtent.width),
+		static_cast<float>(renderExtent.height),
+		static_cast<float>((renderExtent.width + clusterGrid.x - 1) / clusterGrid.x),
+		static_cast<float>((renderExtent.height + clusterGrid.y - 1) / clusterGrid.y));
+	float depthScale = static_cast<float>(clusterGrid.z) / std::log(cullFar / cullNear);
+	ubo.clusterDepth = glm::vec4(cullNear, cullFar, depthScale, depthScale * std::log(cullNear));
+
+	// STREAMING ONLY ADDS AND REMOVES OBJECTS, IT NEVER WAITS FOR A LOAD
+	worldPartition.update(snapshot.cameraPos, cullingScene);
+
+	// FRUSTUM CULLING ON THE SAME MATRICES THE SHADER GETS
+	cullingScene.setWorld(modelObject, ubo.model);
+	visibleObjects.clear();
+	{
+		PROFILE_ZONE("frustum cull");
+		cullingScene.cull(Frustum::fromViewProjection(ubo.proj * ubo.view), cullShape, visibleObjects);
+	}
+	ubo.cullInfo = glm::uvec4(std::min<size_t>(visibleObjects.size(), MAX_DRAW_OBJECTS), hiZMipCount, hiZExtent.width, hiZExtent.height);
+	ubo.renderScale = glm::vec4(
+		renderExtent.width / static_cast<float>(viewExtent.width),
+		renderExtent.height / static_cast<float>(viewExtent.height),
+		0.0f, 0.0f);
+
+	// SUN AND SHADOW CASCADES, AFTER THE WORLD UPDATE SO THE CASTERS ARE CURRENT
+	updateShadows(currentImage, ubo);
+
 	// Copy data
 	auto data = device->mapMemory(uniformBuffersMemory[currentImage], 0, sizeof(ubo));
 	memcpy(data, &ubo, sizeof(ubo));
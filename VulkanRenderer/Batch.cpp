@@ -0,0 +1,517 @@
+#include "VulkanRenderer.h"
+#include "SoftwareRasterizer.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+// BATCH RENDERING
+// WITH --batch=<job list> NOTHING IS PRESENTED, THE WINDOW STAYS HIDDEN AND EVERY JOB
+// (A MODEL AND A CAMERA) IS RENDERED ONCE AND WRITTEN AS A PNG INTO batchOutput.
+// THE FRAME SLOTS (ONE PER SWAPCHAIN IMAGE, SO --swapchain-images SETS HOW MANY)
+// ARE A RING: EVERY SLOT HAS ITS OWN COMMAND BUFFER, UNIFORMS AND A HOST VISIBLE
+// READBACK BUFFER THE COMMAND BUFFER COPIES THE FINISHED IMAGE INTO. A JOB IS
+// SUBMITTED BEFORE WE WAIT FOR THE ONE BEFORE IT, WHICH IS THEN ENCODED ON THE JOB
+// SYSTEM, SO THE GPU DRAWS JOB N+1 WHILE THE WORKERS READ BACK AND ENCODE JOB N.
+// A SLOT IS ONLY USED AGAIN ONCE THE PNG OF ITS LAST JOB HAS BEEN WRITTEN
+//
+// JOB LIST, ONE JOB PER LINE, MODEL PATHS ARE RELATIVE TO THE LIST, # STARTS A COMMENT:
+//   <model> <eye x> <eye y> <eye z> <target x> <target y> <target z> [fov]
+// THE IMAGE OF THE JOB ON LINE N (COUNTING JOBS ONLY) IS <batchOutput>/<N>.png
+//
+// THE JOBS ARE SORTED BY MODEL SO EVERY MODEL IS LOADED ONCE. --batch-churn=P RUNS THE LIST
+// P TIMES IN ITS OWN ORDER INSTEAD (PASS p WRITES <N + p * JOBS>.png), SO THE MODEL CHANGES
+// FROM JOB TO JOB. WITH A SMALL --resource-budget THAT EVICTS AND UPLOADS MODELS ALL THE TIME,
+// WHICH IS THE LOAD THE DEFRAGMENTATION IS FOR: THE POOL IS COMPACTED AFTER EVERY SWITCH AND
+// ITS STATS ARE PRINTED BEFORE AND AFTER THE RUN (COMPARE WITH --no-defrag)
+//
+// WITHOUT A VULKAN DEVICE (OR WITH --software) runSoftwareBatch DRAWS THE SAME JOBS WITH
+// SoftwareRasterizer INTO THE SAME FILES. ONLY THE MODEL IS DRAWN, NO SHADOWS AND NO WORLD
+
+namespace {
+
+struct BatchJob {
+	// POSITION IN THE LIST, NAMES THE OUTPUT
+	size_t index;
+	std::string model;
+	glm::vec3 eye;
+	glm::vec3 target;
+	float fov;
+};
+
+std::vector<BatchJob> loadBatchJobs(const std::string& path, float defaultFov) {
+	std::ifstream file(path);
+	if (!file) {
+		throw std::runtime_error("failed to open batch job list " + path + "!");
+	}
+
+	std::filesystem::path directory = std::filesystem::path(path).parent_path();
+	std::vector<BatchJob> jobs;
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		std::istringstream words(line);
+		std::string model;
+		if (!(words >> model) || model[0] == '#') continue;
+
+		BatchJob job;
+		job.index = jobs.size();
+		job.model = std::filesystem::path(model).is_absolute() ? model : (directory / model).string();
+		if (!(words >> job.eye.x >> job.eye.y >> job.eye.z >> job.target.x >> job.target.y >> job.target.z)) {
+			throw std::runtime_error("failed to read batch job list " + path + ", bad camera on line " + std::to_string(lineNumber) + "!");
+		}
+		if (!(words >> job.fov)) {
+			job.fov = defaultFov;
+		}
+		jobs.push_back(job);
+	}
+	return jobs;
+}
+
+// THE POSITIONS AND TEXTURE COORDINATES OUT OF THE BUFFERS THE GPU WOULD GET
+// ATTRIBUTES THAT ARE NOT PLAIN FLOATS ARE LEFT AT ZERO
+SoftwareMesh softwareMeshFromSource(const MeshSource& source) {
+	std::vector<uint8_t> vertexData(source.vertexBufferSize);
+	for (const auto& range : source.vertexRanges) {
+		std::memcpy(vertexData.data() + range.offset, range.data, range.size);
+	}
+	std::vector<uint8_t> indexData(source.indexBufferSize);
+	for (const auto& range : source.indexRanges) {
+		std::memcpy(indexData.data() + range.offset, range.data, range.size);
+	}
+
+	SoftwareMesh result;
+	result.indices.resize(source.indexCount);
+	uint32_t vertexCount = 0;
+	for (uint32_t i = 0; i < source.indexCount; i++) {
+		if (source.indexType == vk::IndexType::eUint16) {
+			uint16_t index;
+			std::memcpy(&index, indexData.data() + i * sizeof(uint16_t), sizeof(index));
+			result.indices[i] = index;
+		}
+		else {
+			std::memcpy(&result.indices[i], indexData.data() + i * sizeof(uint32_t), sizeof(uint32_t));
+		}
+		vertexCount = std::max(vertexCount, result.indices[i] + 1);
+	}
+
+	result.positions.assign(vertexCount, glm::vec3(0.0f));
+	result.texCoords.assign(vertexCount, glm::vec2(0.0f));
+	for (const auto& attribute : source.layout.attributes) {
+		const auto& binding = source.layout.bindings[attribute.binding];
+		vk::DeviceSize start = source.layout.offsets[attribute.binding] + attribute.offset;
+
+		// MUST MATCH Vertex.vert
+		if (attribute.location == 0 && attribute.format == vk::Format::eR32G32B32Sfloat) {
+			for (uint32_t i = 0; i < vertexCount; i++) {
+				std::memcpy(&result.positions[i], vertexData.data() + start + static_cast<vk::DeviceSize>(i) * binding.stride, sizeof(glm::vec3));
+			}
+		}
+		else if (attribute.location == 2 && attribute.format == vk::Format::eR32G32Sfloat) {
+			for (uint32_t i = 0; i < vertexCount; i++) {
+				std::memcpy(&result.texCoords[i], vertexData.data() + start + static_cast<vk::DeviceSize>(i) * binding.stride, sizeof(glm::vec2));
+			}
+		}
+	}
+	return result;
+}
+
+}
+
+void VulkanRenderer::createBatchResources() {
+	if (!batchMode()) return;
+
+	// PNG IS 8 BITS PER CHANNEL, BGRA IS SWIZZLED WHILE ENCODING
+	if (swapChainImageFormat != vk::Format::eB8G8R8A8Srgb && swapChainImageFormat != vk::Format::eB8G8R8A8Unorm &&
+		swapChainImageFormat != vk::Format::eR8G8B8A8Srgb && swapChainImageFormat != vk::Format::eR8G8B8A8Unorm) {
+		throw std::runtime_error("batch: can not write " + vk::to_string(swapChainImageFormat) + " images as PNG!");
+	}
+
+	vk::DeviceSize imageSize = static_cast<vk::DeviceSize>(viewExtent.width) * viewExtent.height * 4;
+
+	readbackBuffers.resize(swapChainImages.size());
+	readbackBuffersMemory.resize(swapChainImages.size());
+	readbackData.resize(swapChainImages.size());
+	batchFences.resize(swapChainImages.size());
+
+	for (size_t i = 0; i < swapChainImages.size(); i++) {
+		// CACHED SO THE WORKERS READ IT AT FULL SPEED, NON COHERENT IS HANDLED BY THE INVALIDATE IN runBatch
+		createBuffer(imageSize, vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached, readbackBuffers[i], readbackBuffersMemory[i]);
+		// STAYS MAPPED UNTIL CLEANUP
+		readbackData[i] = device->mapMemory(readbackBuffersMemory[i], 0, VK_WHOLE_SIZE);
+
+		try {
+			batchFences[i] = device->createFence(vk::FenceCreateInfo());
+		}
+		catch (vk::SystemError err) {
+			throw std::runtime_error("failed to create batch fence!");
+		}
+	}
+
+	try {
+		defragFence = device->createFence(vk::FenceCreateInfo());
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to create defragmentation fence!");
+	}
+}
+
+void VulkanRenderer::destroyBatchResources() {
+	for (size_t i = 0; i < readbackBuffers.size(); i++) {
+		device->unmapMemory(readbackBuffersMemory[i]);
+		device->destroyBuffer(readbackBuffers[i]);
+		freeMemory(readbackBuffersMemory[i]);
+		device->destroyFence(batchFences[i]);
+	}
+	readbackBuffers.clear();
+	readbackBuffersMemory.clear();
+	readbackData.clear();
+	batchFences.clear();
+
+	if (defragFence) {
+		device->destroyFence(defragFence);
+		defragFence = nullptr;
+	}
+}
+
+void VulkanRenderer::recordReadback(vk::CommandBuffer commandBuffer, size_t image) {
+	// THE RENDER PASS LEFT sceneColorImage IN TRANSFER SRC, WAIT FOR ITS WRITES
+	vk::ImageMemoryBarrier sceneBarrier;
+	sceneBarrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+	sceneBarrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+	sceneBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	sceneBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	sceneBarrier.image = sceneColorImage;
+	sceneBarrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+	sceneBarrier.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+	sceneBarrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer,
+		{},
+		0, nullptr,
+		0, nullptr,
+		1, &sceneBarrier);
+
+	// TIGHTLY PACKED ROWS
+	vk::BufferImageCopy region;
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+	region.imageOffset = vk::Offset3D(0, 0, 0);
+	region.imageExtent = vk::Extent3D(viewExtent.width, viewExtent.height, 1);
+
+	commandBuffer.copyImageToBuffer(sceneColorImage, vk::ImageLayout::eTransferSrcOptimal, readbackBuffers[image], 1, &region);
+
+	// MAKES THE COPY VISIBLE TO THE HOST ONCE THE FENCE SIGNALS
+	vk::BufferMemoryBarrier hostBarrier;
+	hostBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	hostBarrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+	hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.buffer = readbackBuffers[image];
+	hostBarrier.offset = 0;
+	hostBarrier.size = VK_WHOLE_SIZE;
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+		{},
+		0, nullptr,
+		1, &hostBarrier,
+		0, nullptr);
+}
+
+void VulkanRenderer::switchBatchModel(const std::string& path) {
+	PROFILE_FUNCTION();
+	// THE COMMAND BUFFERS BIND THE OLD BUFFERS AND THE PIPELINE ITS VERTEX LAYOUT
+	device->waitIdle();
+
+	cullingScene.remove(modelObject);
+	vertices.clear();
+	indices.clear();
+	MODEL_PATH = path;
+	loadModel();
+	// THROUGH THE RESOURCE CACHE, A MODEL THAT COMES BACK IS NOT UPLOADED AGAIN
+	createVertexBuffer();
+	createIndexBuffer();
+
+	// MODELS WITH THE SAME VERTEX LAYOUT SHARE THE PIPELINE VARIANT
+	createGraphicsPipeline();
+	// THE DEPTH ONLY PASSES READ depthPassLayout(), WHICH CHANGES WITH THE FILE TYPE TOO
+	if (depthPrepass) {
+		device->destroyPipeline(depthPrepassPipeline);
+		createDepthPrepassPipeline();
+	}
+	if (shadows) {
+		device->destroyPipeline(shadowPipeline);
+		device->destroyPipelineLayout(shadowPipelineLayout);
+		createShadowPipeline();
+	}
+
+	// NOTHING IS IN FLIGHT, THE BEST TIME TO COMPACT WHAT THE LAST MODELS LEFT BEHIND
+	// IF ANYTHING MOVED EVERY SLOT WAS ALREADY RECORDED AGAIN WITH THE COPIES
+	if (defragmentIdle()) {
+		return;
+	}
+	for (size_t i = 0; i < commandBuffers.size(); i++) {
+		recordCommandBuffer(i);
+	}
+}
+
+void VulkanRenderer::runBatch() {
+	using Clock = std::chrono::steady_clock;
+
+	std::vector<BatchJob> jobs = loadBatchJobs(batchPath, fov);
+	if (batchChurn > 0) {
+		// THE LIST OVER AND OVER IN ITS OWN ORDER, A NEW MODEL FOR (ALMOST) EVERY JOB
+		std::vector<BatchJob> listed = jobs;
+		jobs.clear();
+		for (uint32_t pass = 0; pass < batchChurn; pass++) {
+			for (BatchJob job : listed) {
+				job.index += pass * listed.size();
+				jobs.push_back(job);
+			}
+		}
+	}
+	else {
+		// EVERY MODEL IS LOADED ONCE, THE OUTPUT NAMES KEEP THE LIST ORDER
+		std::stable_sort(jobs.begin(), jobs.end(), [](const BatchJob& a, const BatchJob& b) {
+			return a.model < b.model;
+		});
+	}
+	std::filesystem::create_directories(batchOutput);
+
+	std::cout << "batch: before the jobs\n";
+	memoryPool.report(std::cout);
+
+	size_t slots = commandBuffers.size();
+	uint32_t width = viewExtent.width;
+	uint32_t height = viewExtent.height;
+	bool bgra = swapChainImageFormat == vk::Format::eB8G8R8A8Srgb || swapChainImageFormat == vk::Format::eB8G8R8A8Unorm;
+
+	// PNGS STILL BEING WRITTEN FROM EACH SLOT'S READBACK BUFFER
+	std::vector<JobCounter> encoding(slots);
+	std::string currentModel = MODEL_PATH;
+	// THE LAST FRAME WE KNOW THE GPU FINISHED, FOR THE RESOURCE CACHE
+	uint64_t completedFrame = frameNumber;
+
+	// HANDS A FINISHED SLOT TO THE WORKERS
+	auto encode = [&](size_t slot, size_t jobIndex) {
+		{
+			PROFILE_ZONE("batch fence");
+			if (device->waitForFences(1, &batchFences[slot], VK_TRUE, UINT64_MAX) != vk::Result::eSuccess) {
+				throw std::runtime_error("failed to wait for a batch job!");
+			}
+		}
+		completedFrame++;
+		vk::MappedMemoryRange range(readbackBuffersMemory[slot], 0, VK_WHOLE_SIZE);
+		device->invalidateMappedMemoryRanges(1, &range);
+
+		std::string output = (std::filesystem::path(batchOutput) / (std::to_string(jobIndex) + ".png")).string();
+		const uint8_t* pixels = static_cast<const uint8_t*>(readbackData[slot]);
+		jobSystem.run([output, pixels, width, height, bgra]() {
+			PROFILE_ZONE("png encode");
+			std::vector<uint8_t> rgba(pixels, pixels + static_cast<size_t>(width) * height * 4);
+			for (size_t i = 0; i < rgba.size(); i += 4) {
+				if (bgra) std::swap(rgba[i], rgba[i + 2]);
+				rgba[i + 3] = 255;
+			}
+			if (!stbi_write_png(output.c_str(), static_cast<int>(width), static_cast<int>(height), 4, rgba.data(), static_cast<int>(width * 4))) {
+				throw std::runtime_error("failed to write " + output + "!");
+			}
+		}, &encoding[slot]);
+	};
+
+	auto start = Clock::now();
+	bool hasPrevious = false;
+	size_t previousSlot = 0;
+	size_t previousJob = 0;
+
+	for (size_t k = 0; k < jobs.size(); k++) {
+		const BatchJob& job = jobs[k];
+
+		if (job.model != currentModel) {
+			// FINISH WHAT USES THE OLD MODEL FIRST
+			if (hasPrevious) {
+				encode(previousSlot, previousJob);
+				hasPrevious = false;
+			}
+			switchBatchModel(job.model);
+			currentModel = job.model;
+		}
+
+		size_t slot = k % slots;
+		// WITH A SINGLE SLOT THE JOB BEFORE IS STILL IN IT
+		if (hasPrevious && previousSlot == slot) {
+			encode(previousSlot, previousJob);
+			hasPrevious = false;
+		}
+		// THE READBACK BUFFER MAY STILL BE BEING ENCODED FROM ITS LAST JOB
+		jobSystem.wait(encoding[slot]);
+		// encode WAITED FOR THE SLOT'S FENCE, ITS LIGHT INDEX POOL CAN GROW
+		checkLightIndexPool(slot);
+
+		// THE CAMERA OF THE JOB, THE MODEL STAYS UNROTATED
+		frameSnapshot = FrameSnapshot();
+		frameSnapshot.cameraPos = job.eye;
+		frameSnapshot.cameraFront = glm::normalize(job.target - job.eye);
+		frameSnapshot.cameraUp = std::abs(frameSnapshot.cameraFront.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		frameSnapshot.fov = job.fov;
+		frameSnapshot.tick = frameNumber;
+
+		resourceCache.beginFrame(frameNumber + 1, completedFrame);
+		updateUniformBuffer(static_cast<uint32_t>(slot));
+		updateLights(static_cast<uint32_t>(slot));
+		updateDrawObjects(static_cast<uint32_t>(slot));
+
+		// NOTHING TO WAIT FOR AND NOTHING TO PRESENT
+		vk::SubmitInfo submitInfo;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffers[slot];
+
+		device->resetFences(1, &batchFences[slot]);
+		{
+			PROFILE_ZONE("queue submit");
+			if (graphicsQueue.submit(1, &submitInfo, batchFences[slot]) != vk::Result::eSuccess) {
+				throw std::runtime_error("failed to submit batch command buffer!");
+			}
+		}
+		frameNumber++;
+
+		// THIS JOB IS QUEUED BEHIND THE PREVIOUS ONE, READ THAT ONE BACK WHILE THE GPU DRAWS
+		if (hasPrevious) {
+			encode(previousSlot, previousJob);
+		}
+		hasPrevious = true;
+		previousSlot = slot;
+		previousJob = job.index;
+	}
+
+	if (hasPrevious) {
+		encode(previousSlot, previousJob);
+	}
+	for (auto& counter : encoding) {
+		jobSystem.wait(counter);
+	}
+	device->waitIdle();
+
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	std::cout << "batch: " << jobs.size() << " images (" << width << "x" << height << ") in " << seconds << " s, "
+		<< (seconds > 0.0 ? jobs.size() / seconds : 0.0) << " images per second\n";
+
+	resourceCache.report(std::cout);
+	memoryPool.report(std::cout);
+}
+
+void VulkanRenderer::runSoftwareBatch() {
+	using Clock = std::chrono::steady_clock;
+
+	// WITH --software init NEVER RAN, AFTER A FAILED init THE CPU STAGES ALREADY DID THIS
+	if (!texturePixels) {
+		decodeTextureImage();
+	}
+	if (mesh.indexCount == 0) {
+		loadModel();
+	}
+	if (lights.empty()) {
+		createLights();
+	}
+
+	std::vector<BatchJob> jobs = loadBatchJobs(batchPath, fov);
+	std::stable_sort(jobs.begin(), jobs.end(), [](const BatchJob& a, const BatchJob& b) {
+		return a.model < b.model;
+	});
+	std::filesystem::create_directories(batchOutput);
+
+	// NO SWAPCHAIN, THE IMAGES ARE THE WINDOW SIZE LIKE viewExtent WOULD BE
+	uint32_t width = WIDTH;
+	uint32_t height = HEIGHT;
+
+	SoftwareRasterizer rasterizer;
+	rasterizer.resize(width, height);
+	rasterizer.setMesh(softwareMeshFromSource(mesh));
+	rasterizer.setTexture(texturePixels, static_cast<uint32_t>(textureWidth), static_cast<uint32_t>(textureHeight));
+	std::string currentModel = MODEL_PATH;
+
+	// THE PNG OF ONE JOB IS WRITTEN WHILE THE NEXT ONE IS DRAWN
+	JobCounter encoding;
+	SoftwareRasterStats totals;
+
+	auto start = Clock::now();
+	for (const BatchJob& job : jobs) {
+		if (job.model != currentModel) {
+			cullingScene.remove(modelObject);
+			vertices.clear();
+			indices.clear();
+			MODEL_PATH = job.model;
+			loadModel();
+			rasterizer.setMesh(softwareMeshFromSource(mesh));
+			currentModel = job.model;
+		}
+
+		// THE SAME CAMERA AND MATRICES AS updateUniformBuffer GIVES THE GPU
+		glm::vec3 front = glm::normalize(job.target - job.eye);
+		glm::vec3 up = std::abs(front.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		uint64_t tick = frameNumber;
+
+		SoftwareFrame frame;
+		frame.view = glm::lookAt(job.eye, job.eye + front, up);
+		frame.proj = glm::perspective(glm::radians(job.fov), width / (float)height, nearPlane, farPlane);
+		frame.proj[1][1] *= -1;
+		frame.cameraPosition = job.eye;
+		frame.alphaTest = textureHasCutout;
+		if (shadows) {
+			frame.sunDirection = glm::vec4(sunDirectionAt(tick), sunIntensity);
+		}
+		frame.lights.resize(lights.size());
+		for (size_t i = 0; i < lights.size(); i++) {
+			frame.lights[i].position = orbitingLightPosition(i, tick);
+			frame.lights[i].radius = lights[i].positionRadius.w;
+			frame.lights[i].color = glm::vec3(lights[i].colorIntensity) * lights[i].colorIntensity.w;
+		}
+
+		rasterizer.render(frame, jobSystem);
+		frameNumber++;
+
+		SoftwareRasterStats stats = rasterizer.stats();
+		totals.triangles += stats.triangles;
+		totals.binned += stats.binned;
+		totals.blocks += stats.blocks;
+		totals.blocksCovered += stats.blocksCovered;
+		totals.blocksOccluded += stats.blocksOccluded;
+
+		// THE RASTERIZER'S ROWS ARE PADDED, THE COPY IS TIGHT LIKE THE GPU READBACK
+		auto pixels = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(width) * height * 4);
+		for (uint32_t y = 0; y < height; y++) {
+			std::memcpy(pixels->data() + static_cast<size_t>(y) * width * 4, rasterizer.pixels() + y * rasterizer.stride(), static_cast<size_t>(width) * 4);
+		}
+
+		jobSystem.wait(encoding);
+		std::string output = (std::filesystem::path(batchOutput) / (std::to_string(job.index) + ".png")).string();
+		jobSystem.run([output, pixels, width, height]() {
+			PROFILE_ZONE("png encode");
+			if (!stbi_write_png(output.c_str(), static_cast<int>(width), static_cast<int>(height), 4, pixels->data(), static_cast<int>(width * 4))) {
+				throw std::runtime_error("failed to write " + output + "!");
+			}
+		}, &encoding);
+	}
+	jobSystem.wait(encoding);
+
+	// createTextureImage NEVER TOOK THE PIXELS
+	stbi_image_free(texturePixels);
+	texturePixels = nullptr;
+
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	std::cout << "batch (software): " << jobs.size() << " images (" << width << "x" << height << ") in " << seconds << " s, "
+		<< (seconds > 0.0 ? jobs.size() / seconds : 0.0) << " images per second\n";
+	std::cout << "batch (software): " << totals.triangles << " triangles, " << totals.binned << " tile bins, "
+		<< totals.blocks << " blocks (" << totals.blocksCovered << " covered, " << totals.blocksOccluded << " occluded by hi-z)\n";
+}
@@ -12,41 +12,92 @@ void VulkanRenderer::clean() {
 
     for (size_t i = 0; i < swapChainImages.size(); i++) {
         device->destroyBuffer(uniformBuffers[i]);
-        device->freeMemory(uniformBuffersMemory[i]);
+        freeMemory(uniformBuffersMemory[i]);
     }
 
-    device->destroyBuffer(indexBuffer);
+    destroyClusterBuffers();
 
-    device->freeMemory(indexBufferMemory);
+    destroyDrawBuffers();
 
-    device->destroyBuffer(vertexBuffer);
+    destroyShadowBuffers();
 
-    device->freeMemory(vertexBufferMemory);
+    destroyShadowResources();
 
-    device->destroySampler(textureSampler);
+    destroyParticleBuffers();
+
+    destroyParticleResources();
+
+    device->destroyBuffer(occlusionBuffer);
+
+    freeMemory(occlusionBufferMemory);
+
+    // THE DEVICE IS IDLE, LET GO OF OUR ASSETS AND DESTROY WHAT THE CACHE STILL HOLDS
+    indexResource.reset();
 
-    device->destroyImageView(textureImageView);
+    vertexResource.reset();
 
-    device->destroyImage(textureImage);
+    textureResource.reset();
+
+    resourceCache.clear();
+
+    // EVERY CACHED RESOURCE IS GONE, SO ARE THE BLOCKS THEY LIVED IN
+    memoryPool.clear();
+
+    device->destroySampler(textureSampler);
 
-    device->freeMemory(textureImageMemory);
+    destroyHiZResources();
 
     device->destroyImageView(depthImageView);
 
+    destroyRenderTarget();
+
+    destroyTimestampQueries();
+
+    destroyBatchResources();
+
+    destroyPostResources();
+
+    destroyPostPipelines();
+
     device->destroyImage(depthImage);
 
-    device->freeMemory(depthImageMemory);
+    freeMemory(depthImageMemory);
 
     device->destroyCommandPool(commandPool);
+    device->destroyCommandPool(transferCommandPool);
 
     for (auto framebuffer : swapChainFramebuffers) {
         device->destroyFramebuffer(framebuffer);
     }
 
-    device->destroyPipeline(graphicsPipeline);
+    shaderVariants.clear();
 
     device->destroyPipelineLayout(pipelineLayout);
 
+    device->destroyPipeline(clusterPipeline);
+
+    device->destroyPipelineLayout(clusterPipelineLayout);
+
+    device->destroyPipeline(occlusionPipeline);
+
+    device->destroyPipelineLayout(occlusionPipelineLayout);
+
+    device->destroyPipeline(hiZPipeline);
+
+    device->destroyPipelineLayout(hiZPipelineLayout);
+
+    device->destroyDescriptorSetLayout(hiZDescriptorSetLayout);
+
+    device->destroySampler(hiZSampler);
+
+    if (depthPrepass) {
+        device->destroyFramebuffer(depthPrepassFramebuffer);
+
+        device->destroyPipeline(depthPrepassPipeline);
+
+        device->destroyRenderPass(depthPrepassRenderPass);
+    }
+
     device->destroyDescriptorSetLayout(descriptorSetLayout);
 
     device->destroyRenderPass(renderPass);
@@ -63,7 +114,35 @@ void VulkanRenderer::clean() {
         DestroyDebugUtilsMessengerEXT(*instance, debugMessenger, nullptr);
     }
 
+    // CELL LOADS RUN ON THE JOB SYSTEM
+    worldPartition.close(cullingScene);
+
+    jobSystem.stop();
+
     glfwDestroyWindow(window);
 
+    glfwTerminate();
+}
+
+void VulkanRenderer::cleanSoftware() {
+    // init MAY HAVE STOPPED ANYWHERE BEFORE THE DEVICE, OR NEVER RUN (--software)
+    if (instance) {
+        if (surface) {
+            instance->destroySurfaceKHR(surface, nullptr);
+        }
+
+        if (enableValidationLayers && debugMessenger != VK_NULL_HANDLE) {
+            DestroyDebugUtilsMessengerEXT(*instance, debugMessenger, nullptr);
+        }
+    }
+
+    worldPartition.close(cullingScene);
+
+    jobSystem.stop();
+
+    if (window) {
+        glfwDestroyWindow(window);
+    }
+
     glfwTerminate();
 }
\ No newline at end of file
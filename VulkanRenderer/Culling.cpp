@@ -0,0 +1,212 @@
+#include "Culling.h"
+#include "Simd.h"
+
+#include "CullingKernels.inl"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#include <intrin.h>
+#endif
+
+const CullingKernels& defaultCullingKernels() {
+	return kernels;
+}
+
+bool cpuSupportsAvx2() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+
+	// AVX, FMA AND THE OS SAVING THE YMM REGISTERS ON A CONTEXT SWITCH
+	__cpuid(info, 1);
+	bool avx = (info[2] & (1 << 28)) != 0;
+	bool fma = (info[2] & (1 << 12)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	if (!avx || !fma || !osxsave) return false;
+	if ((_xgetbv(0) & 6) != 6) return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+	return false;
+#endif
+}
+
+const CullingKernels& bestCullingKernels() {
+	static const CullingKernels* best = [] {
+		const CullingKernels* avx2 = avx2CullingKernels();
+		return avx2 && cpuSupportsAvx2() ? avx2 : &defaultCullingKernels();
+	}();
+	return *best;
+}
+
+Frustum Frustum::fromViewProjection(const glm::mat4& viewProjection) {
+	// GLM IS COLUMN MAJOR, m[column][row]
+	const glm::mat4& m = viewProjection;
+	auto row = [&](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+
+	Frustum frustum;
+	frustum.planes[0] = row(3) + row(0); // LEFT
+	frustum.planes[1] = row(3) - row(0); // RIGHT
+	frustum.planes[2] = row(3) + row(1); // BOTTOM
+	frustum.planes[3] = row(3) - row(1); // TOP
+	frustum.planes[4] = row(2);          // NEAR, DEPTH GOES 0..1 SO IT IS JUST z >= 0
+	frustum.planes[5] = row(3) - row(2); // FAR
+
+	// NORMALIZE SO THE DISTANCES ARE IN WORLD UNITS AND CAN BE COMPARED TO RADII
+	for (auto& plane : frustum.planes) {
+		float length = glm::length(glm::vec3(plane));
+		if (length > 0.0f) {
+			plane /= length;
+		}
+	}
+	return frustum;
+}
+
+void CullingScene::grow() {
+	capacity += BLOCK;
+
+	for (int i = 0; i < 3; i++) {
+		localCenter[i].resize(capacity, 0.0f);
+		localExtent[i].resize(capacity, 0.0f);
+		center[i].resize(capacity, 0.0f);
+		extent[i].resize(capacity, 0.0f);
+	}
+	for (int i = 0; i < 12; i++) {
+		world[i].resize(capacity, 0.0f);
+	}
+	radius.resize(capacity, 0.0f);
+	dirtyBlocks.resize(capacity / BLOCK, 0);
+	live.resize(capacity, 0);
+}
+
+uint32_t CullingScene::add(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& worldMatrix) {
+	uint32_t object;
+	if (!freeObjects.empty()) {
+		object = freeObjects.back();
+		freeObjects.pop_back();
+	}
+	else {
+		if (count == capacity) {
+			grow();
+		}
+		object = static_cast<uint32_t>(count++);
+	}
+	live[object] = 1;
+
+	glm::vec3 localCenterValue = (boundsMin + boundsMax) * 0.5f;
+	glm::vec3 localExtentValue = (boundsMax - boundsMin) * 0.5f;
+	for (int i = 0; i < 3; i++) {
+		localCenter[i][object] = localCenterValue[i];
+		localExtent[i][object] = localExtentValue[i];
+	}
+
+	setWorld(object, worldMatrix);
+	return object;
+}
+
+void CullingScene::setWorld(uint32_t object, const glm::mat4& worldMatrix) {
+	for (int row = 0; row < 3; row++) {
+		for (int column = 0; column < 4; column++) {
+			world[row * 4 + column][object] = worldMatrix[column][row];
+		}
+	}
+	dirtyBlocks[object / BLOCK] = 1;
+	anyDirty = true;
+}
+
+void CullingScene::remove(uint32_t object) {
+	// THE DATA STAYS, cull() JUST NEVER REPORTS IT
+	live[object] = 0;
+	freeObjects.push_back(object);
+}
+
+void CullingScene::clear() {
+	count = 0;
+	capacity = 0;
+	for (int i = 0; i < 3; i++) {
+		localCenter[i].clear();
+		localExtent[i].clear();
+		center[i].clear();
+		extent[i].clear();
+	}
+	for (int i = 0; i < 12; i++) {
+		world[i].clear();
+	}
+	radius.clear();
+	dirtyBlocks.clear();
+	anyDirty = false;
+	live.clear();
+	freeObjects.clear();
+}
+
+CullingArrays CullingScene::arrays() {
+	CullingArrays result;
+	for (int i = 0; i < 3; i++) {
+		result.localCenter[i] = localCenter[i].data();
+		result.localExtent[i] = localExtent[i].data();
+		result.center[i] = center[i].data();
+		result.extent[i] = extent[i].data();
+	}
+	for (int i = 0; i < 12; i++) {
+		result.world[i] = world[i].data();
+	}
+	result.radius = radius.data();
+	result.live = live.data();
+	return result;
+}
+
+void CullingScene::updateBounds() {
+	if (!anyDirty) return;
+
+	CullingArrays data = arrays();
+	for (size_t block = 0; block < dirtyBlocks.size(); block++) {
+		if (dirtyBlocks[block]) {
+			kernels->transform(data, block * BLOCK, BLOCK);
+			dirtyBlocks[block] = 0;
+		}
+	}
+	anyDirty = false;
+}
+
+void CullingScene::cull(const Frustum& frustum, CullShape shape, std::vector<uint32_t>& visible) {
+	updateBounds();
+
+	// MAKE ROOM FOR THE WORST CASE AND WRITE THROUGH A POINTER, SHRINK AT THE END
+	size_t firstOutput = visible.size();
+	visible.resize(firstOutput + count);
+
+	float planes[6][4];
+	for (int p = 0; p < 6; p++) {
+		for (int i = 0; i < 4; i++) {
+			planes[p][i] = frustum.planes[p][i];
+		}
+	}
+
+	uint32_t* output = kernels->cull(arrays(), count, planes, shape == CullShape::Box, visible.data() + firstOutput);
+	visible.resize(static_cast<size_t>(output - visible.data()));
+}
+
+glm::vec3 CullingScene::worldCenter(uint32_t object) const {
+	return glm::vec3(center[0][object], center[1][object], center[2][object]);
+}
+
+float CullingScene::worldRadius(uint32_t object) const {
+	return radius[object];
+}
+
+glm::vec3 CullingScene::worldExtent(uint32_t object) const {
+	return glm::vec3(extent[0][object], extent[1][object], extent[2][object]);
+}
+
+glm::mat4 CullingScene::worldMatrix(uint32_t object) const {
+	glm::mat4 matrix(1.0f);
+	for (int row = 0; row < 3; row++) {
+		for (int column = 0; column < 4; column++) {
+			matrix[column][row] = world[row * 4 + column][object];
+		}
+	}
+	return matrix;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "CullingKernels.h"
+
+#include <cstdint>
+#include <vector>
+
+// SIX PLANES (a, b, c, d) WITH a*x + b*y + c*z + d >= 0 MEANING INSIDE
+// ORDER: LEFT, RIGHT, BOTTOM, TOP, NEAR, FAR
+struct Frustum {
+	glm::vec4 planes[6];
+
+	// EXTRACTS THE PLANES FROM proj * view (VULKAN 0..1 DEPTH)
+	static Frustum fromViewProjection(const glm::mat4& viewProjection);
+};
+
+enum class CullShape {
+	Sphere,
+	Box
+};
+
+// STRUCTURE OF ARRAYS STORE FOR EVERYTHING WE MIGHT DRAW
+// LOCAL BOUNDS + AFFINE WORLD MATRIX GO IN, WORLD BOUNDS COME OUT OF
+// updateBounds(), ONLY OBJECTS WHOSE MATRIX CHANGED GET TRANSFORMED AGAIN
+class CullingScene {
+public:
+	// THE FASTEST KERNELS THIS CPU CAN RUN, setKernels() SWAPS THEM (E.G. FOR THE SCALAR ONES)
+	CullingScene() : kernels(&bestCullingKernels()) {}
+
+	void setKernels(const CullingKernels& newKernels) { kernels = &newKernels; }
+	const char* kernelName() const { return kernels->name; }
+
+	uint32_t add(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& world);
+
+	void setWorld(uint32_t object, const glm::mat4& world);
+
+	// TAKES THE OBJECT OUT OF cull(), THE NEXT add() HANDS ITS INDEX OUT AGAIN
+	// SO INDICES STAY DENSE WHILE THINGS ARE STREAMED IN AND OUT
+	void remove(uint32_t object);
+
+	void clear();
+
+	// LIVE OBJECTS
+	size_t size() const { return count - freeObjects.size(); }
+
+	// TRANSFORMS THE LOCAL BOUNDS OF EVERY DIRTY OBJECT INTO WORLD SPACE
+	void updateBounds();
+
+	// APPENDS THE INDICES OF THE OBJECTS INSIDE THE FRUSTUM TO visible
+	// CALLS updateBounds() FIRST IF ANYTHING IS DIRTY
+	void cull(const Frustum& frustum, CullShape shape, std::vector<uint32_t>& visible);
+
+	// WORLD SPACE RESULTS, VALID AFTER updateBounds()
+	glm::vec3 worldCenter(uint32_t object) const;
+	float worldRadius(uint32_t object) const;
+	glm::vec3 worldExtent(uint32_t object) const;
+
+	// THE MATRIX GIVEN TO add() / setWorld()
+	glm::mat4 worldMatrix(uint32_t object) const;
+
+private:
+	// EVERYTHING IS PADDED TO A MULTIPLE OF THIS SO KERNELS NEVER NEED A TAIL LOOP
+	static constexpr size_t BLOCK = 8;
+
+	void grow();
+	CullingArrays arrays();
+
+	const CullingKernels* kernels;
+
+	size_t count = 0;
+	size_t capacity = 0;
+
+	// LOCAL AABB AS CENTER + HALF EXTENT
+	std::vector<float> localCenter[3];
+	std::vector<float> localExtent[3];
+	// AFFINE PART OF THE WORLD MATRIX, ROW MAJOR 3x4 (world[row][column])
+	std::vector<float> world[12];
+
+	// WORLD SPACE SPHERE AND AABB
+	std::vector<float> center[3];
+	std::vector<float> extent[3];
+	std::vector<float> radius;
+
+	// ONE FLAG PER BLOCK
+	std::vector<uint8_t> dirtyBlocks;
+	bool anyDirty = false;
+
+	// 1 FOR OBJECTS THAT WERE NOT REMOVED
+	std::vector<uint8_t> live;
+	std::vector<uint32_t> freeObjects;
+};
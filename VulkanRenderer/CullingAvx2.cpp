@@ -0,0 +1,21 @@
+#include "CullingKernels.h"
+
+// BUILT WITH /arch:AVX2 (SEE THE PROJECT FILES) LIKE RasterAvx2.cpp, NOTHING IN HERE RUNS
+// BEFORE bestCullingKernels() HAS CHECKED THE CPU
+#include "Simd.h"
+
+#if defined(SIMD_AVX2)
+
+#include "CullingKernels.inl"
+
+const CullingKernels* avx2CullingKernels() {
+	return &kernels;
+}
+
+#else
+
+const CullingKernels* avx2CullingKernels() {
+	return nullptr;
+}
+
+#endif
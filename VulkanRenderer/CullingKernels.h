@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// THE SIMD HALF OF CullingScene, BUILT ONCE PER INSTRUCTION SET FROM CullingKernels.inl
+// THE AVX2 COPY (AND THE ONE OF RasterKernels) IS THE ONLY CODE COMPILED WITH /arch:AVX2 AND IS ONLY CALLED WHEN THE CPU
+// HAS IT, SO THE REST OF THE BINARY STILL RUNS ON ANY x64 CPU
+// NO GLM OR STANDARD LIBRARY CALLS IN HERE: AN INLINE FUNCTION THE AVX2 FILE EMITS COULD BE
+// THE COPY THE LINKER KEEPS FOR EVERYONE ELSE
+
+// THE STRUCTURE OF ARRAYS OF A CullingScene, ALL PADDED TO A MULTIPLE OF 8
+struct CullingArrays {
+	const float* localCenter[3];
+	const float* localExtent[3];
+	// ROW MAJOR 3x4
+	const float* world[12];
+	float* center[3];
+	float* extent[3];
+	float* radius;
+	const uint8_t* live;
+};
+
+struct CullingKernels {
+	const char* name;
+	// WORLD BOUNDS OF OBJECTS [first, first + count), count A MULTIPLE OF 8
+	void (*transform)(const CullingArrays& arrays, size_t first, size_t count);
+	// WRITES THE LIVE OBJECTS OF [0, count) INSIDE ALL SIX planes TO output, RETURNS THE NEW END
+	uint32_t* (*cull)(const CullingArrays& arrays, size_t count, const float (*planes)[4], bool box, uint32_t* output);
+};
+
+// WHAT THE BUILD FLAGS GIVE (SSE ON x64)
+const CullingKernels& defaultCullingKernels();
+// NULL WHEN THE COMPILER COULD NOT BUILD THEM
+const CullingKernels* avx2CullingKernels();
+// PLAIN C++ (SIMD_FORCE_SCALAR), THE REFERENCE THE OTHERS ARE CHECKED AGAINST
+const CullingKernels& scalarCullingKernels();
+
+// AVX2 WHEN THE CPU (AND THE OS) SUPPORT IT, OTHERWISE THE DEFAULT ONES
+const CullingKernels& bestCullingKernels();
@@ -0,0 +1,104 @@
+// INCLUDED BY EVERY FILE THAT BUILDS A CullingKernels TABLE, AFTER CullingKernels.h AND Simd.h
+// THE TABLE IS CALLED kernels, EVERYTHING HERE IS LOCAL TO THE INCLUDING FILE
+
+namespace {
+
+void transformKernel(const CullingArrays& arrays, size_t first, size_t count) {
+	using namespace simd;
+
+	for (size_t i = first; i < first + count; i += WIDTH) {
+		Float cx = load(arrays.localCenter[0] + i);
+		Float cy = load(arrays.localCenter[1] + i);
+		Float cz = load(arrays.localCenter[2] + i);
+		Float ex = load(arrays.localExtent[0] + i);
+		Float ey = load(arrays.localExtent[1] + i);
+		Float ez = load(arrays.localExtent[2] + i);
+
+		Float columnScale[3] = { set(0.0f), set(0.0f), set(0.0f) };
+
+		for (int row = 0; row < 3; row++) {
+			Float m0 = load(arrays.world[row * 4 + 0] + i);
+			Float m1 = load(arrays.world[row * 4 + 1] + i);
+			Float m2 = load(arrays.world[row * 4 + 2] + i);
+			Float m3 = load(arrays.world[row * 4 + 3] + i);
+
+			// CENTER GOES THROUGH THE FULL AFFINE TRANSFORM
+			store(arrays.center[row] + i, mulAdd(m0, cx, mulAdd(m1, cy, mulAdd(m2, cz, m3))));
+
+			// EXTENT THROUGH THE ABSOLUTE LINEAR PART (ARVO'S METHOD)
+			store(arrays.extent[row] + i, mulAdd(abs(m0), ex, mulAdd(abs(m1), ey, mul(abs(m2), ez))));
+
+			columnScale[0] = mulAdd(m0, m0, columnScale[0]);
+			columnScale[1] = mulAdd(m1, m1, columnScale[1]);
+			columnScale[2] = mulAdd(m2, m2, columnScale[2]);
+		}
+
+		// THE SPHERE AROUND THE LOCAL BOX, SCALED BY THE BIGGEST AXIS SCALE
+		Float maxScaleSquared = max(columnScale[0], max(columnScale[1], columnScale[2]));
+		Float localRadiusSquared = mulAdd(ex, ex, mulAdd(ey, ey, mul(ez, ez)));
+		store(arrays.radius + i, sqrt(mul(localRadiusSquared, maxScaleSquared)));
+	}
+}
+
+uint32_t* cullKernel(const CullingArrays& arrays, size_t count, const float (*planes)[4], bool box, uint32_t* output) {
+	using namespace simd;
+
+	Float planeX[6], planeY[6], planeZ[6], planeW[6];
+	Float absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; p++) {
+		planeX[p] = set(planes[p][0]);
+		planeY[p] = set(planes[p][1]);
+		planeZ[p] = set(planes[p][2]);
+		planeW[p] = set(planes[p][3]);
+		absX[p] = abs(planeX[p]);
+		absY[p] = abs(planeY[p]);
+		absZ[p] = abs(planeZ[p]);
+	}
+	const Float zero = set(0.0f);
+
+	for (size_t i = 0; i < count; i += WIDTH) {
+		Float cx = load(arrays.center[0] + i);
+		Float cy = load(arrays.center[1] + i);
+		Float cz = load(arrays.center[2] + i);
+
+		// SPHERE: THE RADIUS, BOX: THE PROJECTED HALF SIZE ON EACH PLANE NORMAL
+		Mask inside = maskAll();
+		if (!box) {
+			Float r = load(arrays.radius + i);
+			for (int p = 0; p < 6; p++) {
+				Float distance = mulAdd(planeX[p], cx, mulAdd(planeY[p], cy, mulAdd(planeZ[p], cz, add(planeW[p], r))));
+				inside = maskAnd(inside, greaterEqual(distance, zero));
+			}
+		}
+		else {
+			Float ex = load(arrays.extent[0] + i);
+			Float ey = load(arrays.extent[1] + i);
+			Float ez = load(arrays.extent[2] + i);
+			for (int p = 0; p < 6; p++) {
+				Float reach = mulAdd(absX[p], ex, mulAdd(absY[p], ey, mul(absZ[p], ez)));
+				Float distance = mulAdd(planeX[p], cx, mulAdd(planeY[p], cy, mulAdd(planeZ[p], cz, add(planeW[p], reach))));
+				inside = maskAnd(inside, greaterEqual(distance, zero));
+			}
+		}
+
+		uint32_t bits = maskBits(inside);
+		// THE PADDING LANES AT THE END ARE NOT OBJECTS
+		size_t remaining = count - i;
+		if (remaining < static_cast<size_t>(WIDTH)) {
+			bits &= (1u << remaining) - 1u;
+		}
+
+		// REMOVED OBJECTS ARE WRITTEN BUT NOT KEPT
+		while (bits) {
+			uint32_t object = static_cast<uint32_t>(i + lowestBit(bits));
+			*output = object;
+			output += arrays.live[object];
+			bits &= bits - 1u;
+		}
+	}
+	return output;
+}
+
+const CullingKernels kernels = { simd::NAME, &transformKernel, &cullKernel };
+
+}
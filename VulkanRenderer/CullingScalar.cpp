@@ -0,0 +1,13 @@
+#include "CullingKernels.h"
+
+// THE SAME KERNELS ONE LANE AT A TIME, KEPT IN THE BINARY SO THE VECTOR ONES CAN BE CHECKED
+#if !defined(SIMD_FORCE_SCALAR)
+	#define SIMD_FORCE_SCALAR
+#endif
+#include "Simd.h"
+
+#include "CullingKernels.inl"
+
+const CullingKernels& scalarCullingKernels() {
+	return kernels;
+}
@@ -0,0 +1,222 @@
+#include "VulkanRenderer.h"
+
+// ONLINE DEFRAGMENTATION
+// THE RESOURCE CACHE ALLOCATES FROM memoryPool, SO LOADING AND EVICTING ASSETS FOR DAYS LEAVES
+// HOLES IN ITS BLOCKS. EVERY FRAME THE POOL PLANS UP TO defragBudget BYTES OF MOVES OUT OF ITS
+// EMPTIEST BLOCK. EACH MOVE GETS A NEW BUFFER OR IMAGE BOUND AT THE NEW PLACE AND ITS COPY IS
+// RECORDED INTO A COMMAND BUFFER SUBMITTED RIGHT BEFORE THE FRAME. THE CACHE ENTRY THEN HOLDS
+// THE COPY AND THE OLD ONE IS RETIRED, SO IT IS DESTROYED (AND ITS RANGE FREED) ONCE NO FRAME
+// IN FLIGHT READS IT, AND THE BLOCK GOES BACK TO THE DRIVER WITH ITS LAST RANGE.
+// THE OTHER SWAPCHAIN IMAGES' DESCRIPTOR SETS AND COMMAND BUFFERS STILL NAME THE OLD ONES, THEY
+// ARE FIXED UP WHEN THAT IMAGE IS ACQUIRED AGAIN AND ITS FENCE HAS BEEN WAITED.
+// THE BATCH PATH NEVER GOES THROUGH drawFrame, IT CALLS defragmentIdle BETWEEN MODELS INSTEAD
+
+vk::CommandBuffer VulkanRenderer::defragmentMemory(uint32_t currentImage) {
+	PROFILE_FUNCTION();
+	// A RECREATED SWAPCHAIN RECORDED EVERYTHING AGAIN WITH THE CURRENT RESOURCES
+	if (staleImages.size() != swapChainImages.size()) {
+		staleImages.assign(swapChainImages.size(), false);
+	}
+	if (staleImages[currentImage]) {
+		refreshMovedResources(currentImage);
+	}
+
+	if (!defragment) {
+		return nullptr;
+	}
+	std::vector<DeviceMemoryPool::Move> moves = memoryPool.planDefragmentation(defragBudget);
+	if (moves.empty()) {
+		return nullptr;
+	}
+
+	// ITS FRAME'S FENCE WAS WAITED AT THE TOP OF drawFrame
+	vk::CommandBuffer commandBuffer = defragCommandBuffer(currentFrame);
+	if (recordDefragmentation(moves, commandBuffer) == 0) {
+		return nullptr;
+	}
+
+	useMovedResources();
+	staleImages.assign(staleImages.size(), true);
+	refreshMovedResources(currentImage);
+	return commandBuffer;
+}
+
+bool VulkanRenderer::defragmentIdle() {
+	PROFILE_FUNCTION();
+	if (!defragment) {
+		return false;
+	}
+	std::vector<DeviceMemoryPool::Move> moves = memoryPool.planDefragmentation(defragBudget);
+	if (moves.empty()) {
+		return false;
+	}
+
+	vk::CommandBuffer commandBuffer = defragCommandBuffer(0);
+	if (recordDefragmentation(moves, commandBuffer) == 0) {
+		return false;
+	}
+
+	// NOTHING ELSE IS IN FLIGHT, SO THE COPIES ARE WAITED FOR RIGHT HERE
+	vk::SubmitInfo submitInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	device->resetFences(1, &defragFence);
+	if (graphicsQueue.submit(1, &submitInfo, defragFence) != vk::Result::eSuccess) {
+		throw std::runtime_error("failed to submit defragmentation command buffer!");
+	}
+	if (device->waitForFences(1, &defragFence, VK_TRUE, UINT64_MAX) != vk::Result::eSuccess) {
+		throw std::runtime_error("failed to wait for defragmentation!");
+	}
+
+	// NO SLOT CAN BE IN FLIGHT EITHER, FIX ALL OF THEM UP NOW
+	useMovedResources();
+	staleImages.assign(swapChainImages.size(), true);
+	for (uint32_t i = 0; i < swapChainImages.size(); i++) {
+		refreshMovedResources(i);
+	}
+	return true;
+}
+
+vk::CommandBuffer VulkanRenderer::defragCommandBuffer(size_t index) {
+	if (defragCommandBuffers.empty()) {
+		vk::CommandBufferAllocateInfo allocInfo;
+		allocInfo.commandPool = commandPool;
+		allocInfo.level = vk::CommandBufferLevel::ePrimary;
+		allocInfo.commandBufferCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+
+		try {
+			defragCommandBuffers = device->allocateCommandBuffers(allocInfo);
+		}
+		catch (vk::SystemError err) {
+			throw std::runtime_error("failed to allocate defragmentation command buffers!");
+		}
+	}
+	return defragCommandBuffers[index];
+}
+
+size_t VulkanRenderer::recordDefragmentation(const std::vector<DeviceMemoryPool::Move>& moves, vk::CommandBuffer commandBuffer) {
+	vk::CommandBufferBeginInfo beginInfo;
+	beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	commandBuffer.begin(beginInfo);
+
+	// THE FRAMES BEFORE ARE DONE READING THE OLD PLACES, AND WHATEVER LIVED IN THE NEW ONES
+	vk::MemoryBarrier before;
+	before.srcAccessMask = vk::AccessFlagBits::eMemoryWrite;
+	before.dstAccessMask = vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite;
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eTransfer,
+		vk::DependencyFlags(), 1, &before, 0, nullptr, 0, nullptr);
+
+	size_t relocated = 0;
+	for (const auto& move : moves) {
+		bool moved = resourceCache.relocate(move.owner, move.from, [&](const GpuResource& old) {
+			return moveResource(old, move.to, commandBuffer);
+		});
+		if (moved) {
+			relocated++;
+		}
+		else {
+			// EVICTED SINCE, ITS OLD RANGE IS FREED WITH IT
+			memoryPool.cancelMove(move);
+		}
+	}
+
+	// THE FRAME READS THE BUFFERS AS VERTICES AND INDICES, THE IMAGES WERE MADE VISIBLE ON THEIR OWN
+	vk::MemoryBarrier after;
+	after.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	after.dstAccessMask = vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead | vk::AccessFlagBits::eShaderRead;
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eVertexShader,
+		vk::DependencyFlags(), 1, &after, 0, nullptr, 0, nullptr);
+
+	try {
+		commandBuffer.end();
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to record defragmentation command buffer!");
+	}
+	return relocated;
+}
+
+void VulkanRenderer::useMovedResources() {
+	// THE HANDLES ALREADY HAND OUT THE COPIES, WHAT THE RENDERER KEPT OF THEM DOES NOT
+	textureImage = textureResource->image;
+	textureImageView = textureResource->view;
+	vertexBuffer = vertexResource->buffer;
+	indexBuffer = indexResource->buffer;
+}
+
+GpuResource VulkanRenderer::moveResource(const GpuResource& old, const PoolAllocation& to, vk::CommandBuffer commandBuffer) {
+	GpuResource moved;
+	moved.bytes = old.bytes;
+
+	if (old.buffer) {
+		createPooledBuffer(old.bytes, old.bufferUsage, 0, moved, to);
+
+		vk::BufferCopy region;
+		region.size = old.bytes;
+		commandBuffer.copyBuffer(old.buffer, moved.buffer, 1, &region);
+		return moved;
+	}
+
+	createPooledImage(old.extent.width, old.extent.height, old.format, old.imageUsage, 0, moved, to);
+
+	// THE OLD ONE IS NEVER SAMPLED AGAIN, IT CAN STAY A TRANSFER SOURCE
+	std::array<vk::ImageMemoryBarrier, 2> toTransfer;
+	toTransfer[0].oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	toTransfer[0].newLayout = vk::ImageLayout::eTransferSrcOptimal;
+	toTransfer[0].image = old.image;
+	toTransfer[0].dstAccessMask = vk::AccessFlagBits::eTransferRead;
+	toTransfer[1].oldLayout = vk::ImageLayout::eUndefined;
+	toTransfer[1].newLayout = vk::ImageLayout::eTransferDstOptimal;
+	toTransfer[1].image = moved.image;
+	toTransfer[1].dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+	for (auto& barrier : toTransfer) {
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+	}
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
+		vk::DependencyFlags(), 0, nullptr, 0, nullptr, static_cast<uint32_t>(toTransfer.size()), toTransfer.data());
+
+	vk::ImageCopy region;
+	region.srcSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+	region.dstSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+	region.extent = vk::Extent3D(old.extent.width, old.extent.height, 1);
+	commandBuffer.copyImage(old.image, vk::ImageLayout::eTransferSrcOptimal, moved.image, vk::ImageLayout::eTransferDstOptimal, 1, &region);
+
+	vk::ImageMemoryBarrier toShader;
+	toShader.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+	toShader.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	toShader.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toShader.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toShader.image = moved.image;
+	toShader.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+	toShader.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	toShader.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+		vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &toShader);
+
+	moved.view = createImageView(moved.image, old.format, vk::ImageAspectFlagBits::eColor);
+	return moved;
+}
+
+void VulkanRenderer::refreshMovedResources(uint32_t currentImage) {
+	// THE TEXTURE IS THE ONLY CACHED RESOURCE IN THE DESCRIPTOR SET, BINDING 1 LIKE createDescriptorSets
+	vk::DescriptorImageInfo imageInfo;
+	imageInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	imageInfo.imageView = textureImageView;
+	imageInfo.sampler = textureSampler;
+
+	vk::WriteDescriptorSet descriptorWrite;
+	descriptorWrite.dstSet = descriptorSets[currentImage];
+	descriptorWrite.dstBinding = 1;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pImageInfo = &imageInfo;
+	device->updateDescriptorSets(1, &descriptorWrite, 0, nullptr);
+
+	// THE VERTEX AND INDEX BUFFERS ARE BOUND WHILE RECORDING
+	recordCommandBuffer(currentImage);
+	staleImages[currentImage] = false;
+}
@@ -0,0 +1,329 @@
+#include "DeviceMemoryPool.h"
+
+#include <algorithm>
+#include <iostream>
+
+static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+	return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+void DeviceMemoryPool::init(vk::Device device, MemoryTracker* tracker, vk::DeviceSize blockSize) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->device = device;
+	this->tracker = tracker;
+	defaultBlockSize = blockSize;
+}
+
+DeviceMemoryPool::Block* DeviceMemoryPool::newBlock(vk::DeviceSize size, uint32_t memoryType, MemoryCategory category) {
+	vk::MemoryAllocateInfo allocInfo;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	auto block = std::make_unique<Block>();
+	try {
+		block->memory = device.allocateMemory(allocInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to allocate memory block!");
+	}
+	tracker->recordAllocation(block->memory, size, memoryType, category);
+
+	block->size = size;
+	block->memoryType = memoryType;
+	block->category = category;
+	block->freeRanges[0] = size;
+	blocksAllocated++;
+
+	blocks.push_back(std::move(block));
+	return blocks.back().get();
+}
+
+void DeviceMemoryPool::freeBlock(size_t index) {
+	tracker->recordFree(blocks[index]->memory);
+	device.freeMemory(blocks[index]->memory);
+	blocks.erase(blocks.begin() + index);
+	blocksFreed++;
+}
+
+bool DeviceMemoryPool::place(Block& block, vk::DeviceSize size, vk::DeviceSize alignment, uint64_t owner, vk::DeviceSize& offset) {
+	// THE SMALLEST FREE RANGE IT FITS IN, SO THE BIG HOLES STAY BIG
+	auto best = block.freeRanges.end();
+	for (auto range = block.freeRanges.begin(); range != block.freeRanges.end(); ++range) {
+		vk::DeviceSize aligned = alignUp(range->first, alignment);
+		if (aligned + size <= range->first + range->second && (best == block.freeRanges.end() || range->second < best->second)) {
+			best = range;
+		}
+	}
+	if (best == block.freeRanges.end()) {
+		return false;
+	}
+
+	vk::DeviceSize start = best->first;
+	vk::DeviceSize end = best->first + best->second;
+	offset = alignUp(start, alignment);
+	block.freeRanges.erase(best);
+	// THE ALIGNMENT PADDING AND THE TAIL STAY FREE
+	if (offset > start) {
+		block.freeRanges[start] = offset - start;
+	}
+	if (offset + size < end) {
+		block.freeRanges[offset + size] = end - (offset + size);
+	}
+
+	block.live[offset] = { size, alignment, owner };
+	block.used += size;
+	return true;
+}
+
+void DeviceMemoryPool::release(Block& block, vk::DeviceSize offset) {
+	auto found = block.live.find(offset);
+	if (found == block.live.end()) {
+		std::cerr << "memory pool: nothing allocated at offset " << offset << "\n";
+		return;
+	}
+	vk::DeviceSize start = offset;
+	vk::DeviceSize size = found->second.size;
+	block.used -= size;
+	block.live.erase(found);
+
+	// MERGE WITH THE FREE RANGES ON BOTH SIDES
+	auto next = block.freeRanges.lower_bound(start);
+	if (next != block.freeRanges.end() && next->first == start + size) {
+		size += next->second;
+		next = block.freeRanges.erase(next);
+	}
+	if (next != block.freeRanges.begin()) {
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == start) {
+			start = previous->first;
+			size += previous->second;
+			block.freeRanges.erase(previous);
+		}
+	}
+	block.freeRanges[start] = size;
+}
+
+vk::DeviceSize DeviceMemoryPool::largestFreeRange(const Block& block) {
+	vk::DeviceSize largest = 0;
+	for (const auto& range : block.freeRanges) {
+		largest = std::max(largest, range.second);
+	}
+	return largest;
+}
+
+PoolAllocation DeviceMemoryPool::allocate(const vk::MemoryRequirements& requirements, uint32_t memoryType, MemoryCategory category, uint64_t owner) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	PoolAllocation allocation;
+	allocation.size = requirements.size;
+	allocation.memoryType = memoryType;
+
+	if (requirements.size > defaultBlockSize / 2) {
+		Block* block = newBlock(requirements.size, memoryType, category);
+		block->dedicated = true;
+		place(*block, requirements.size, requirements.alignment, owner, allocation.offset);
+		allocation.memory = block->memory;
+		return allocation;
+	}
+
+	// THE FULLEST BLOCK IT FITS IN, SO THE EMPTY ONES GET EMPTIER AND CAN BE FREED
+	std::vector<Block*> candidates;
+	for (const auto& block : blocks) {
+		if (block->memoryType == memoryType && block->category == category && !block->dedicated && !block->evacuating) {
+			candidates.push_back(block.get());
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const Block* a, const Block* b) {
+		return a->used > b->used;
+	});
+	for (Block* block : candidates) {
+		if (place(*block, requirements.size, requirements.alignment, owner, allocation.offset)) {
+			allocation.memory = block->memory;
+			return allocation;
+		}
+	}
+
+	Block* block = newBlock(defaultBlockSize, memoryType, category);
+	place(*block, requirements.size, requirements.alignment, owner, allocation.offset);
+	allocation.memory = block->memory;
+	return allocation;
+}
+
+void DeviceMemoryPool::free(const PoolAllocation& allocation) {
+	if (!allocation) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (size_t i = 0; i < blocks.size(); i++) {
+		if (blocks[i]->memory == allocation.memory) {
+			release(*blocks[i], allocation.offset);
+			// EMPTY BLOCKS GO BACK TO THE DRIVER RIGHT AWAY
+			if (blocks[i]->live.empty()) {
+				freeBlock(i);
+			}
+			return;
+		}
+	}
+	std::cerr << "memory pool: freeing memory that is not in a block\n";
+}
+
+std::vector<DeviceMemoryPool::Move> DeviceMemoryPool::planDefragmentation(vk::DeviceSize byteBudget) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<Move> planned;
+	vk::DeviceSize spent = 0;
+
+	// EVERY KIND OF BLOCK ON ITS OWN, A BLOCK ONLY EVER HOLDS ONE KIND
+	std::vector<std::pair<uint32_t, MemoryCategory>> kinds;
+	for (const auto& block : blocks) {
+		auto kind = std::make_pair(block->memoryType, block->category);
+		if (!block->dedicated && std::find(kinds.begin(), kinds.end(), kind) == kinds.end()) {
+			kinds.push_back(kind);
+		}
+	}
+
+	for (const auto& kind : kinds) {
+		std::vector<Block*> group;
+		Block* source = nullptr;
+		vk::DeviceSize freeBytes = 0;
+		for (const auto& block : blocks) {
+			if (block->memoryType == kind.first && block->category == kind.second && !block->dedicated) {
+				group.push_back(block.get());
+				freeBytes += block->size - block->used;
+				if (block->evacuating) {
+					source = block.get();
+				}
+			}
+		}
+		if (group.size() < 2) {
+			// NOWHERE TO MOVE TO, LET IT BE USED AGAIN
+			if (source) {
+				source->evacuating = false;
+			}
+			continue;
+		}
+
+		if (!source) {
+			// ONLY WORTH IT WHEN THE HOLES ADD UP TO A WHOLE BLOCK WE COULD GIVE BACK
+			if (freeBytes < defaultBlockSize) {
+				continue;
+			}
+			source = *std::min_element(group.begin(), group.end(), [](const Block* a, const Block* b) {
+				return a->used < b->used;
+			});
+			if (source->used > freeBytes - (source->size - source->used)) {
+				continue;
+			}
+			source->evacuating = true;
+		}
+
+		std::vector<Block*> destinations;
+		for (Block* block : group) {
+			if (block != source) {
+				destinations.push_back(block);
+			}
+		}
+		// FILL THE FULLEST BLOCKS FIRST, LIKE allocate
+		std::sort(destinations.begin(), destinations.end(), [](const Block* a, const Block* b) {
+			return a->used > b->used;
+		});
+
+		for (auto& live : source->live) {
+			if (live.second.moved) {
+				continue;
+			}
+			if (spent >= byteBudget && !planned.empty()) {
+				return planned;
+			}
+
+			Move move;
+			move.owner = live.second.owner;
+			move.from.memory = source->memory;
+			move.from.offset = live.first;
+			move.from.size = live.second.size;
+			move.from.memoryType = source->memoryType;
+			move.to.size = live.second.size;
+			move.to.memoryType = source->memoryType;
+
+			for (Block* destination : destinations) {
+				if (place(*destination, live.second.size, live.second.alignment, live.second.owner, move.to.offset)) {
+					move.to.memory = destination->memory;
+					break;
+				}
+			}
+			// THE HOLES ARE TOO SMALL AFTER ALL, GIVE UP ON THIS BLOCK
+			if (!move.to) {
+				source->evacuating = false;
+				break;
+			}
+
+			live.second.moved = true;
+			planned.push_back(move);
+			spent += live.second.size;
+			moves++;
+			movedBytes += live.second.size;
+		}
+	}
+	return planned;
+}
+
+void DeviceMemoryPool::cancelMove(const Move& move) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (size_t i = 0; i < blocks.size(); i++) {
+		if (blocks[i]->memory == move.to.memory) {
+			release(*blocks[i], move.to.offset);
+			if (blocks[i]->live.empty()) {
+				freeBlock(i);
+			}
+			break;
+		}
+	}
+	moves--;
+	movedBytes -= move.to.size;
+}
+
+void DeviceMemoryPool::clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (const auto& block : blocks) {
+		if (!block->live.empty()) {
+			std::cerr << "memory pool: block still has " << block->live.size() << " allocations\n";
+		}
+		tracker->recordFree(block->memory);
+		device.freeMemory(block->memory);
+	}
+	blocksFreed += blocks.size();
+	blocks.clear();
+}
+
+DeviceMemoryPoolStats DeviceMemoryPool::stats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	DeviceMemoryPoolStats result;
+	result.blocks = blocks.size();
+	for (const auto& block : blocks) {
+		result.blockBytes += block->size;
+		result.usedBytes += block->used;
+		result.allocations += block->live.size();
+		if (!block->dedicated && !block->evacuating) {
+			result.largestFree = std::max(result.largestFree, largestFreeRange(*block));
+		}
+	}
+	result.blocksAllocated = blocksAllocated;
+	result.blocksFreed = blocksFreed;
+	result.moves = moves;
+	result.movedBytes = movedBytes;
+	return result;
+}
+
+void DeviceMemoryPool::report(std::ostream& out) const {
+	DeviceMemoryPoolStats result = stats();
+	const double mb = 1024.0 * 1024.0;
+
+	out << "memory pool: " << result.allocations << " allocations in " << result.blocks << " blocks, "
+		<< result.usedBytes / mb << " MB used of " << result.blockBytes / mb << " MB, largest hole " << result.largestFree / mb << " MB\n";
+	out << "  " << result.blocksAllocated << " blocks allocated, " << result.blocksFreed << " returned, "
+		<< result.moves << " moves (" << result.movedBytes / mb << " MB) while compacting\n";
+}
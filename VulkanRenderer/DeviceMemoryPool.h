@@ -0,0 +1,125 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "MemoryStats.h"
+
+// A RANGE OF ONE BLOCK, NULL memory WHEN IT IS NOT POOLED
+struct PoolAllocation {
+	vk::DeviceMemory memory;
+	vk::DeviceSize offset = 0;
+	vk::DeviceSize size = 0;
+	uint32_t memoryType = 0;
+
+	explicit operator bool() const { return static_cast<bool>(memory); }
+};
+
+struct DeviceMemoryPoolStats {
+	size_t blocks = 0;
+	vk::DeviceSize blockBytes = 0;
+	vk::DeviceSize usedBytes = 0;
+	// THE BIGGEST SINGLE ALLOCATION THAT WOULD FIT WITHOUT A NEW BLOCK
+	vk::DeviceSize largestFree = 0;
+	size_t allocations = 0;
+	uint64_t blocksAllocated = 0;
+	uint64_t blocksFreed = 0;
+	uint64_t moves = 0;
+	vk::DeviceSize movedBytes = 0;
+};
+
+// SUB ALLOCATES DEVICE LOCAL MEMORY FROM BIG BLOCKS AND COMPACTS THEM WHILE THE RENDERER RUNS
+// EVERY ALLOCATION HAS AN OWNER (THE RESOURCE CACHE HASH) SO A MOVE CAN FIND WHAT TO FIX UP.
+// BLOCKS ARE PER MEMORY TYPE AND CATEGORY, SO IMAGES AND BUFFERS NEVER SHARE ONE AND
+// bufferImageGranularity DOES NOT MATTER. A BLOCK GOES BACK TO THE DRIVER AS SOON AS IT IS EMPTY.
+// planDefragmentation PICKS THE EMPTIEST BLOCK OF A KIND WHOSE FREE SPACE ADDS UP TO A WHOLE
+// BLOCK, RESERVES ROOM FOR ITS ALLOCATIONS IN THE OTHER BLOCKS AND HANDS BACK THE MOVES, THE
+// CALLER COPIES THEM ON THE GPU AND FREES THE OLD RANGES ONCE NO FRAME READS THEM. NOTHING NEW
+// IS PLACED IN A BLOCK BEING EMPTIED, SO IT DRAINS OVER A FEW FRAMES AND IS FREED
+// ALLOCATED FROM THE STARTUP JOBS AND THE RENDER THREAD, SO ALL OF IT IS LOCKED
+class DeviceMemoryPool {
+public:
+	// A LIVE ALLOCATION AND WHERE ITS CONTENT GOES
+	struct Move {
+		uint64_t owner;
+		PoolAllocation from;
+		PoolAllocation to;
+	};
+
+	DeviceMemoryPool() = default;
+
+	DeviceMemoryPool(const DeviceMemoryPool&) = delete;
+	DeviceMemoryPool& operator=(const DeviceMemoryPool&) = delete;
+
+	// BLOCKS ARE COUNTED IN tracker LIKE ANY OTHER vkAllocateMemory
+	void init(vk::Device device, MemoryTracker* tracker, vk::DeviceSize blockSize);
+
+	vk::DeviceSize blockSize() const { return defaultBlockSize; }
+
+	// ANYTHING OVER HALF A BLOCK GETS A BLOCK OF ITS OWN, THOSE ARE NEVER MOVED
+	PoolAllocation allocate(const vk::MemoryRequirements& requirements, uint32_t memoryType, MemoryCategory category, uint64_t owner);
+	void free(const PoolAllocation& allocation);
+
+	// UP TO byteBudget BYTES OF MOVES (AT LEAST ONE IF THERE IS ANY), THE to RANGES ARE ALREADY
+	// RESERVED. free EVERY from ONCE THE COPY IS DONE AND NOTHING READS IT ANY MORE
+	std::vector<Move> planDefragmentation(vk::DeviceSize byteBudget);
+	// THE OWNER WAS GONE, GIVES to BACK (from IS STILL FREED BY WHOEVER OWNS IT)
+	void cancelMove(const Move& move);
+
+	// DEVICE MUST BE IDLE, FREES EVERY BLOCK
+	void clear();
+
+	DeviceMemoryPoolStats stats() const;
+
+	void report(std::ostream& out) const;
+
+private:
+	struct Live {
+		vk::DeviceSize size;
+		vk::DeviceSize alignment;
+		uint64_t owner;
+		// ALREADY COPIED SOMEWHERE ELSE, ONLY WAITING TO BE FREED
+		bool moved = false;
+	};
+
+	struct Block {
+		vk::DeviceMemory memory;
+		vk::DeviceSize size = 0;
+		vk::DeviceSize used = 0;
+		uint32_t memoryType = 0;
+		MemoryCategory category = MemoryCategory::Texture;
+		// ONE ALLOCATION, NEVER A SOURCE OR A DESTINATION
+		bool dedicated = false;
+		// BEING EMPTIED, NOTHING NEW GOES IN
+		bool evacuating = false;
+		// OFFSET TO SIZE, NEIGHBOURS ARE ALWAYS MERGED
+		std::map<vk::DeviceSize, vk::DeviceSize> freeRanges;
+		// OFFSET TO WHAT IS THERE
+		std::map<vk::DeviceSize, Live> live;
+	};
+
+	// LOCK HELD
+	Block* newBlock(vk::DeviceSize size, uint32_t memoryType, MemoryCategory category);
+	void freeBlock(size_t index);
+	// BEST FIT, FALSE IF IT DOES NOT FIT
+	bool place(Block& block, vk::DeviceSize size, vk::DeviceSize alignment, uint64_t owner, vk::DeviceSize& offset);
+	void release(Block& block, vk::DeviceSize offset);
+	static vk::DeviceSize largestFreeRange(const Block& block);
+
+	mutable std::mutex mutex;
+	vk::Device device;
+	MemoryTracker* tracker = nullptr;
+	vk::DeviceSize defaultBlockSize = 0;
+
+	std::vector<std::unique_ptr<Block>> blocks;
+	uint64_t blocksAllocated = 0;
+	uint64_t blocksFreed = 0;
+	uint64_t moves = 0;
+	vk::DeviceSize movedBytes = 0;
+};
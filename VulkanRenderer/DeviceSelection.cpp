@@ -0,0 +1,108 @@
+#include "VulkanRenderer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+// DEVICE SELECTION
+// EVERY SUITABLE DEVICE IS SCORED AND THE HIGHEST ONE IS USED. THE TYPE COUNTS THE MOST,
+// A DISCRETE GPU BEATS AN INTEGRATED ONE WHATEVER ELSE THEY HAVE. THEN EVERY FEATURE AN
+// OPTION ASKED FOR (OTHERWISE THAT OPTION IS TURNED OFF LATER), THEN QUEUE FAMILIES THAT
+// CAN RUN NEXT TO GRAPHICS, AND LAST THE DEVICE LOCAL MEMORY.
+// --gpu= SKIPS THE SCORE AND TAKES THE FIRST SUITABLE DEVICE IT NAMES
+
+static const uint64_t TYPE_WEIGHT = 1000000;
+static const uint64_t FEATURE_WEIGHT = 100000;
+static const uint64_t QUEUE_WEIGHT = 10000;
+
+static uint64_t deviceTypeRank(vk::PhysicalDeviceType type) {
+	switch (type) {
+	case vk::PhysicalDeviceType::eDiscreteGpu: return 4;
+	case vk::PhysicalDeviceType::eIntegratedGpu: return 3;
+	case vk::PhysicalDeviceType::eVirtualGpu: return 2;
+	case vk::PhysicalDeviceType::eCpu: return 1;
+	default: return 0;
+	}
+}
+
+static std::string toLower(std::string text) {
+	std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return text;
+}
+
+// 32 LOWERCASE HEX DIGITS, EMPTY BEFORE VULKAN 1.1
+static std::string deviceUuid(const vk::PhysicalDevice& device) {
+	if (device.getProperties().apiVersion < VK_API_VERSION_1_1) {
+		return "";
+	}
+
+	auto properties = device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceIDProperties>();
+	const auto& uuid = properties.get<vk::PhysicalDeviceIDProperties>().deviceUUID;
+
+	std::string text;
+	char digits[3];
+	for (uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+		snprintf(digits, sizeof(digits), "%02x", uuid[i]);
+		text += digits;
+	}
+	return text;
+}
+
+static uint64_t deviceLocalMegabytes(const vk::PhysicalDevice& device) {
+	auto memory = device.getMemoryProperties();
+
+	vk::DeviceSize bytes = 0;
+	for (uint32_t i = 0; i < memory.memoryHeapCount; i++) {
+		if (memory.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+			bytes += memory.memoryHeaps[i].size;
+		}
+	}
+	return bytes / (1024 * 1024);
+}
+
+uint64_t VulkanRenderer::scorePhysicalDevice(const vk::PhysicalDevice& device) {
+	auto properties = device.getProperties();
+	uint64_t score = deviceTypeRank(properties.deviceType) * TYPE_WEIGHT;
+
+	// ONLY WHAT IS ASKED FOR, A DEVICE IS NOT BETTER FOR A FEATURE NOBODY USES
+	if (stereo && properties.apiVersion >= VK_API_VERSION_1_1) {
+		auto features = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceMultiviewFeatures>();
+		if (features.get<vk::PhysicalDeviceMultiviewFeatures>().multiview) {
+			score += FEATURE_WEIGHT;
+		}
+	}
+	if (postProcess && device.getFeatures().shaderStorageImageWriteWithoutFormat) {
+		score += FEATURE_WEIGHT;
+	}
+
+	QueueFamilyIndices indices = findQueueFamilies(device);
+	auto families = device.getQueueFamilyProperties();
+	if (dynamicResolution && families[indices.graphicsFamily.value()].timestampValidBits > 0) {
+		score += FEATURE_WEIGHT;
+	}
+
+	if (indices.computeFamily != indices.graphicsFamily) {
+		score += QUEUE_WEIGHT;
+	}
+	if (indices.transferFamily != indices.graphicsFamily) {
+		score += QUEUE_WEIGHT;
+	}
+
+	// IN 16 MB STEPS SO IT NEVER OUTWEIGHS A QUEUE
+	score += std::min<uint64_t>(deviceLocalMegabytes(device) / 16, QUEUE_WEIGHT - 1);
+	return score;
+}
+
+bool VulkanRenderer::matchesGpuOverride(const vk::PhysicalDevice& device) {
+	// THE UUID AS vulkaninfo PRINTS IT, WITH OR WITHOUT THE DASHES
+	std::string wanted = toLower(gpuOverride);
+	wanted.erase(std::remove(wanted.begin(), wanted.end(), '-'), wanted.end());
+	std::string uuid = deviceUuid(device);
+	if (!uuid.empty() && wanted == uuid) {
+		return true;
+	}
+
+	// OTHERWISE ANY PART OF THE NAME
+	std::string name = toLower(device.getProperties().deviceName);
+	return name.find(toLower(gpuOverride)) != std::string::npos;
+}
@@ -0,0 +1,33 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+ResolutionController::ResolutionController(float minScale, float maxScale)
+	: minScale(minScale), maxScale(maxScale), continuous(maxScale), current(maxScale) {
+}
+
+void ResolutionController::setMinScale(float scale) {
+	minScale = std::min(scale, maxScale);
+	continuous = std::max(continuous, minScale);
+	current = std::max(current, minScale);
+}
+
+float ResolutionController::update(float gpuMilliseconds) {
+	// ONE SLOW FRAME SHOULD NOT DROP THE RESOLUTION
+	smoothed = samples == 0 ? gpuMilliseconds : smoothed + (gpuMilliseconds - smoothed) * SMOOTHING;
+	samples++;
+
+	// THE TIME WAS MEASURED AT current, SO THAT IS WHAT WE CORRECT
+	float budget = targetMilliseconds * HEADROOM;
+	float ideal = current * std::sqrt(budget / std::max(smoothed, 0.01f));
+
+	continuous = std::clamp(ideal, continuous - MAX_CHANGE, continuous + MAX_CHANGE);
+	continuous = std::clamp(continuous, minScale, maxScale);
+
+	// ONLY SNAP TO A NEW STEP ONCE WE ARE A WHOLE STEP AWAY
+	if (std::fabs(continuous - current) >= STEP) {
+		current = std::clamp(std::round(continuous / STEP) * STEP, minScale, maxScale);
+	}
+	return current;
+}
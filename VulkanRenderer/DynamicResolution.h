@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+
+// PICKS THE RENDER SCALE FOR THE NEXT FRAME FROM THE MEASURED GPU TIME
+// THE COST OF A FRAME GOES ROUGHLY WITH THE NUMBER OF PIXELS, SO WITH
+// THE SQUARE OF THE SCALE. THE SCALE ONLY MOVES IN FIXED STEPS SO THE
+// PICTURE DOES NOT SWIM BETWEEN TWO SIZES EVERY FRAME
+class ResolutionController {
+public:
+	ResolutionController(float minScale = 0.5f, float maxScale = 1.0f);
+
+	void setTargetFrameTime(float milliseconds) { targetMilliseconds = milliseconds; }
+	void setMinScale(float scale);
+
+	// FEED ONE GPU FRAME TIME, RETURNS THE SCALE TO RENDER THE NEXT FRAME AT
+	float update(float gpuMilliseconds);
+
+	float scale() const { return current; }
+	float smoothedFrameTime() const { return smoothed; }
+	size_t sampleCount() const { return samples; }
+
+private:
+	// HOW MUCH OF THE TARGET WE ACTUALLY AIM FOR, THE REST IS FOR SPIKES
+	static constexpr float HEADROOM = 0.9f;
+	// WEIGHT OF A NEW SAMPLE IN THE MOVING AVERAGE
+	static constexpr float SMOOTHING = 0.1f;
+	// THE CONTINUOUS SCALE MOVES AT MOST THIS MUCH PER FRAME
+	static constexpr float MAX_CHANGE = 0.02f;
+	// THE SCALE WE REALLY RENDER AT IS A MULTIPLE OF THIS
+	static constexpr float STEP = 0.05f;
+
+	float minScale;
+	float maxScale;
+	float targetMilliseconds = 1000.0f / 60.0f;
+
+	float smoothed = 0.0f;
+	float continuous;
+	float current;
+	size_t samples = 0;
+};
@@ -0,0 +1,86 @@
+#include "FrameLatency.h"
+
+#include <algorithm>
+#include <iomanip>
+
+static float millisecondsBetween(FrameLatencyTracker::Clock::time_point from, FrameLatencyTracker::Clock::time_point to) {
+	return std::chrono::duration<float, std::milli>(to - from).count();
+}
+
+FrameLatencyTracker::FrameLatencyTracker(size_t capacity) : capacity(capacity) {
+	samples.reserve(capacity);
+}
+
+void FrameLatencyTracker::markInputSample(Clock::time_point time) {
+	inputSample = time;
+}
+
+void FrameLatencyTracker::markAcquired() {
+	acquired = Clock::now();
+}
+
+void FrameLatencyTracker::markSubmitted() {
+	submitted = Clock::now();
+}
+
+void FrameLatencyTracker::markPresented() {
+	auto now = Clock::now();
+
+	Sample sample;
+	sample.inputToAcquire = millisecondsBetween(inputSample, acquired);
+	sample.inputToSubmit = millisecondsBetween(inputSample, submitted);
+	sample.inputToPresent = millisecondsBetween(inputSample, now);
+	// FIRST FRAME HAS NOTHING TO COMPARE TO
+	sample.frameInterval = hasLastPresent ? millisecondsBetween(lastPresent, now) : 0.0f;
+
+	lastPresent = now;
+	hasLastPresent = true;
+
+	// RING BUFFER SO LONG RUNS DO NOT GROW FOREVER
+	if (samples.size() < capacity) {
+		samples.push_back(sample);
+	}
+	else {
+		samples[next] = sample;
+	}
+	next = (next + 1) % capacity;
+	totalFrames++;
+}
+
+void FrameLatencyTracker::report(std::ostream& out, const std::string& label) const {
+	if (samples.empty()) {
+		out << "latency [" << label << "]: no frames recorded\n";
+		return;
+	}
+
+	auto printRow = [&](const char* name, float Sample::* field, bool skipFirst) {
+		std::vector<float> values;
+		values.reserve(samples.size());
+		for (size_t i = 0; i < samples.size(); i++) {
+			if (skipFirst && totalFrames == samples.size() && i == 0) continue;
+			values.push_back(samples[i].*field);
+		}
+		if (values.empty()) return;
+
+		std::sort(values.begin(), values.end());
+		auto percentile = [&](float p) {
+			size_t index = static_cast<size_t>(p * (values.size() - 1));
+			return values[index];
+		};
+		float sum = 0.0f;
+		for (float v : values) sum += v;
+
+		out << "  " << std::left << std::setw(18) << name << std::right << std::fixed << std::setprecision(3)
+			<< " avg " << std::setw(8) << sum / values.size()
+			<< " p50 " << std::setw(8) << percentile(0.50f)
+			<< " p95 " << std::setw(8) << percentile(0.95f)
+			<< " p99 " << std::setw(8) << percentile(0.99f)
+			<< " max " << std::setw(8) << values.back() << " ms\n";
+	};
+
+	out << "latency [" << label << "] over the last " << samples.size() << " of " << totalFrames << " frames\n";
+	printRow("input->acquire", &Sample::inputToAcquire, false);
+	printRow("input->submit", &Sample::inputToSubmit, false);
+	printRow("input->present", &Sample::inputToPresent, false);
+	printRow("frame interval", &Sample::frameInterval, true);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <ostream>
+
+// MEASURES HOW LONG IT TAKES FROM THE MOMENT WE SAMPLE INPUT
+// IN mainLoop UNTIL THE FRAME IS SUBMITTED AND PRESENTED.
+// ALL TIMES ARE CPU TIMESTAMPS, PRESENT IS THE MOMENT presentKHR
+// RETURNS (NOT THE MOMENT THE IMAGE IS ON SCREEN)
+class FrameLatencyTracker {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// HOW MANY FRAMES WE KEEP, OLDER ONES GET OVERWRITTEN
+	explicit FrameLatencyTracker(size_t capacity = 8192);
+
+	void markInputSample(Clock::time_point time);
+	// AFTER THE FENCE WAIT AND IMAGE ACQUIRE
+	void markAcquired();
+	void markSubmitted();
+	void markPresented();
+
+	size_t frameCount() const { return totalFrames; }
+
+	void report(std::ostream& out, const std::string& label) const;
+
+private:
+	struct Sample {
+		float inputToAcquire;
+		float inputToSubmit;
+		float inputToPresent;
+		float frameInterval;
+	};
+
+	size_t capacity;
+	size_t next = 0;
+	size_t totalFrames = 0;
+	std::vector<Sample> samples;
+
+	Clock::time_point inputSample;
+	Clock::time_point acquired;
+	Clock::time_point submitted;
+	Clock::time_point lastPresent;
+	bool hasLastPresent = false;
+};
@@ -0,0 +1,511 @@
+#include "AssetLoading.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+// glTF 2.0 BINARY CONTAINER
+// 12 BYTE HEADER ("glTF", VERSION 2, TOTAL LENGTH), THEN A JSON CHUNK AND
+// AN OPTIONAL BIN CHUNK, EVERY CHUNK IS (LENGTH, TYPE, DATA)
+// ONLY THE JSON IS PARSED, THE BIN CHUNK IS NEVER COPIED HERE
+
+namespace {
+
+const uint32_t GLB_MAGIC = 0x46546C67;
+const uint32_t CHUNK_JSON = 0x4E4F534A;
+const uint32_t CHUNK_BIN = 0x004E4942;
+
+// glTF componentType VALUES (THE GL ENUMS)
+const uint32_t COMPONENT_BYTE = 5120;
+const uint32_t COMPONENT_UNSIGNED_BYTE = 5121;
+const uint32_t COMPONENT_SHORT = 5122;
+const uint32_t COMPONENT_UNSIGNED_SHORT = 5123;
+const uint32_t COMPONENT_UNSIGNED_INT = 5125;
+const uint32_t COMPONENT_FLOAT = 5126;
+
+const uint32_t MODE_TRIANGLES = 4;
+
+// THE SHADER ATTRIBUTES (Vertex.vert)
+const uint32_t LOCATION_POSITION = 0;
+const uint32_t LOCATION_COLOR = 1;
+const uint32_t LOCATION_TEXCOORD = 2;
+
+// WHAT MISSING ATTRIBUTES READ, BOUND WITH STRIDE 0
+const float DEFAULT_COLOR[3] = { 1.0f, 1.0f, 1.0f };
+const float DEFAULT_TEXCOORD[2] = { 0.0f, 0.0f };
+
+// ENOUGH JSON FOR A glTF HEADER
+struct JsonValue {
+	enum class Type {
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	Type type = Type::Null;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> array;
+	std::vector<std::pair<std::string, JsonValue>> object;
+
+	const JsonValue* find(const char* key) const {
+		for (const auto& member : object) {
+			if (member.first == key) return &member.second;
+		}
+		return nullptr;
+	}
+};
+
+class JsonParser {
+public:
+	JsonParser(const char* begin, const char* end) : cursor(begin), end(end) {}
+
+	JsonValue parseDocument() {
+		JsonValue value = parseValue();
+		skipSpaces();
+		if (cursor != end) fail();
+		return value;
+	}
+
+private:
+	[[noreturn]] void fail() {
+		throw std::runtime_error("failed to parse glb json!");
+	}
+
+	void skipSpaces() {
+		while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r')) cursor++;
+	}
+
+	void expect(char c) {
+		skipSpaces();
+		if (cursor >= end || *cursor != c) fail();
+		cursor++;
+	}
+
+	bool consume(const char* literal) {
+		size_t length = std::strlen(literal);
+		if (static_cast<size_t>(end - cursor) < length || std::memcmp(cursor, literal, length) != 0) return false;
+		cursor += length;
+		return true;
+	}
+
+	JsonValue parseValue() {
+		skipSpaces();
+		if (cursor >= end) fail();
+
+		JsonValue value;
+		switch (*cursor) {
+		case '{':
+			value.type = JsonValue::Type::Object;
+			cursor++;
+			skipSpaces();
+			if (cursor < end && *cursor == '}') {
+				cursor++;
+				return value;
+			}
+			while (true) {
+				skipSpaces();
+				std::string key = parseString();
+				expect(':');
+				value.object.emplace_back(std::move(key), parseValue());
+				skipSpaces();
+				if (cursor < end && *cursor == ',') {
+					cursor++;
+					continue;
+				}
+				expect('}');
+				return value;
+			}
+		case '[':
+			value.type = JsonValue::Type::Array;
+			cursor++;
+			skipSpaces();
+			if (cursor < end && *cursor == ']') {
+				cursor++;
+				return value;
+			}
+			while (true) {
+				value.array.push_back(parseValue());
+				skipSpaces();
+				if (cursor < end && *cursor == ',') {
+					cursor++;
+					continue;
+				}
+				expect(']');
+				return value;
+			}
+		case '"':
+			value.type = JsonValue::Type::String;
+			value.string = parseString();
+			return value;
+		default:
+			if (consume("true")) {
+				value.type = JsonValue::Type::Bool;
+				value.boolean = true;
+				return value;
+			}
+			if (consume("false")) {
+				value.type = JsonValue::Type::Bool;
+				return value;
+			}
+			if (consume("null")) {
+				return value;
+			}
+			value.type = JsonValue::Type::Number;
+			{
+				auto result = std::from_chars(cursor, end, value.number);
+				if (result.ec != std::errc()) fail();
+				cursor = result.ptr;
+			}
+			return value;
+		}
+	}
+
+	std::string parseString() {
+		if (cursor >= end || *cursor != '"') fail();
+		cursor++;
+
+		std::string result;
+		while (cursor < end && *cursor != '"') {
+			char c = *cursor++;
+			if (c != '\\') {
+				result += c;
+				continue;
+			}
+			if (cursor >= end) fail();
+			switch (char escaped = *cursor++) {
+			case 'b': result += '\b'; break;
+			case 'f': result += '\f'; break;
+			case 'n': result += '\n'; break;
+			case 'r': result += '\r'; break;
+			case 't': result += '\t'; break;
+			case 'u': {
+				// NAMES AND URIS, NO NEED TO JOIN SURROGATE PAIRS
+				unsigned int code = 0;
+				if (end - cursor < 4) fail();
+				auto parsed = std::from_chars(cursor, cursor + 4, code, 16);
+				if (parsed.ptr != cursor + 4) fail();
+				cursor += 4;
+				if (code < 0x80) {
+					result += static_cast<char>(code);
+				}
+				else if (code < 0x800) {
+					result += static_cast<char>(0xC0 | (code >> 6));
+					result += static_cast<char>(0x80 | (code & 0x3F));
+				}
+				else {
+					result += static_cast<char>(0xE0 | (code >> 12));
+					result += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+					result += static_cast<char>(0x80 | (code & 0x3F));
+				}
+				break;
+			}
+			default: result += escaped; break;
+			}
+		}
+		if (cursor >= end) fail();
+		cursor++;
+		return result;
+	}
+
+	const char* cursor;
+	const char* end;
+};
+
+uint32_t readU32(const char* data) {
+	uint32_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+// AN ACCESSOR RESOLVED AGAINST ITS BUFFER VIEW
+struct Accessor {
+	size_t view = 0;
+	// FROM THE START OF THE BIN CHUNK
+	size_t viewOffset = 0;
+	size_t viewLength = 0;
+	// FROM THE START OF THE VIEW
+	size_t offset = 0;
+	// 0 WHEN THE VIEW IS TIGHTLY PACKED
+	size_t viewStride = 0;
+	size_t count = 0;
+	uint32_t componentType = 0;
+	uint32_t components = 0;
+	bool normalized = false;
+	const JsonValue* json = nullptr;
+
+	size_t componentSize() const {
+		switch (componentType) {
+		case COMPONENT_BYTE: case COMPONENT_UNSIGNED_BYTE: return 1;
+		case COMPONENT_SHORT: case COMPONENT_UNSIGNED_SHORT: return 2;
+		default: return 4;
+		}
+	}
+
+	size_t elementSize() const { return componentSize() * components; }
+	size_t stride() const { return viewStride ? viewStride : elementSize(); }
+};
+
+class GlbReader {
+public:
+	GlbReader(const std::string& path, const JsonValue& root, const char* bin, size_t binSize)
+		: path(path), root(root), bin(bin), binSize(binSize) {}
+
+	[[noreturn]] void fail(const std::string& reason) const {
+		throw std::runtime_error("failed to load " + path + ", " + reason + "!");
+	}
+
+	const JsonValue& member(const JsonValue& object, const char* key) const {
+		const JsonValue* value = object.find(key);
+		if (!value) fail(std::string("missing '") + key + "'");
+		return *value;
+	}
+
+	const JsonValue& element(const char* arrayName, size_t index) const {
+		const JsonValue& array = member(root, arrayName);
+		if (array.type != JsonValue::Type::Array || index >= array.array.size()) {
+			fail(std::string("bad ") + arrayName + " index " + std::to_string(index));
+		}
+		return array.array[index];
+	}
+
+	static size_t number(const JsonValue& object, const char* key, size_t fallback) {
+		const JsonValue* value = object.find(key);
+		return value && value->type == JsonValue::Type::Number ? static_cast<size_t>(value->number) : fallback;
+	}
+
+	Accessor accessor(size_t index) const {
+		const JsonValue& json = element("accessors", index);
+		if (json.find("sparse")) fail("sparse accessors are not supported");
+		if (!json.find("bufferView")) fail("accessors without a buffer view are not supported");
+
+		Accessor result;
+		result.json = &json;
+		result.view = number(json, "bufferView", 0);
+		result.offset = number(json, "byteOffset", 0);
+		result.count = number(json, "count", 0);
+		result.componentType = static_cast<uint32_t>(number(json, "componentType", 0));
+		const JsonValue* normalized = json.find("normalized");
+		result.normalized = normalized && normalized->boolean;
+
+		const std::string& type = member(json, "type").string;
+		if (type == "SCALAR") result.components = 1;
+		else if (type == "VEC2") result.components = 2;
+		else if (type == "VEC3") result.components = 3;
+		else if (type == "VEC4") result.components = 4;
+		else fail("unsupported accessor type " + type);
+
+		const JsonValue& view = element("bufferViews", result.view);
+		if (number(view, "buffer", 0) != 0) fail("only the embedded buffer is supported");
+		result.viewOffset = number(view, "byteOffset", 0);
+		result.viewLength = number(view, "byteLength", 0);
+		result.viewStride = number(view, "byteStride", 0);
+
+		if (result.viewOffset + result.viewLength > binSize) fail("buffer view outside the bin chunk");
+		if (result.count > 0 && result.offset + (result.count - 1) * result.stride() + result.elementSize() > result.viewLength) {
+			fail("accessor outside its buffer view");
+		}
+		return result;
+	}
+
+	const char* data(const Accessor& accessor) const {
+		return bin + accessor.viewOffset + accessor.offset;
+	}
+
+	vk::Format vertexFormat(const Accessor& accessor) const {
+		static const vk::Format floats[] = { vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat };
+		static const vk::Format unorm8[] = { vk::Format::eR8Unorm, vk::Format::eR8G8Unorm, vk::Format::eR8G8B8Unorm, vk::Format::eR8G8B8A8Unorm };
+		static const vk::Format snorm8[] = { vk::Format::eR8Snorm, vk::Format::eR8G8Snorm, vk::Format::eR8G8B8Snorm, vk::Format::eR8G8B8A8Snorm };
+		static const vk::Format unorm16[] = { vk::Format::eR16Unorm, vk::Format::eR16G16Unorm, vk::Format::eR16G16B16Unorm, vk::Format::eR16G16B16A16Unorm };
+		static const vk::Format snorm16[] = { vk::Format::eR16Snorm, vk::Format::eR16G16Snorm, vk::Format::eR16G16B16Snorm, vk::Format::eR16G16B16A16Snorm };
+
+		uint32_t c = accessor.components - 1;
+		switch (accessor.componentType) {
+		case COMPONENT_FLOAT: return floats[c];
+		// THE SHADER READS FLOATS, INTEGER DATA ONLY WORKS NORMALIZED
+		case COMPONENT_UNSIGNED_BYTE: if (accessor.normalized) return unorm8[c]; break;
+		case COMPONENT_BYTE: if (accessor.normalized) return snorm8[c]; break;
+		case COMPONENT_UNSIGNED_SHORT: if (accessor.normalized) return unorm16[c]; break;
+		case COMPONENT_SHORT: if (accessor.normalized) return snorm16[c]; break;
+		default: break;
+		}
+		fail("unsupported vertex attribute format");
+	}
+
+	// POSITION min / max ARE REQUIRED BY THE SPEC, ONLY BROKEN EXPORTERS MAKE US READ THE DATA
+	void bounds(const Accessor& position, glm::vec3& boundsMin, glm::vec3& boundsMax) const {
+		const JsonValue* minimum = position.json->find("min");
+		const JsonValue* maximum = position.json->find("max");
+		if (minimum && maximum && minimum->array.size() >= 3 && maximum->array.size() >= 3) {
+			for (int i = 0; i < 3; i++) {
+				boundsMin[i] = static_cast<float>(minimum->array[i].number);
+				boundsMax[i] = static_cast<float>(maximum->array[i].number);
+			}
+			return;
+		}
+
+		if (position.componentType != COMPONENT_FLOAT || position.components < 3) fail("positions without min / max must be floats");
+		boundsMin = glm::vec3(std::numeric_limits<float>::max());
+		boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+		for (size_t i = 0; i < position.count; i++) {
+			glm::vec3 value;
+			std::memcpy(&value, data(position) + i * position.stride(), sizeof(value));
+			boundsMin = glm::min(boundsMin, value);
+			boundsMax = glm::max(boundsMax, value);
+		}
+	}
+
+private:
+	const std::string& path;
+	const JsonValue& root;
+	const char* bin;
+	size_t binSize;
+};
+
+vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+GlbFile::GlbFile(const std::string& path) : file(std::make_unique<MappedFile>(path)) {
+	const char* data = file->data();
+	size_t size = file->size();
+
+	if (size < 20 || readU32(data) != GLB_MAGIC) {
+		throw std::runtime_error("failed to load " + path + ", not a glb file!");
+	}
+	if (readU32(data + 4) != 2) {
+		throw std::runtime_error("failed to load " + path + ", only glTF 2.0 is supported!");
+	}
+	size = std::min<size_t>(size, readU32(data + 8));
+
+	size_t jsonLength = readU32(data + 12);
+	if (readU32(data + 16) != CHUNK_JSON || 20 + jsonLength > size) {
+		throw std::runtime_error("failed to load " + path + ", bad json chunk!");
+	}
+	JsonValue root = JsonParser(data + 20, data + 20 + jsonLength).parseDocument();
+
+	// THE BIN CHUNK IS OPTIONAL, A FILE WITHOUT ONE HAS NOTHING WE CAN DRAW
+	const char* bin = nullptr;
+	size_t binSize = 0;
+	size_t binHeader = 20 + jsonLength;
+	if (binHeader + 8 <= size && readU32(data + binHeader + 4) == CHUNK_BIN) {
+		binSize = std::min<size_t>(readU32(data + binHeader), size - binHeader - 8);
+		bin = data + binHeader + 8;
+	}
+
+	GlbReader reader(path, root, bin, binSize);
+
+	const JsonValue* buffers = root.find("buffers");
+	if (!bin || !buffers || buffers->array.empty() || buffers->array[0].find("uri")) {
+		reader.fail("only glb files with an embedded buffer are supported");
+	}
+
+	const JsonValue& meshes = reader.member(root, "meshes");
+	const JsonValue& primitives = reader.member(reader.element("meshes", 0), "primitives");
+	if (primitives.array.empty()) reader.fail("the first mesh has no primitives");
+	if (meshes.array.size() > 1 || primitives.array.size() > 1) {
+		std::cout << "glb: " << path << " has more than one primitive, only the first one is drawn\n";
+	}
+	const JsonValue& primitive = primitives.array[0];
+	if (GlbReader::number(primitive, "mode", MODE_TRIANGLES) != MODE_TRIANGLES) {
+		reader.fail("only triangle lists are supported");
+	}
+
+	// VERTEX STREAMS
+	// EVERY BUFFER VIEW AN ATTRIBUTE USES IS COPIED ONCE, AS IS, ATTRIBUTES THAT
+	// SHARE AN INTERLEAVED VIEW GET ONE BINDING EACH OVER THE SAME BYTES
+	const JsonValue& attributes = reader.member(primitive, "attributes");
+	std::vector<std::pair<size_t, vk::DeviceSize>> placedViews;
+	auto addStream = [&](uint32_t location, vk::Format format, vk::DeviceSize offset, uint32_t stride) {
+		uint32_t binding = static_cast<uint32_t>(source.layout.bindings.size());
+		source.layout.bindings.push_back({ binding, stride, vk::VertexInputRate::eVertex });
+		source.layout.attributes.push_back({ location, binding, format, 0 });
+		source.layout.offsets.push_back(offset);
+	};
+	auto addAttribute = [&](const char* name, uint32_t location, const void* fallback, size_t fallbackSize, vk::Format fallbackFormat) {
+		const JsonValue* index = attributes.find(name);
+		if (!index) {
+			// CONSTANT, EVERY VERTEX READS THE SAME BYTES
+			vk::DeviceSize offset = alignUp(source.vertexBufferSize, 16);
+			source.vertexRanges.push_back({ fallback, fallbackSize, offset });
+			source.vertexBufferSize = offset + fallbackSize;
+			addStream(location, fallbackFormat, offset, 0);
+			return;
+		}
+
+		Accessor accessor = reader.accessor(static_cast<size_t>(index->number));
+		auto placed = std::find_if(placedViews.begin(), placedViews.end(), [&](const auto& view) { return view.first == accessor.view; });
+		vk::DeviceSize viewOffset;
+		if (placed != placedViews.end()) {
+			viewOffset = placed->second;
+		}
+		else {
+			viewOffset = alignUp(source.vertexBufferSize, 16);
+			source.vertexRanges.push_back({ bin + accessor.viewOffset, accessor.viewLength, viewOffset });
+			source.vertexBufferSize = viewOffset + accessor.viewLength;
+			placedViews.push_back({ accessor.view, viewOffset });
+		}
+		addStream(location, reader.vertexFormat(accessor), viewOffset + accessor.offset, static_cast<uint32_t>(accessor.stride()));
+
+		if (location == LOCATION_POSITION) {
+			reader.bounds(accessor, source.boundsMin, source.boundsMax);
+		}
+	};
+	if (!attributes.find("POSITION")) reader.fail("the primitive has no positions");
+	addAttribute("POSITION", LOCATION_POSITION, nullptr, 0, vk::Format::eUndefined);
+	addAttribute("COLOR_0", LOCATION_COLOR, DEFAULT_COLOR, sizeof(DEFAULT_COLOR), vk::Format::eR32G32B32Sfloat);
+	addAttribute("TEXCOORD_0", LOCATION_TEXCOORD, DEFAULT_TEXCOORD, sizeof(DEFAULT_TEXCOORD), vk::Format::eR32G32Sfloat);
+
+	// INDICES
+	const JsonValue* indices = primitive.find("indices");
+	if (!indices) {
+		// NOT INDEXED, EVERY THREE VERTICES ARE A TRIANGLE
+		size_t vertexCount = reader.accessor(static_cast<size_t>(attributes.find("POSITION")->number)).count;
+		ownedIndices.resize(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++) ownedIndices[i] = static_cast<uint32_t>(i);
+		source.indexType = vk::IndexType::eUint32;
+		source.indexBufferSize = ownedIndices.size() * sizeof(uint32_t);
+		source.indexRanges = { { ownedIndices.data(), static_cast<size_t>(source.indexBufferSize), 0 } };
+		source.indexCount = static_cast<uint32_t>(ownedIndices.size());
+		return;
+	}
+
+	Accessor accessor = reader.accessor(static_cast<size_t>(indices->number));
+	if (accessor.components != 1 || accessor.viewStride != 0) reader.fail("indices must be tightly packed scalars");
+	source.indexCount = static_cast<uint32_t>(accessor.count);
+
+	switch (accessor.componentType) {
+	case COMPONENT_UNSIGNED_INT:
+		source.indexType = vk::IndexType::eUint32;
+		break;
+	case COMPONENT_UNSIGNED_SHORT:
+		source.indexType = vk::IndexType::eUint16;
+		break;
+	case COMPONENT_UNSIGNED_BYTE: {
+		// 8 BIT INDEX BUFFERS NEED VK_EXT_index_type_uint8, WIDEN THEM
+		const uint8_t* narrow = reinterpret_cast<const uint8_t*>(reader.data(accessor));
+		ownedIndices.assign(narrow, narrow + accessor.count);
+		source.indexType = vk::IndexType::eUint32;
+		source.indexBufferSize = ownedIndices.size() * sizeof(uint32_t);
+		source.indexRanges = { { ownedIndices.data(), static_cast<size_t>(source.indexBufferSize), 0 } };
+		return;
+	}
+	default:
+		reader.fail("unsupported index type");
+	}
+
+	source.indexBufferSize = accessor.count * accessor.componentSize();
+	source.indexRanges = { { reader.data(accessor), static_cast<size_t>(source.indexBufferSize), 0 } };
+}
+
+GlbFile::~GlbFile() = default;
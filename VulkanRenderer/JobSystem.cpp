@@ -0,0 +1,309 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// STATIC INITIALIZATION HAPPENS ON THE MAIN THREAD
+static const std::thread::id mainThreadId = std::this_thread::get_id();
+static thread_local int workerIndex = -1;
+
+JobSystem::~JobSystem() {
+	stop();
+}
+
+int JobSystem::currentWorkerIndex() {
+	return workerIndex;
+}
+
+bool JobSystem::isMainThread() {
+	return std::this_thread::get_id() == mainThreadId;
+}
+
+void JobSystem::start(uint32_t workerCount) {
+	if (started()) return;
+
+	if (workerCount == 0) {
+		uint32_t cores = std::thread::hardware_concurrency();
+		workerCount = cores > 1 ? cores - 1 : 1;
+	}
+
+	stopping.store(false);
+	queues.clear();
+	// SET BEFORE THE THREADS START, THEY READ IT WITHOUT LOCKING
+	activeWorkers = workerCount;
+	for (uint32_t i = 0; i < workerCount; i++) {
+		queues.push_back(std::make_unique<WorkQueue>());
+	}
+	for (uint32_t i = 0; i < workerCount; i++) {
+		workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+void JobSystem::stop() {
+	if (!started()) return;
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping.store(true);
+	}
+	wakeUp.notify_all();
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+	queues.clear();
+	activeWorkers = 0;
+
+	// MAIN THREAD JOBS NOBODY PUMPED, RUN THEM NOW SO COUNTERS REACH ZERO
+	pumpMainThread();
+}
+
+void JobSystem::run(JobFunction function, JobCounter* counter, JobCounter* dependency, JobAffinity affinity) {
+	if (counter) {
+		counter->pending.fetch_add(1, std::memory_order_acq_rel);
+	}
+
+	if (dependency) {
+		std::exception_ptr error;
+		{
+			std::unique_lock<std::mutex> lock(dependency->dependentsMutex);
+			// THE LAST JOB OF THE DEPENDENCY TAKES THE SAME LOCK BEFORE
+			// RELEASING ITS DEPENDENTS, SO WE CANNOT MISS IT
+			if (dependency->pending.load(std::memory_order_acquire) != 0) {
+				dependency->dependents.push_back({ std::move(function), counter, affinity });
+				return;
+			}
+			// ALREADY FAILED AND NOBODY HAS WAITED FOR IT YET
+			error = dependency->error;
+		}
+		if (error) {
+			skip(counter, error);
+			return;
+		}
+	}
+
+	schedule(std::move(function), counter, affinity);
+}
+
+void JobSystem::schedule(JobFunction function, JobCounter* counter, JobAffinity affinity) {
+	Job job{ std::move(function), counter };
+
+	// WITHOUT WORKERS EVERYTHING RUNS INLINE (EXCEPT MAIN THREAD WORK FROM OTHER THREADS)
+	if (!started() && (affinity == JobAffinity::Any || isMainThread())) {
+		execute(job);
+		return;
+	}
+
+	push(std::move(job), affinity);
+}
+
+void JobSystem::push(Job job, JobAffinity affinity) {
+	if (affinity == JobAffinity::MainThread) {
+		std::lock_guard<std::mutex> lock(mainQueue.mutex);
+		mainQueue.jobs.push_back(std::move(job));
+		return;
+	}
+
+	// WORKERS PUSH TO THEIR OWN DEQUE, EVERYONE ELSE SPREADS THE JOBS AROUND
+	uint32_t target = workerIndex >= 0
+		? static_cast<uint32_t>(workerIndex)
+		: nextQueue.fetch_add(1, std::memory_order_relaxed) % workerCount();
+
+	{
+		std::lock_guard<std::mutex> lock(queues[target]->mutex);
+		queues[target]->jobs.push_back(std::move(job));
+	}
+
+	queuedJobs.fetch_add(1, std::memory_order_release);
+	{
+		// TAKING THE LOCK HERE MEANS A WORKER CANNOT CHECK THE COUNT
+		// AND GO TO SLEEP BETWEEN OUR INCREMENT AND THE NOTIFY
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wakeUp.notify_one();
+}
+
+bool JobSystem::popOwn(uint32_t worker, Job& job) {
+	WorkQueue& queue = *queues[worker];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.jobs.empty()) return false;
+
+	job = std::move(queue.jobs.back());
+	queue.jobs.pop_back();
+	queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+bool JobSystem::steal(uint32_t thief, Job& job) {
+	uint32_t count = workerCount();
+	for (uint32_t i = 1; i <= count; i++) {
+		WorkQueue& queue = *queues[(thief + i) % count];
+		// DO NOT BLOCK ON A BUSY DEQUE, JUST TRY THE NEXT ONE
+		std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+		if (!lock.owns_lock() || queue.jobs.empty()) continue;
+
+		job = std::move(queue.jobs.front());
+		queue.jobs.pop_front();
+		queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
+
+bool JobSystem::findJob(Job& job) {
+	if (isMainThread()) {
+		std::lock_guard<std::mutex> lock(mainQueue.mutex);
+		if (!mainQueue.jobs.empty()) {
+			job = std::move(mainQueue.jobs.front());
+			mainQueue.jobs.pop_front();
+			return true;
+		}
+	}
+
+	if (!started()) return false;
+
+	if (workerIndex >= 0) {
+		return popOwn(static_cast<uint32_t>(workerIndex), job) || steal(static_cast<uint32_t>(workerIndex), job);
+	}
+	return steal(nextQueue.fetch_add(1, std::memory_order_relaxed) % workerCount(), job);
+}
+
+// NOBODY WAITS FOR A JOB WITHOUT A COUNTER, SO THIS IS THE ONLY PLACE ITS ERROR SHOWS UP
+static void printUnwaitedError(const char* what, std::exception_ptr error) {
+	try {
+		std::rethrow_exception(error);
+	}
+	catch (const std::exception& exception) {
+		std::cerr << what << ": " << exception.what() << "\n";
+	}
+	catch (...) {
+		std::cerr << what << "\n";
+	}
+}
+
+void JobSystem::execute(Job& job) {
+	PROFILE_ZONE("job");
+	try {
+		job.function();
+	}
+	catch (...) {
+		if (job.counter) {
+			fail(job.counter, std::current_exception());
+		}
+		else {
+			printUnwaitedError("job failed", std::current_exception());
+		}
+	}
+	finish(job.counter);
+}
+
+void JobSystem::fail(JobCounter* counter, std::exception_ptr error) {
+	// ONLY WHOEVER WAITS ON THIS COUNTER HEARS ABOUT IT, SET BEFORE finish SO wait SEES IT
+	std::lock_guard<std::mutex> lock(counter->dependentsMutex);
+	if (!counter->error) {
+		counter->error = error;
+	}
+}
+
+void JobSystem::skip(JobCounter* counter, std::exception_ptr error) {
+	// THE JOB WOULD WORK ON WHAT THE FAILED ONE NEVER PRODUCED, IT FAILS THE SAME WAY
+	// WITHOUT RUNNING, AND SO DOES EVERYTHING WAITING ON ITS COUNTER
+	if (counter) {
+		fail(counter, error);
+		finish(counter);
+	}
+	else {
+		printUnwaitedError("job skipped, a job it depended on failed", error);
+	}
+}
+
+void JobSystem::finish(JobCounter* counter) {
+	if (!counter) return;
+
+	// THE DECREMENT HAPPENS UNDER THE LOCK AND WE NEVER TOUCH THE COUNTER
+	// AFTER UNLOCKING, wait() TAKES THE SAME LOCK BEFORE RETURNING SO THE
+	// OWNER CAN SAFELY DESTROY THE COUNTER AS SOON AS wait() RETURNS
+	std::vector<JobCounter::Dependent> released;
+	std::exception_ptr error;
+	{
+		std::lock_guard<std::mutex> lock(counter->dependentsMutex);
+		if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			// WE WERE THE LAST ONE, RELEASE EVERYTHING WAITING ON THIS COUNTER
+			released.swap(counter->dependents);
+			// A COPY, THE ONE IN THE COUNTER IS STILL RETHROWN BY wait()
+			error = counter->error;
+		}
+	}
+	for (auto& dependent : released) {
+		if (error) {
+			skip(dependent.counter, error);
+		}
+		else {
+			schedule(std::move(dependent.function), dependent.counter, dependent.affinity);
+		}
+	}
+}
+
+void JobSystem::wait(JobCounter& counter) {
+	while (!counter.done()) {
+		Job job;
+		if (findJob(job)) {
+			execute(job);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+	std::exception_ptr error;
+	{
+		// MAKE SURE THE LAST finish() IS DONE WITH THE COUNTER
+		std::lock_guard<std::mutex> lock(counter.dependentsMutex);
+		std::swap(error, counter.error);
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+size_t JobSystem::pumpMainThread() {
+	size_t ran = 0;
+	while (true) {
+		Job job;
+		{
+			std::lock_guard<std::mutex> lock(mainQueue.mutex);
+			if (mainQueue.jobs.empty()) break;
+			job = std::move(mainQueue.jobs.front());
+			mainQueue.jobs.pop_front();
+		}
+		execute(job);
+		ran++;
+	}
+	return ran;
+}
+
+void JobSystem::workerLoop(uint32_t index) {
+	workerIndex = static_cast<int>(index);
+	profiler::setThreadName(profiler::intern("worker " + std::to_string(index)));
+
+	while (true) {
+		Job job;
+		if (popOwn(index, job) || steal(index, job)) {
+			execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wakeUp.wait(lock, [this]() {
+			return stopping.load() || queuedJobs.load(std::memory_order_acquire) > 0;
+		});
+		// DRAIN EVERYTHING BEFORE LEAVING
+		if (stopping.load() && queuedJobs.load(std::memory_order_acquire) == 0) {
+			break;
+		}
+	}
+
+	workerIndex = -1;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using JobFunction = std::function<void()>;
+
+// WHERE A JOB IS ALLOWED TO RUN
+// GLFW (AND ANYTHING TOUCHING THE WINDOW) MUST STAY ON THE MAIN THREAD
+enum class JobAffinity {
+	Any,
+	MainThread
+};
+
+// COUNTS HOW MANY JOBS ARE STILL RUNNING FOR SOMETHING
+// JOBS CAN BE MADE TO WAIT ON A COUNTER, THEY GET SCHEDULED
+// WHEN IT DROPS TO ZERO. IF ONE OF ITS JOBS THREW THEY ARE SKIPPED
+// INSTEAD AND THEIR OWN COUNTERS FAIL WITH THE SAME EXCEPTION
+class JobCounter {
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	// ONLY A HINT, USE JobSystem::wait BEFORE DESTROYING THE COUNTER
+	bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+	int value() const { return pending.load(std::memory_order_acquire); }
+
+private:
+	friend class JobSystem;
+
+	struct Dependent {
+		JobFunction function;
+		JobCounter* counter;
+		JobAffinity affinity;
+	};
+
+	std::atomic<int> pending{ 0 };
+	std::mutex dependentsMutex;
+	std::vector<Dependent> dependents;
+	// THE FIRST EXCEPTION ONE OF ITS JOBS THREW, UNDER dependentsMutex
+	std::exception_ptr error;
+};
+
+// WORK STEALING SCHEDULER
+// EVERY WORKER HAS ITS OWN DEQUE, IT PUSHES AND POPS AT THE BACK
+// (NEWEST FIRST, CACHE FRIENDLY) AND IDLE WORKERS STEAL FROM THE
+// FRONT OF SOMEONE ELSE'S DEQUE (OLDEST, USUALLY THE BIGGEST CHUNK)
+class JobSystem {
+public:
+	JobSystem() = default;
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// 0 WORKERS MEANS ONE PER CORE MINUS THE MAIN THREAD
+	// MUST BE CALLED FROM THE MAIN THREAD
+	void start(uint32_t workerCount = 0);
+
+	void stop();
+
+	bool started() const { return activeWorkers > 0; }
+
+	uint32_t workerCount() const { return activeWorkers; }
+
+	// THE COUNTER (IF ANY) IS INCREMENTED NOW AND DECREMENTED WHEN THE JOB FINISHES
+	// IF dependency IS GIVEN THE JOB IS HELD BACK UNTIL IT REACHES ZERO, AND NEVER RUNS
+	// IF A JOB OF dependency THREW (counter THEN FAILS WITH THAT EXCEPTION)
+	void run(JobFunction function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr, JobAffinity affinity = JobAffinity::Any);
+
+	// RUNS OTHER JOBS WHILE WAITING SO WAITING FROM INSIDE A JOB NEVER DEADLOCKS
+	// RETHROWS THE FIRST EXCEPTION ONE OF counter's JOBS THREW (OR A JOB THEY DEPENDED ON),
+	// JOBS WITHOUT A COUNTER ONLY GET THEIR ERROR PRINTED
+	void wait(JobCounter& counter);
+
+	// RUNS EVERYTHING QUEUED FOR THE MAIN THREAD, CALL IT FROM THE MAIN THREAD
+	// RETURNS HOW MANY JOBS RAN
+	size_t pumpMainThread();
+
+	// SPLITS [0, count) INTO CHUNKS OF grain AND WAITS FOR ALL OF THEM
+	// body IS CALLED AS body(begin, end)
+	template<typename Body>
+	void parallelFor(size_t count, size_t grain, Body&& body) {
+		if (count == 0) return;
+		if (grain == 0) grain = 1;
+
+		if (!started() || count <= grain) {
+			body(static_cast<size_t>(0), count);
+			return;
+		}
+
+		JobCounter counter;
+		for (size_t begin = 0; begin < count; begin += grain) {
+			size_t end = begin + grain < count ? begin + grain : count;
+			run([&body, begin, end]() { body(begin, end); }, &counter);
+		}
+		wait(counter);
+	}
+
+	// INDEX OF THE CALLING WORKER, -1 FOR THREADS THAT ARE NOT WORKERS
+	// USEFUL FOR PER THREAD RESOURCES LIKE COMMAND POOLS
+	static int currentWorkerIndex();
+
+	static bool isMainThread();
+
+private:
+	struct Job {
+		JobFunction function;
+		JobCounter* counter;
+	};
+
+	struct alignas(64) WorkQueue {
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	void push(Job job, JobAffinity affinity);
+	void schedule(JobFunction function, JobCounter* counter, JobAffinity affinity);
+	// A JOB THAT WILL NEVER RUN BECAUSE ITS DEPENDENCY FAILED WITH error
+	void skip(JobCounter* counter, std::exception_ptr error);
+	// KEEPS THE FIRST ERROR OF counter
+	void fail(JobCounter* counter, std::exception_ptr error);
+	bool popOwn(uint32_t worker, Job& job);
+	bool steal(uint32_t thief, Job& job);
+	bool findJob(Job& job);
+	void execute(Job& job);
+	void finish(JobCounter* counter);
+	void workerLoop(uint32_t index);
+
+	uint32_t activeWorkers = 0;
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	WorkQueue mainQueue;
+
+	std::atomic<bool> stopping{ false };
+	std::atomic<int> queuedJobs{ 0 };
+	std::atomic<uint32_t> nextQueue{ 0 };
+
+	std::mutex sleepMutex;
+	std::condition_variable wakeUp;
+};
@@ -0,0 +1,299 @@
+#include "VulkanRenderer.h"
+
+#include <cstring>
+#include <random>
+
+// CLUSTERED FORWARD LIGHTING
+// THE VIEW FRUSTUM IS CUT INTO clusterGrid.x * clusterGrid.y SCREEN TILES AND
+// clusterGrid.z EXPONENTIAL DEPTH SLICES (FROXELS). EVERY FRAME cluster.comp
+// TESTS THE LIGHTS AGAINST EVERY FROXEL AND WRITES ONE PACKED LIST OF LIGHT
+// INDICES PLUS AN (OFFSET, COUNT) PAIR PER FROXEL. THE FRAGMENT SHADER ONLY
+// LOOPS OVER THE LIGHTS OF ITS OWN FROXEL, SO ITS COST DEPENDS ON HOW MANY
+// LIGHTS OVERLAP A PIXEL, NOT ON HOW MANY LIGHTS THERE ARE
+// A FROXEL HAS NO LIMIT ON ITS LIGHTS, ALL OF THEM SHARE ONE POOL OF INDICES
+// SIZED FROM THE LIGHT COUNT. A FRAME THAT NEEDS MORE COUNTS WHAT IT DROPPED,
+// checkLightIndexPool WARNS AND GROWS THE POOL BEFORE THE IMAGE IS DRAWN AGAIN
+
+void VulkanRenderer::createLights() {
+	lights.resize(lightCount);
+	lightOrbitSpeeds.resize(lightCount);
+
+	glm::vec3 center = (modelBoundsMin + modelBoundsMax) * 0.5f;
+	glm::vec3 halfSize = glm::max((modelBoundsMax - modelBoundsMin) * 0.75f, glm::vec3(0.1f));
+
+	// THE RADIUS ONLY DEPENDS ON THE MODEL, SO MORE LIGHTS REALLY MEANS MORE LIGHTS PER PIXEL
+	// ("light binning" IN THE BENCHMARKS MEASURES HOW MANY EACH FROXEL GETS)
+	float radius = lightRadius * glm::length(halfSize);
+
+	// FIXED SEED, SAME LIGHTS EVERY RUN
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	for (uint32_t i = 0; i < lightCount; i++) {
+		glm::vec3 offset = glm::vec3(unit(random), unit(random), unit(random)) * 2.0f - 1.0f;
+		glm::vec3 color = glm::vec3(unit(random), unit(random), unit(random));
+
+		lights[i].positionRadius = glm::vec4(center + offset * halfSize, radius);
+		lights[i].colorIntensity = glm::vec4(color / std::max(color.r, std::max(color.g, color.b)), 1.0f);
+		lightOrbitSpeeds[i] = (unit(random) - 0.5f) * 2.0f;
+	}
+}
+
+void VulkanRenderer::createClusterBuffers() {
+	// SAME AS THE UNIFORMS, ONE SET PER SWAPCHAIN IMAGE SO A FRAME
+	// IN FLIGHT NEVER SEES THE NEXT FRAME'S LIGHTS
+	vk::DeviceSize lightBufferSize = sizeof(PointLight) * std::max<size_t>(lights.size(), 1);
+	vk::DeviceSize clusterBufferSize = sizeof(uint32_t) * 2 * clusterCount();
+
+	// A QUARTER OF THE LIGHTS IN EVERY CLUSTER, THE "light binning" BENCHMARK SCENE NEEDS
+	// AN EIGHTH. KEEPS WHAT AN EARLIER SWAPCHAIN GREW IT TO
+	if (lightIndexCapacity == 0) {
+		uint64_t indices = static_cast<uint64_t>(clusterCount()) * std::max<uint32_t>(lightCount / 4, 1);
+		lightIndexCapacity = static_cast<uint32_t>(std::min<uint64_t>(indices, maxLightIndexCapacity()));
+	}
+
+	lightBuffers.resize(swapChainImages.size());
+	lightBuffersMemory.resize(swapChainImages.size());
+	clusterBuffers.resize(swapChainImages.size());
+	clusterBuffersMemory.resize(swapChainImages.size());
+	lightIndexBuffers.resize(swapChainImages.size());
+	lightIndexBuffersMemory.resize(swapChainImages.size());
+	lightIndexBufferCapacities.resize(swapChainImages.size());
+	lightIndexReadbackBuffers.resize(swapChainImages.size());
+	lightIndexReadbackBuffersMemory.resize(swapChainImages.size());
+
+	for (size_t i = 0; i < swapChainImages.size(); i++) {
+		createBuffer(lightBufferSize, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, lightBuffers[i], lightBuffersMemory[i]);
+		createBuffer(clusterBufferSize, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, clusterBuffers[i], clusterBuffersMemory[i]);
+		createLightIndexBuffer(i);
+
+		// ZERO UNTIL THE IMAGE'S FIRST FRAME COPIES THE COUNTERS IN
+		createBuffer(LIGHT_INDEX_HEADER_SIZE, vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, lightIndexReadbackBuffers[i], lightIndexReadbackBuffersMemory[i]);
+		void* data = device->mapMemory(lightIndexReadbackBuffersMemory[i], 0, LIGHT_INDEX_HEADER_SIZE);
+		std::memset(data, 0, static_cast<size_t>(LIGHT_INDEX_HEADER_SIZE));
+		device->unmapMemory(lightIndexReadbackBuffersMemory[i]);
+	}
+}
+
+void VulkanRenderer::createLightIndexBuffer(size_t image) {
+	// THE TWO COUNTERS, THEN THE INDICES
+	vk::DeviceSize size = LIGHT_INDEX_HEADER_SIZE + sizeof(uint32_t) * static_cast<vk::DeviceSize>(lightIndexCapacity);
+	createBuffer(size, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eDeviceLocal, lightIndexBuffers[image], lightIndexBuffersMemory[image]);
+	lightIndexBufferCapacities[image] = lightIndexCapacity;
+}
+
+uint32_t VulkanRenderer::maxLightIndexCapacity() const {
+	// THE WHOLE POOL IS ONE STORAGE BUFFER DESCRIPTOR
+	vk::DeviceSize range = physicalDevice.getProperties().limits.maxStorageBufferRange;
+	return static_cast<uint32_t>((range - LIGHT_INDEX_HEADER_SIZE) / sizeof(uint32_t));
+}
+
+void VulkanRenderer::checkLightIndexPool(size_t image) {
+	auto counters = static_cast<const uint32_t*>(device->mapMemory(lightIndexReadbackBuffersMemory[image], 0, LIGHT_INDEX_HEADER_SIZE));
+	uint32_t needed = counters[0];
+	uint32_t overflow = counters[1];
+	device->unmapMemory(lightIndexReadbackBuffersMemory[image]);
+
+	if (overflow > 0) {
+		droppedLightIndices += overflow;
+		// A LITTLE EXTRA SO A CAMERA THAT KEEPS MOVING IN DOES NOT GROW IT EVERY FRAME
+		uint32_t grown = static_cast<uint32_t>(std::min<uint64_t>(needed + needed / 4ull, maxLightIndexCapacity()));
+		std::cerr << "warning: the light index pool overflowed, " << overflow << " light indices dropped ("
+			<< droppedLightIndices << " so far), growing it from " << lightIndexCapacity << " to " << grown << " indices\n";
+		lightIndexCapacity = std::max(lightIndexCapacity, grown);
+	}
+
+	// ANOTHER IMAGE MAY HAVE GROWN IT, NOTHING ON THE GPU USES THIS ONE NOW
+	if (lightIndexBufferCapacities[image] >= lightIndexCapacity) {
+		return;
+	}
+	device->destroyBuffer(lightIndexBuffers[image]);
+	freeMemory(lightIndexBuffersMemory[image]);
+	createLightIndexBuffer(image);
+
+	// BINDING 4 LIKE createDescriptorSets
+	vk::DescriptorBufferInfo bufferInfo;
+	bufferInfo.buffer = lightIndexBuffers[image];
+	bufferInfo.offset = 0;
+	bufferInfo.range = VK_WHOLE_SIZE;
+
+	vk::WriteDescriptorSet descriptorWrite;
+	descriptorWrite.dstSet = descriptorSets[image];
+	descriptorWrite.dstBinding = 4;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = vk::DescriptorType::eStorageBuffer;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pBufferInfo = &bufferInfo;
+	device->updateDescriptorSets(1, &descriptorWrite, 0, nullptr);
+
+	// THE COUNTER CLEAR AND THE COPY BACK NAME THE BUFFER
+	recordCommandBuffer(image);
+}
+
+void VulkanRenderer::destroyClusterBuffers() {
+	for (size_t i = 0; i < lightBuffers.size(); i++) {
+		device->destroyBuffer(lightBuffers[i]);
+		freeMemory(lightBuffersMemory[i]);
+		device->destroyBuffer(clusterBuffers[i]);
+		freeMemory(clusterBuffersMemory[i]);
+		device->destroyBuffer(lightIndexBuffers[i]);
+		freeMemory(lightIndexBuffersMemory[i]);
+		device->destroyBuffer(lightIndexReadbackBuffers[i]);
+		freeMemory(lightIndexReadbackBuffersMemory[i]);
+	}
+	lightBuffers.clear();
+	lightBuffersMemory.clear();
+	clusterBuffers.clear();
+	clusterBuffersMemory.clear();
+	lightIndexBuffers.clear();
+	lightIndexBuffersMemory.clear();
+	lightIndexBufferCapacities.clear();
+	lightIndexReadbackBuffers.clear();
+	lightIndexReadbackBuffersMemory.clear();
+}
+
+void VulkanRenderer::createClusterPipeline() {
+	auto computeShaderCode = readFile(SHADER_PATH + "cluster.spv");
+	vk::ShaderModule computeShaderModule = createShaderModule(computeShaderCode);
+
+	vk::PipelineShaderStageCreateInfo computeShaderStageInfo;
+	computeShaderStageInfo.stage = vk::ShaderStageFlagBits::eCompute;
+	computeShaderStageInfo.module = computeShaderModule;
+	computeShaderStageInfo.pName = "main";
+
+	// SAME DESCRIPTOR SET AS THE GRAPHICS PIPELINE, THE COMPUTE
+	// SHADER JUST IGNORES THE SAMPLER
+	vk::PipelineLayoutCreateInfo pipelineLayoutInfo;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+	try {
+		clusterPipelineLayout = device->createPipelineLayout(pipelineLayoutInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to create cluster Pipeline Layout!");
+	}
+
+	vk::ComputePipelineCreateInfo pipelineInfo;
+	pipelineInfo.stage = computeShaderStageInfo;
+	pipelineInfo.layout = clusterPipelineLayout;
+
+	vk::Result result;
+	std::tie(result, clusterPipeline) = device->createComputePipeline(nullptr, pipelineInfo);
+
+	if (result != vk::Result::eSuccess) {
+		throw std::runtime_error("failed to create cluster Pipeline!");
+	}
+
+	device->destroyShaderModule(computeShaderModule);
+}
+
+void VulkanRenderer::recordLightCulling(vk::CommandBuffer commandBuffer, size_t image) {
+	// RESET BOTH COUNTERS
+	commandBuffer.fillBuffer(lightIndexBuffers[image], 0, LIGHT_INDEX_HEADER_SIZE, 0);
+
+	vk::BufferMemoryBarrier clearBarrier;
+	clearBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	clearBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+	clearBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	clearBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	clearBarrier.buffer = lightIndexBuffers[image];
+	clearBarrier.offset = 0;
+	clearBarrier.size = VK_WHOLE_SIZE;
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+		{},
+		0, nullptr,
+		1, &clearBarrier,
+		0, nullptr);
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, clusterPipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, clusterPipelineLayout, 0, 1, &descriptorSets[image], 0, nullptr);
+	commandBuffer.dispatch((clusterCount() + CLUSTER_GROUP_SIZE - 1) / CLUSTER_GROUP_SIZE, 1, 1);
+
+	// THE FRAGMENT SHADER READS BOTH LISTS
+	std::array<vk::BufferMemoryBarrier, 2> listBarriers;
+	vk::Buffer lists[] = { clusterBuffers[image], lightIndexBuffers[image] };
+	for (size_t i = 0; i < listBarriers.size(); i++) {
+		listBarriers[i].srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+		listBarriers[i].dstAccessMask = vk::AccessFlagBits::eShaderRead;
+		listBarriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		listBarriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		listBarriers[i].buffer = lists[i];
+		listBarriers[i].offset = 0;
+		listBarriers[i].size = VK_WHOLE_SIZE;
+	}
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eFragmentShader,
+		{},
+		0, nullptr,
+		static_cast<uint32_t>(listBarriers.size()), listBarriers.data(),
+		0, nullptr);
+
+	// THE COUNTERS GO BACK TO THE HOST FOR checkLightIndexPool
+	vk::BufferMemoryBarrier counterBarrier;
+	counterBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+	counterBarrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+	counterBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	counterBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	counterBarrier.buffer = lightIndexBuffers[image];
+	counterBarrier.offset = 0;
+	counterBarrier.size = LIGHT_INDEX_HEADER_SIZE;
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer,
+		{},
+		0, nullptr,
+		1, &counterBarrier,
+		0, nullptr);
+
+	vk::BufferCopy copyRegion(0, 0, LIGHT_INDEX_HEADER_SIZE);
+	commandBuffer.copyBuffer(lightIndexBuffers[image], lightIndexReadbackBuffers[image], 1, &copyRegion);
+
+	// MAKES THE COPY VISIBLE TO THE HOST ONCE THE FENCE SIGNALS
+	vk::BufferMemoryBarrier hostBarrier;
+	hostBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	hostBarrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+	hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.buffer = lightIndexReadbackBuffers[image];
+	hostBarrier.offset = 0;
+	hostBarrier.size = VK_WHOLE_SIZE;
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+		{},
+		0, nullptr,
+		1, &hostBarrier,
+		0, nullptr);
+}
+
+void VulkanRenderer::updateLights(uint32_t currentImage) {
+	PROFILE_FUNCTION();
+	if (lights.empty()) return;
+
+	auto data = static_cast<PointLight*>(device->mapMemory(lightBuffersMemory[currentImage], 0, sizeof(PointLight) * lights.size()));
+
+	jobSystem.parallelFor(lights.size(), 1024, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			data[i].positionRadius = glm::vec4(orbitingLightPosition(i, frameSnapshot.tick), lights[i].positionRadius.w);
+			data[i].colorIntensity = lights[i].colorIntensity;
+		}
+	});
+
+	device->unmapMemory(lightBuffersMemory[currentImage]);
+}
+
+glm::vec3 VulkanRenderer::orbitingLightPosition(size_t i, uint64_t tick) const {
+	// LIGHTS ORBIT THE MODEL, TIME COMES FROM THE SIMULATION SO IT IS THE SAME ON EVERY MACHINE
+	float time = static_cast<float>(tick / simulationRate);
+	glm::vec3 center = (modelBoundsMin + modelBoundsMax) * 0.5f;
+
+	float angle = time * lightOrbitSpeeds[i];
+	float c = std::cos(angle);
+	float s = std::sin(angle);
+	glm::vec3 offset = glm::vec3(lights[i].positionRadius) - center;
+
+	return glm::vec3(
+		center.x + c * offset.x + s * offset.z,
+		center.y + offset.y,
+		center.z - s * offset.x + c * offset.z);
+}
@@ -0,0 +1,176 @@
+#include "VulkanRenderer.h"
+
+// THREE THREADS RUN WHILE THE WINDOW IS OPEN:
+// MAIN       -> GLFW EVENTS, INPUT SAMPLING AND MAIN THREAD JOBS (GLFW ONLY WORKS FROM HERE)
+// SIMULATION -> FIXED TICK, TURNS INPUT INTO CAMERA STATE
+// RENDER     -> drawFrame ON THE LATEST SNAPSHOT, NEVER WAITS ON THE OTHERS
+// THEY ONLY TALK THROUGH TRIPLE BUFFERS
+
+void VulkanRenderer::sampleInput() {
+	PROFILE_FUNCTION();
+	InputState& input = inputBuffer.writeBuffer();
+	input.forward = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
+	input.backward = glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
+	input.left = glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS;
+	input.right = glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+	glfwGetCursorPos(window, &input.cursorX, &input.cursorY);
+	input.sampleTime = std::chrono::steady_clock::now();
+	inputBuffer.publish();
+
+	// ONE REPORT PER KEY PRESS, THE TRACKER IS LOCKED SO ANY THREAD CAN WRITE IT
+	bool memoryKey = glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS;
+	if (memoryKey && !memoryKeyDown) {
+		writeMemoryReport(memoryReportPath.empty() ? "memory.json" : memoryReportPath);
+	}
+	memoryKeyDown = memoryKey;
+
+	// THE RENDER THREAD NEEDS THIS WHEN IT RECREATES THE SWAPCHAIN
+	int width, height;
+	glfwGetFramebufferSize(window, &width, &height);
+	framebufferWidth.store(width, std::memory_order_relaxed);
+	framebufferHeight.store(height, std::memory_order_relaxed);
+}
+
+FrameSnapshot VulkanRenderer::makeSnapshot(std::chrono::steady_clock::time_point inputSampleTime) {
+	FrameSnapshot snapshot;
+	snapshot.cameraPos = cameraPos;
+	snapshot.cameraFront = cameraFront;
+	snapshot.cameraUp = cameraUp;
+	snapshot.yaw = yaw;
+	snapshot.pitch = pitch;
+	snapshot.fov = fov;
+	snapshot.tick = simulationTick;
+	snapshot.inputSampleTime = inputSampleTime;
+	return snapshot;
+}
+
+void VulkanRenderer::simulateTick(const InputState& input, float deltaTime) {
+	PROFILE_FUNCTION();
+	// KEY BULLSHIT
+	float cameraSpeed = 2.5f * deltaTime;
+	if (input.forward)
+		cameraPos += cameraSpeed * cameraFront;
+	if (input.backward)
+		cameraPos -= cameraSpeed * cameraFront;
+	if (input.left)
+		cameraPos -= cameraSpeed * glm::normalize(glm::cross(cameraFront, cameraUp));
+	if (input.right)
+		cameraPos += cameraSpeed * glm::normalize(glm::cross(cameraFront, cameraUp));
+
+	// MOUSE BULLSHIT
+	// FIRST SAMPLE ONLY SETS THE REFERENCE SO THE CAMERA DOES NOT JUMP
+	if (!hasLastCursor) {
+		lastX = static_cast<float>(input.cursorX);
+		lastY = static_cast<float>(input.cursorY);
+		hasLastCursor = true;
+	}
+	yaw += static_cast<float>(input.cursorX - lastX) * sensitivity;
+	pitch += static_cast<float>(lastY - input.cursorY) * sensitivity;
+	lastX = static_cast<float>(input.cursorX);
+	lastY = static_cast<float>(input.cursorY);
+	// CORRECT PITCH
+	if (pitch > 89.0f) pitch = 89.0f;
+	if (pitch < -89.0f) pitch = -89.0f;
+	/*
+	cameraFront.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
+	cameraFront.y = sin(glm::radians(pitch));
+	cameraFront.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
+	cameraFront = glm::normalize(cameraFront);
+	*/
+
+	simulationTick++;
+	snapshotBuffer.publish(makeSnapshot(input.sampleTime));
+}
+
+void VulkanRenderer::simulationLoop() {
+	using Clock = std::chrono::steady_clock;
+	profiler::setThreadName("simulation");
+
+	auto tickLength = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / simulationRate));
+	float deltaTime = static_cast<float>(1.0 / simulationRate);
+	auto nextTick = Clock::now();
+
+	while (running.load(std::memory_order_acquire)) {
+		inputBuffer.consume();
+		simulateTick(inputBuffer.read(), deltaTime);
+
+		nextTick += tickLength;
+		// IF WE FELL WAY BEHIND (DEBUGGER, SUSPEND) DO NOT BURST TICKS TO CATCH UP
+		auto now = Clock::now();
+		if (now - nextTick > 8 * tickLength) {
+			nextTick = now;
+		}
+		std::this_thread::sleep_until(nextTick);
+	}
+}
+
+void VulkanRenderer::renderLoop() {
+	profiler::setThreadName("render");
+	try {
+		while (running.load(std::memory_order_acquire)) {
+			// TAKE THE NEWEST SNAPSHOT IF THERE IS ONE, OTHERWISE
+			// DRAW THE OLD ONE AGAIN
+			snapshotBuffer.consume();
+			frameSnapshot = snapshotBuffer.read();
+			inputSampleTime = frameSnapshot.inputSampleTime;
+
+			drawFrame();
+		}
+	}
+	catch (...) {
+		renderError = std::current_exception();
+		running.store(false, std::memory_order_release);
+	}
+
+	device->waitIdle();
+}
+
+void VulkanRenderer::mainLoop() {
+	// SEED BOTH BUFFERS SO NOBODY READS GARBAGE ON THE FIRST FRAME
+	sampleInput();
+	inputBuffer.consume();
+	snapshotBuffer.publish(makeSnapshot(std::chrono::steady_clock::now()));
+
+	running.store(true, std::memory_order_release);
+	simulationThread = std::thread(&VulkanRenderer::simulationLoop, this);
+	renderThread = std::thread(&VulkanRenderer::renderLoop, this);
+
+	while (running.load(std::memory_order_acquire) && !glfwWindowShouldClose(window)) {
+		glfwWaitEventsTimeout(inputPollInterval);
+		sampleInput();
+		// JOBS THAT NEED GLFW OR THE WINDOW
+		jobSystem.pumpMainThread();
+	}
+
+	running.store(false, std::memory_order_release);
+	renderThread.join();
+	simulationThread.join();
+
+	if (renderError) {
+		std::rethrow_exception(renderError);
+	}
+
+	if (reportLatency) {
+		latencyTracker.report(std::cout, vk::to_string(activePresentMode) + ", " + std::to_string(swapChainImages.size()) + " images, " + std::to_string(MAX_FRAMES_IN_FLIGHT) + " frames in flight");
+	}
+
+	if (!memoryReportPath.empty()) {
+		writeMemoryReport(memoryReportPath);
+	}
+
+	if (worldPartition.isOpen()) {
+		worldPartition.report(std::cout);
+	}
+
+	resourceCache.report(std::cout);
+	memoryPool.report(std::cout);
+	shaderVariants.report(std::cout);
+
+	if (shadows) {
+		std::cout << "shadows: " << shadowCascadeRenders << " of " << shadowCascadeFrames << " cascade updates re-rendered\n";
+	}
+
+	if (dynamicResolution) {
+		std::cout << "dynamic resolution: scale " << resolutionController.scale() << ", gpu " << resolutionController.smoothedFrameTime() << " ms for a target of " << 1000.0f / targetFrameRate << " ms\n";
+	}
+}
@@ -0,0 +1,76 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#if defined(_WIN32)
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("failed to open " + path + "!");
+	}
+	file = handle;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(handle, &fileSize)) {
+		release();
+		throw std::runtime_error("failed to get the size of " + path + "!");
+	}
+	length = static_cast<size_t>(fileSize.QuadPart);
+	// AN EMPTY FILE CAN NOT BE MAPPED
+	if (length == 0) return;
+
+	mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	view = mapping ? static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+#else
+	descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) {
+		throw std::runtime_error("failed to open " + path + "!");
+	}
+	struct stat status;
+	if (fstat(descriptor, &status) != 0) {
+		release();
+		throw std::runtime_error("failed to get the size of " + path + "!");
+	}
+	length = static_cast<size_t>(status.st_size);
+	if (length == 0) return;
+
+	void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	if (address != MAP_FAILED) {
+		madvise(address, length, MADV_SEQUENTIAL);
+		view = static_cast<const char*>(address);
+	}
+#endif
+	if (!view) {
+		release();
+		throw std::runtime_error("failed to map " + path + "!");
+	}
+}
+
+MappedFile::~MappedFile() {
+	release();
+}
+
+void MappedFile::release() {
+#if defined(_WIN32)
+	if (view) UnmapViewOfFile(view);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+	mapping = nullptr;
+	file = nullptr;
+#else
+	if (view) munmap(const_cast<char*>(view), length);
+	if (descriptor >= 0) close(descriptor);
+	descriptor = -1;
+#endif
+	view = nullptr;
+}
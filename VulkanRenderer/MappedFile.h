@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// READ ONLY VIEW OF A WHOLE FILE, THE OS PAGES IT IN AS WE TOUCH IT
+// AND CAN DROP IT AGAIN, SO THE INPUT NEVER SITS IN OUR HEAP
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// NULL FOR AN EMPTY FILE
+	const char* data() const { return view; }
+	size_t size() const { return length; }
+
+private:
+	void release();
+
+	const char* view = nullptr;
+	size_t length = 0;
+#if defined(_WIN32)
+	// HANDLES, KEPT AS void* SO windows.h STAYS OUT OF THE HEADER
+	void* file = nullptr;
+	void* mapping = nullptr;
+#else
+	int descriptor = -1;
+#endif
+};
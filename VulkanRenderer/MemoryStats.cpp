@@ -0,0 +1,158 @@
+#include "MemoryStats.h"
+
+#include <algorithm>
+#include <iostream>
+
+const char* memoryCategoryName(MemoryCategory category) {
+	switch (category) {
+	case MemoryCategory::Vertex: return "vertex";
+	case MemoryCategory::Index: return "index";
+	case MemoryCategory::Texture: return "texture";
+	case MemoryCategory::Uniform: return "uniform";
+	case MemoryCategory::Staging: return "staging";
+	case MemoryCategory::Attachment: return "attachment";
+	case MemoryCategory::Storage: return "storage";
+	default: return "unknown";
+	}
+}
+
+MemoryCategory categorizeBuffer(vk::BufferUsageFlags usage) {
+	if (usage & vk::BufferUsageFlagBits::eVertexBuffer) return MemoryCategory::Vertex;
+	if (usage & vk::BufferUsageFlagBits::eIndexBuffer) return MemoryCategory::Index;
+	if (usage & vk::BufferUsageFlagBits::eUniformBuffer) return MemoryCategory::Uniform;
+	// ONLY EVER COPIED FROM
+	if (usage == vk::BufferUsageFlagBits::eTransferSrc) return MemoryCategory::Staging;
+	return MemoryCategory::Storage;
+}
+
+MemoryCategory categorizeImage(vk::ImageUsageFlags usage) {
+	// RENDER TARGETS AND WHAT THE GPU WRITES ITSELF (HI-Z)
+	if (usage & (vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eStorage)) {
+		return MemoryCategory::Attachment;
+	}
+	return MemoryCategory::Texture;
+}
+
+void MemoryTracker::init(vk::PhysicalDevice physicalDevice, bool budgetSupported) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->physicalDevice = physicalDevice;
+	this->budgetSupported = budgetSupported;
+	properties = physicalDevice.getMemoryProperties();
+}
+
+void MemoryTracker::add(Counter& counter, vk::DeviceSize size) {
+	counter.bytes += size;
+	counter.allocations++;
+	counter.peakBytes = std::max(counter.peakBytes, counter.bytes);
+}
+
+void MemoryTracker::remove(Counter& counter, vk::DeviceSize size) {
+	counter.bytes -= size;
+	counter.allocations--;
+}
+
+void MemoryTracker::recordAllocation(vk::DeviceMemory memory, vk::DeviceSize size, uint32_t memoryType, MemoryCategory category) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	uint32_t heap = properties.memoryTypes[memoryType].heapIndex;
+	allocations[static_cast<VkDeviceMemory>(memory)] = { size, memoryType, category };
+	add(heaps[heap], size);
+	add(types[memoryType], size);
+	add(categories[static_cast<size_t>(category)], size);
+
+	if (!budgetSupported || pressureWarned[heap]) return;
+
+	// THE DRIVER'S USAGE ALREADY INCLUDES THIS ALLOCATION
+	auto budget = queryBudget();
+	if (budget[heap].budget > 0 && budget[heap].usage > PRESSURE_WARNING * budget[heap].budget) {
+		pressureWarned[heap] = true;
+		std::cout << "memory: heap " << heap << " is at " << budget[heap].usage / (1024 * 1024) << " of " << budget[heap].budget / (1024 * 1024) << " MiB budget\n";
+	}
+}
+
+void MemoryTracker::recordFree(vk::DeviceMemory memory) {
+	if (!memory) return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto found = allocations.find(static_cast<VkDeviceMemory>(memory));
+	if (found == allocations.end()) return;
+
+	const Allocation& allocation = found->second;
+	remove(heaps[properties.memoryTypes[allocation.memoryType].heapIndex], allocation.size);
+	remove(types[allocation.memoryType], allocation.size);
+	remove(categories[static_cast<size_t>(allocation.category)], allocation.size);
+	allocations.erase(found);
+}
+
+std::array<MemoryTracker::HeapBudget, VK_MAX_MEMORY_HEAPS> MemoryTracker::queryBudget() const {
+	std::array<HeapBudget, VK_MAX_MEMORY_HEAPS> result;
+	if (!budgetSupported) return result;
+
+	vk::PhysicalDeviceMemoryBudgetPropertiesEXT budget;
+	vk::PhysicalDeviceMemoryProperties2 properties2;
+	properties2.pNext = &budget;
+	physicalDevice.getMemoryProperties2(&properties2);
+
+	for (uint32_t i = 0; i < properties2.memoryProperties.memoryHeapCount; i++) {
+		result[i].budget = budget.heapBudget[i];
+		result[i].usage = budget.heapUsage[i];
+	}
+	return result;
+}
+
+MemoryTracker::Counter MemoryTracker::heapCounter(uint32_t heap) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return heaps[heap];
+}
+
+MemoryTracker::Counter MemoryTracker::categoryCounter(MemoryCategory category) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return categories[static_cast<size_t>(category)];
+}
+
+void MemoryTracker::writeJson(std::ostream& out) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto budget = queryBudget();
+
+	auto writeCounter = [&](const Counter& counter) {
+		out << "\"bytes\": " << counter.bytes << ", \"allocations\": " << counter.allocations << ", \"peakBytes\": " << counter.peakBytes;
+	};
+
+	out << "{\n";
+	out << "  \"budgetExtension\": " << (budgetSupported ? "true" : "false") << ",\n";
+
+	out << "  \"heaps\": [\n";
+	for (uint32_t i = 0; i < properties.memoryHeapCount; i++) {
+		const auto& heap = properties.memoryHeaps[i];
+		out << "    { \"index\": " << i
+			<< ", \"size\": " << heap.size
+			<< ", \"deviceLocal\": " << ((heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal) ? "true" : "false") << ", ";
+		writeCounter(heaps[i]);
+		if (budgetSupported) {
+			out << ", \"budget\": " << budget[i].budget << ", \"usage\": " << budget[i].usage;
+		}
+		out << " }" << (i + 1 < properties.memoryHeapCount ? "," : "") << "\n";
+	}
+	out << "  ],\n";
+
+	out << "  \"types\": [\n";
+	for (uint32_t i = 0; i < properties.memoryTypeCount; i++) {
+		const auto& type = properties.memoryTypes[i];
+		out << "    { \"index\": " << i
+			<< ", \"heap\": " << type.heapIndex
+			<< ", \"flags\": \"" << vk::to_string(type.propertyFlags) << "\", ";
+		writeCounter(types[i]);
+		out << " }" << (i + 1 < properties.memoryTypeCount ? "," : "") << "\n";
+	}
+	out << "  ],\n";
+
+	out << "  \"categories\": {\n";
+	for (size_t i = 0; i < categories.size(); i++) {
+		out << "    \"" << memoryCategoryName(static_cast<MemoryCategory>(i)) << "\": { ";
+		writeCounter(categories[i]);
+		out << " }" << (i + 1 < categories.size() ? "," : "") << "\n";
+	}
+	out << "  }\n";
+	out << "}\n";
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+
+// WHAT A DEVICE ALLOCATION IS USED FOR
+enum class MemoryCategory : uint32_t {
+	Vertex,
+	Index,
+	Texture,
+	Uniform,
+	Staging,
+	Attachment,
+	Storage,
+	Count
+};
+
+const char* memoryCategoryName(MemoryCategory category);
+
+// GUESSES THE CATEGORY FROM THE USAGE FLAGS THE RESOURCE WAS CREATED WITH
+MemoryCategory categorizeBuffer(vk::BufferUsageFlags usage);
+MemoryCategory categorizeImage(vk::ImageUsageFlags usage);
+
+// COUNTS EVERY vkAllocateMemory / vkFreeMemory PER HEAP, PER MEMORY TYPE AND
+// PER CATEGORY, AND READS THE DRIVER'S BUDGET (VK_EXT_memory_budget) WHEN THE
+// DEVICE HAS IT. THE BUDGET IS WHAT THIS PROCESS CAN USE BEFORE THE DRIVER
+// STARTS EVICTING OR FAILING, SO WITH SEVERAL RENDERERS ON ONE GPU IT IS
+// USUALLY FAR BELOW THE HEAP SIZE
+// ALLOCATIONS HAPPEN FROM THE STARTUP JOBS AND THE RENDER THREAD, SO ALL OF IT IS LOCKED
+class MemoryTracker {
+public:
+	struct Counter {
+		uint64_t bytes = 0;
+		uint64_t allocations = 0;
+		uint64_t peakBytes = 0;
+	};
+
+	struct HeapBudget {
+		vk::DeviceSize budget = 0;
+		vk::DeviceSize usage = 0;
+	};
+
+	// ABOVE THIS FRACTION OF A HEAP'S BUDGET WE WARN (ONCE PER HEAP)
+	static constexpr double PRESSURE_WARNING = 0.9;
+
+	void init(vk::PhysicalDevice physicalDevice, bool budgetSupported);
+
+	void recordAllocation(vk::DeviceMemory memory, vk::DeviceSize size, uint32_t memoryType, MemoryCategory category);
+	void recordFree(vk::DeviceMemory memory);
+
+	bool hasBudget() const { return budgetSupported; }
+
+	// WHAT THE DRIVER REPORTS RIGHT NOW, ZEROS WITHOUT THE EXTENSION
+	std::array<HeapBudget, VK_MAX_MEMORY_HEAPS> queryBudget() const;
+
+	Counter heapCounter(uint32_t heap) const;
+	Counter categoryCounter(MemoryCategory category) const;
+
+	void writeJson(std::ostream& out) const;
+
+private:
+	struct Allocation {
+		vk::DeviceSize size;
+		uint32_t memoryType;
+		MemoryCategory category;
+	};
+
+	static void add(Counter& counter, vk::DeviceSize size);
+	static void remove(Counter& counter, vk::DeviceSize size);
+
+	mutable std::mutex mutex;
+
+	vk::PhysicalDevice physicalDevice;
+	vk::PhysicalDeviceMemoryProperties properties;
+	bool budgetSupported = false;
+
+	std::unordered_map<VkDeviceMemory, Allocation> allocations;
+	std::array<Counter, VK_MAX_MEMORY_HEAPS> heaps;
+	std::array<Counter, VK_MAX_MEMORY_TYPES> types;
+	std::array<Counter, static_cast<size_t>(MemoryCategory::Count)> categories;
+	std::array<bool, VK_MAX_MEMORY_HEAPS> pressureWarned = {};
+};
@@ -0,0 +1,382 @@
+#include "AssetLoading.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+// NATIVE OBJ LOADER
+// 1. THE FILE IS MAPPED AND CUT INTO CHUNKS AT LINE BOUNDARIES
+// 2. PRESCAN (PARALLEL): COUNT v AND vt LINES PER CHUNK, A PREFIX SUM GIVES
+//    EVERY CHUNK THE GLOBAL INDEX OF ITS FIRST POSITION / TEXCOORD
+// 3. PARSE (PARALLEL): POSITIONS AND TEXCOORDS GO STRAIGHT INTO THE SHARED
+//    ARRAYS, FACE CORNERS ARE DEDUPLICATED INSIDE THE CHUNK
+// 4. MERGE (SERIAL, ONLY TOUCHES THE UNIQUE CORNERS OF EVERY CHUNK)
+// 5. VERTICES AND THE FINAL INDICES ARE WRITTEN IN PARALLEL
+
+namespace {
+
+// A CORNER IS (POSITION INDEX << 32) | TEXCOORD INDEX, BOTH 0 BASED
+const uint32_t NO_TEXCOORD = UINT32_MAX;
+
+uint64_t cornerKey(uint32_t position, uint32_t texCoord) {
+	return (static_cast<uint64_t>(position) << 32) | texCoord;
+}
+
+// OPEN ADDRESSING MAP FROM CORNER KEY TO A DENSE ID
+// std::unordered_map ALLOCATES A NODE PER CORNER, THIS IS TWO FLAT ARRAYS
+class CornerMap {
+public:
+	// ID OF key, A NEW ONE (= size() BEFORE THE CALL) IF IT WAS NOT THERE
+	uint32_t insert(uint64_t key) {
+		if ((count + 1) * 2 > slots.size()) {
+			grow();
+		}
+		size_t mask = slots.size() - 1;
+		for (size_t slot = hash(key) & mask;; slot = (slot + 1) & mask) {
+			if (ids[slot] == EMPTY) {
+				slots[slot] = key;
+				ids[slot] = count;
+				return count++;
+			}
+			if (slots[slot] == key) {
+				return ids[slot];
+			}
+		}
+	}
+
+	uint32_t size() const { return count; }
+
+private:
+	static constexpr uint32_t EMPTY = UINT32_MAX;
+
+	static size_t hash(uint64_t key) {
+		// FACES MOSTLY USE POSITIONS NEAR EACH OTHER, KEEPING THE POSITION IN ORDER
+		// KEEPS THOSE LOOKUPS IN THE SAME CACHE LINES, THE TEXCOORD ONLY SPREADS
+		// CORNERS THAT SHARE A POSITION OVER A FEW SLOTS
+		uint32_t position = static_cast<uint32_t>(key >> 32);
+		uint32_t texCoord = static_cast<uint32_t>(key);
+		return static_cast<size_t>(position) * 2 + ((texCoord * 0x9E3779B1u) >> 28);
+	}
+
+	void grow() {
+		std::vector<uint64_t> oldSlots = std::move(slots);
+		std::vector<uint32_t> oldIds = std::move(ids);
+
+		size_t capacity = std::max<size_t>(1024, oldSlots.size() * 2);
+		slots.assign(capacity, 0);
+		ids.assign(capacity, EMPTY);
+
+		size_t mask = capacity - 1;
+		for (size_t i = 0; i < oldSlots.size(); i++) {
+			if (oldIds[i] == EMPTY) continue;
+			size_t slot = hash(oldSlots[i]) & mask;
+			while (ids[slot] != EMPTY) slot = (slot + 1) & mask;
+			slots[slot] = oldSlots[i];
+			ids[slot] = oldIds[i];
+		}
+	}
+
+	std::vector<uint64_t> slots;
+	std::vector<uint32_t> ids;
+	uint32_t count = 0;
+};
+
+struct ObjChunk {
+	const char* begin = nullptr;
+	const char* end = nullptr;
+
+	// FROM THE PRESCAN
+	uint32_t positionCount = 0;
+	uint32_t texCoordCount = 0;
+	// GLOBAL INDEX OF THE FIRST v / vt IN THIS CHUNK
+	uint32_t positionOffset = 0;
+	uint32_t texCoordOffset = 0;
+
+	// UNIQUE CORNERS IN ORDER OF FIRST USE, REPLACED BY THEIR GLOBAL IDS IN THE MERGE
+	std::vector<uint64_t> corners;
+	std::vector<uint32_t> remap;
+	// THREE PER TRIANGLE, INDEX INTO corners
+	std::vector<uint32_t> indices;
+	size_t indexOffset = 0;
+};
+
+// EVERYTHING THAT IS NOT A LINE BREAK COUNTS AS A SEPARATOR
+bool isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char* skipSpaces(const char* cursor, const char* end) {
+	while (cursor < end && isSpace(*cursor)) cursor++;
+	return cursor;
+}
+
+[[noreturn]] void malformedLine(const char* begin, const char* end) {
+	throw std::runtime_error("failed to parse obj line '" + std::string(begin, std::min<size_t>(end - begin, 80)) + "'!");
+}
+
+const char* parseFloat(const char* cursor, const char* lineBegin, const char* end, float& value) {
+	cursor = skipSpaces(cursor, end);
+	// from_chars DOES NOT TAKE A LEADING PLUS
+	if (cursor < end && *cursor == '+') cursor++;
+	auto result = std::from_chars(cursor, end, value);
+	if (result.ec != std::errc()) {
+		malformedLine(lineBegin, end);
+	}
+	return result.ptr;
+}
+
+// OBJ INDICES START AT 1, NEGATIVE ONES COUNT BACK FROM THE LAST ELEMENT READ SO FAR
+uint32_t resolveIndex(int64_t index, uint64_t seen, uint64_t total, const char* lineBegin, const char* end) {
+	int64_t resolved = index > 0 ? index - 1 : static_cast<int64_t>(seen) + index;
+	if (index == 0 || resolved < 0 || static_cast<uint64_t>(resolved) >= total) {
+		malformedLine(lineBegin, end);
+	}
+	return static_cast<uint32_t>(resolved);
+}
+
+// LINE TYPES WE CARE ABOUT, EVERYTHING ELSE (vn, o, g, s, usemtl, COMMENTS ...) IS SKIPPED
+enum class LineType {
+	Position,
+	TexCoord,
+	Face,
+	Other
+};
+
+LineType lineType(const char*& cursor, const char* end) {
+	cursor = skipSpaces(cursor, end);
+	if (end - cursor < 2) return LineType::Other;
+	if (cursor[0] == 'v') {
+		if (isSpace(cursor[1])) {
+			cursor += 1;
+			return LineType::Position;
+		}
+		if (cursor[1] == 't' && end - cursor > 2 && isSpace(cursor[2])) {
+			cursor += 2;
+			return LineType::TexCoord;
+		}
+	}
+	else if (cursor[0] == 'f' && isSpace(cursor[1])) {
+		cursor += 1;
+		return LineType::Face;
+	}
+	return LineType::Other;
+}
+
+// memchr IS VECTORIZED IN EVERY C RUNTIME WE BUILD WITH, IT DOES THE NEWLINE SCANNING
+template<typename Function>
+void forEachLine(const char* begin, const char* end, Function&& function) {
+	const char* cursor = begin;
+	while (cursor < end) {
+		const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+		if (!lineEnd) lineEnd = end;
+		function(cursor, lineEnd);
+		cursor = lineEnd + 1;
+	}
+}
+
+void prescanChunk(ObjChunk& chunk) {
+	forEachLine(chunk.begin, chunk.end, [&](const char* line, const char* lineEnd) {
+		switch (lineType(line, lineEnd)) {
+		case LineType::Position: chunk.positionCount++; break;
+		case LineType::TexCoord: chunk.texCoordCount++; break;
+		default: break;
+		}
+	});
+}
+
+void parseChunk(ObjChunk& chunk, std::vector<glm::vec3>& positions, std::vector<glm::vec2>& texCoords) {
+	uint32_t positionsRead = 0;
+	uint32_t texCoordsRead = 0;
+	CornerMap chunkCorners;
+	std::vector<uint32_t> polygon;
+
+	forEachLine(chunk.begin, chunk.end, [&](const char* lineBegin, const char* lineEnd) {
+		const char* cursor = lineBegin;
+		switch (lineType(cursor, lineEnd)) {
+		case LineType::Position: {
+			glm::vec3& position = positions[chunk.positionOffset + positionsRead++];
+			cursor = parseFloat(cursor, lineBegin, lineEnd, position.x);
+			cursor = parseFloat(cursor, lineBegin, lineEnd, position.y);
+			parseFloat(cursor, lineBegin, lineEnd, position.z);
+			break;
+		}
+		case LineType::TexCoord: {
+			glm::vec2& texCoord = texCoords[chunk.texCoordOffset + texCoordsRead++];
+			cursor = parseFloat(cursor, lineBegin, lineEnd, texCoord.x);
+			// SOME EXPORTERS WRITE ONLY u
+			texCoord.y = 0.0f;
+			if (skipSpaces(cursor, lineEnd) < lineEnd) {
+				parseFloat(cursor, lineBegin, lineEnd, texCoord.y);
+			}
+			break;
+		}
+		case LineType::Face: {
+			polygon.clear();
+			while ((cursor = skipSpaces(cursor, lineEnd)) < lineEnd) {
+				// v, v/t, v/t/n OR v//n, NORMALS ARE NOT USED
+				int64_t position = 0;
+				int64_t texCoord = 0;
+				auto result = std::from_chars(cursor, lineEnd, position);
+				if (result.ec != std::errc()) malformedLine(lineBegin, lineEnd);
+				cursor = result.ptr;
+				if (cursor < lineEnd && *cursor == '/') {
+					cursor++;
+					if (cursor < lineEnd && *cursor != '/') {
+						result = std::from_chars(cursor, lineEnd, texCoord);
+						if (result.ec != std::errc()) malformedLine(lineBegin, lineEnd);
+						cursor = result.ptr;
+					}
+					if (cursor < lineEnd && *cursor == '/') {
+						cursor++;
+						int64_t normal;
+						result = std::from_chars(cursor, lineEnd, normal);
+						if (result.ec != std::errc()) malformedLine(lineBegin, lineEnd);
+						cursor = result.ptr;
+					}
+				}
+
+				uint32_t positionIndex = resolveIndex(position, chunk.positionOffset + positionsRead, positions.size(), lineBegin, lineEnd);
+				uint32_t texCoordIndex = texCoord == 0
+					? NO_TEXCOORD
+					: resolveIndex(texCoord, chunk.texCoordOffset + texCoordsRead, texCoords.size(), lineBegin, lineEnd);
+
+				uint32_t corner = chunkCorners.insert(cornerKey(positionIndex, texCoordIndex));
+				if (corner == chunk.corners.size()) {
+					chunk.corners.push_back(cornerKey(positionIndex, texCoordIndex));
+				}
+				polygon.push_back(corner);
+			}
+			if (polygon.size() < 3) malformedLine(lineBegin, lineEnd);
+
+			// FAN TRIANGULATION, SAME AS tinyobj
+			for (size_t i = 2; i < polygon.size(); i++) {
+				chunk.indices.push_back(polygon[0]);
+				chunk.indices.push_back(polygon[i - 1]);
+				chunk.indices.push_back(polygon[i]);
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	});
+}
+
+}
+
+void loadObj(const std::string& path, JobSystem& jobs, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+	PROFILE_FUNCTION();
+
+	MappedFile file(path);
+	const char* data = file.data();
+	size_t size = file.size();
+
+	// A FEW CHUNKS PER THREAD SO STEALING CAN EVEN OUT DENSE AND SPARSE PARTS OF THE FILE
+	const size_t MIN_CHUNK_SIZE = 1024 * 1024;
+	size_t threads = jobs.workerCount() + 1;
+	size_t chunkSize = std::max(MIN_CHUNK_SIZE, size / (threads * 4) + 1);
+
+	std::vector<ObjChunk> chunks;
+	for (size_t begin = 0; begin < size;) {
+		size_t end = std::min(size, begin + chunkSize);
+		// FINISH THE LINE WE CUT INTO
+		if (end < size) {
+			const char* newline = static_cast<const char*>(std::memchr(data + end, '\n', size - end));
+			end = newline ? static_cast<size_t>(newline - data) + 1 : size;
+		}
+		ObjChunk chunk;
+		chunk.begin = data + begin;
+		chunk.end = data + end;
+		chunks.push_back(std::move(chunk));
+		begin = end;
+	}
+
+	{
+		PROFILE_ZONE("obj prescan");
+		jobs.parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) prescanChunk(chunks[i]);
+		});
+	}
+
+	uint64_t positionCount = 0;
+	uint64_t texCoordCount = 0;
+	for (auto& chunk : chunks) {
+		chunk.positionOffset = static_cast<uint32_t>(positionCount);
+		chunk.texCoordOffset = static_cast<uint32_t>(texCoordCount);
+		positionCount += chunk.positionCount;
+		texCoordCount += chunk.texCoordCount;
+	}
+	if (positionCount >= UINT32_MAX || texCoordCount >= UINT32_MAX) {
+		throw std::runtime_error("failed to load " + path + ", too many vertices!");
+	}
+
+	std::vector<glm::vec3> positions(positionCount);
+	std::vector<glm::vec2> texCoords(texCoordCount);
+
+	{
+		PROFILE_ZONE("obj parse");
+		jobs.parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) parseChunk(chunks[i], positions, texCoords);
+		});
+	}
+
+	// CORNERS SHARED BETWEEN CHUNKS GET ONE ID, IN ORDER OF FIRST USE LIKE buildIndexedMesh
+	std::vector<uint64_t> uniqueCorners;
+	size_t indexCount = 0;
+	{
+		PROFILE_ZONE("obj merge");
+		CornerMap allCorners;
+		for (auto& chunk : chunks) {
+			chunk.remap.resize(chunk.corners.size());
+			for (size_t i = 0; i < chunk.corners.size(); i++) {
+				uint32_t id = allCorners.insert(chunk.corners[i]);
+				if (id == uniqueCorners.size()) {
+					uniqueCorners.push_back(chunk.corners[i]);
+				}
+				chunk.remap[i] = id;
+			}
+			std::vector<uint64_t>().swap(chunk.corners);
+
+			chunk.indexOffset = indexCount;
+			indexCount += chunk.indices.size();
+		}
+	}
+
+	{
+		PROFILE_ZONE("obj output");
+		size_t firstVertex = vertices.size();
+		size_t firstIndex = indices.size();
+		vertices.resize(firstVertex + uniqueCorners.size());
+		indices.resize(firstIndex + indexCount);
+
+		jobs.parallelFor(uniqueCorners.size(), 64 * 1024, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				uint32_t position = static_cast<uint32_t>(uniqueCorners[i] >> 32);
+				uint32_t texCoord = static_cast<uint32_t>(uniqueCorners[i]);
+
+				Vertex& vertex = vertices[firstVertex + i];
+				vertex.pos = positions[position];
+				vertex.color = { 1.0f, 1.0f, 1.0f };
+				vertex.texCoord = texCoord == NO_TEXCOORD
+					? glm::vec2(0.0f)
+					: glm::vec2(texCoords[texCoord].x, 1.0f - texCoords[texCoord].y);
+			}
+		});
+
+		jobs.parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t c = begin; c < end; c++) {
+				ObjChunk& chunk = chunks[c];
+				uint32_t* out = indices.data() + firstIndex + chunk.indexOffset;
+				for (size_t i = 0; i < chunk.indices.size(); i++) {
+					out[i] = static_cast<uint32_t>(firstVertex) + chunk.remap[chunk.indices[i]];
+				}
+				std::vector<uint32_t>().swap(chunk.indices);
+				std::vector<uint32_t>().swap(chunk.remap);
+			}
+		});
+	}
+}
@@ -0,0 +1,587 @@
+#include "VulkanRenderer.h"
+
+// DEPTH PREPASS + HI-Z OCCLUSION CULLING
+// EVERY FRAME, BEFORE THE MAIN PASS:
+// 1. occlusion.comp PHASE 0 LISTS THE OBJECTS THAT WERE VISIBLE LAST FRAME
+// 2. THOSE ARE DRAWN DEPTH ONLY INTO depthImage
+// 3. hiz.comp REDUCES THAT DEPTH INTO A MAX DEPTH MIP PYRAMID
+// 4. occlusion.comp PHASE 1 TESTS EVERY OBJECT'S BOUNDS AGAINST THE PYRAMID,
+//    WRITES THE MAIN PASS LIST AND REMEMBERS WHO WAS VISIBLE FOR NEXT FRAME
+// THE MAIN PASS THEN LOADS THE PREPASS DEPTH AND ONLY SHADES WHAT IS VISIBLE
+// WITHOUT --depth-prepass ONLY PHASE 1 RUNS, WITH THE HI-Z TEST SWITCHED OFF
+
+void VulkanRenderer::createDepthPrepassRenderPass() {
+	if (!depthPrepass) return;
+
+	vk::AttachmentDescription depthAttachment;
+	depthAttachment.format = findDepthFormat();
+	depthAttachment.samples = vk::SampleCountFlagBits::e1;
+	depthAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+	// KEPT FOR THE HI-Z BUILD AND THE MAIN PASS
+	depthAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+	depthAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+	depthAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+	depthAttachment.initialLayout = vk::ImageLayout::eUndefined;
+	depthAttachment.finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+	vk::AttachmentReference depthAttachmentRef;
+	depthAttachmentRef.attachment = 0;
+	depthAttachmentRef.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+	// NO COLOR AT ALL
+	vk::SubpassDescription subpass;
+	subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+	subpass.colorAttachmentCount = 0;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+	std::array<vk::SubpassDependency, 2> dependencies;
+	// WAIT FOR THE LAST FRAME'S MAIN PASS AND HI-Z BUILD TO BE DONE WITH THE DEPTH
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests | vk::PipelineStageFlagBits::eComputeShader;
+	dependencies[0].dstStageMask = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+	dependencies[0].srcAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+	dependencies[0].dstAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+	// THE HI-Z BUILD READS THE RESULT
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = vk::PipelineStageFlagBits::eLateFragmentTests;
+	dependencies[1].dstStageMask = vk::PipelineStageFlagBits::eComputeShader;
+	dependencies[1].srcAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+	dependencies[1].dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+	vk::RenderPassCreateInfo renderPassInfo;
+	renderPassInfo.attachmentCount = 1;
+	renderPassInfo.pAttachments = &depthAttachment;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	renderPassInfo.pDependencies = dependencies.data();
+
+	try {
+		depthPrepassRenderPass = device->createRenderPass(renderPassInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to create depth prepass Render Pass!");
+	}
+}
+
+void VulkanRenderer::createDepthPrepassPipeline() {
+	if (!depthPrepass) return;
+
+	// Vertex.vert WITHOUT THE ATTRIBUTES, gl_Position IS invariant IN BOTH SO THE DEPTH MATCHES EXACTLY
+	// A CUTOUT TEXTURE ALSO NEEDS THE TEXCOORD, cutout.frag DROPS THE TEXELS THE MAIN PASS DROPS
+	// SO THEY NEITHER HIDE WHAT IS BEHIND THEM NOR END UP IN THE HI-Z PYRAMID
+	auto vertShaderCode = readFile(SHADER_PATH + (textureHasCutout ? "vert_depth_alpha.spv" : "vert_depth.spv"));
+	vk::ShaderModule vertShaderModule = createShaderModule(vertShaderCode);
+
+	std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages;
+	shaderStages[0].stage = vk::ShaderStageFlagBits::eVertex;
+	shaderStages[0].module = vertShaderModule;
+	shaderStages[0].pName = "main";
+
+	vk::ShaderModule fragShaderModule;
+	if (textureHasCutout) {
+		fragShaderModule = createShaderModule(readFile(SHADER_PATH + "cutout_frag.spv"));
+		shaderStages[1].stage = vk::ShaderStageFlagBits::eFragment;
+		shaderStages[1].module = fragShaderModule;
+		shaderStages[1].pName = "main";
+	}
+
+	// ONLY THE POSITION STREAM IS FETCHED (AND THE TEXCOORDS FOR A CUTOUT)
+	vk::PipelineVertexInputStateCreateInfo vertexInputInfo = depthPassLayout().inputState();
+
+	vk::PipelineInputAssemblyStateCreateInfo inputAssembly;
+	inputAssembly.topology = vk::PrimitiveTopology::eTriangleList;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	vk::Viewport viewport(0.0f, 0.0f, (float)viewExtent.width, (float)viewExtent.height, 0.0f, 1.0f);
+	vk::Rect2D scissor({ 0, 0 }, viewExtent);
+
+	vk::PipelineViewportStateCreateInfo viewportState;
+	viewportState.viewportCount = 1;
+	viewportState.pViewports = &viewport;
+	viewportState.scissorCount = 1;
+	viewportState.pScissors = &scissor;
+
+	// SAME AS THE MAIN PIPELINE, SET WHILE RECORDING
+	std::array<vk::DynamicState, 2> dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+	vk::PipelineDynamicStateCreateInfo dynamicState;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	vk::PipelineRasterizationStateCreateInfo rasterizer;
+	rasterizer.polygonMode = vk::PolygonMode::eFill;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = vk::CullModeFlagBits::eBack;
+	rasterizer.frontFace = vk::FrontFace::eCounterClockwise;
+
+	vk::PipelineMultisampleStateCreateInfo multisampling;
+	multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
+
+	vk::PipelineDepthStencilStateCreateInfo depthStencil;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = vk::CompareOp::eLess;
+
+	// NO COLOR ATTACHMENTS
+	vk::PipelineColorBlendStateCreateInfo colorBlending;
+	colorBlending.attachmentCount = 0;
+
+	vk::GraphicsPipelineCreateInfo pipelineInfo;
+	pipelineInfo.stageCount = textureHasCutout ? 2 : 1;
+	pipelineInfo.pStages = shaderStages.data();
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	// THE MAIN PIPELINE LAYOUT, SAME DESCRIPTORS AND PUSH CONSTANTS
+	pipelineInfo.layout = pipelineLayout;
+	pipelineInfo.renderPass = depthPrepassRenderPass;
+	pipelineInfo.subpass = 0;
+
+	vk::Result result;
+	std::tie(result, depthPrepassPipeline) = device->createGraphicsPipeline(nullptr, pipelineInfo);
+
+	if (result != vk::Result::eSuccess) {
+		throw std::runtime_error("failed to create depth prepass Pipeline!");
+	}
+
+	device->destroyShaderModule(vertShaderModule);
+	if (fragShaderModule) {
+		device->destroyShaderModule(fragShaderModule);
+	}
+}
+
+void VulkanRenderer::createDepthPrepassFramebuffer() {
+	if (!depthPrepass) return;
+
+	vk::FramebufferCreateInfo framebufferInfo;
+	framebufferInfo.renderPass = depthPrepassRenderPass;
+	framebufferInfo.attachmentCount = 1;
+	framebufferInfo.pAttachments = &depthImageView;
+	framebufferInfo.width = viewExtent.width;
+	framebufferInfo.height = viewExtent.height;
+	framebufferInfo.layers = 1;
+
+	try {
+		depthPrepassFramebuffer = device->createFramebuffer(framebufferInfo);
+	}
+	catch (vk::SystemError err) {
+		throw(std::runtime_error("failed to create depth prepass frame buffer!"));
+	}
+}
+
+void VulkanRenderer::createOcclusionPipelines() {
+	// NEAREST, THE PYRAMID ALREADY HOLDS THE MAX OF EVERYTHING UNDER A TEXEL
+	vk::SamplerCreateInfo samplerInfo;
+	samplerInfo.magFilter = vk::Filter::eNearest;
+	samplerInfo.minFilter = vk::Filter::eNearest;
+	samplerInfo.mipmapMode = vk::SamplerMipmapMode::eNearest;
+	samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+	samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+	samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	try {
+		hiZSampler = device->createSampler(samplerInfo);
+	}
+	catch (vk::SystemError err) {
+		throw(std::runtime_error("failed to create Hi-Z sampler!"));
+	}
+
+	// HI-Z BUILD: PREVIOUS LEVEL IN, NEXT LEVEL OUT
+	std::array<vk::DescriptorSetLayoutBinding, 2> bindings;
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = vk::ShaderStageFlagBits::eCompute;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = vk::DescriptorType::eStorageImage;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = vk::ShaderStageFlagBits::eCompute;
+
+	vk::DescriptorSetLayoutCreateInfo layoutInfo;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	try {
+		hiZDescriptorSetLayout = device->createDescriptorSetLayout(layoutInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to create Hi-Z Descriptor Set Layout!");
+	}
+
+	// SOURCE SIZE AND DESTINATION SIZE
+	vk::PushConstantRange hiZPushConstants(vk::ShaderStageFlagBits::eCompute, 0, 4 * sizeof(int32_t));
+	vk::PipelineLayoutCreateInfo hiZLayoutInfo;
+	hiZLayoutInfo.setLayoutCount = 1;
+	hiZLayoutInfo.pSetLayouts = &hiZDescriptorSetLayout;
+	hiZLayoutInfo.pushConstantRangeCount = 1;
+	hiZLayoutInfo.pPushConstantRanges = &hiZPushConstants;
+
+	// PHASE AND WHETHER TO USE THE PYRAMID
+	vk::PushConstantRange occlusionPushConstants(vk::ShaderStageFlagBits::eCompute, 0, 2 * sizeof(uint32_t));
+	vk::PipelineLayoutCreateInfo occlusionLayoutInfo;
+	occlusionLayoutInfo.setLayoutCount = 1;
+	occlusionLayoutInfo.pSetLayouts = &descriptorSetLayout;
+	occlusionLayoutInfo.pushConstantRangeCount = 1;
+	occlusionLayoutInfo.pPushConstantRanges = &occlusionPushConstants;
+
+	try {
+		hiZPipelineLayout = device->createPipelineLayout(hiZLayoutInfo);
+		occlusionPipelineLayout = device->createPipelineLayout(occlusionLayoutInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to create occlusion Pipeline Layout!");
+	}
+
+	auto createComputePipeline = [this](const std::string& file, vk::PipelineLayout layout) {
+		auto code = readFile(SHADER_PATH + file);
+		vk::ShaderModule module = createShaderModule(code);
+
+		vk::ComputePipelineCreateInfo pipelineInfo;
+		pipelineInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+		pipelineInfo.stage.module = module;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = layout;
+
+		vk::Result result;
+		vk::Pipeline pipeline;
+		std::tie(result, pipeline) = device->createComputePipeline(nullptr, pipelineInfo);
+
+		device->destroyShaderModule(module);
+
+		if (result != vk::Result::eSuccess) {
+			throw std::runtime_error("failed to create compute Pipeline from " + file + "!");
+		}
+		return pipeline;
+	};
+
+	hiZPipeline = createComputePipeline("hiz.spv", hiZPipelineLayout);
+	occlusionPipeline = createComputePipeline("occlusion.spv", occlusionPipelineLayout);
+}
+
+void VulkanRenderer::createHiZResources() {
+	// FULL RESOLUTION AT LEVEL 0, HALVING DOWN TO 1x1
+	hiZExtent = viewExtent;
+	hiZMipCount = static_cast<uint32_t>(std::floor(std::log2(std::max(hiZExtent.width, hiZExtent.height)))) + 1;
+
+	// ALWAYS CREATED, THE MAIN DESCRIPTOR SET NEEDS SOMETHING TO POINT AT
+	createImage(hiZExtent.width, hiZExtent.height, vk::Format::eR32Sfloat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal, hiZImage, hiZImageMemory, hiZMipCount);
+	hiZImageView = createImageView(hiZImage, vk::Format::eR32Sfloat, vk::ImageAspectFlagBits::eColor, 0, hiZMipCount);
+
+	// THE PYRAMID LIVES IN GENERAL LAYOUT, IT IS WRITTEN AND READ BY COMPUTE ONLY
+	vk::CommandBuffer commandBuffer = beginSingleTimeCommands();
+
+	vk::ImageMemoryBarrier barrier;
+	barrier.oldLayout = vk::ImageLayout::eUndefined;
+	barrier.newLayout = vk::ImageLayout::eGeneral;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = hiZImage;
+	barrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, hiZMipCount, 0, 1);
+	barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eComputeShader,
+		{},
+		0, nullptr,
+		0, nullptr,
+		1, &barrier);
+
+	endSingleTimeCommands(commandBuffer);
+
+	if (!depthPrepass) return;
+
+	// ONE VIEW AND ONE DESCRIPTOR SET PER LEVEL FOR THE BUILD
+	hiZMipViews.resize(hiZMipCount);
+	for (uint32_t mip = 0; mip < hiZMipCount; mip++) {
+		hiZMipViews[mip] = createImageView(hiZImage, vk::Format::eR32Sfloat, vk::ImageAspectFlagBits::eColor, mip, 1);
+	}
+
+	std::array<vk::DescriptorPoolSize, 2> poolSizes;
+	poolSizes[0].type = vk::DescriptorType::eCombinedImageSampler;
+	poolSizes[0].descriptorCount = hiZMipCount;
+	poolSizes[1].type = vk::DescriptorType::eStorageImage;
+	poolSizes[1].descriptorCount = hiZMipCount;
+
+	vk::DescriptorPoolCreateInfo poolInfo;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = hiZMipCount;
+
+	try {
+		hiZDescriptorPool = device->createDescriptorPool(poolInfo);
+	}
+	catch (vk::SystemError err) {
+		throw(std::runtime_error("failed to create Hi-Z descriptor pool!"));
+	}
+
+	std::vector<vk::DescriptorSetLayout> layouts(hiZMipCount, hiZDescriptorSetLayout);
+	vk::DescriptorSetAllocateInfo allocInfo;
+	allocInfo.descriptorPool = hiZDescriptorPool;
+	allocInfo.descriptorSetCount = hiZMipCount;
+	allocInfo.pSetLayouts = layouts.data();
+
+	try {
+		hiZDescriptorSets = device->allocateDescriptorSets(allocInfo);
+	}
+	catch (vk::SystemError err) {
+		throw(std::runtime_error("failed to allocate Hi-Z descriptor sets!"));
+	}
+
+	for (uint32_t mip = 0; mip < hiZMipCount; mip++) {
+		// LEVEL 0 READS THE DEPTH BUFFER, EVERY OTHER LEVEL THE ONE ABOVE IT
+		vk::DescriptorImageInfo sourceInfo;
+		sourceInfo.sampler = hiZSampler;
+		sourceInfo.imageView = mip == 0 ? depthImageView : hiZMipViews[mip - 1];
+		sourceInfo.imageLayout = mip == 0 ? vk::ImageLayout::eShaderReadOnlyOptimal : vk::ImageLayout::eGeneral;
+
+		vk::DescriptorImageInfo destinationInfo;
+		destinationInfo.imageView = hiZMipViews[mip];
+		destinationInfo.imageLayout = vk::ImageLayout::eGeneral;
+
+		std::array<vk::WriteDescriptorSet, 2> descriptorWrites;
+		descriptorWrites[0].dstSet = hiZDescriptorSets[mip];
+		descriptorWrites[0].dstBinding = 0;
+		descriptorWrites[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+		descriptorWrites[0].descriptorCount = 1;
+		descriptorWrites[0].pImageInfo = &sourceInfo;
+		descriptorWrites[1].dstSet = hiZDescriptorSets[mip];
+		descriptorWrites[1].dstBinding = 1;
+		descriptorWrites[1].descriptorType = vk::DescriptorType::eStorageImage;
+		descriptorWrites[1].descriptorCount = 1;
+		descriptorWrites[1].pImageInfo = &destinationInfo;
+
+		device->updateDescriptorSets(static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+}
+
+void VulkanRenderer::destroyHiZResources() {
+	if (hiZDescriptorPool) {
+		device->destroyDescriptorPool(hiZDescriptorPool);
+		hiZDescriptorPool = nullptr;
+	}
+	for (auto view : hiZMipViews) {
+		device->destroyImageView(view);
+	}
+	hiZMipViews.clear();
+	hiZDescriptorSets.clear();
+
+	device->destroyImageView(hiZImageView);
+	device->destroyImage(hiZImage);
+	freeMemory(hiZImageMemory);
+}
+
+void VulkanRenderer::createOcclusionBuffer() {
+	vk::DeviceSize bufferSize = sizeof(uint32_t) * MAX_DRAW_OBJECTS;
+	createBuffer(bufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, occlusionBuffer, occlusionBufferMemory);
+
+	// NOTHING IS OCCLUDED BEFORE THE FIRST FRAME
+	vk::CommandBuffer commandBuffer = beginSingleTimeCommands();
+	commandBuffer.fillBuffer(occlusionBuffer, 0, bufferSize, 0);
+	endSingleTimeCommands(commandBuffer);
+}
+
+void VulkanRenderer::createDrawBuffers() {
+	vk::DeviceSize objectBufferSize = sizeof(DrawObject) * MAX_DRAW_OBJECTS;
+	// TWO INDIRECT COMMANDS, THEN ONE INSTANCE LIST PER PHASE
+	vk::DeviceSize indirectBufferSize = 2 * sizeof(vk::DrawIndexedIndirectCommand) + 2 * sizeof(uint32_t) * MAX_DRAW_OBJECTS;
+
+	drawObjectBuffers.resize(swapChainImages.size());
+	drawObjectBuffersMemory.resize(swapChainImages.size());
+	indirectBuffers.resize(swapChainImages.size());
+	indirectBuffersMemory.resize(swapChainImages.size());
+
+	for (size_t i = 0; i < swapChainImages.size(); i++) {
+		createBuffer(objectBufferSize, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, drawObjectBuffers[i], drawObjectBuffersMemory[i]);
+		createBuffer(indirectBufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, indirectBuffers[i], indirectBuffersMemory[i]);
+	}
+}
+
+void VulkanRenderer::destroyDrawBuffers() {
+	for (size_t i = 0; i < drawObjectBuffers.size(); i++) {
+		device->destroyBuffer(drawObjectBuffers[i]);
+		freeMemory(drawObjectBuffersMemory[i]);
+		device->destroyBuffer(indirectBuffers[i]);
+		freeMemory(indirectBuffersMemory[i]);
+	}
+	drawObjectBuffers.clear();
+	drawObjectBuffersMemory.clear();
+	indirectBuffers.clear();
+	indirectBuffersMemory.clear();
+}
+
+void VulkanRenderer::updateDrawObjects(uint32_t currentImage) {
+	PROFILE_FUNCTION();
+	// visibleObjects WAS FILLED BY THE FRUSTUM CULLING IN updateUniformBuffer
+	size_t count = std::min<size_t>(visibleObjects.size(), MAX_DRAW_OBJECTS);
+	if (count == 0) return;
+
+	auto data = static_cast<DrawObject*>(device->mapMemory(drawObjectBuffersMemory[currentImage], 0, sizeof(DrawObject) * count));
+	for (size_t i = 0; i < count; i++) {
+		uint32_t object = visibleObjects[i];
+		data[i].model = cullingScene.worldMatrix(object);
+		data[i].center = glm::vec4(cullingScene.worldCenter(object), 1.0f);
+		data[i].extent = glm::vec4(cullingScene.worldExtent(object), 0.0f);
+		data[i].info = glm::uvec4(object, 0, 0, 0);
+	}
+	device->unmapMemory(drawObjectBuffersMemory[currentImage]);
+}
+
+void VulkanRenderer::recordOcclusionPhase(vk::CommandBuffer commandBuffer, size_t image, uint32_t phase, bool useHiZ) {
+	uint32_t pushConstants[] = { phase, useHiZ ? 1u : 0u };
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, occlusionPipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, occlusionPipelineLayout, 0, 1, &descriptorSets[image], 0, nullptr);
+	commandBuffer.pushConstants(occlusionPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(pushConstants), pushConstants);
+	commandBuffer.dispatch((MAX_DRAW_OBJECTS + OCCLUSION_GROUP_SIZE - 1) / OCCLUSION_GROUP_SIZE, 1, 1);
+
+	// THE LIST IS CONSUMED BY AN INDIRECT DRAW AND THE VERTEX SHADER
+	vk::BufferMemoryBarrier listBarrier;
+	listBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+	listBarrier.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead;
+	listBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	listBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	listBarrier.buffer = indirectBuffers[image];
+	listBarrier.offset = 0;
+	listBarrier.size = VK_WHOLE_SIZE;
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader,
+		{},
+		0, nullptr,
+		1, &listBarrier,
+		0, nullptr);
+}
+
+void VulkanRenderer::recordHiZBuild(vk::CommandBuffer commandBuffer) {
+	// LAST FRAME'S OCCLUSION TEST MAY STILL BE READING THE PYRAMID
+	vk::ImageMemoryBarrier barrier;
+	barrier.oldLayout = vk::ImageLayout::eGeneral;
+	barrier.newLayout = vk::ImageLayout::eGeneral;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = hiZImage;
+	barrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, hiZMipCount, 0, 1);
+	barrier.srcAccessMask = vk::AccessFlagBits::eShaderRead;
+	barrier.dstAccessMask = vk::AccessFlagBits::eShaderWrite;
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+		{},
+		0, nullptr,
+		0, nullptr,
+		1, &barrier);
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, hiZPipeline);
+
+	int32_t sourceWidth = static_cast<int32_t>(viewExtent.width);
+	int32_t sourceHeight = static_cast<int32_t>(viewExtent.height);
+	for (uint32_t mip = 0; mip < hiZMipCount; mip++) {
+		int32_t width = std::max(static_cast<int32_t>(hiZExtent.width >> mip), 1);
+		int32_t height = std::max(static_cast<int32_t>(hiZExtent.height >> mip), 1);
+		int32_t sizes[] = { sourceWidth, sourceHeight, width, height };
+
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, hiZPipelineLayout, 0, 1, &hiZDescriptorSets[mip], 0, nullptr);
+		commandBuffer.pushConstants(hiZPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(sizes), sizes);
+		commandBuffer.dispatch((width + 7) / 8, (height + 7) / 8, 1);
+
+		// THE NEXT LEVEL (OR THE OCCLUSION TEST) READS THIS ONE
+		barrier.subresourceRange.baseMipLevel = mip;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+		barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+			{},
+			0, nullptr,
+			0, nullptr,
+			1, &barrier);
+
+		sourceWidth = width;
+		sourceHeight = height;
+	}
+}
+
+void VulkanRenderer::recordDepthPrepass(vk::CommandBuffer commandBuffer, size_t image) {
+	vk::RenderPassBeginInfo renderPassInfo;
+	renderPassInfo.renderPass = depthPrepassRenderPass;
+	renderPassInfo.framebuffer = depthPrepassFramebuffer;
+	// CLEAR ALL OF IT EVEN WHEN ONLY PART IS DRAWN, THE HI-Z BUILD READS THE
+	// WHOLE IMAGE AND FAR DEPTH OUTSIDE THE RENDERED PART KEEPS IT CONSERVATIVE
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = viewExtent;
+
+	vk::ClearValue clearValue;
+	clearValue.depthStencil = { 1.0f, 0 };
+	renderPassInfo.clearValueCount = 1;
+	renderPassInfo.pClearValues = &clearValue;
+
+	commandBuffer.beginRenderPass(&renderPassInfo, vk::SubpassContents::eInline);
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, depthPrepassPipeline);
+
+	vk::Viewport viewport(0.0f, 0.0f, (float)renderExtent.width, (float)renderExtent.height, 0.0f, 1.0f);
+	vk::Rect2D scissor({ 0, 0 }, renderExtent);
+	commandBuffer.setViewport(0, 1, &viewport);
+	commandBuffer.setScissor(0, 1, &scissor);
+
+	// EVERY BINDING IS A WINDOW INTO THE SAME BUFFER
+	const VertexLayout& layout = depthPassLayout();
+	std::vector<vk::Buffer> vertexBuffers(layout.offsets.size(), vertexBuffer);
+	commandBuffer.bindVertexBuffers(0, static_cast<uint32_t>(vertexBuffers.size()), vertexBuffers.data(), layout.offsets.data());
+	commandBuffer.bindIndexBuffer(indexBuffer, 0, mesh.indexType);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, 1, &descriptorSets[image], 0, nullptr);
+
+	// PHASE 0 LIST: WHAT WAS VISIBLE LAST FRAME
+	uint32_t instanceOffset = 0;
+	commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(instanceOffset), &instanceOffset);
+	commandBuffer.drawIndexedIndirect(indirectBuffers[image], 0, 1, sizeof(vk::DrawIndexedIndirectCommand));
+
+	commandBuffer.endRenderPass();
+}
+
+void VulkanRenderer::recordVisibility(vk::CommandBuffer commandBuffer, size_t image) {
+	// RESET BOTH INDIRECT COMMANDS, THE COMPUTE PASSES ONLY BUMP instanceCount
+	std::array<vk::DrawIndexedIndirectCommand, 2> commands;
+	for (auto& command : commands) {
+		command.indexCount = mesh.indexCount;
+		command.instanceCount = 0;
+		command.firstIndex = 0;
+		command.vertexOffset = 0;
+		command.firstInstance = 0;
+	}
+	commandBuffer.updateBuffer(indirectBuffers[image], 0, sizeof(commands), commands.data());
+
+	vk::BufferMemoryBarrier resetBarrier;
+	resetBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	resetBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+	resetBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	resetBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	resetBarrier.buffer = indirectBuffers[image];
+	resetBarrier.offset = 0;
+	resetBarrier.size = VK_WHOLE_SIZE;
+
+	// occlusionBuffer IS SHARED BY ALL FRAMES, LAST FRAME'S PHASE 1 WROTE IT
+	vk::MemoryBarrier flagsBarrier;
+	flagsBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+	flagsBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+		{},
+		1, &flagsBarrier,
+		1, &resetBarrier,
+		0, nullptr);
+
+	if (depthPrepass) {
+		recordOcclusionPhase(commandBuffer, image, 0, false);
+		recordDepthPrepass(commandBuffer, image);
+		recordHiZBuild(commandBuffer);
+	}
+
+	recordOcclusionPhase(commandBuffer, image, 1, depthPrepass);
+}
@@ -0,0 +1,269 @@
+#include "VulkanRenderer.h"
+
+// SPLITS "--name=value" INTO NAME AND VALUE
+static bool splitOption(const std::string& argument, std::string& name, std::string& value) {
+	if (argument.rfind("--", 0) != 0) {
+		return false;
+	}
+
+	auto equals = argument.find('=');
+	if (equals == std::string::npos) {
+		name = argument.substr(2);
+		value.clear();
+	}
+	else {
+		name = argument.substr(2, equals - 2);
+		value = argument.substr(equals + 1);
+	}
+	return true;
+}
+
+static uint32_t parseCount(const std::string& name, const std::string& value) {
+	try {
+		int count = std::stoi(value);
+		if (count > 0) {
+			return static_cast<uint32_t>(count);
+		}
+	}
+	catch (const std::exception&) {
+	}
+	throw std::runtime_error("option --" + name + " needs a positive number, got '" + value + "'");
+}
+
+static vk::PresentModeKHR parsePresentMode(const std::string& value) {
+	if (value == "fifo") return vk::PresentModeKHR::eFifo;
+	if (value == "fifo-relaxed") return vk::PresentModeKHR::eFifoRelaxed;
+	if (value == "mailbox") return vk::PresentModeKHR::eMailbox;
+	if (value == "immediate") return vk::PresentModeKHR::eImmediate;
+
+	throw std::runtime_error("unknown present mode '" + value + "' (fifo, fifo-relaxed, mailbox, immediate)");
+}
+
+void VulkanRenderer::parseCommandLine(int argc, char* argv[]) {
+	for (int i = 1; i < argc; i++) {
+		std::string name, value;
+		if (!splitOption(argv[i], name, value)) {
+			throw std::runtime_error(std::string("unexpected argument '") + argv[i] + "'");
+		}
+
+		if (name == "present-mode") {
+			preferredPresentMode = parsePresentMode(value);
+		}
+		else if (name == "swapchain-images") {
+			requestedSwapChainImageCount = parseCount(name, value);
+		}
+		else if (name == "frames-in-flight") {
+			MAX_FRAMES_IN_FLIGHT = static_cast<int>(parseCount(name, value));
+		}
+		else if (name == "sim-rate") {
+			simulationRate = static_cast<double>(parseCount(name, value));
+		}
+		else if (name == "workers") {
+			workerThreadCount = parseCount(name, value);
+		}
+		else if (name == "serial-startup") {
+			serialStartup = true;
+		}
+		else if (name == "gpu") {
+			// PART OF THE DEVICE NAME OR ITS UUID
+			if (value.empty()) {
+				throw std::runtime_error("option --gpu needs a device name or UUID");
+			}
+			gpuOverride = value;
+		}
+		else if (name == "shared-queues") {
+			dedicatedQueues = false;
+		}
+		else if (name == "cull-shape") {
+			if (value == "sphere") cullShape = CullShape::Sphere;
+			else if (value == "box") cullShape = CullShape::Box;
+			else throw std::runtime_error("unknown cull shape '" + value + "' (sphere, box)");
+		}
+		else if (name == "lights") {
+			lightCount = parseCount(name, value);
+		}
+		else if (name == "light-radius") {
+			// IN PERCENT OF THE HALF DIAGONAL OF THE LIT VOLUME
+			lightRadius = parseCount(name, value) / 100.0f;
+		}
+		else if (name == "depth-prepass") {
+			depthPrepass = true;
+		}
+		else if (name == "dynamic-resolution") {
+			// OPTIONAL VALUE IS THE FRAME RATE TO HOLD
+			dynamicResolution = true;
+			if (!value.empty()) {
+				targetFrameRate = static_cast<float>(parseCount(name, value));
+			}
+		}
+		else if (name == "min-render-scale") {
+			// IN PERCENT OF THE WINDOW SIZE
+			minRenderScale = std::min(parseCount(name, value), 100u) / 100.0f;
+		}
+		else if (name == "batch") {
+			if (value.empty()) {
+				throw std::runtime_error("option --batch needs a job list");
+			}
+			batchPath = value;
+		}
+		else if (name == "batch-output") {
+			if (value.empty()) {
+				throw std::runtime_error("option --batch-output needs a directory");
+			}
+			batchOutput = value;
+		}
+		else if (name == "batch-churn") {
+			// OPTIONAL VALUE IS THE NUMBER OF PASSES
+			batchChurn = value.empty() ? 4 : parseCount(name, value);
+		}
+		else if (name == "batch-size") {
+			// WIDTH x HEIGHT OF THE IMAGES, THE HIDDEN WINDOW IS MADE THAT BIG
+			auto x = value.find('x');
+			if (x == std::string::npos) {
+				throw std::runtime_error("option --batch-size needs WIDTHxHEIGHT, got '" + value + "'");
+			}
+			WIDTH = parseCount(name, value.substr(0, x));
+			HEIGHT = parseCount(name, value.substr(x + 1));
+		}
+		else if (name == "stereo") {
+			// OPTIONAL VALUE IS THE EYE SEPARATION IN MILLIMETERS (ONE WORLD UNIT IS A METER)
+			stereo = true;
+			if (!value.empty()) {
+				eyeSeparation = parseCount(name, value) / 1000.0f;
+			}
+		}
+		else if (name == "shadows") {
+			// OPTIONAL VALUE IS THE NUMBER OF CASCADES
+			shadows = true;
+			if (!value.empty()) {
+				shadowCascadeCount = std::min(parseCount(name, value), MAX_SHADOW_CASCADES);
+			}
+		}
+		else if (name == "shadow-size") {
+			shadowMapSize = parseCount(name, value);
+		}
+		else if (name == "shadow-distance") {
+			shadowDistance = static_cast<float>(parseCount(name, value));
+		}
+		else if (name == "sun-speed") {
+			// DEGREES PER SECOND, A MOVING SUN KEEPS THE CASCADES RE-RENDERING
+			sunSpeed = static_cast<float>(parseCount(name, value));
+		}
+		else if (name == "particles") {
+			// OPTIONAL VALUE IS HOW MANY, A MILLION WITHOUT ONE
+			particleCount = value.empty() ? 1000000 : parseCount(name, value);
+		}
+		else if (name == "particle-lifetime") {
+			// IN SECONDS
+			particleLifetime = static_cast<float>(parseCount(name, value));
+		}
+		else if (name == "post") {
+			postProcess = true;
+		}
+		else if (name == "exposure") {
+			// IN PERCENT, 100 LEAVES THE SCENE AS IT IS
+			postSettings.exposure = parseCount(name, value) / 100.0f;
+		}
+		else if (name == "bloom") {
+			// IN PERCENT OF THE BLOOM ADDED ON TOP OF THE SCENE
+			postSettings.bloomStrength = parseCount(name, value) / 100.0f;
+		}
+		else if (name == "bloom-levels") {
+			bloomLevels = parseCount(name, value);
+		}
+		else if (name == "sharpen") {
+			// IN PERCENT
+			postSettings.sharpness = parseCount(name, value) / 100.0f;
+		}
+		else if (name == "memory-report") {
+			if (value.empty()) {
+				throw std::runtime_error("option --memory-report needs a file name");
+			}
+			memoryReportPath = value;
+		}
+		else if (name == "resource-budget") {
+			// IN MEGABYTES
+			resourceBudget = static_cast<vk::DeviceSize>(parseCount(name, value)) * 1024 * 1024;
+		}
+		else if (name == "defrag-budget") {
+			// MEGABYTES MOVED PER FRAME
+			defragBudget = static_cast<vk::DeviceSize>(parseCount(name, value)) * 1024 * 1024;
+		}
+		else if (name == "no-defrag") {
+			defragment = false;
+		}
+		else if (name == "shader-cache") {
+			// DIRECTORY FOR THE PIPELINE VARIANTS, EMPTY KEEPS THEM IN MEMORY ONLY
+			shaderCachePath = value;
+		}
+		else if (name == "tinyobj") {
+			nativeObjLoader = false;
+		}
+		else if (name == "interleaved-vertices") {
+			splitVertexStreams = false;
+		}
+		else if (name == "model") {
+			if (value.empty()) {
+				throw std::runtime_error("option --model needs a file name");
+			}
+			MODEL_PATH = value;
+		}
+		else if (name == "world") {
+			if (value.empty()) {
+				throw std::runtime_error("option --world needs an index file");
+			}
+			worldPath = value;
+		}
+		else if (name == "world-radius") {
+			// CELLS ARE DROPPED A QUARTER FURTHER OUT THAN THEY ARE LOADED
+			worldSettings.loadRadius = static_cast<float>(parseCount(name, value));
+			worldSettings.unloadRadius = worldSettings.loadRadius * 1.25f;
+		}
+		else if (name == "world-memory") {
+			// MEGABYTES OF PLACEMENTS, THE MODEL ITSELF IS UNDER --resource-budget
+			worldSettings.memoryBudget = static_cast<size_t>(parseCount(name, value)) * 1024 * 1024;
+		}
+		else if (name == "world-objects") {
+			worldSettings.objectBudget = parseCount(name, value);
+		}
+		else if (name == "profile") {
+			if (value.empty()) {
+				throw std::runtime_error("option --profile needs a file name");
+			}
+			profilePath = value;
+		}
+		else if (name == "software") {
+			softwareRendering = true;
+		}
+		else if (name == "no-latency-report") {
+			reportLatency = false;
+		}
+		else {
+			throw std::runtime_error("unknown option --" + name);
+		}
+	}
+
+	// THE CPU RENDERER ONLY WRITES IMAGES, IT HAS NO WINDOW TO PRESENT TO
+	if (softwareRendering && !batchMode()) {
+		throw std::runtime_error("option --software needs --batch");
+	}
+
+	// EVERY BATCH IMAGE IS ONE VIEW AT THE FULL SIZE, BATCH SUBMITS DO NOT RUN THE PARTICLE STEP
+	// AND THE READBACK COPIES THE SCENE TARGET AS IT IS, SO IT CAN NOT BE HDR
+	if (batchMode() && (dynamicResolution || stereo || particleCount > 0 || postProcess)) {
+		std::cout << "dynamic resolution, stereo, particles and post processing turned off for --batch\n";
+		dynamicResolution = false;
+		stereo = false;
+		particleCount = 0;
+		postProcess = false;
+	}
+
+	// THE HI-Z OF ONE EYE DOES NOT TELL WHAT THE OTHER EYE CAN SEE
+	if (stereo && depthPrepass) {
+		std::cout << "depth prepass turned off, it does not work with --stereo\n";
+		depthPrepass = false;
+	}
+
+	resolutionController.setTargetFrameTime(1000.0f / targetFrameRate);
+	resolutionController.setMinScale(minRenderScale);
+}
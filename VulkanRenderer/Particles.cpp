@@ -0,0 +1,619 @@
+#include "VulkanRenderer.h"
+
+// GPU PARTICLES
+// particleCount PARTICLES LIVE IN ONE STORAGE BUFFER WITH A DEAD LIST OF FREE INDICES
+// AND TWO ALIVE LISTS THAT TAKE TURNS (particleParity). EVERY FRAME THREE COMPUTE
+// STAGES RUN ON computeQueue:
+// 1. particle_emit.comp TAKES INDICES OFF THE DEAD LIST AND ADDS THEM TO THIS FRAME'S ALIVE LIST
+// 2. particle_simulate.comp MOVES AND AGES EVERYTHING ON IT
+// 3. particle_compact.comp PUTS THE DEAD BACK AND PACKS THE SURVIVORS INTO THE OTHER
+//    ALIVE LIST AND INTO THE IMAGE'S INSTANCE BUFFER, WHICH IS DRAWN AS BILLBOARDS WITH
+//    ONE INDIRECT INSTANCED DRAW IN THE MAIN PASS
+// THE COUNTS NEVER COME BACK TO THE CPU, THE SIMULATE AND COMPACT DISPATCHES ARE
+// INDIRECT AND THE DRAW COUNT IS COPIED INTO THE IMAGE'S DRAW BUFFER
+// ONLY THE INSTANCES AND THE DRAW LEAVE THE COMPUTE QUEUE, THEY ARE RELEASED TO THE
+// GRAPHICS FAMILY AT THE END OF THE STEP AND ACQUIRED BEFORE THE MAIN PASS. NOTHING
+// IN THEM IS NEEDED AFTER THE DRAW, SO THEY ARE NOT TRANSFERRED BACK, THE NEXT STEP
+// FOR THAT IMAGE TAKES THEM OVER WITHOUT THEIR CONTENTS
+// A STEP ONLY WAITS FOR THE LAST FRAME THAT USED ITS IMAGE, SO IT RUNS ON THE COMPUTE
+// QUEUE WHILE THE GRAPHICS QUEUE IS STILL DRAWING THE PREVIOUS FRAME
+
+// LAYOUT OF particleCounterBuffer, SAME AS CounterBuffer IN THE SHADERS
+struct ParticleCounters {
+	int32_t deadCount;
+	uint32_t pad[3];
+	// PER ALIVE LIST, instanceCount IS HOW MANY ARE ON IT
+	vk::DrawIndirectCommand draws[2];
+	// PER ALIVE LIST, ONE GROUP PER PARTICLE_GROUP_SIZE OF THEM
+	vk::DispatchIndirectCommand dispatches[2];
+};
+
+static vk::DeviceSize drawOffset(uint32_t list) {
+	return offsetof(ParticleCounters, draws) + list * sizeof(vk::DrawIndirectCommand);
+}
+
+static vk::DeviceSize dispatchOffset(uint32_t list) {
+	return offsetof(ParticleCounters, dispatches) + list * sizeof(vk::DispatchIndirectCommand);
+}
+
+void VulkanRenderer::createParticleResources() {
+	if (particleCount == 0) return;
+
+	vk::CommandPoolCreateInfo poolInfo;
+	poolInfo.queueFamilyIndex = queueFamilies.computeFamily.value();
+
+	try {
+		particleCommandPool = device->createCommandPool(poolInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to create particle Command Pool!");
+	}
+
+	particleSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+	try {
+		for (auto& semaphore : particleSemaphores) {
+			semaphore = device->createSemaphore(vk::SemaphoreCreateInfo());
+		}
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to create particle semaphores!");
+	}
+
+	vk::DeviceSize particleBufferSize = sizeof(GpuParticle) * static_cast<vk::DeviceSize>(particleCount);
+	// DEAD LIST AND TWO ALIVE LISTS
+	vk::DeviceSize listBufferSize = sizeof(uint32_t) * 3 * static_cast<vk::DeviceSize>(particleCount);
+	createBuffer(particleBufferSize, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, particleBuffer, particleBufferMemory);
+	createBuffer(sizeof(ParticleCounters), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, particleCounterBuffer, particleCounterBufferMemory);
+	createBuffer(listBufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, particleListBuffer, particleListBufferMemory);
+
+	// EVERY PARTICLE STARTS DEAD, BOTH ALIVE LISTS EMPTY
+	ParticleCounters counters{};
+	counters.deadCount = static_cast<int32_t>(particleCount);
+	for (uint32_t list = 0; list < 2; list++) {
+		counters.draws[list] = vk::DrawIndirectCommand(4, 0, 0, 0);
+		counters.dispatches[list] = vk::DispatchIndirectCommand(0, 1, 1);
+	}
+
+	vk::DeviceSize deadListSize = sizeof(uint32_t) * static_cast<vk::DeviceSize>(particleCount);
+	vk::Buffer stagingBuffer;
+	vk::DeviceMemory stagingBufferMemory;
+	createBuffer(sizeof(counters) + deadListSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingBufferMemory);
+
+	auto data = static_cast<unsigned char*>(device->mapMemory(stagingBufferMemory, 0, sizeof(counters) + deadListSize));
+	memcpy(data, &counters, sizeof(counters));
+	auto deadList = reinterpret_cast<uint32_t*>(data + sizeof(counters));
+	for (uint32_t i = 0; i < particleCount; i++) {
+		deadList[i] = i;
+	}
+	device->unmapMemory(stagingBufferMemory);
+
+	// UPLOADED ON THE COMPUTE QUEUE, SO ITS FAMILY OWNS THEM FROM THE START
+	vk::CommandBuffer commandBuffer = beginOneTimeCommands(particleCommandPool);
+
+	vk::BufferCopy counterCopy(0, 0, sizeof(counters));
+	vk::BufferCopy deadListCopy(sizeof(counters), 0, deadListSize);
+	commandBuffer.copyBuffer(stagingBuffer, particleCounterBuffer, 1, &counterCopy);
+	commandBuffer.copyBuffer(stagingBuffer, particleListBuffer, 1, &deadListCopy);
+
+	submitOneTimeCommands(commandBuffer, particleCommandPool, computeQueue);
+
+	device->destroyBuffer(stagingBuffer);
+	freeMemory(stagingBufferMemory);
+
+	std::cout << "particles: " << particleCount << " on queue family " << queueFamilies.computeFamily.value()
+		<< (queueFamilies.computeFamily == queueFamilies.graphicsFamily ? " (same as graphics)\n" : " (ownership transfer to graphics)\n");
+}
+
+void VulkanRenderer::createParticlePipelines() {
+	if (particleCount == 0) return;
+
+	// PARAMETERS, PARTICLES, COUNTERS, LISTS, INSTANCES
+	std::array<vk::DescriptorSetLayoutBinding, 5> bindings;
+	for (uint32_t binding = 0; binding < bindings.size(); binding++) {
+		bindings[binding].binding = binding;
+		bindings[binding].descriptorType = binding == 0 ? vk::DescriptorType::eUniformBuffer : vk::DescriptorType::eStorageBuffer;
+		bindings[binding].descriptorCount = 1;
+		bindings[binding].stageFlags = vk::ShaderStageFlagBits::eCompute;
+	}
+
+	vk::DescriptorSetLayoutCreateInfo layoutInfo;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	try {
+		particleDescriptorSetLayout = device->createDescriptorSetLayout(layoutInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to create particle Descriptor Set Layout!");
+	}
+
+	// THE PARITY
+	vk::PushConstantRange pushConstantRange(vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t));
+	vk::PipelineLayoutCreateInfo pipelineLayoutInfo;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &particleDescriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	try {
+		particlePipelineLayout = device->createPipelineLayout(pipelineLayoutInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to create particle Pipeline Layout!");
+	}
+
+	auto createComputePipeline = [this](const std::string& file) {
+		auto code = readFile(SHADER_PATH + file);
+		vk::ShaderModule module = createShaderModule(code);
+
+		vk::ComputePipelineCreateInfo pipelineInfo;
+		pipelineInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+		pipelineInfo.stage.module = module;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = particlePipelineLayout;
+
+		vk::Result result;
+		vk::Pipeline pipeline;
+		std::tie(result, pipeline) = device->createComputePipeline(nullptr, pipelineInfo);
+
+		device->destroyShaderModule(module);
+
+		if (result != vk::Result::eSuccess) {
+			throw std::runtime_error("failed to create compute Pipeline from " + file + "!");
+		}
+		return pipeline;
+	};
+
+	particleEmitPipeline = createComputePipeline("particle_emit.spv");
+	particleSimulatePipeline = createComputePipeline("particle_simulate.spv");
+	particleCompactPipeline = createComputePipeline("particle_compact.spv");
+}
+
+void VulkanRenderer::createParticleRenderPipeline() {
+	if (particleCount == 0) return;
+
+	// MAIN DESCRIPTOR SET FOR THE CAMERA
+	vk::PipelineLayoutCreateInfo pipelineLayoutInfo;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+	try {
+		particleRenderPipelineLayout = device->createPipelineLayout(pipelineLayoutInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to create particle render Pipeline Layout!");
+	}
+
+	auto vertShaderCode = readFile(SHADER_PATH + (stereo ? "particle_vert_multiview.spv" : "particle_vert.spv"));
+	auto fragShaderCode = readFile(SHADER_PATH + "particle_frag.spv");
+	vk::ShaderModule vertShaderModule = createShaderModule(vertShaderCode);
+	vk::ShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+
+	std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages;
+	shaderStages[0].stage = vk::ShaderStageFlagBits::eVertex;
+	shaderStages[0].module = vertShaderModule;
+	shaderStages[0].pName = "main";
+	shaderStages[1].stage = vk::ShaderStageFlagBits::eFragment;
+	shaderStages[1].module = fragShaderModule;
+	shaderStages[1].pName = "main";
+
+	// ONE ParticleInstance PER INSTANCE, THE CORNERS COME FROM THE VERTEX INDEX
+	vk::VertexInputBindingDescription bindingDescription(0, sizeof(ParticleInstance), vk::VertexInputRate::eInstance);
+	std::array<vk::VertexInputAttributeDescription, 2> attributeDescriptions = {
+		vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(ParticleInstance, positionSize)),
+		vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(ParticleInstance, color))
+	};
+
+	vk::PipelineVertexInputStateCreateInfo vertexInputInfo;
+	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+	vk::PipelineInputAssemblyStateCreateInfo inputAssembly;
+	inputAssembly.topology = vk::PrimitiveTopology::eTriangleStrip;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	vk::Viewport viewport(0.0f, 0.0f, (float)viewExtent.width, (float)viewExtent.height, 0.0f, 1.0f);
+	vk::Rect2D scissor({ 0, 0 }, viewExtent);
+
+	vk::PipelineViewportStateCreateInfo viewportState;
+	viewportState.viewportCount = 1;
+	viewportState.pViewports = &viewport;
+	viewportState.scissorCount = 1;
+	viewportState.pScissors = &scissor;
+
+	// SAME AS THE MAIN PIPELINE, SET WHILE RECORDING
+	std::array<vk::DynamicState, 2> dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+	vk::PipelineDynamicStateCreateInfo dynamicState;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	vk::PipelineRasterizationStateCreateInfo rasterizer;
+	rasterizer.polygonMode = vk::PolygonMode::eFill;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = vk::CullModeFlagBits::eNone;
+	rasterizer.frontFace = vk::FrontFace::eCounterClockwise;
+
+	vk::PipelineMultisampleStateCreateInfo multisampling;
+	multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
+
+	// HIDDEN BEHIND THE SCENE, BUT THEY DO NOT HIDE EACH OTHER
+	vk::PipelineDepthStencilStateCreateInfo depthStencil;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_FALSE;
+	depthStencil.depthCompareOp = vk::CompareOp::eLess;
+
+	// ADDITIVE, THE ORDER THEY ARE DRAWN IN DOES NOT MATTER
+	vk::PipelineColorBlendAttachmentState colorBlendAttachment;
+	colorBlendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+	colorBlendAttachment.blendEnable = VK_TRUE;
+	colorBlendAttachment.srcColorBlendFactor = vk::BlendFactor::eOne;
+	colorBlendAttachment.dstColorBlendFactor = vk::BlendFactor::eOne;
+	colorBlendAttachment.colorBlendOp = vk::BlendOp::eAdd;
+	colorBlendAttachment.srcAlphaBlendFactor = vk::BlendFactor::eZero;
+	colorBlendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eOne;
+	colorBlendAttachment.alphaBlendOp = vk::BlendOp::eAdd;
+
+	vk::PipelineColorBlendStateCreateInfo colorBlending;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	vk::GraphicsPipelineCreateInfo pipelineInfo;
+	pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+	pipelineInfo.pStages = shaderStages.data();
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = particleRenderPipelineLayout;
+	pipelineInfo.renderPass = renderPass;
+	pipelineInfo.subpass = 0;
+
+	vk::Result result;
+	std::tie(result, particleRenderPipeline) = device->createGraphicsPipeline(nullptr, pipelineInfo);
+
+	if (result != vk::Result::eSuccess) {
+		throw std::runtime_error("failed to create particle Pipeline!");
+	}
+
+	device->destroyShaderModule(fragShaderModule);
+	device->destroyShaderModule(vertShaderModule);
+}
+
+void VulkanRenderer::createParticleBuffers() {
+	if (particleCount == 0) return;
+
+	size_t imageCount = swapChainImages.size();
+	particleParamBuffers.resize(imageCount);
+	particleParamBuffersMemory.resize(imageCount);
+	particleInstanceBuffers.resize(imageCount);
+	particleInstanceBuffersMemory.resize(imageCount);
+	particleDrawBuffers.resize(imageCount);
+	particleDrawBuffersMemory.resize(imageCount);
+
+	// EVERY PARTICLE COULD BE ALIVE
+	vk::DeviceSize instanceBufferSize = sizeof(ParticleInstance) * static_cast<vk::DeviceSize>(particleCount);
+	for (size_t i = 0; i < imageCount; i++) {
+		createBuffer(sizeof(ParticleParams), vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, particleParamBuffers[i], particleParamBuffersMemory[i]);
+		createBuffer(instanceBufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, particleInstanceBuffers[i], particleInstanceBuffersMemory[i]);
+		createBuffer(sizeof(vk::DrawIndirectCommand), vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, particleDrawBuffers[i], particleDrawBuffersMemory[i]);
+	}
+
+	std::array<vk::DescriptorPoolSize, 2> poolSizes;
+	poolSizes[0].type = vk::DescriptorType::eUniformBuffer;
+	poolSizes[0].descriptorCount = static_cast<uint32_t>(imageCount);
+	poolSizes[1].type = vk::DescriptorType::eStorageBuffer;
+	poolSizes[1].descriptorCount = static_cast<uint32_t>(4 * imageCount);
+
+	vk::DescriptorPoolCreateInfo poolInfo;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = static_cast<uint32_t>(imageCount);
+
+	try {
+		particleDescriptorPool = device->createDescriptorPool(poolInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to create particle descriptor pool!");
+	}
+
+	std::vector<vk::DescriptorSetLayout> layouts(imageCount, particleDescriptorSetLayout);
+	vk::DescriptorSetAllocateInfo allocInfo;
+	allocInfo.descriptorPool = particleDescriptorPool;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(imageCount);
+	allocInfo.pSetLayouts = layouts.data();
+
+	try {
+		particleDescriptorSets = device->allocateDescriptorSets(allocInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to allocate particle descriptor sets!");
+	}
+
+	for (size_t i = 0; i < imageCount; i++) {
+		std::array<vk::DescriptorBufferInfo, 5> bufferInfos = {
+			vk::DescriptorBufferInfo(particleParamBuffers[i], 0, sizeof(ParticleParams)),
+			vk::DescriptorBufferInfo(particleBuffer, 0, VK_WHOLE_SIZE),
+			vk::DescriptorBufferInfo(particleCounterBuffer, 0, VK_WHOLE_SIZE),
+			vk::DescriptorBufferInfo(particleListBuffer, 0, VK_WHOLE_SIZE),
+			vk::DescriptorBufferInfo(particleInstanceBuffers[i], 0, VK_WHOLE_SIZE)
+		};
+
+		std::array<vk::WriteDescriptorSet, 5> descriptorWrites;
+		for (uint32_t binding = 0; binding < descriptorWrites.size(); binding++) {
+			descriptorWrites[binding].dstSet = particleDescriptorSets[i];
+			descriptorWrites[binding].dstBinding = binding;
+			descriptorWrites[binding].dstArrayElement = 0;
+			descriptorWrites[binding].descriptorType = binding == 0 ? vk::DescriptorType::eUniformBuffer : vk::DescriptorType::eStorageBuffer;
+			descriptorWrites[binding].descriptorCount = 1;
+			descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+		}
+
+		device->updateDescriptorSets(static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+
+	vk::CommandBufferAllocateInfo commandBufferInfo;
+	commandBufferInfo.commandPool = particleCommandPool;
+	commandBufferInfo.level = vk::CommandBufferLevel::ePrimary;
+	commandBufferInfo.commandBufferCount = static_cast<uint32_t>(2 * imageCount);
+
+	try {
+		particleCommandBuffers = device->allocateCommandBuffers(commandBufferInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to allocate particle command buffers!");
+	}
+
+	for (size_t i = 0; i < imageCount; i++) {
+		recordParticleSimulation(i, 0);
+		recordParticleSimulation(i, 1);
+	}
+}
+
+void VulkanRenderer::destroyParticleBuffers() {
+	if (particleCount == 0) return;
+
+	device->freeCommandBuffers(particleCommandPool, static_cast<uint32_t>(particleCommandBuffers.size()), particleCommandBuffers.data());
+	particleCommandBuffers.clear();
+
+	device->destroyDescriptorPool(particleDescriptorPool);
+	particleDescriptorSets.clear();
+
+	for (size_t i = 0; i < particleParamBuffers.size(); i++) {
+		device->destroyBuffer(particleParamBuffers[i]);
+		freeMemory(particleParamBuffersMemory[i]);
+		device->destroyBuffer(particleInstanceBuffers[i]);
+		freeMemory(particleInstanceBuffersMemory[i]);
+		device->destroyBuffer(particleDrawBuffers[i]);
+		freeMemory(particleDrawBuffersMemory[i]);
+	}
+	particleParamBuffers.clear();
+	particleParamBuffersMemory.clear();
+	particleInstanceBuffers.clear();
+	particleInstanceBuffersMemory.clear();
+	particleDrawBuffers.clear();
+	particleDrawBuffersMemory.clear();
+
+	// THE RENDER PASS GOES WITH THE SWAPCHAIN
+	device->destroyPipeline(particleRenderPipeline);
+	device->destroyPipelineLayout(particleRenderPipelineLayout);
+}
+
+void VulkanRenderer::destroyParticleResources() {
+	if (particleCount == 0) return;
+
+	device->destroyPipeline(particleEmitPipeline);
+	device->destroyPipeline(particleSimulatePipeline);
+	device->destroyPipeline(particleCompactPipeline);
+	device->destroyPipelineLayout(particlePipelineLayout);
+	device->destroyDescriptorSetLayout(particleDescriptorSetLayout);
+
+	device->destroyBuffer(particleBuffer);
+	freeMemory(particleBufferMemory);
+	device->destroyBuffer(particleCounterBuffer);
+	freeMemory(particleCounterBufferMemory);
+	device->destroyBuffer(particleListBuffer);
+	freeMemory(particleListBufferMemory);
+
+	for (auto semaphore : particleSemaphores) {
+		device->destroySemaphore(semaphore);
+	}
+	particleSemaphores.clear();
+
+	device->destroyCommandPool(particleCommandPool);
+}
+
+void VulkanRenderer::recordParticleSimulation(size_t image, uint32_t parity) {
+	vk::CommandBuffer commandBuffer = particleCommandBuffers[2 * image + parity];
+	uint32_t next = 1 - parity;
+
+	vk::CommandBufferBeginInfo beginInfo;
+	commandBuffer.begin(beginInfo);
+
+	// THE PREVIOUS STEP RAN EARLIER ON THIS QUEUE AND WROTE EVERYTHING WE READ
+	vk::MemoryBarrier previousStep;
+	previousStep.srcAccessMask = vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite;
+	previousStep.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eIndirectCommandRead;
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eDrawIndirect,
+		{},
+		1, &previousStep,
+		0, nullptr,
+		0, nullptr);
+
+	// EMPTY THE LIST THE SURVIVORS GO TO
+	commandBuffer.fillBuffer(particleCounterBuffer, drawOffset(next) + offsetof(vk::DrawIndirectCommand, instanceCount), sizeof(uint32_t), 0);
+	commandBuffer.fillBuffer(particleCounterBuffer, dispatchOffset(next) + offsetof(vk::DispatchIndirectCommand, x), sizeof(uint32_t), 0);
+
+	vk::MemoryBarrier clearBarrier;
+	clearBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	clearBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+		{},
+		1, &clearBarrier,
+		0, nullptr,
+		0, nullptr);
+
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, particlePipelineLayout, 0, 1, &particleDescriptorSets[image], 0, nullptr);
+	commandBuffer.pushConstants(particlePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(parity), &parity);
+
+	// EVERY STAGE READS WHAT THE ONE BEFORE WROTE, THE DISPATCH SIZES INCLUDED
+	vk::MemoryBarrier stageBarrier;
+	stageBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+	stageBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eIndirectCommandRead;
+
+	// THE REAL COUNT IS IN THE PARAMETERS, THE LIMIT IS WHAT ONE STEP CAN ASK FOR
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, particleEmitPipeline);
+	commandBuffer.dispatch((particleEmitLimit() + PARTICLE_GROUP_SIZE - 1) / PARTICLE_GROUP_SIZE, 1, 1);
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eDrawIndirect,
+		{},
+		1, &stageBarrier,
+		0, nullptr,
+		0, nullptr);
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, particleSimulatePipeline);
+	commandBuffer.dispatchIndirect(particleCounterBuffer, dispatchOffset(parity));
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+		{},
+		1, &stageBarrier,
+		0, nullptr,
+		0, nullptr);
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, particleCompactPipeline);
+	commandBuffer.dispatchIndirect(particleCounterBuffer, dispatchOffset(parity));
+
+	// THE SURVIVOR COUNT BECOMES THE IMAGE'S DRAW
+	vk::MemoryBarrier countBarrier;
+	countBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+	countBarrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer,
+		{},
+		1, &countBarrier,
+		0, nullptr,
+		0, nullptr);
+
+	vk::BufferCopy drawCopy(drawOffset(next), 0, sizeof(vk::DrawIndirectCommand));
+	commandBuffer.copyBuffer(particleCounterBuffer, particleDrawBuffers[image], 1, &drawCopy);
+
+	// RELEASE THE INSTANCES AND THE DRAW TO THE GRAPHICS FAMILY, recordParticleAcquire
+	// IS THE OTHER HALF. ON ONE FAMILY THE SEMAPHORE ALREADY MAKES THE WRITES VISIBLE
+	if (queueFamilies.computeFamily != queueFamilies.graphicsFamily) {
+		std::array<vk::BufferMemoryBarrier, 2> releaseBarriers;
+		releaseBarriers[0].srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+		releaseBarriers[0].buffer = particleInstanceBuffers[image];
+		releaseBarriers[1].srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+		releaseBarriers[1].buffer = particleDrawBuffers[image];
+		for (auto& barrier : releaseBarriers) {
+			barrier.dstAccessMask = {};
+			barrier.srcQueueFamilyIndex = queueFamilies.computeFamily.value();
+			barrier.dstQueueFamilyIndex = queueFamilies.graphicsFamily.value();
+			barrier.offset = 0;
+			barrier.size = VK_WHOLE_SIZE;
+		}
+
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+			{},
+			0, nullptr,
+			static_cast<uint32_t>(releaseBarriers.size()), releaseBarriers.data(),
+			0, nullptr);
+	}
+
+	try {
+		commandBuffer.end();
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to record the particle command buffer!");
+	}
+}
+
+void VulkanRenderer::recordParticleAcquire(vk::CommandBuffer commandBuffer, size_t image) {
+	if (particleCount == 0 || queueFamilies.computeFamily == queueFamilies.graphicsFamily) return;
+
+	// SAME BUFFERS AND FAMILIES AS THE RELEASE IN recordParticleSimulation
+	std::array<vk::BufferMemoryBarrier, 2> acquireBarriers;
+	acquireBarriers[0].dstAccessMask = vk::AccessFlagBits::eVertexAttributeRead;
+	acquireBarriers[0].buffer = particleInstanceBuffers[image];
+	acquireBarriers[1].dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead;
+	acquireBarriers[1].buffer = particleDrawBuffers[image];
+	for (auto& barrier : acquireBarriers) {
+		barrier.srcAccessMask = {};
+		barrier.srcQueueFamilyIndex = queueFamilies.computeFamily.value();
+		barrier.dstQueueFamilyIndex = queueFamilies.graphicsFamily.value();
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+	}
+
+	// THE SOURCE STAGES ARE THE ONES THE FRAME'S SUBMIT WAITS ON THE SEMAPHORE AT
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput,
+		{},
+		0, nullptr,
+		static_cast<uint32_t>(acquireBarriers.size()), acquireBarriers.data(),
+		0, nullptr);
+}
+
+void VulkanRenderer::recordParticleDraw(vk::CommandBuffer commandBuffer, size_t image) {
+	if (particleCount == 0) return;
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, particleRenderPipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, particleRenderPipelineLayout, 0, 1, &descriptorSets[image], 0, nullptr);
+
+	vk::DeviceSize offset = 0;
+	commandBuffer.bindVertexBuffers(0, 1, &particleInstanceBuffers[image], &offset);
+
+	// 4 VERTICES, ONE INSTANCE PER SURVIVOR, THE COUNT COMES FROM particle_compact.comp
+	commandBuffer.drawIndirect(particleDrawBuffers[image], 0, 1, sizeof(vk::DrawIndirectCommand));
+}
+
+void VulkanRenderer::updateParticles(uint32_t currentImage) {
+	PROFILE_FUNCTION();
+	if (particleCount == 0) return;
+
+	// SIMULATION TIME LIKE THE LIGHTS, A LONG STALL IS CUT DOWN TO ONE SHORT STEP
+	double time = frameSnapshot.tick / simulationRate;
+	float deltaTime = static_cast<float>(std::min(std::max(time - particleTime, 0.0), 0.1));
+	particleTime = time;
+
+	// ON AVERAGE A PARTICLE LIVES 3/4 OF particleLifetime, SO THIS KEEPS ABOUT 3/4 OF THEM ALIVE
+	particleEmitCarry += particleCount / particleLifetime * deltaTime;
+	uint32_t emit = std::min(static_cast<uint32_t>(particleEmitCarry), particleEmitLimit());
+	particleEmitCarry = std::min(particleEmitCarry - emit, 1.0f);
+
+	// A FOUNTAIN ON TOP OF THE MODEL, EVERYTHING SCALED BY THE MODEL'S SIZE
+	glm::vec3 center = (modelBoundsMin + modelBoundsMax) * 0.5f;
+	float size = std::max(glm::length(modelBoundsMax - modelBoundsMin), 0.1f);
+
+	ParticleParams params;
+	params.emitter = glm::vec4(center.x, modelBoundsMax.y, center.z, 0.05f * size);
+	params.gravity = glm::vec4(0.0f, -1.5f * size, 0.0f, 0.2f);
+	params.counts = glm::uvec4(emit, particleCount, static_cast<uint32_t>(frameNumber), 0);
+	params.timing = glm::vec4(deltaTime, particleLifetime, 1.2f * size, 0.003f * size);
+
+	auto data = device->mapMemory(particleParamBuffersMemory[currentImage], 0, sizeof(params));
+	memcpy(data, &params, sizeof(params));
+	device->unmapMemory(particleParamBuffersMemory[currentImage]);
+}
+
+vk::Semaphore VulkanRenderer::submitParticleSimulation(uint32_t currentImage) {
+	PROFILE_FUNCTION();
+
+	// THE LAST FRAME THAT DREW THIS IMAGE'S INSTANCES IS DONE (drawFrame WAITED FOR IT),
+	// NOTHING ELSE HAS TO FINISH FIRST
+	vk::SubmitInfo submitInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &particleCommandBuffers[2 * currentImage + particleParity];
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &particleSemaphores[currentFrame];
+
+	if (computeQueue.submit(1, &submitInfo, vk::Fence()) != vk::Result::eSuccess) {
+		throw std::runtime_error("failed to submit particle command buffer!");
+	}
+
+	particleParity = 1 - particleParity;
+	return particleSemaphores[currentFrame];
+}
@@ -0,0 +1,469 @@
+#include "VulkanRenderer.h"
+
+// COMPUTE POST PROCESSING
+// WITH --post THE SCENE IS DRAWN INTO AN HDR sceneColorImage AND FINISHED BY COMPUTE:
+//   1. BLOOM DOWN: THE BRIGHT PART OF THE SCENE IS HALVED bloomLevels TIMES
+//   2. BLOOM UP: EVERY LEVEL ADDS A TENT FILTERED COPY OF THE ONE BELOW IT
+//   3. ONE FUSED PASS: SCENE + BLOOM, EXPOSURE, TONEMAP, GRADING AND SHARPENING
+// THE PER PIXEL STAGES OF 3 NEVER GO THROUGH MEMORY, A WORKGROUP GRADES ITS TILE AND A ONE
+// TEXEL BORDER INTO SHARED MEMORY AND SHARPENS FROM THERE, SO THE FULL RESOLUTION IMAGE
+// IS READ ONCE AND WRITTEN ONCE. THE BLOOM LEVELS ARE A QUARTER OF THE PIXELS AND LESS.
+// IF THE SWAPCHAIN CAN BE A STORAGE IMAGE THE FUSED PASS WRITES IT DIRECTLY (A UNORM
+// FORMAT IS PICKED AND THE SHADER DOES THE SRGB ENCODING), OTHERWISE IT WRITES
+// postOutputImage AND THAT IS BLITTED. THE SCENE IS SAMPLED, SO THE PASS ALSO DOES THE
+// UPSCALE OF DYNAMIC RESOLUTION AND PUTS THE STEREO VIEWS SIDE BY SIDE (recordUpscale IS NOT USED)
+
+bool VulkanRenderer::choosePostOutputFormat(const SwapChainSupportDetails& support, vk::SurfaceFormatKHR& format) {
+	// THE SWAPCHAIN FORMAT IS NOT KNOWN WHEN THE SHADER IS WRITTEN
+	if (!physicalDevice.getFeatures().shaderStorageImageWriteWithoutFormat) {
+		std::cout << "post processing: the device can not write storage images without a format\n";
+		return false;
+	}
+
+	if (!(support.capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eStorage)) {
+		std::cout << "post processing: the swapchain can not be a storage image\n";
+		return false;
+	}
+
+	for (const auto& availableFormat : support.formats) {
+		bool unorm = availableFormat.format == vk::Format::eB8G8R8A8Unorm || availableFormat.format == vk::Format::eR8G8B8A8Unorm;
+		if (!unorm || availableFormat.colorSpace != vk::ColorSpaceKHR::eSrgbNonlinear) continue;
+
+		vk::FormatProperties properties = physicalDevice.getFormatProperties(availableFormat.format);
+		if (properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eStorageImage) {
+			format = availableFormat;
+			return true;
+		}
+	}
+
+	std::cout << "post processing: no swapchain format can be a storage image\n";
+	return false;
+}
+
+void VulkanRenderer::createPostPipelines() {
+	if (!postProcess) return;
+
+	// LINEAR AND CLAMPED, THE BLOOM FILTERS ARE BUILT FROM BILINEAR TAPS
+	vk::SamplerCreateInfo samplerInfo;
+	samplerInfo.magFilter = vk::Filter::eLinear;
+	samplerInfo.minFilter = vk::Filter::eLinear;
+	samplerInfo.mipmapMode = vk::SamplerMipmapMode::eNearest;
+	samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+	samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+	samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = 0.0f;
+
+	try {
+		postSampler = device->createSampler(samplerInfo);
+	}
+	catch (vk::SystemError err) {
+		throw(std::runtime_error("failed to create post processing sampler!"));
+	}
+
+	// BLOOM: LEVEL TO READ, LEVEL TO WRITE (THE UP PASS ALSO READS IT)
+	std::array<vk::DescriptorSetLayoutBinding, 2> bloomBindings;
+	bloomBindings[0].binding = 0;
+	bloomBindings[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+	bloomBindings[0].descriptorCount = 1;
+	bloomBindings[0].stageFlags = vk::ShaderStageFlagBits::eCompute;
+	bloomBindings[1].binding = 1;
+	bloomBindings[1].descriptorType = vk::DescriptorType::eStorageImage;
+	bloomBindings[1].descriptorCount = 1;
+	bloomBindings[1].stageFlags = vk::ShaderStageFlagBits::eCompute;
+
+	// FUSED PASS: SCENE, BLOOM, OUTPUT
+	std::array<vk::DescriptorSetLayoutBinding, 3> postBindings;
+	postBindings[0].binding = 0;
+	postBindings[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+	postBindings[0].descriptorCount = 1;
+	postBindings[0].stageFlags = vk::ShaderStageFlagBits::eCompute;
+	postBindings[1].binding = 1;
+	postBindings[1].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+	postBindings[1].descriptorCount = 1;
+	postBindings[1].stageFlags = vk::ShaderStageFlagBits::eCompute;
+	postBindings[2].binding = 2;
+	postBindings[2].descriptorType = vk::DescriptorType::eStorageImage;
+	postBindings[2].descriptorCount = 1;
+	postBindings[2].stageFlags = vk::ShaderStageFlagBits::eCompute;
+
+	vk::DescriptorSetLayoutCreateInfo bloomLayoutInfo;
+	bloomLayoutInfo.bindingCount = static_cast<uint32_t>(bloomBindings.size());
+	bloomLayoutInfo.pBindings = bloomBindings.data();
+
+	vk::DescriptorSetLayoutCreateInfo postLayoutInfo;
+	postLayoutInfo.bindingCount = static_cast<uint32_t>(postBindings.size());
+	postLayoutInfo.pBindings = postBindings.data();
+
+	try {
+		bloomDescriptorSetLayout = device->createDescriptorSetLayout(bloomLayoutInfo);
+		postDescriptorSetLayout = device->createDescriptorSetLayout(postLayoutInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to create post processing Descriptor Set Layout!");
+	}
+
+	// EVERY POST SHADER TAKES THE SAME PostConstants
+	vk::PushConstantRange pushConstantRange(vk::ShaderStageFlagBits::eCompute, 0, sizeof(PostConstants));
+
+	vk::PipelineLayoutCreateInfo bloomPipelineLayoutInfo;
+	bloomPipelineLayoutInfo.setLayoutCount = 1;
+	bloomPipelineLayoutInfo.pSetLayouts = &bloomDescriptorSetLayout;
+	bloomPipelineLayoutInfo.pushConstantRangeCount = 1;
+	bloomPipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	vk::PipelineLayoutCreateInfo postPipelineLayoutInfo = bloomPipelineLayoutInfo;
+	postPipelineLayoutInfo.pSetLayouts = &postDescriptorSetLayout;
+
+	try {
+		bloomPipelineLayout = device->createPipelineLayout(bloomPipelineLayoutInfo);
+		postPipelineLayout = device->createPipelineLayout(postPipelineLayoutInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to create post processing Pipeline Layout!");
+	}
+
+	auto createComputePipeline = [this](const std::string& file, vk::PipelineLayout layout) {
+		auto code = readFile(SHADER_PATH + file);
+		vk::ShaderModule module = createShaderModule(code);
+
+		vk::ComputePipelineCreateInfo pipelineInfo;
+		pipelineInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+		pipelineInfo.stage.module = module;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = layout;
+
+		vk::Result result;
+		vk::Pipeline pipeline;
+		std::tie(result, pipeline) = device->createComputePipeline(nullptr, pipelineInfo);
+
+		device->destroyShaderModule(module);
+
+		if (result != vk::Result::eSuccess) {
+			throw std::runtime_error("failed to create compute Pipeline from " + file + "!");
+		}
+		return pipeline;
+	};
+
+	bloomDownsamplePipeline = createComputePipeline("post_bloom_down.spv", bloomPipelineLayout);
+	bloomUpsamplePipeline = createComputePipeline("post_bloom_up.spv", bloomPipelineLayout);
+	// postDirectOutput IS KNOWN, createSwapChain RAN BEFORE THIS
+	postPipeline = createComputePipeline(postDirectOutput ? "post_swapchain.spv" : "post.spv", postPipelineLayout);
+}
+
+void VulkanRenderer::createPostResources() {
+	if (!postProcess) return;
+
+	// HALF THE VIEW AT LEVEL 0, STOPS EARLY IF A LEVEL WOULD BE A SINGLE TEXEL
+	bloomExtents.clear();
+	vk::Extent2D extent = viewExtent;
+	for (uint32_t level = 0; level < bloomLevels; level++) {
+		if (extent.width == 1 && extent.height == 1) break;
+		extent.width = std::max(extent.width / 2, 1u);
+		extent.height = std::max(extent.height / 2, 1u);
+		bloomExtents.push_back(extent);
+	}
+	uint32_t levelCount = static_cast<uint32_t>(bloomExtents.size());
+
+	// WRITTEN FROM SCRATCH EVERY FRAME, THE LAYOUT IS SET WHILE RECORDING
+	createImage(bloomExtents[0].width, bloomExtents[0].height, vk::Format::eR16G16B16A16Sfloat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal, bloomImage, bloomImageMemory, levelCount, viewCount());
+	bloomLevelViews.resize(levelCount);
+	for (uint32_t level = 0; level < levelCount; level++) {
+		bloomLevelViews[level] = createImageView(bloomImage, vk::Format::eR16G16B16A16Sfloat, vk::ImageAspectFlagBits::eColor, level, 1, vk::ImageViewType::e2DArray, 0, viewCount());
+	}
+
+	if (!postDirectOutput) {
+		createImage(swapChainExtent.width, swapChainExtent.height, vk::Format::eR16G16B16A16Sfloat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eDeviceLocal, postOutputImage, postOutputImageMemory);
+		postOutputImageView = createImageView(postOutputImage, vk::Format::eR16G16B16A16Sfloat, vk::ImageAspectFlagBits::eColor);
+	}
+
+	uint32_t bloomSetCount = 2 * levelCount - 1;
+	uint32_t postSetCount = static_cast<uint32_t>(swapChainImages.size());
+
+	std::array<vk::DescriptorPoolSize, 2> poolSizes;
+	poolSizes[0].type = vk::DescriptorType::eCombinedImageSampler;
+	poolSizes[0].descriptorCount = bloomSetCount + 2 * postSetCount;
+	poolSizes[1].type = vk::DescriptorType::eStorageImage;
+	poolSizes[1].descriptorCount = bloomSetCount + postSetCount;
+
+	vk::DescriptorPoolCreateInfo poolInfo;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = bloomSetCount + postSetCount;
+
+	try {
+		postDescriptorPool = device->createDescriptorPool(poolInfo);
+	}
+	catch (vk::SystemError err) {
+		throw(std::runtime_error("failed to create post processing descriptor pool!"));
+	}
+
+	auto allocateSets = [this](vk::DescriptorSetLayout layout, uint32_t count) {
+		std::vector<vk::DescriptorSetLayout> layouts(count, layout);
+		vk::DescriptorSetAllocateInfo allocInfo;
+		allocInfo.descriptorPool = postDescriptorPool;
+		allocInfo.descriptorSetCount = count;
+		allocInfo.pSetLayouts = layouts.data();
+
+		try {
+			return device->allocateDescriptorSets(allocInfo);
+		}
+		catch (vk::SystemError err) {
+			throw(std::runtime_error("failed to allocate post processing descriptor sets!"));
+		}
+	};
+
+	bloomDownsampleSets = allocateSets(bloomDescriptorSetLayout, levelCount);
+	bloomUpsampleSets = levelCount > 1 ? allocateSets(bloomDescriptorSetLayout, levelCount - 1) : std::vector<vk::DescriptorSet>();
+	postDescriptorSets = allocateSets(postDescriptorSetLayout, postSetCount);
+
+	auto writeBloomSet = [this](vk::DescriptorSet set, vk::ImageView source, vk::ImageLayout sourceLayout, vk::ImageView destination) {
+		vk::DescriptorImageInfo sourceInfo(postSampler, source, sourceLayout);
+		vk::DescriptorImageInfo destinationInfo(nullptr, destination, vk::ImageLayout::eGeneral);
+
+		std::array<vk::WriteDescriptorSet, 2> descriptorWrites;
+		descriptorWrites[0].dstSet = set;
+		descriptorWrites[0].dstBinding = 0;
+		descriptorWrites[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+		descriptorWrites[0].descriptorCount = 1;
+		descriptorWrites[0].pImageInfo = &sourceInfo;
+		descriptorWrites[1].dstSet = set;
+		descriptorWrites[1].dstBinding = 1;
+		descriptorWrites[1].descriptorType = vk::DescriptorType::eStorageImage;
+		descriptorWrites[1].descriptorCount = 1;
+		descriptorWrites[1].pImageInfo = &destinationInfo;
+
+		device->updateDescriptorSets(static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	};
+
+	// DOWN: LEVEL 0 READS THE SCENE, EVERY OTHER LEVEL THE ONE ABOVE IT
+	for (uint32_t level = 0; level < levelCount; level++) {
+		if (level == 0) {
+			writeBloomSet(bloomDownsampleSets[level], sceneColorImageView, vk::ImageLayout::eShaderReadOnlyOptimal, bloomLevelViews[level]);
+		}
+		else {
+			writeBloomSet(bloomDownsampleSets[level], bloomLevelViews[level - 1], vk::ImageLayout::eGeneral, bloomLevelViews[level]);
+		}
+	}
+	// UP: EVERY LEVEL BUT THE LAST READS THE ONE BELOW IT
+	for (uint32_t level = 0; level + 1 < levelCount; level++) {
+		writeBloomSet(bloomUpsampleSets[level], bloomLevelViews[level + 1], vk::ImageLayout::eGeneral, bloomLevelViews[level]);
+	}
+
+	for (size_t i = 0; i < swapChainImages.size(); i++) {
+		vk::DescriptorImageInfo sceneInfo(postSampler, sceneColorImageView, vk::ImageLayout::eShaderReadOnlyOptimal);
+		vk::DescriptorImageInfo bloomInfo(postSampler, bloomLevelViews[0], vk::ImageLayout::eGeneral);
+		vk::DescriptorImageInfo outputInfo(nullptr, postDirectOutput ? swapChainImageViews[i] : postOutputImageView, vk::ImageLayout::eGeneral);
+
+		std::array<vk::WriteDescriptorSet, 3> descriptorWrites;
+		descriptorWrites[0].dstSet = postDescriptorSets[i];
+		descriptorWrites[0].dstBinding = 0;
+		descriptorWrites[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+		descriptorWrites[0].descriptorCount = 1;
+		descriptorWrites[0].pImageInfo = &sceneInfo;
+		descriptorWrites[1].dstSet = postDescriptorSets[i];
+		descriptorWrites[1].dstBinding = 1;
+		descriptorWrites[1].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+		descriptorWrites[1].descriptorCount = 1;
+		descriptorWrites[1].pImageInfo = &bloomInfo;
+		descriptorWrites[2].dstSet = postDescriptorSets[i];
+		descriptorWrites[2].dstBinding = 2;
+		descriptorWrites[2].descriptorType = vk::DescriptorType::eStorageImage;
+		descriptorWrites[2].descriptorCount = 1;
+		descriptorWrites[2].pImageInfo = &outputInfo;
+
+		device->updateDescriptorSets(static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+}
+
+void VulkanRenderer::destroyPostResources() {
+	if (!postProcess) return;
+
+	device->destroyDescriptorPool(postDescriptorPool);
+	bloomDownsampleSets.clear();
+	bloomUpsampleSets.clear();
+	postDescriptorSets.clear();
+
+	for (auto view : bloomLevelViews) {
+		device->destroyImageView(view);
+	}
+	bloomLevelViews.clear();
+	device->destroyImage(bloomImage);
+	freeMemory(bloomImageMemory);
+
+	if (!postDirectOutput) {
+		device->destroyImageView(postOutputImageView);
+		device->destroyImage(postOutputImage);
+		freeMemory(postOutputImageMemory);
+	}
+}
+
+void VulkanRenderer::destroyPostPipelines() {
+	if (!postProcess) return;
+
+	device->destroyPipeline(postPipeline);
+	device->destroyPipeline(bloomUpsamplePipeline);
+	device->destroyPipeline(bloomDownsamplePipeline);
+	device->destroyPipelineLayout(postPipelineLayout);
+	device->destroyPipelineLayout(bloomPipelineLayout);
+	device->destroyDescriptorSetLayout(postDescriptorSetLayout);
+	device->destroyDescriptorSetLayout(bloomDescriptorSetLayout);
+	device->destroySampler(postSampler);
+}
+
+void VulkanRenderer::recordPostProcess(vk::CommandBuffer commandBuffer, size_t image) {
+	uint32_t levelCount = static_cast<uint32_t>(bloomExtents.size());
+
+	PostConstants constants = postSettings;
+	constants.sceneScale = glm::vec2(static_cast<float>(renderExtent.width) / viewExtent.width, static_cast<float>(renderExtent.height) / viewExtent.height);
+	constants.views = viewCount();
+	constants.encodeSrgb = postDirectOutput ? 1 : 0;
+
+	// THE RENDER PASS LEFT THE SCENE READY TO SAMPLE, WAIT FOR ITS WRITES
+	// THE BLOOM CHAIN IS REWRITTEN, ONLY LAST FRAME'S READS OF IT HAVE TO BE DONE
+	std::array<vk::ImageMemoryBarrier, 2> barriers;
+	barriers[0].oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	barriers[0].newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].image = sceneColorImage;
+	barriers[0].subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, viewCount());
+	barriers[0].srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+	barriers[0].dstAccessMask = vk::AccessFlagBits::eShaderRead;
+	barriers[1].oldLayout = vk::ImageLayout::eUndefined;
+	barriers[1].newLayout = vk::ImageLayout::eGeneral;
+	barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[1].image = bloomImage;
+	barriers[1].subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, levelCount, 0, viewCount());
+	barriers[1].srcAccessMask = {};
+	barriers[1].dstAccessMask = vk::AccessFlagBits::eShaderWrite;
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+		{},
+		0, nullptr,
+		0, nullptr,
+		static_cast<uint32_t>(barriers.size()), barriers.data());
+
+	// EVERY LEVEL IS READ BY THE NEXT DISPATCH
+	auto levelBarrier = [&](uint32_t level) {
+		vk::ImageMemoryBarrier barrier;
+		barrier.oldLayout = vk::ImageLayout::eGeneral;
+		barrier.newLayout = vk::ImageLayout::eGeneral;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = bloomImage;
+		barrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, level, 1, 0, viewCount());
+		barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+		barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+			{},
+			0, nullptr,
+			0, nullptr,
+			1, &barrier);
+	};
+
+	auto dispatchLevel = [&](vk::DescriptorSet set, uint32_t level, vk::Extent2D sourceExtent) {
+		constants.level = level;
+		constants.texelSize = glm::vec2(1.0f / sourceExtent.width, 1.0f / sourceExtent.height);
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, bloomPipelineLayout, 0, 1, &set, 0, nullptr);
+		commandBuffer.pushConstants(bloomPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(PostConstants), &constants);
+		commandBuffer.dispatch((bloomExtents[level].width + 7) / 8, (bloomExtents[level].height + 7) / 8, viewCount());
+		levelBarrier(level);
+	};
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, bloomDownsamplePipeline);
+	for (uint32_t level = 0; level < levelCount; level++) {
+		dispatchLevel(bloomDownsampleSets[level], level, level == 0 ? viewExtent : bloomExtents[level - 1]);
+	}
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, bloomUpsamplePipeline);
+	for (uint32_t level = levelCount - 1; level-- > 0;) {
+		dispatchLevel(bloomUpsampleSets[level], level, bloomExtents[level + 1]);
+	}
+
+	// THE OUTPUT IS OVERWRITTEN COMPLETELY, ITS OLD CONTENT DOES NOT MATTER
+	// THE ACQUIRE SEMAPHORE IS WAITED ON AT THE COMPUTE STAGE (SEE drawFrame)
+	vk::Image output = postDirectOutput ? swapChainImages[image] : postOutputImage;
+	vk::ImageMemoryBarrier outputBarrier;
+	outputBarrier.oldLayout = vk::ImageLayout::eUndefined;
+	outputBarrier.newLayout = vk::ImageLayout::eGeneral;
+	outputBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	outputBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	outputBarrier.image = output;
+	outputBarrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+	outputBarrier.srcAccessMask = {};
+	outputBarrier.dstAccessMask = vk::AccessFlagBits::eShaderWrite;
+
+	// postOutputImage MAY STILL BE BLITTED FROM BY THE LAST FRAME
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+		{},
+		0, nullptr,
+		0, nullptr,
+		1, &outputBarrier);
+
+	// ONE WORKGROUP PER TILE OF THE WINDOW
+	constants.level = 0;
+	constants.texelSize = glm::vec2(1.0f / viewExtent.width, 1.0f / viewExtent.height);
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, postPipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, postPipelineLayout, 0, 1, &postDescriptorSets[image], 0, nullptr);
+	commandBuffer.pushConstants(postPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(PostConstants), &constants);
+	commandBuffer.dispatch((swapChainExtent.width + POST_TILE_SIZE - 1) / POST_TILE_SIZE, (swapChainExtent.height + POST_TILE_SIZE - 1) / POST_TILE_SIZE, 1);
+
+	if (postDirectOutput) {
+		outputBarrier.oldLayout = vk::ImageLayout::eGeneral;
+		outputBarrier.newLayout = vk::ImageLayout::ePresentSrcKHR;
+		outputBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+		outputBarrier.dstAccessMask = {};
+
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eBottomOfPipe,
+			{},
+			0, nullptr,
+			0, nullptr,
+			1, &outputBarrier);
+		return;
+	}
+
+	// SAME SIZE, THE BLIT IS ONLY THERE FOR THE FORMAT CONVERSION (AND THE SRGB ENCODING)
+	std::array<vk::ImageMemoryBarrier, 2> blitBarriers;
+	blitBarriers[0] = outputBarrier;
+	blitBarriers[0].oldLayout = vk::ImageLayout::eGeneral;
+	blitBarriers[0].newLayout = vk::ImageLayout::eTransferSrcOptimal;
+	blitBarriers[0].srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+	blitBarriers[0].dstAccessMask = vk::AccessFlagBits::eTransferRead;
+	blitBarriers[1] = outputBarrier;
+	blitBarriers[1].image = swapChainImages[image];
+	blitBarriers[1].oldLayout = vk::ImageLayout::eUndefined;
+	blitBarriers[1].newLayout = vk::ImageLayout::eTransferDstOptimal;
+	blitBarriers[1].srcAccessMask = {};
+	blitBarriers[1].dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer,
+		{},
+		0, nullptr,
+		0, nullptr,
+		static_cast<uint32_t>(blitBarriers.size()), blitBarriers.data());
+
+	vk::ImageBlit region;
+	region.srcSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+	region.srcOffsets[0] = vk::Offset3D(0, 0, 0);
+	region.srcOffsets[1] = vk::Offset3D(static_cast<int32_t>(swapChainExtent.width), static_cast<int32_t>(swapChainExtent.height), 1);
+	region.dstSubresource = region.srcSubresource;
+	region.dstOffsets[0] = region.srcOffsets[0];
+	region.dstOffsets[1] = region.srcOffsets[1];
+
+	commandBuffer.blitImage(postOutputImage, vk::ImageLayout::eTransferSrcOptimal, swapChainImages[image], vk::ImageLayout::eTransferDstOptimal, 1, &region, vk::Filter::eNearest);
+
+	vk::ImageMemoryBarrier presentBarrier = blitBarriers[1];
+	presentBarrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+	presentBarrier.newLayout = vk::ImageLayout::ePresentSrcKHR;
+	presentBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	presentBarrier.dstAccessMask = {};
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+		{},
+		0, nullptr,
+		0, nullptr,
+		1, &presentBarrier);
+}
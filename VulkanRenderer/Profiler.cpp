@@ -0,0 +1,196 @@
+#include "Profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace profiler {
+
+namespace {
+
+std::mutex internMutex;
+std::deque<std::string> internedNames;
+
+}
+
+const char* intern(const std::string& name) {
+	std::lock_guard<std::mutex> lock(internMutex);
+	// A DEQUE NEVER MOVES WHAT IS ALREADY IN IT
+	internedNames.push_back(name);
+	return internedNames.back().c_str();
+}
+
+#if PROFILER_ENABLED
+
+namespace {
+
+struct Event {
+	const char* name;
+	uint64_t begin;
+	uint64_t end;
+};
+
+// ONLY THE OWNING THREAD WRITES, IT PUBLISHES count WITH RELEASE SO A
+// READER THAT LOADS count WITH ACQUIRE SEES EVERY EVENT BELOW IT
+// BLOCKS ARE NEVER MOVED OR FREED, SO A READER CAN WALK THEM WHILE THE OWNER APPENDS
+struct ThreadBuffer {
+	static constexpr size_t BLOCK_EVENTS = 4096;
+	// 4M EVENTS PER THREAD, AFTER THAT WE COUNT WHAT WE DROP
+	static constexpr size_t MAX_BLOCKS = 1024;
+
+	std::atomic<Event*> blocks[MAX_BLOCKS] = {};
+	std::atomic<size_t> count{ 0 };
+	std::atomic<size_t> dropped{ 0 };
+	std::atomic<const char*> name{ nullptr };
+	uint32_t id = 0;
+
+	~ThreadBuffer() {
+		for (auto& block : blocks) {
+			delete[] block.load();
+		}
+	}
+};
+
+// TICKS AND WALL CLOCK AT STARTUP, WITH A SECOND PAIR AT WRITE TIME THEY GIVE THE TICK RATE
+struct TimeBase {
+	uint64_t ticks;
+	std::chrono::steady_clock::time_point time;
+};
+
+const TimeBase startBase = { now(), std::chrono::steady_clock::now() };
+
+std::mutex registryMutex;
+// OWNED HERE SO A THREAD THAT ALREADY EXITED STILL SHOWS UP IN THE TRACE
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+
+thread_local ThreadBuffer* localBuffer = nullptr;
+
+ThreadBuffer* threadBuffer() {
+	if (!localBuffer) {
+		// ONCE PER THREAD
+		std::lock_guard<std::mutex> lock(registryMutex);
+		registry.push_back(std::make_unique<ThreadBuffer>());
+		localBuffer = registry.back().get();
+		localBuffer->id = static_cast<uint32_t>(registry.size());
+	}
+	return localBuffer;
+}
+
+void writeEscaped(std::ostream& out, const char* text) {
+	for (const char* c = text; *c; c++) {
+		if (*c == '"' || *c == '\\') out << '\\';
+		out << *c;
+	}
+}
+
+}
+
+void record(const char* name, uint64_t begin, uint64_t end) {
+	ThreadBuffer* buffer = threadBuffer();
+
+	size_t index = buffer->count.load(std::memory_order_relaxed);
+	size_t block = index / ThreadBuffer::BLOCK_EVENTS;
+	if (block >= ThreadBuffer::MAX_BLOCKS) {
+		buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Event* events = buffer->blocks[block].load(std::memory_order_relaxed);
+	if (!events) {
+		events = new Event[ThreadBuffer::BLOCK_EVENTS];
+		buffer->blocks[block].store(events, std::memory_order_release);
+	}
+
+	events[index % ThreadBuffer::BLOCK_EVENTS] = { name, begin, end };
+	buffer->count.store(index + 1, std::memory_order_release);
+}
+
+void setThreadName(const char* name) {
+	threadBuffer()->name.store(name, std::memory_order_release);
+}
+
+bool writeChromeTrace(const std::string& path) {
+	std::ofstream out(path);
+	if (!out) {
+		std::cout << "profiler: could not write " << path << "\n";
+		return false;
+	}
+
+	TimeBase endBase = { now(), std::chrono::steady_clock::now() };
+	double elapsedNanoseconds = std::chrono::duration<double, std::nano>(endBase.time - startBase.time).count();
+	double elapsedTicks = static_cast<double>(endBase.ticks - startBase.ticks);
+	double nanosecondsPerTick = elapsedTicks > 0.0 ? elapsedNanoseconds / elapsedTicks : 1.0;
+
+	// CHROME WANTS MICROSECONDS, THE FRACTION KEEPS THE NANOSECONDS
+	auto microseconds = [&](uint64_t ticks) {
+		return static_cast<double>(static_cast<int64_t>(ticks - startBase.ticks)) * nanosecondsPerTick / 1000.0;
+	};
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+	size_t events = 0;
+	size_t dropped = 0;
+	bool first = true;
+	auto separator = [&]() {
+		if (!first) out << ",\n";
+		first = false;
+	};
+
+	for (const auto& buffer : registry) {
+		const char* name = buffer->name.load(std::memory_order_acquire);
+		separator();
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"name\":\"";
+		if (name) {
+			writeEscaped(out, name);
+		}
+		else {
+			out << "thread " << buffer->id;
+		}
+		out << "\"}}";
+
+		size_t count = buffer->count.load(std::memory_order_acquire);
+		for (size_t i = 0; i < count; i++) {
+			const Event& event = buffer->blocks[i / ThreadBuffer::BLOCK_EVENTS].load(std::memory_order_acquire)[i % ThreadBuffer::BLOCK_EVENTS];
+			separator();
+			out << "{\"name\":\"";
+			writeEscaped(out, event.name);
+			out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+				<< ",\"ts\":" << microseconds(event.begin)
+				<< ",\"dur\":" << static_cast<double>(event.end - event.begin) * nanosecondsPerTick / 1000.0 << "}";
+		}
+		events += count;
+		dropped += buffer->dropped.load(std::memory_order_relaxed);
+	}
+
+	out << "\n]}\n";
+
+	std::cout << "profiler: " << events << " zones from " << registry.size() << " threads written to " << path;
+	if (dropped > 0) {
+		std::cout << " (" << dropped << " dropped, buffers full)";
+	}
+	std::cout << "\n";
+	return true;
+}
+
+#else
+
+void setThreadName(const char*) {
+}
+
+bool writeChromeTrace(const std::string& path) {
+	std::cout << "profiler: compiled out, build with ENABLE_PROFILER to write " << path << "\n";
+	return false;
+}
+
+#endif
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+// SCOPED CPU PROFILER
+// PROFILE_ZONE("name") TIMES THE REST OF THE SCOPE, PROFILE_FUNCTION() USES THE
+// FUNCTION NAME. EVERY THREAD WRITES ITS OWN EVENT BUFFER WITHOUT LOCKS, THE
+// BUFFERS ARE ONLY READ WHEN THE TRACE IS WRITTEN (CHROME / PERFETTO JSON,
+// OPEN IT IN chrome://tracing OR ui.perfetto.dev)
+// ON IN DEBUG BUILDS, IN RELEASE ONLY WITH ENABLE_PROFILER DEFINED, OTHERWISE
+// THE MACROS EXPAND TO NOTHING
+
+#include <cstdint>
+#include <string>
+
+#if defined(ENABLE_PROFILER) || !defined(NDEBUG)
+	#define PROFILER_ENABLED 1
+#else
+	#define PROFILER_ENABLED 0
+#endif
+
+#if PROFILER_ENABLED
+	#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+		#define PROFILER_RDTSC 1
+		#if defined(_MSC_VER)
+			#include <intrin.h>
+		#else
+			#include <x86intrin.h>
+		#endif
+	#else
+		#include <chrono>
+	#endif
+#endif
+
+namespace profiler {
+
+// ZONE NAMES ARE KEPT AS POINTERS, ANYTHING THAT IS NOT A STRING LITERAL
+// HAS TO BE COPIED SOMEWHERE THAT LIVES UNTIL THE TRACE IS WRITTEN
+const char* intern(const std::string& name);
+
+// SHOWN AS THE TRACK NAME IN THE TRACE, name MUST STAY ALIVE (LITERAL OR intern)
+void setThreadName(const char* name);
+
+// EVERYTHING RECORDED SO FAR, FROM ALL THREADS. RETURNS FALSE IF NOTHING WAS WRITTEN
+bool writeChromeTrace(const std::string& path);
+
+#if PROFILER_ENABLED
+
+// RAW TICKS, CONVERTED TO NANOSECONDS WHEN THE TRACE IS WRITTEN
+inline uint64_t now() {
+#if defined(PROFILER_RDTSC)
+	return __rdtsc();
+#else
+	return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+void record(const char* name, uint64_t begin, uint64_t end);
+
+class Zone {
+public:
+	explicit Zone(const char* name) : name(name), begin(now()) {}
+	~Zone() { record(name, begin, now()); }
+
+	Zone(const Zone&) = delete;
+	Zone& operator=(const Zone&) = delete;
+
+private:
+	const char* name;
+	uint64_t begin;
+};
+
+#endif
+
+}
+
+#if PROFILER_ENABLED
+	#define PROFILE_CONCAT_INNER(a, b) a##b
+	#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+	#define PROFILE_ZONE(name) ::profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+	#define PROFILE_FUNCTION() PROFILE_ZONE(__FUNCTION__)
+#else
+	#define PROFILE_ZONE(name) ((void)0)
+	#define PROFILE_FUNCTION() ((void)0)
+#endif
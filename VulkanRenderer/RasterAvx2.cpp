@@ -0,0 +1,21 @@
+#include "RasterKernels.h"
+
+// BUILT WITH /arch:AVX2 LIKE CullingAvx2.cpp, NOTHING IN HERE RUNS BEFORE
+// bestRasterKernels() HAS CHECKED THE CPU
+#include "Simd.h"
+
+#if defined(SIMD_AVX2)
+
+#include "RasterKernels.inl"
+
+const RasterKernels* avx2RasterKernels() {
+	return &rasterKernels;
+}
+
+#else
+
+const RasterKernels* avx2RasterKernels() {
+	return nullptr;
+}
+
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// THE EDGE AND DEPTH TESTS OF SoftwareRasterizer, BUILT ONCE PER INSTRUCTION SET FROM
+// RasterKernels.inl LIKE CullingKernels. THE PIXELS THAT PASS ARE SHADED BY THE CALLER,
+// SO THE SAME RULES HOLD: NO GLM OR STANDARD LIBRARY CALLS IN HERE
+
+// ONE TRIANGLE OVER ONE 8x8 BLOCK, EVERYTHING AS SoftwareRasterizer::Triangle HOLDS IT
+struct RasterBlock {
+	// PIXEL CENTER OF THE TOP LEFT PIXEL
+	float left;
+	float top;
+	float x[3];
+	float y[3];
+	float edgeA[3];
+	float edgeB[3];
+	float edgeBias[3];
+	// z = z0 + dz1 * E2 + dz2 * E0
+	float z0;
+	float dz1;
+	float dz2;
+	// EVERY PIXEL IS INSIDE, ONLY THE DEPTH IS TESTED
+	bool covered;
+	// THE TOP LEFT PIXEL OF THE BLOCK, ROWS ARE stride FLOATS APART
+	const float* depth;
+	size_t stride;
+};
+
+// BIT x OF rows[y] IS SET WHEN PIXEL (x, y) OF THE BLOCK PASSED, ITS EDGE FUNCTIONS 0 AND 2
+// AND ITS DEPTH ARE AT [y * 8 + x]. THE ARRAYS ARE ONLY WRITTEN FOR THE PIXELS THAT PASSED
+struct RasterBlockResult {
+	uint8_t rows[8];
+	float e0[64];
+	float e2[64];
+	float z[64];
+};
+
+struct RasterKernels {
+	const char* name;
+	// FALSE IF NO PIXEL PASSED
+	bool (*testBlock)(const RasterBlock& block, RasterBlockResult& result);
+};
+
+// WHAT THE BUILD FLAGS GIVE (SSE ON x64)
+const RasterKernels& defaultRasterKernels();
+// NULL WHEN THE COMPILER COULD NOT BUILD THEM
+const RasterKernels* avx2RasterKernels();
+// PLAIN C++ (SIMD_FORCE_SCALAR), THE REFERENCE THE OTHERS ARE CHECKED AGAINST
+const RasterKernels& scalarRasterKernels();
+
+// AVX2 (ONE BLOCK ROW PER INSTRUCTION) WHEN THE CPU AND THE OS SUPPORT IT, OTHERWISE THE DEFAULT ONES
+const RasterKernels& bestRasterKernels();
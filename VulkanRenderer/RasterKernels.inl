@@ -0,0 +1,64 @@
+// INCLUDED BY EVERY FILE THAT BUILDS A RasterKernels TABLE, AFTER RasterKernels.h AND Simd.h
+// THE TABLE IS CALLED rasterKernels, EVERYTHING HERE IS LOCAL TO THE INCLUDING FILE
+
+namespace {
+
+bool testBlockKernel(const RasterBlock& block, RasterBlockResult& result) {
+	using namespace simd;
+
+	static const float laneOffsets[8] = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
+	const Float lanes = load(laneOffsets);
+
+	Float a[3], bias[3];
+	for (int i = 0; i < 3; i++) {
+		a[i] = set(block.edgeA[i]);
+		bias[i] = set(block.edgeBias[i]);
+	}
+	Float z0 = set(block.z0);
+	Float dz1 = set(block.dz1);
+	Float dz2 = set(block.dz2);
+
+	uint32_t passed = 0;
+	for (uint32_t row = 0; row < 8; row++) {
+		float centerY = block.top + static_cast<float>(row);
+		const float* depthRow = block.depth + row * block.stride;
+		uint32_t rowBits = 0;
+
+		for (uint32_t column = 0; column < 8; column += WIDTH) {
+			float centerX = block.left + static_cast<float>(column);
+
+			// E = a * (x - xi) + b * (y - yi), THE b TERM IS THE SAME FOR THE WHOLE ROW
+			Float e[3];
+			for (int i = 0; i < 3; i++) {
+				Float dx = add(set(centerX - block.x[i]), lanes);
+				e[i] = mulAdd(a[i], dx, set(block.edgeB[i] * (centerY - block.y[i])));
+			}
+
+			Mask inside = maskAll();
+			if (!block.covered) {
+				inside = maskAnd(greaterEqual(e[0], bias[0]), maskAnd(greaterEqual(e[1], bias[1]), greaterEqual(e[2], bias[2])));
+			}
+
+			// DEPTH TEST, LESS LIKE THE PIPELINE
+			Float z = mulAdd(dz1, e[2], mulAdd(dz2, e[0], z0));
+			inside = maskAnd(inside, less(z, load(depthRow + column)));
+
+			uint32_t bits = maskBits(inside);
+			if (!bits) continue;
+
+			uint32_t pixel = row * 8 + column;
+			store(result.e0 + pixel, e[0]);
+			store(result.e2 + pixel, e[2]);
+			store(result.z + pixel, z);
+			rowBits |= bits << column;
+		}
+
+		result.rows[row] = static_cast<uint8_t>(rowBits);
+		passed |= rowBits;
+	}
+	return passed != 0;
+}
+
+const RasterKernels rasterKernels = { simd::NAME, &testBlockKernel };
+
+}
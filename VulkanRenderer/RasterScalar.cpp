@@ -0,0 +1,13 @@
+#include "RasterKernels.h"
+
+// THE SAME KERNEL ONE PIXEL AT A TIME, KEPT IN THE BINARY SO THE VECTOR ONES CAN BE CHECKED
+#if !defined(SIMD_FORCE_SCALAR)
+	#define SIMD_FORCE_SCALAR
+#endif
+#include "Simd.h"
+
+#include "RasterKernels.inl"
+
+const RasterKernels& scalarRasterKernels() {
+	return rasterKernels;
+}
@@ -0,0 +1,231 @@
+#include "ResourceCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed) {
+	// FNV-1a OVER 8 BYTE WORDS WITH A FINAL MIX, ASSETS ARE BIG SO A BYTE AT A TIME IS TOO SLOW
+	const uint64_t prime = 0x100000001b3ull;
+	uint64_t hash = (seed ^ 0xcbf29ce484222325ull) * prime;
+	hash ^= size;
+
+	auto bytes = static_cast<const unsigned char*>(data);
+	size_t words = size / sizeof(uint64_t);
+	for (size_t i = 0; i < words; i++) {
+		uint64_t word;
+		memcpy(&word, bytes + i * sizeof(uint64_t), sizeof(word));
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 29;
+	}
+	for (size_t i = words * sizeof(uint64_t); i < size; i++) {
+		hash = (hash ^ bytes[i]) * prime;
+	}
+
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+ResourceHandle::ResourceHandle(const ResourceHandle& other) : cache(other.cache), entry(other.entry) {
+	if (entry) {
+		cache->addReference(entry);
+	}
+}
+
+ResourceHandle::ResourceHandle(ResourceHandle&& other) noexcept : cache(other.cache), entry(other.entry) {
+	other.cache = nullptr;
+	other.entry = nullptr;
+}
+
+ResourceHandle& ResourceHandle::operator=(ResourceHandle other) noexcept {
+	std::swap(cache, other.cache);
+	std::swap(entry, other.entry);
+	return *this;
+}
+
+ResourceHandle::~ResourceHandle() {
+	reset();
+}
+
+void ResourceHandle::reset() {
+	if (entry) {
+		cache->release(entry);
+	}
+	cache = nullptr;
+	entry = nullptr;
+}
+
+const GpuResource& ResourceHandle::operator*() const {
+	return entry->resource;
+}
+
+void ResourceCache::init(Destroy destroy, vk::DeviceSize budget) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->destroy = std::move(destroy);
+	byteBudget = budget;
+}
+
+ResourceHandle ResourceCache::acquire(const std::string& path, uint64_t hash, const Create& create) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// THE PATH NAMED SOMETHING ELSE BEFORE, THAT VERSION IS THE FIRST TO GO
+	auto named = paths.find(path);
+	if (named != paths.end() && named->second != hash) {
+		auto old = entries.find(named->second);
+		if (old != entries.end() && old->second->references == 0) {
+			unused.splice(unused.begin(), unused, old->second->lru);
+		}
+	}
+	paths[path] = hash;
+
+	Entry* entry;
+	auto found = entries.find(hash);
+	bool cached = found != entries.end();
+	if (cached) {
+		entry = found->second.get();
+		counters.hits++;
+		if (entry->path != path) {
+			counters.shared++;
+		}
+	}
+	else {
+		auto created = std::make_unique<Entry>();
+		created->hash = hash;
+		created->path = path;
+		created->resource = create();
+		entry = created.get();
+		entries.emplace(hash, std::move(created));
+		counters.misses++;
+
+		bytes += entry->resource.bytes;
+		counters.peakBytes = std::max(counters.peakBytes, bytes);
+	}
+
+	if (entry->references++ == 0 && cached) {
+		unused.erase(entry->lru);
+	}
+
+	// A NEW RESOURCE MAY HAVE PUSHED US OVER, ONLY UNREFERENCED ONES CAN GO
+	evict();
+	return ResourceHandle(this, entry);
+}
+
+void ResourceCache::addReference(Entry* entry) {
+	std::lock_guard<std::mutex> lock(mutex);
+	entry->references++;
+}
+
+void ResourceCache::release(Entry* entry) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (--entry->references == 0) {
+		entry->lru = unused.insert(unused.end(), entry);
+		evict();
+	}
+}
+
+void ResourceCache::evict() {
+	while (bytes > byteBudget && !unused.empty()) {
+		Entry* entry = unused.front();
+		unused.pop_front();
+		retire(entry);
+		counters.evictions++;
+	}
+}
+
+void ResourceCache::retire(Entry* entry) {
+	// A FRAME ALREADY SUBMITTED, OR THE ONE BEING RECORDED, MAY STILL READ IT
+	retired.push_back({ entry->resource, frame });
+	counters.retiredBytes += entry->resource.bytes;
+	bytes -= entry->resource.bytes;
+
+	for (auto path = paths.begin(); path != paths.end();) {
+		if (path->second == entry->hash) {
+			path = paths.erase(path);
+		}
+		else {
+			++path;
+		}
+	}
+	entries.erase(entry->hash);
+}
+
+void ResourceCache::beginFrame(uint64_t frame, uint64_t completedFrame) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->frame = frame;
+
+	size_t kept = 0;
+	for (size_t i = 0; i < retired.size(); i++) {
+		if (retired[i].frame <= completedFrame) {
+			counters.retiredBytes -= retired[i].resource.bytes;
+			destroy(retired[i].resource);
+		}
+		else {
+			retired[kept++] = retired[i];
+		}
+	}
+	retired.resize(kept);
+}
+
+bool ResourceCache::relocate(uint64_t hash, const PoolAllocation& from, const Relocate& move) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto found = entries.find(hash);
+	if (found == entries.end()) {
+		return false;
+	}
+	GpuResource& resource = found->second->resource;
+	if (resource.allocation.memory != from.memory || resource.allocation.offset != from.offset) {
+		return false;
+	}
+
+	// THE FRAMES ALREADY SUBMITTED STILL READ THE OLD ONE
+	GpuResource moved = move(resource);
+	retired.push_back({ resource, frame });
+	counters.retiredBytes += resource.bytes;
+	counters.relocations++;
+	resource = moved;
+	return true;
+}
+
+void ResourceCache::clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (const auto& old : retired) {
+		destroy(old.resource);
+	}
+	retired.clear();
+	counters.retiredBytes = 0;
+
+	for (const auto& entry : entries) {
+		if (entry.second->references != 0) {
+			std::cerr << "resource cache: " << entry.second->path << " still has " << entry.second->references << " references\n";
+		}
+		destroy(entry.second->resource);
+	}
+	entries.clear();
+	paths.clear();
+	unused.clear();
+	bytes = 0;
+}
+
+ResourceCacheStats ResourceCache::stats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	ResourceCacheStats result = counters;
+	result.resources = entries.size();
+	result.unreferenced = unused.size();
+	result.bytes = bytes;
+	result.retired = retired.size();
+	return result;
+}
+
+void ResourceCache::report(std::ostream& out) const {
+	ResourceCacheStats result = stats();
+	const double mb = 1024.0 * 1024.0;
+
+	out << "resource cache: " << result.resources << " resources (" << result.unreferenced << " unreferenced), "
+		<< result.bytes / mb << " MB of " << byteBudget / mb << " MB budget, peak " << result.peakBytes / mb << " MB\n";
+	out << "  " << result.hits << " hits (" << result.shared << " shared across paths), " << result.misses << " uploads, "
+		<< result.evictions << " evictions, " << result.relocations << " relocations, " << result.retired << " waiting for the GPU\n";
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DeviceMemoryPool.h"
+
+// 64 BIT CONTENT HASH FOR THE CACHE KEYS, PASS THE PREVIOUS RESULT AS seed TO CHAIN PIECES
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+// ONE DEVICE RESOURCE, WHAT IT DOES NOT USE STAYS NULL
+struct GpuResource {
+	vk::Buffer buffer;
+	vk::Image image;
+	vk::ImageView view;
+	// A DEDICATED ALLOCATION, NULL WHEN IT LIVES IN allocation
+	vk::DeviceMemory memory;
+	// A RANGE OF A DeviceMemoryPool BLOCK, THE OWNER IS THE CACHE HASH
+	PoolAllocation allocation;
+	// WHAT COUNTS AGAINST THE BUDGET
+	vk::DeviceSize bytes = 0;
+	// HOW IT WAS CREATED, SO A DEFRAGMENTATION MOVE CAN MAKE IT AGAIN
+	vk::BufferUsageFlags bufferUsage;
+	vk::ImageUsageFlags imageUsage;
+	vk::Format format = vk::Format::eUndefined;
+	vk::Extent2D extent;
+};
+
+class ResourceCache;
+
+// SHARED OWNERSHIP OF A CACHED RESOURCE, COPIES ADD A REFERENCE
+// WHEN THE LAST ONE GOES THE RESOURCE STAYS CACHED UNTIL THE BUDGET NEEDS ITS SPACE
+class ResourceHandle {
+public:
+	ResourceHandle() = default;
+	ResourceHandle(const ResourceHandle& other);
+	ResourceHandle(ResourceHandle&& other) noexcept;
+	ResourceHandle& operator=(ResourceHandle other) noexcept;
+	~ResourceHandle();
+
+	void reset();
+
+	explicit operator bool() const { return entry != nullptr; }
+	const GpuResource& operator*() const;
+	const GpuResource* operator->() const { return &**this; }
+
+private:
+	friend class ResourceCache;
+	struct Entry;
+
+	ResourceHandle(ResourceCache* cache, Entry* entry) : cache(cache), entry(entry) {}
+
+	ResourceCache* cache = nullptr;
+	Entry* entry = nullptr;
+};
+
+struct ResourceCacheStats {
+	size_t resources = 0;
+	size_t unreferenced = 0;
+	vk::DeviceSize bytes = 0;
+	vk::DeviceSize peakBytes = 0;
+	// EVICTED BUT MAYBE STILL USED BY A FRAME IN FLIGHT
+	size_t retired = 0;
+	vk::DeviceSize retiredBytes = 0;
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	// HITS WHERE THE CONTENT WAS ALREADY THERE UNDER ANOTHER PATH
+	uint64_t shared = 0;
+	uint64_t evictions = 0;
+	// MOVED TO ANOTHER PLACE IN MEMORY BY DEFRAGMENTATION
+	uint64_t relocations = 0;
+};
+
+// DEVICE RESOURCES KEYED BY ASSET PATH AND CONTENT HASH
+// THE SAME CONTENT IS UPLOADED ONCE, EVEN FROM DIFFERENT PATHS. WHEN THE CACHED
+// BYTES GO OVER THE BUDGET THE LEAST RECENTLY RELEASED UNREFERENCED RESOURCES
+// ARE EVICTED. AN EVICTED RESOURCE IS ONLY DESTROYED ONCE EVERY FRAME THAT WAS
+// SUBMITTED BEFORE THE EVICTION HAS FINISHED ON THE GPU (SEE beginFrame)
+// ACQUIRED FROM THE STARTUP JOBS AND THE RENDER THREAD, SO ALL OF IT IS LOCKED
+class ResourceCache {
+public:
+	using Create = std::function<GpuResource()>;
+	using Destroy = std::function<void(const GpuResource&)>;
+	using Relocate = std::function<GpuResource(const GpuResource&)>;
+
+	ResourceCache() = default;
+
+	ResourceCache(const ResourceCache&) = delete;
+	ResourceCache& operator=(const ResourceCache&) = delete;
+
+	// destroy FREES ONE RESOURCE (THE RENDERER GOES THROUGH freeMemory)
+	void init(Destroy destroy, vk::DeviceSize budget);
+
+	vk::DeviceSize budget() const { return byteBudget; }
+
+	// THE CACHED RESOURCE FOR hash, OTHERWISE create() IS CALLED AND ITS RESULT CACHED
+	// path ONLY NAMES THE CONTENT, A PATH THAT COMES BACK WITH ANOTHER HASH (THE FILE
+	// CHANGED) NOW NAMES THE NEW CONTENT AND THE OLD ONE IS EVICTED FIRST
+	// create RUNS UNDER THE LOCK SO THE SAME ASSET IS NEVER UPLOADED TWICE AT ONCE
+	ResourceHandle acquire(const std::string& path, uint64_t hash, const Create& create);
+
+	// frame IS ABOUT TO BE RECORDED AND SUBMITTED, EVERYTHING UP TO completedFrame HAS
+	// FINISHED ON THE GPU, SO WHAT WAS EVICTED BY THEN CAN BE DESTROYED
+	void beginFrame(uint64_t frame, uint64_t completedFrame);
+
+	// A DEFRAGMENTATION MOVE OF THE RESOURCE LIVING IN from: move MAKES THE NEW ONE FROM THE
+	// OLD (AND RECORDS THE COPY), THE ENTRY AND ITS HANDLES TAKE THE NEW ONE AND THE OLD ONE IS
+	// RETIRED LIKE AN EVICTION. FALSE WITHOUT CALLING move IF hash WAS EVICTED OR NOW NAMES
+	// ANOTHER UPLOAD
+	bool relocate(uint64_t hash, const PoolAllocation& from, const Relocate& move);
+
+	// DEVICE MUST BE IDLE, DESTROYS EVERYTHING (HANDLES STILL HELD BECOME DANGLING)
+	void clear();
+
+	ResourceCacheStats stats() const;
+
+	void report(std::ostream& out) const;
+
+private:
+	friend class ResourceHandle;
+	using Entry = ResourceHandle::Entry;
+
+	struct Retired {
+		GpuResource resource;
+		// LAST FRAME THAT COULD HAVE USED IT
+		uint64_t frame;
+	};
+
+	void addReference(Entry* entry);
+	void release(Entry* entry);
+	// LOCK HELD
+	void evict();
+	void retire(Entry* entry);
+
+	mutable std::mutex mutex;
+	Destroy destroy;
+	vk::DeviceSize byteBudget = 0;
+
+	// OWNS THE ENTRIES
+	std::unordered_map<uint64_t, std::unique_ptr<Entry>> entries;
+	std::unordered_map<std::string, uint64_t> paths;
+	// UNREFERENCED ENTRIES, LEAST RECENTLY RELEASED FIRST
+	std::list<Entry*> unused;
+	std::vector<Retired> retired;
+
+	uint64_t frame = 0;
+	vk::DeviceSize bytes = 0;
+	ResourceCacheStats counters;
+};
+
+struct ResourceHandle::Entry {
+	uint64_t hash = 0;
+	// THE FIRST PATH IT WAS ACQUIRED WITH, FOR THE REPORT
+	std::string path;
+	GpuResource resource;
+	uint32_t references = 0;
+	// INTO ResourceCache::unused WHEN references IS 0
+	std::list<Entry*>::iterator lru;
+};
@@ -0,0 +1,136 @@
+#include "ShaderVariants.h"
+#include "ResourceCache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+std::string shaderFeatureNames(uint32_t features) {
+	static const char* names[SHADER_FEATURE_COUNT] = { "sun", "shadows", "point-lights", "alpha-test" };
+
+	std::string result;
+	for (uint32_t i = 0; i < SHADER_FEATURE_COUNT; i++) {
+		if (features & (1u << i)) {
+			if (!result.empty()) result += "+";
+			result += names[i];
+		}
+	}
+	return result.empty() ? "none" : result;
+}
+
+ShaderSpecialization::ShaderSpecialization(uint32_t features) {
+	for (uint32_t i = 0; i < SHADER_FEATURE_COUNT; i++) {
+		values[i] = (features & (1u << i)) ? VK_TRUE : VK_FALSE;
+		entries[i] = vk::SpecializationMapEntry(i, static_cast<uint32_t>(i * sizeof(vk::Bool32)), sizeof(vk::Bool32));
+	}
+
+	info.mapEntryCount = SHADER_FEATURE_COUNT;
+	info.pMapEntries = entries.data();
+	info.dataSize = sizeof(values);
+	info.pData = values.data();
+}
+
+void ShaderVariantCache::init(vk::Device device, const vk::PhysicalDeviceProperties& properties, const std::string& directory) {
+	this->device = device;
+	this->directory = directory;
+
+	uint32_t ids[] = { properties.vendorID, properties.deviceID, properties.driverVersion };
+	deviceHash = hashBytes(ids, sizeof(ids));
+	deviceHash = hashBytes(properties.pipelineCacheUUID, VK_UUID_SIZE, deviceHash);
+
+	if (!directory.empty()) {
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		if (error) {
+			std::cout << "shader variants: can not create " << directory << ", they are not kept on disk\n";
+			this->directory.clear();
+		}
+	}
+}
+
+std::string ShaderVariantCache::filePath(uint64_t key) const {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(hashBytes(&key, sizeof(key), deviceHash)));
+	return (std::filesystem::path(directory) / name).string();
+}
+
+vk::Pipeline ShaderVariantCache::acquire(uint64_t key, const Build& build) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto found = pipelines.find(key);
+	if (found != pipelines.end()) {
+		counters.hits++;
+		return found->second;
+	}
+
+	// THE DRIVER CHECKS THE HEADER OF THE DATA AND IGNORES IT IF IT DOES NOT MATCH
+	std::vector<char> data;
+	if (!directory.empty()) {
+		std::ifstream file(filePath(key), std::ios::binary);
+		if (file) {
+			data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		}
+	}
+
+	vk::PipelineCacheCreateInfo cacheInfo;
+	cacheInfo.initialDataSize = data.size();
+	cacheInfo.pInitialData = data.data();
+
+	vk::PipelineCache cache;
+	try {
+		cache = device.createPipelineCache(cacheInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to create Pipeline Cache!");
+	}
+
+	vk::Pipeline pipeline;
+	try {
+		pipeline = build(cache);
+	}
+	catch (...) {
+		device.destroyPipelineCache(cache);
+		throw;
+	}
+
+	if (data.empty()) {
+		counters.builds++;
+		if (!directory.empty()) {
+			std::vector<uint8_t> built = device.getPipelineCacheData(cache);
+			std::ofstream file(filePath(key), std::ios::binary);
+			file.write(reinterpret_cast<const char*>(built.data()), built.size());
+		}
+	}
+	else {
+		counters.diskHits++;
+	}
+	device.destroyPipelineCache(cache);
+
+	pipelines.emplace(key, pipeline);
+	return pipeline;
+}
+
+void ShaderVariantCache::clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto& entry : pipelines) {
+		device.destroyPipeline(entry.second);
+	}
+	pipelines.clear();
+}
+
+ShaderVariantStats ShaderVariantCache::stats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	ShaderVariantStats result = counters;
+	result.pipelines = pipelines.size();
+	return result;
+}
+
+void ShaderVariantCache::report(std::ostream& out) const {
+	ShaderVariantStats result = stats();
+	out << "shader variants: " << result.pipelines << " pipelines, " << result.hits << " reused, "
+		<< result.diskHits << " from the disk cache, " << result.builds << " compiled\n";
+}
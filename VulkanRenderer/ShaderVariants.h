@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+// FEATURES OF THE MAIN FRAGMENT SHADER, BIT i IS THE SPECIALIZATION CONSTANT constant_id = i
+// A FEATURE THAT IS OFF IS A CONSTANT false IN THE SPIR-V THE DRIVER COMPILES, SO ITS
+// BRANCHES, LOOPS AND TEXTURE READS ARE FOLDED AWAY AND COST NOTHING AT RUN TIME.
+// WHAT CAN NOT BE A CONSTANT (AN EXTENSION, A DIFFERENT INTERFACE) STAYS A -D BUILD IN compile.bat
+enum ShaderFeature : uint32_t {
+	SHADER_FEATURE_SUN = 1u << 0,
+	SHADER_FEATURE_SHADOWS = 1u << 1,
+	SHADER_FEATURE_POINT_LIGHTS = 1u << 2,
+	SHADER_FEATURE_ALPHA_TEST = 1u << 3,
+};
+
+constexpr uint32_t SHADER_FEATURE_COUNT = 4;
+
+// "sun+shadows+..." FOR THE LOG
+std::string shaderFeatureNames(uint32_t features);
+
+// THE SPECIALIZATION CONSTANTS OF ONE SET OF FEATURES, info POINTS INTO THE OBJECT SO IT DOES NOT MOVE
+struct ShaderSpecialization {
+	explicit ShaderSpecialization(uint32_t features);
+	ShaderSpecialization(const ShaderSpecialization&) = delete;
+	ShaderSpecialization& operator=(const ShaderSpecialization&) = delete;
+
+	std::array<vk::Bool32, SHADER_FEATURE_COUNT> values;
+	std::array<vk::SpecializationMapEntry, SHADER_FEATURE_COUNT> entries;
+	vk::SpecializationInfo info;
+};
+
+struct ShaderVariantStats {
+	size_t pipelines = 0;
+	// ALREADY BUILT IN THIS RUN
+	uint64_t hits = 0;
+	// BUILT WITH THE PIPELINE CACHE AN EARLIER RUN LEFT ON DISK
+	uint64_t diskHits = 0;
+	// BUILT FROM NOTHING, THE DRIVER COMPILED EVERY STAGE
+	uint64_t builds = 0;
+};
+
+// PIPELINE VARIANTS KEYED BY A HASH OF EVERYTHING THAT MAKES THEM DIFFERENT
+// THE CALLER PUTS THE SPIR-V, THE FEATURES AND THE STATE THAT MATTERS IN THE KEY, THE CACHE
+// ADDS THE DEVICE AND DRIVER. A VARIANT IS ONLY BUILT WHEN SOMETHING ASKS FOR IT, WITH THE
+// PIPELINE CACHE FILE <key>.bin FROM AN EARLIER RUN IF THERE IS ONE, AND THE FILE IS WRITTEN
+// WHEN IT WAS NOT. BUILT PIPELINES ARE KEPT UNTIL clear, SO A SWAPCHAIN RECREATION OR A NEW
+// MODEL WITH THE SAME KEY GETS THE SAME PIPELINE BACK (THE RENDER PASS ONLY HAS TO BE COMPATIBLE)
+class ShaderVariantCache {
+public:
+	// CREATES THE PIPELINE, WITH THE GIVEN CACHE
+	using Build = std::function<vk::Pipeline(vk::PipelineCache)>;
+
+	// AN EMPTY directory KEEPS THE VARIANTS IN MEMORY ONLY
+	void init(vk::Device device, const vk::PhysicalDeviceProperties& properties, const std::string& directory);
+
+	// THE PIPELINE OF key, build ONLY RUNS IF THIS RUN HAS NOT BUILT IT YET
+	vk::Pipeline acquire(uint64_t key, const Build& build);
+
+	// DESTROYS EVERY PIPELINE, NOTHING MAY STILL USE THEM
+	void clear();
+
+	ShaderVariantStats stats() const;
+
+	void report(std::ostream& out) const;
+
+private:
+	std::string filePath(uint64_t key) const;
+
+	vk::Device device;
+	std::string directory;
+	// VENDOR, DEVICE, DRIVER AND PIPELINE CACHE UUID, A NEW DRIVER MEANS NEW FILES
+	uint64_t deviceHash = 0;
+
+	// PIPELINES ARE ASKED FOR FROM THE STARTUP JOBS
+	mutable std::mutex mutex;
+	std::unordered_map<uint64_t, vk::Pipeline> pipelines;
+	ShaderVariantStats counters;
+};
@@ -0,0 +1,471 @@
+#include "VulkanRenderer.h"
+
+// CASCADED SHADOW MAPS FOR THE SUN
+// THE VIEW UP TO shadowDistance IS CUT INTO shadowCascadeCount SLICES, EVERY
+// SLICE GETS ITS OWN ORTHOGRAPHIC SHADOW MAP (ONE LAYER OF shadowImage) THAT
+// IS DRAWN DEPTH ONLY BEFORE THE MAIN PASS
+// A CASCADE IS NOT DRAWN AGAIN UNLESS SOMETHING IN IT CHANGED:
+// - ITS BOUNDS ARE BIGGER THAN THE SLICE BY shadowCacheMargin, SO THE CAMERA CAN
+//   MOVE A BIT BEFORE THE CASCADE HAS TO FOLLOW
+// - THE SUN HAS TO TURN MORE THAN shadowLightThreshold DEGREES
+// - THE CASTERS ARE HASHED WITH THEIR MATRICES, A STATIC CASCADE HASHES THE SAME
+//   EVERY FRAME, ONE WITH SOMETHING MOVING OR STREAMING IN DOES NOT
+// THE COMMAND BUFFERS ARE PRERECORDED, SO ONE IS ONLY RECORDED AGAIN WHEN THE
+// SET OF CASCADES IT HAS TO DRAW IS DIFFERENT FROM LAST TIME
+
+// SAMPLED WITH A COMPARE SAMPLER, EVERY DESKTOP DRIVER CAN DO BOTH WITH IT
+static const vk::Format SHADOW_FORMAT = vk::Format::eD32Sfloat;
+// HOW MUCH THE SPLITS LEAN TOWARDS LOGARITHMIC (1) OVER UNIFORM (0)
+static const float SHADOW_SPLIT_LAMBDA = 0.75f;
+
+void VulkanRenderer::createShadowRenderPass() {
+	if (!shadows) return;
+
+	vk::AttachmentDescription depthAttachment;
+	depthAttachment.format = SHADOW_FORMAT;
+	depthAttachment.samples = vk::SampleCountFlagBits::e1;
+	// A CASCADE IS ONLY EVER DRAWN WHOLE
+	depthAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+	depthAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+	depthAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+	depthAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+	depthAttachment.initialLayout = vk::ImageLayout::eUndefined;
+	depthAttachment.finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+	vk::AttachmentReference depthAttachmentRef;
+	depthAttachmentRef.attachment = 0;
+	depthAttachmentRef.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+	vk::SubpassDescription subpass;
+	subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+	subpass.colorAttachmentCount = 0;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+	std::array<vk::SubpassDependency, 2> dependencies;
+	// EARLIER FRAMES MAY STILL BE SAMPLING THE OLD CONTENTS
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = vk::PipelineStageFlagBits::eFragmentShader;
+	dependencies[0].dstStageMask = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+	dependencies[0].srcAccessMask = {};
+	dependencies[0].dstAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+	// THE MAIN PASS SAMPLES THE RESULT
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = vk::PipelineStageFlagBits::eLateFragmentTests;
+	dependencies[1].dstStageMask = vk::PipelineStageFlagBits::eFragmentShader;
+	dependencies[1].srcAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+	dependencies[1].dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+	vk::RenderPassCreateInfo renderPassInfo;
+	renderPassInfo.attachmentCount = 1;
+	renderPassInfo.pAttachments = &depthAttachment;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	renderPassInfo.pDependencies = dependencies.data();
+
+	try {
+		shadowRenderPass = device->createRenderPass(renderPassInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to create shadow Render Pass!");
+	}
+}
+
+void VulkanRenderer::createShadowPipeline() {
+	if (!shadows) return;
+
+	// MAIN DESCRIPTOR SET, THE PUSH CONSTANT IS THE CASCADE
+	// ITS OWN LAYOUT SO IT OUTLIVES THE SWAPCHAIN LIKE THE PIPELINE DOES
+	vk::PushConstantRange pushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, sizeof(uint32_t));
+	vk::PipelineLayoutCreateInfo pipelineLayoutInfo;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	try {
+		shadowPipelineLayout = device->createPipelineLayout(pipelineLayoutInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to create shadow Pipeline Layout!");
+	}
+
+	// THE LIGHT GOES THROUGH THE CUT OUT TEXELS, cutout.frag DROPS THEM LIKE IN THE MAIN PASS
+	auto vertShaderCode = readFile(SHADER_PATH + (textureHasCutout ? "shadow_alpha.spv" : "shadow.spv"));
+	vk::ShaderModule vertShaderModule = createShaderModule(vertShaderCode);
+
+	std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages;
+	shaderStages[0].stage = vk::ShaderStageFlagBits::eVertex;
+	shaderStages[0].module = vertShaderModule;
+	shaderStages[0].pName = "main";
+
+	vk::ShaderModule fragShaderModule;
+	if (textureHasCutout) {
+		fragShaderModule = createShaderModule(readFile(SHADER_PATH + "cutout_frag.spv"));
+		shaderStages[1].stage = vk::ShaderStageFlagBits::eFragment;
+		shaderStages[1].module = fragShaderModule;
+		shaderStages[1].pName = "main";
+	}
+
+	// ONLY THE POSITION IS READ, SO ONLY ITS STREAM IS FETCHED (AND THE TEXCOORDS FOR A CUTOUT)
+	vk::PipelineVertexInputStateCreateInfo vertexInputInfo = depthPassLayout().inputState();
+
+	vk::PipelineInputAssemblyStateCreateInfo inputAssembly;
+	inputAssembly.topology = vk::PrimitiveTopology::eTriangleList;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	// EVERY CASCADE IS THE WHOLE LAYER
+	vk::Extent2D extent(shadowMapSize, shadowMapSize);
+	vk::Viewport viewport(0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f);
+	vk::Rect2D scissor({ 0, 0 }, extent);
+
+	vk::PipelineViewportStateCreateInfo viewportState;
+	viewportState.viewportCount = 1;
+	viewportState.pViewports = &viewport;
+	viewportState.scissorCount = 1;
+	viewportState.pScissors = &scissor;
+
+	vk::PipelineRasterizationStateCreateInfo rasterizer;
+	rasterizer.polygonMode = vk::PolygonMode::eFill;
+	rasterizer.lineWidth = 1.0f;
+	// THE SUN SEES BOTH SIDES OF OPEN MESHES
+	rasterizer.cullMode = vk::CullModeFlagBits::eNone;
+	rasterizer.frontFace = vk::FrontFace::eCounterClockwise;
+	// PUSHES THE STORED DEPTH AWAY SO LIT SURFACES DO NOT SHADOW THEMSELVES
+	rasterizer.depthBiasEnable = VK_TRUE;
+	rasterizer.depthBiasConstantFactor = 1.25f;
+	rasterizer.depthBiasSlopeFactor = 1.75f;
+
+	vk::PipelineMultisampleStateCreateInfo multisampling;
+	multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
+
+	vk::PipelineDepthStencilStateCreateInfo depthStencil;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = vk::CompareOp::eLess;
+
+	// NO COLOR ATTACHMENTS
+	vk::PipelineColorBlendStateCreateInfo colorBlending;
+	colorBlending.attachmentCount = 0;
+
+	vk::GraphicsPipelineCreateInfo pipelineInfo;
+	pipelineInfo.stageCount = textureHasCutout ? 2 : 1;
+	pipelineInfo.pStages = shaderStages.data();
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.layout = shadowPipelineLayout;
+	pipelineInfo.renderPass = shadowRenderPass;
+	pipelineInfo.subpass = 0;
+
+	vk::Result result;
+	std::tie(result, shadowPipeline) = device->createGraphicsPipeline(nullptr, pipelineInfo);
+
+	if (result != vk::Result::eSuccess) {
+		throw std::runtime_error("failed to create shadow Pipeline!");
+	}
+
+	device->destroyShaderModule(vertShaderModule);
+	if (fragShaderModule) {
+		device->destroyShaderModule(fragShaderModule);
+	}
+}
+
+void VulkanRenderer::createShadowResources() {
+	// ALWAYS CREATED, THE MAIN DESCRIPTOR SET NEEDS SOMETHING TO POINT AT
+	uint32_t size = shadows ? shadowMapSize : 1;
+	createImage(size, size, SHADOW_FORMAT, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, shadowImage, shadowImageMemory, 1, shadowLayers());
+	shadowImageView = createImageView(shadowImage, SHADOW_FORMAT, vk::ImageAspectFlagBits::eDepth, 0, 1, vk::ImageViewType::e2DArray, 0, shadowLayers());
+
+	// NOTHING IS IN SHADOW BEFORE A CASCADE IS FIRST DRAWN
+	vk::CommandBuffer commandBuffer = beginSingleTimeCommands();
+
+	vk::ImageMemoryBarrier barrier;
+	barrier.oldLayout = vk::ImageLayout::eUndefined;
+	barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = shadowImage;
+	barrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, shadowLayers());
+	barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+		{},
+		0, nullptr,
+		0, nullptr,
+		1, &barrier);
+
+	vk::ClearDepthStencilValue far(1.0f, 0);
+	commandBuffer.clearDepthStencilImage(shadowImage, vk::ImageLayout::eTransferDstOptimal, &far, 1, &barrier.subresourceRange);
+
+	barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+	barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+		{},
+		0, nullptr,
+		0, nullptr,
+		1, &barrier);
+
+	endSingleTimeCommands(commandBuffer);
+
+	// HARDWARE PCF, OUTSIDE THE MAP COUNTS AS LIT
+	vk::SamplerCreateInfo samplerInfo;
+	samplerInfo.magFilter = vk::Filter::eLinear;
+	samplerInfo.minFilter = vk::Filter::eLinear;
+	samplerInfo.mipmapMode = vk::SamplerMipmapMode::eNearest;
+	samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToBorder;
+	samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToBorder;
+	samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToBorder;
+	samplerInfo.borderColor = vk::BorderColor::eFloatOpaqueWhite;
+	samplerInfo.compareEnable = VK_TRUE;
+	samplerInfo.compareOp = vk::CompareOp::eLessOrEqual;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = 0.0f;
+
+	try {
+		shadowSampler = device->createSampler(samplerInfo);
+	}
+	catch (vk::SystemError err) {
+		throw(std::runtime_error("failed to create shadow sampler!"));
+	}
+
+	if (!shadows) return;
+
+	shadowLayerViews.resize(shadowCascadeCount);
+	shadowFramebuffers.resize(shadowCascadeCount);
+	for (uint32_t cascade = 0; cascade < shadowCascadeCount; cascade++) {
+		shadowLayerViews[cascade] = createImageView(shadowImage, SHADOW_FORMAT, vk::ImageAspectFlagBits::eDepth, 0, 1, vk::ImageViewType::e2D, cascade, 1);
+
+		vk::FramebufferCreateInfo framebufferInfo;
+		framebufferInfo.renderPass = shadowRenderPass;
+		framebufferInfo.attachmentCount = 1;
+		framebufferInfo.pAttachments = &shadowLayerViews[cascade];
+		framebufferInfo.width = shadowMapSize;
+		framebufferInfo.height = shadowMapSize;
+		framebufferInfo.layers = 1;
+
+		try {
+			shadowFramebuffers[cascade] = device->createFramebuffer(framebufferInfo);
+		}
+		catch (vk::SystemError err) {
+			throw(std::runtime_error("failed to create shadow frame buffer!"));
+		}
+	}
+}
+
+void VulkanRenderer::destroyShadowResources() {
+	for (auto framebuffer : shadowFramebuffers) {
+		device->destroyFramebuffer(framebuffer);
+	}
+	shadowFramebuffers.clear();
+	for (auto view : shadowLayerViews) {
+		device->destroyImageView(view);
+	}
+	shadowLayerViews.clear();
+
+	device->destroySampler(shadowSampler);
+	device->destroyImageView(shadowImageView);
+	device->destroyImage(shadowImage);
+	freeMemory(shadowImageMemory);
+
+	if (shadows) {
+		device->destroyPipeline(shadowPipeline);
+		device->destroyPipelineLayout(shadowPipelineLayout);
+		device->destroyRenderPass(shadowRenderPass);
+	}
+}
+
+void VulkanRenderer::createShadowBuffers() {
+	vk::DeviceSize objectBufferSize = sizeof(glm::mat4) * MAX_DRAW_OBJECTS * shadowLayers();
+	vk::DeviceSize indirectBufferSize = sizeof(vk::DrawIndexedIndirectCommand) * shadowLayers();
+
+	shadowObjectBuffers.resize(swapChainImages.size());
+	shadowObjectBuffersMemory.resize(swapChainImages.size());
+	shadowIndirectBuffers.resize(swapChainImages.size());
+	shadowIndirectBuffersMemory.resize(swapChainImages.size());
+	// NEW COMMAND BUFFERS START WITHOUT SHADOW PASSES, THE CACHED CASCADES ARE STILL IN THE IMAGE
+	shadowRenderMasks.assign(swapChainImages.size(), 0);
+
+	for (size_t i = 0; i < swapChainImages.size(); i++) {
+		createBuffer(objectBufferSize, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, shadowObjectBuffers[i], shadowObjectBuffersMemory[i]);
+		createBuffer(indirectBufferSize, vk::BufferUsageFlagBits::eIndirectBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, shadowIndirectBuffers[i], shadowIndirectBuffersMemory[i]);
+	}
+}
+
+void VulkanRenderer::destroyShadowBuffers() {
+	for (size_t i = 0; i < shadowObjectBuffers.size(); i++) {
+		device->destroyBuffer(shadowObjectBuffers[i]);
+		freeMemory(shadowObjectBuffersMemory[i]);
+		device->destroyBuffer(shadowIndirectBuffers[i]);
+		freeMemory(shadowIndirectBuffersMemory[i]);
+	}
+	shadowObjectBuffers.clear();
+	shadowObjectBuffersMemory.clear();
+	shadowIndirectBuffers.clear();
+	shadowIndirectBuffersMemory.clear();
+}
+
+glm::vec3 VulkanRenderer::sunDirectionAt(uint64_t tick) const {
+	// THE SUN TURNS AROUND Y, TIME COMES FROM THE SIMULATION LIKE FOR THE POINT LIGHTS
+	float angle = glm::radians(sunSpeed * static_cast<float>(tick / simulationRate));
+	float c = std::cos(angle);
+	float s = std::sin(angle);
+	return glm::normalize(glm::vec3(c * sunDirection.x + s * sunDirection.z, sunDirection.y, -s * sunDirection.x + c * sunDirection.z));
+}
+
+void VulkanRenderer::updateShadows(uint32_t currentImage, UniformBufferObject& ubo) {
+	PROFILE_FUNCTION();
+	ubo.shadowInfo = glm::uvec4(0, shadowMapSize, 0, 0);
+	ubo.sunDirection = glm::vec4(0.0f);
+	if (!shadows) return;
+
+	const FrameSnapshot& snapshot = frameSnapshot;
+
+	glm::vec3 light = sunDirectionAt(snapshot.tick);
+	ubo.sunDirection = glm::vec4(light, sunIntensity);
+	ubo.shadowInfo.x = shadowCascadeCount;
+
+	float distance = shadowDistance > 0.0f ? std::min(shadowDistance, farPlane) : farPlane;
+	// SQUARED TANGENT OF THE ANGLE BETWEEN THE VIEW AXIS AND THE FRUSTUM CORNERS
+	float tanY = std::tan(glm::radians(snapshot.fov) * 0.5f);
+	float tanX = tanY * viewExtent.width / (float)viewExtent.height;
+	float corner = tanX * tanX + tanY * tanY;
+	glm::vec3 front = glm::normalize(snapshot.cameraFront);
+	float lightThreshold = std::cos(glm::radians(shadowLightThreshold));
+
+	auto objects = static_cast<glm::mat4*>(device->mapMemory(shadowObjectBuffersMemory[currentImage], 0, VK_WHOLE_SIZE));
+	auto commands = static_cast<vk::DrawIndexedIndirectCommand*>(device->mapMemory(shadowIndirectBuffersMemory[currentImage], 0, VK_WHOLE_SIZE));
+
+	uint32_t mask = 0;
+	float splitNear = nearPlane;
+	for (uint32_t index = 0; index < shadowCascadeCount; index++) {
+		ShadowCascade& cascade = shadowCascades[index];
+
+		// MOSTLY LOGARITHMIC SO THE NEAR CASCADES ARE SHARP, A BIT UNIFORM SO THE FIRST ONE IS NOT TINY
+		float t = (index + 1) / static_cast<float>(shadowCascadeCount);
+		float splitFar = glm::mix(nearPlane + (distance - nearPlane) * t, nearPlane * std::pow(distance / nearPlane, t), SHADOW_SPLIT_LAMBDA);
+
+		// SMALLEST SPHERE AROUND THE SLICE, IT SITS ON THE VIEW AXIS AND ITS RADIUS
+		// DOES NOT CHANGE AS THE CAMERA TURNS, ONLY WITH THE PROJECTION
+		float centerDepth = std::min((splitNear + splitFar) * (1.0f + corner) * 0.5f, splitFar);
+		float radius = std::sqrt((splitFar - centerDepth) * (splitFar - centerDepth) + splitFar * splitFar * corner);
+		glm::vec3 center = snapshot.cameraPos + front * centerDepth;
+
+		bool moved = !cascade.valid
+			|| radius != cascade.sliceRadius
+			|| glm::dot(light, cascade.light) < lightThreshold
+			|| glm::length(center - cascade.sliceCenter) > shadowCacheMargin * radius;
+
+		if (moved) {
+			cascade.light = light;
+			cascade.sliceCenter = center;
+			cascade.sliceRadius = radius;
+
+			// WITH THE MARGIN THE SLICE STAYS INSIDE UNTIL ITS CENTER MOVES margin * radius
+			float extent = radius * (1.0f + shadowCacheMargin);
+			glm::vec3 up = std::abs(light.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+			glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), light, up);
+
+			// WHOLE TEXELS ONLY, SO A CASCADE THAT MOVES DOES NOT SHIMMER
+			float texel = 2.0f * extent / shadowMapSize;
+			glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+			lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+			lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+
+			// CASTERS UP TO distance TOWARDS THE SUN STILL THROW SHADOWS INTO THE SLICE
+			glm::mat4 lightProj = glm::ortho(
+				lightCenter.x - extent, lightCenter.x + extent,
+				lightCenter.y - extent, lightCenter.y + extent,
+				-lightCenter.z - extent - distance, -lightCenter.z + extent);
+			cascade.matrix = lightProj * lightView;
+		}
+
+		// WHAT THROWS A SHADOW INTO THE CASCADE AND WHERE IT IS
+		shadowCasters.clear();
+		cullingScene.cull(Frustum::fromViewProjection(cascade.matrix), cullShape, shadowCasters);
+		size_t count = std::min<size_t>(shadowCasters.size(), MAX_DRAW_OBJECTS);
+		shadowCasterModels.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			shadowCasterModels[i] = cullingScene.worldMatrix(shadowCasters[i]);
+		}
+		uint64_t contents = hashBytes(&cascade.matrix, sizeof(cascade.matrix));
+		contents = hashBytes(shadowCasters.data(), sizeof(uint32_t) * count, contents);
+		contents = hashBytes(shadowCasterModels.data(), sizeof(glm::mat4) * count, contents);
+
+		shadowCascadeFrames++;
+		if (moved || contents != cascade.contents) {
+			mask |= 1u << index;
+			shadowCascadeRenders++;
+			cascade.contents = contents;
+
+			if (count > 0) {
+				memcpy(objects + static_cast<size_t>(index) * MAX_DRAW_OBJECTS, shadowCasterModels.data(), sizeof(glm::mat4) * count);
+			}
+			commands[index].indexCount = mesh.indexCount;
+			commands[index].instanceCount = static_cast<uint32_t>(count);
+			commands[index].firstIndex = 0;
+			commands[index].vertexOffset = 0;
+			commands[index].firstInstance = 0;
+		}
+		cascade.valid = true;
+
+		ubo.shadowMatrices[index] = cascade.matrix;
+		ubo.shadowSplits[index] = splitFar;
+		splitNear = splitFar;
+	}
+
+	device->unmapMemory(shadowIndirectBuffersMemory[currentImage]);
+	device->unmapMemory(shadowObjectBuffersMemory[currentImage]);
+
+	// THE IMAGE IS IDLE (ITS FENCE WAS WAITED ON), SO IT CAN BE RECORDED AGAIN
+	if (shadowRenderMasks[currentImage] != mask) {
+		shadowRenderMasks[currentImage] = mask;
+		recordCommandBuffer(currentImage);
+	}
+}
+
+void VulkanRenderer::recordShadows(vk::CommandBuffer commandBuffer, size_t image) {
+	uint32_t mask = shadows ? shadowRenderMasks[image] : 0;
+	if (mask == 0) return;
+
+	// BINDINGS LAST FOR THE WHOLE COMMAND BUFFER, ACROSS THE RENDER PASSES
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, shadowPipeline);
+
+	// EVERY BINDING IS A WINDOW INTO THE SAME BUFFER
+	const VertexLayout& layout = depthPassLayout();
+	std::vector<vk::Buffer> vertexBuffers(layout.offsets.size(), vertexBuffer);
+	commandBuffer.bindVertexBuffers(0, static_cast<uint32_t>(vertexBuffers.size()), vertexBuffers.data(), layout.offsets.data());
+	commandBuffer.bindIndexBuffer(indexBuffer, 0, mesh.indexType);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, shadowPipelineLayout, 0, 1, &descriptorSets[image], 0, nullptr);
+
+	for (uint32_t cascade = 0; cascade < shadowCascadeCount; cascade++) {
+		if (!(mask & (1u << cascade))) continue;
+
+		vk::RenderPassBeginInfo renderPassInfo;
+		renderPassInfo.renderPass = shadowRenderPass;
+		renderPassInfo.framebuffer = shadowFramebuffers[cascade];
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = vk::Extent2D(shadowMapSize, shadowMapSize);
+
+		vk::ClearValue clearValue;
+		clearValue.depthStencil = { 1.0f, 0 };
+		renderPassInfo.clearValueCount = 1;
+		renderPassInfo.pClearValues = &clearValue;
+
+		commandBuffer.beginRenderPass(&renderPassInfo, vk::SubpassContents::eInline);
+
+		commandBuffer.pushConstants(shadowPipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(cascade), &cascade);
+		commandBuffer.drawIndexedIndirect(shadowIndirectBuffers[image], sizeof(vk::DrawIndexedIndirectCommand) * cascade, 1, sizeof(vk::DrawIndexedIndirectCommand));
+
+		commandBuffer.endRenderPass();
+	}
+}
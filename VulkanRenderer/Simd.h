@@ -0,0 +1,160 @@
+#pragma once
+
+// THIN WRAPPER OVER THE VECTOR INSTRUCTIONS WE HAVE
+// KERNELS ARE WRITTEN ONCE AGAINST simd:: AND GET
+// 8 LANES ON AVX2, 4 ON SSE / NEON AND 1 ON ANYTHING ELSE
+// DEFINE SIMD_FORCE_SCALAR TO CHECK THE KERNELS AGAINST PLAIN C++
+// THE BACKEND FOLLOWS THE FLAGS OF THE FILE INCLUDING IT, SO ONE BINARY CAN HOLD SEVERAL
+// (SEE CullingKernels.h), EACH IN ITS OWN INLINE NAMESPACE SO THE LINKER NEVER MIXES THEM UP
+
+#include <cstdint>
+#include <cmath>
+
+#if !defined(SIMD_FORCE_SCALAR) && defined(__AVX2__)
+	#define SIMD_AVX2 1
+	#define SIMD_NAMESPACE avx2
+	#include <immintrin.h>
+#elif !defined(SIMD_FORCE_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+	#define SIMD_SSE 1
+	#define SIMD_NAMESPACE sse
+	#include <emmintrin.h>
+#elif !defined(SIMD_FORCE_SCALAR) && (defined(__ARM_NEON) || defined(_M_ARM64))
+	#define SIMD_NEON 1
+	#define SIMD_NAMESPACE neon
+	#include <arm_neon.h>
+#else
+	#define SIMD_SCALAR 1
+	#define SIMD_NAMESPACE scalar
+#endif
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+// WHETHER THE CPU AND THE OS CAN RUN THE AVX2 BUILD OF A KERNEL (DEFINED IN Culling.cpp)
+bool cpuSupportsAvx2();
+
+namespace simd {
+inline namespace SIMD_NAMESPACE {
+
+// INDEX OF THE LOWEST SET BIT, bits MUST NOT BE ZERO
+inline uint32_t lowestBit(uint32_t bits) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, bits);
+	return static_cast<uint32_t>(index);
+#else
+	return static_cast<uint32_t>(__builtin_ctz(bits));
+#endif
+}
+
+#if defined(SIMD_AVX2)
+
+constexpr int WIDTH = 8;
+constexpr const char* NAME = "AVX2";
+using Float = __m256;
+using Mask = __m256;
+
+inline Float load(const float* p) { return _mm256_loadu_ps(p); }
+inline void store(float* p, Float v) { _mm256_storeu_ps(p, v); }
+inline Float set(float v) { return _mm256_set1_ps(v); }
+inline Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+inline Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+inline Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+// a * b + c
+#if defined(__FMA__) || defined(_MSC_VER)
+inline Float mulAdd(Float a, Float b, Float c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+inline Float mulAdd(Float a, Float b, Float c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+inline Float max(Float a, Float b) { return _mm256_max_ps(a, b); }
+inline Float min(Float a, Float b) { return _mm256_min_ps(a, b); }
+inline Float sqrt(Float a) { return _mm256_sqrt_ps(a); }
+inline Float abs(Float a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+inline Mask greaterEqual(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+inline Mask less(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline Mask maskAnd(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+inline Mask maskAll() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+inline uint32_t maskBits(Mask m) { return static_cast<uint32_t>(_mm256_movemask_ps(m)); }
+
+#elif defined(SIMD_SSE)
+
+constexpr int WIDTH = 4;
+constexpr const char* NAME = "SSE";
+using Float = __m128;
+using Mask = __m128;
+
+inline Float load(const float* p) { return _mm_loadu_ps(p); }
+inline void store(float* p, Float v) { _mm_storeu_ps(p, v); }
+inline Float set(float v) { return _mm_set1_ps(v); }
+inline Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+inline Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+inline Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+inline Float mulAdd(Float a, Float b, Float c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+inline Float max(Float a, Float b) { return _mm_max_ps(a, b); }
+inline Float min(Float a, Float b) { return _mm_min_ps(a, b); }
+inline Float sqrt(Float a) { return _mm_sqrt_ps(a); }
+inline Float abs(Float a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+inline Mask greaterEqual(Float a, Float b) { return _mm_cmpge_ps(a, b); }
+inline Mask less(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+inline Mask maskAnd(Mask a, Mask b) { return _mm_and_ps(a, b); }
+inline Mask maskAll() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+inline uint32_t maskBits(Mask m) { return static_cast<uint32_t>(_mm_movemask_ps(m)); }
+
+#elif defined(SIMD_NEON)
+
+constexpr int WIDTH = 4;
+constexpr const char* NAME = "NEON";
+using Float = float32x4_t;
+using Mask = uint32x4_t;
+
+inline Float load(const float* p) { return vld1q_f32(p); }
+inline void store(float* p, Float v) { vst1q_f32(p, v); }
+inline Float set(float v) { return vdupq_n_f32(v); }
+inline Float add(Float a, Float b) { return vaddq_f32(a, b); }
+inline Float sub(Float a, Float b) { return vsubq_f32(a, b); }
+inline Float mul(Float a, Float b) { return vmulq_f32(a, b); }
+inline Float mulAdd(Float a, Float b, Float c) { return vmlaq_f32(c, a, b); }
+inline Float max(Float a, Float b) { return vmaxq_f32(a, b); }
+inline Float min(Float a, Float b) { return vminq_f32(a, b); }
+inline Float sqrt(Float a) { return vsqrtq_f32(a); }
+inline Float abs(Float a) { return vabsq_f32(a); }
+inline Mask greaterEqual(Float a, Float b) { return vcgeq_f32(a, b); }
+inline Mask less(Float a, Float b) { return vcltq_f32(a, b); }
+inline Mask maskAnd(Mask a, Mask b) { return vandq_u32(a, b); }
+inline Mask maskAll() { return vdupq_n_u32(0xFFFFFFFFu); }
+inline uint32_t maskBits(Mask m) {
+	// NO MOVEMASK ON NEON, SHIFT EVERY LANE'S TOP BIT INTO PLACE AND ADD
+	static const int32_t shifts[4] = { 0, 1, 2, 3 };
+	uint32x4_t bits = vshlq_u32(vshrq_n_u32(m, 31), vld1q_s32(shifts));
+	return vaddvq_u32(bits);
+}
+
+#else
+
+constexpr int WIDTH = 1;
+constexpr const char* NAME = "scalar";
+using Float = float;
+using Mask = bool;
+
+inline Float load(const float* p) { return *p; }
+inline void store(float* p, Float v) { *p = v; }
+inline Float set(float v) { return v; }
+inline Float add(Float a, Float b) { return a + b; }
+inline Float sub(Float a, Float b) { return a - b; }
+inline Float mul(Float a, Float b) { return a * b; }
+inline Float mulAdd(Float a, Float b, Float c) { return a * b + c; }
+inline Float max(Float a, Float b) { return a > b ? a : b; }
+inline Float min(Float a, Float b) { return a < b ? a : b; }
+inline Float sqrt(Float a) { return std::sqrt(a); }
+inline Float abs(Float a) { return std::fabs(a); }
+inline Mask greaterEqual(Float a, Float b) { return a >= b; }
+inline Mask less(Float a, Float b) { return a < b; }
+inline Mask maskAnd(Mask a, Mask b) { return a && b; }
+inline Mask maskAll() { return true; }
+inline uint32_t maskBits(Mask m) { return m ? 1u : 0u; }
+
+#endif
+
+}
+}
@@ -0,0 +1,537 @@
+#include "SoftwareRasterizer.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "Simd.h"
+
+#include "RasterKernels.inl"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+const RasterKernels& defaultRasterKernels() {
+	return rasterKernels;
+}
+
+const RasterKernels& bestRasterKernels() {
+	static const RasterKernels* best = [] {
+		const RasterKernels* avx2 = avx2RasterKernels();
+		return avx2 && cpuSupportsAvx2() ? avx2 : &defaultRasterKernels();
+	}();
+	return *best;
+}
+
+// TRIANGLES SET UP AND BINNED BY ONE JOB
+static const size_t TRIANGLES_PER_BIN = 8192;
+// VERTICES FURTHER OUT THAN THIS MANY HALF SCREENS ARE CLIPPED, SO THE EDGE FUNCTIONS STAY PRECISE
+static const float GUARD_BAND = 8.0f;
+// MUST MATCH Fragment.frag
+static const glm::vec3 AMBIENT = glm::vec3(0.1f);
+static const glm::vec3 SUN_COLOR = glm::vec3(1.0f, 0.95f, 0.85f);
+
+static float srgbToLinear(uint8_t value) {
+	static const auto table = []() {
+		std::vector<float> result(256);
+		for (int i = 0; i < 256; i++) {
+			float c = i / 255.0f;
+			result[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		return result;
+	}();
+	return table[value];
+}
+
+static uint8_t linearToSrgb(float value) {
+	static const int STEPS = 4096;
+	static const auto table = []() {
+		std::vector<uint8_t> result(STEPS + 1);
+		for (int i = 0; i <= STEPS; i++) {
+			float c = i / static_cast<float>(STEPS);
+			float encoded = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+			result[i] = static_cast<uint8_t>(encoded * 255.0f + 0.5f);
+		}
+		return result;
+	}();
+	value = std::min(std::max(value, 0.0f), 1.0f);
+	return table[static_cast<int>(value * STEPS + 0.5f)];
+}
+
+void SoftwareRasterizer::resize(uint32_t width, uint32_t height) {
+	this->width = width;
+	this->height = height;
+	paddedWidth = (width + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+	paddedHeight = (height + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+	tilesX = (paddedWidth + TILE_SIZE - 1) / TILE_SIZE;
+	tilesY = (paddedHeight + TILE_SIZE - 1) / TILE_SIZE;
+	blocksX = paddedWidth / BLOCK_SIZE;
+
+	color.assign(static_cast<size_t>(paddedWidth) * paddedHeight * 4, 0);
+	depth.assign(static_cast<size_t>(paddedWidth) * paddedHeight, 1.0f);
+	blockMaxDepth.assign(static_cast<size_t>(blocksX) * (paddedHeight / BLOCK_SIZE), 1.0f);
+	tileStats.assign(static_cast<size_t>(tilesX) * tilesY, TileStats());
+}
+
+void SoftwareRasterizer::setMesh(SoftwareMesh mesh) {
+	this->mesh = std::move(mesh);
+	// A MESH WITHOUT TEXTURE COORDINATES READS THE FIRST TEXEL EVERYWHERE
+	this->mesh.texCoords.resize(this->mesh.positions.size(), glm::vec2(0.0f));
+}
+
+void SoftwareRasterizer::setTexture(const uint8_t* pixels, uint32_t width, uint32_t height) {
+	texture = pixels;
+	textureWidth = width;
+	textureHeight = height;
+}
+
+void SoftwareRasterizer::render(const SoftwareFrame& frame, JobSystem& jobs) {
+	PROFILE_FUNCTION();
+	transformVertices(frame, jobs);
+
+	size_t triangleCount = mesh.indices.size() / 3;
+	size_t binCount = (triangleCount + TRIANGLES_PER_BIN - 1) / TRIANGLES_PER_BIN;
+	bins.resize(binCount);
+	{
+		PROFILE_ZONE("software binning");
+		jobs.parallelFor(binCount, 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				size_t first = i * TRIANGLES_PER_BIN;
+				binTriangles(first, std::min(TRIANGLES_PER_BIN, triangleCount - first), bins[i]);
+			}
+		});
+	}
+
+	{
+		PROFILE_ZONE("software tiles");
+		jobs.parallelFor(tileStats.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t tile = begin; tile < end; tile++) {
+				rasterizeTile(static_cast<uint32_t>(tile), frame, tileStats[tile]);
+			}
+		});
+	}
+}
+
+SoftwareRasterStats SoftwareRasterizer::stats() const {
+	SoftwareRasterStats result;
+	for (const Bin& bin : bins) {
+		result.triangles += bin.triangleCount;
+		for (const auto& tile : bin.tiles) {
+			result.binned += tile.size();
+		}
+	}
+	for (const TileStats& tile : tileStats) {
+		result.blocks += tile.blocks;
+		result.blocksCovered += tile.blocksCovered;
+		result.blocksOccluded += tile.blocksOccluded;
+	}
+	return result;
+}
+
+void SoftwareRasterizer::transformVertices(const SoftwareFrame& frame, JobSystem& jobs) {
+	PROFILE_FUNCTION();
+	glm::mat4 modelViewProj = frame.proj * frame.view * frame.model;
+	transformed.resize(mesh.positions.size());
+
+	jobs.parallelFor(mesh.positions.size(), 16384, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			glm::vec4 position = glm::vec4(mesh.positions[i], 1.0f);
+			transformed[i].clip = modelViewProj * position;
+			transformed[i].world = glm::vec3(frame.model * position);
+			transformed[i].texCoord = mesh.texCoords[i];
+		}
+	});
+}
+
+void SoftwareRasterizer::binTriangles(size_t first, size_t count, Bin& bin) {
+	bin.triangles.clear();
+	bin.tiles.resize(tileStats.size());
+	for (auto& tile : bin.tiles) {
+		tile.clear();
+	}
+	bin.triangleCount = 0;
+
+	// INSIDE WHERE dot(plane, clip) >= 0: NEAR, THEN THE GUARD BAND
+	static const glm::vec4 planes[] = {
+		glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
+		glm::vec4(1.0f, 0.0f, 0.0f, GUARD_BAND),
+		glm::vec4(-1.0f, 0.0f, 0.0f, GUARD_BAND),
+		glm::vec4(0.0f, 1.0f, 0.0f, GUARD_BAND),
+		glm::vec4(0.0f, -1.0f, 0.0f, GUARD_BAND),
+	};
+	const size_t planeCount = sizeof(planes) / sizeof(planes[0]);
+
+	// A TRIANGLE CLIPPED BY EVERY PLANE HAS AT MOST 3 + planeCount CORNERS
+	ClipVertex polygon[2][3 + planeCount];
+
+	for (size_t t = first; t < first + count; t++) {
+		const ClipVertex* corners[3] = {
+			&transformed[mesh.indices[3 * t]],
+			&transformed[mesh.indices[3 * t + 1]],
+			&transformed[mesh.indices[3 * t + 2]],
+		};
+
+		// OUTSIDE ONE OF THE FRUSTUM PLANES WITH ALL THREE CORNERS, NOTHING TO DRAW
+		uint32_t outsideAll = 0x3F;
+		uint32_t needsClip = 0;
+		for (const ClipVertex* corner : corners) {
+			const glm::vec4& c = corner->clip;
+			uint32_t outside = (c.x < -c.w ? 1u : 0u) | (c.x > c.w ? 2u : 0u) | (c.y < -c.w ? 4u : 0u) |
+				(c.y > c.w ? 8u : 0u) | (c.z < 0.0f ? 16u : 0u) | (c.z > c.w ? 32u : 0u);
+			outsideAll &= outside;
+			for (size_t p = 0; p < planeCount; p++) {
+				if (glm::dot(planes[p], c) < 0.0f) needsClip |= 1u << p;
+			}
+		}
+		if (outsideAll) continue;
+
+		if (!needsClip) {
+			setupTriangle(*corners[0], *corners[1], *corners[2], bin);
+			continue;
+		}
+
+		// SUTHERLAND-HODGMAN, ONLY AGAINST THE PLANES SOME CORNER IS OUTSIDE OF
+		// ATTRIBUTES ARE LINEAR IN CLIP SPACE, SO NEW CORNERS ARE PLAIN LERPS
+		size_t size = 3;
+		for (size_t i = 0; i < 3; i++) polygon[0][i] = *corners[i];
+		int current = 0;
+		for (size_t p = 0; p < planeCount && size > 0; p++) {
+			if (!(needsClip & (1u << p))) continue;
+
+			const ClipVertex* in = polygon[current];
+			ClipVertex* out = polygon[1 - current];
+			size_t outSize = 0;
+			for (size_t i = 0; i < size; i++) {
+				const ClipVertex& a = in[i];
+				const ClipVertex& b = in[(i + 1) % size];
+				float da = glm::dot(planes[p], a.clip);
+				float db = glm::dot(planes[p], b.clip);
+				if (da >= 0.0f) out[outSize++] = a;
+				if ((da >= 0.0f) != (db >= 0.0f)) {
+					float s = da / (da - db);
+					ClipVertex& v = out[outSize++];
+					v.clip = a.clip + (b.clip - a.clip) * s;
+					v.world = a.world + (b.world - a.world) * s;
+					v.texCoord = a.texCoord + (b.texCoord - a.texCoord) * s;
+				}
+			}
+			size = outSize;
+			current = 1 - current;
+		}
+
+		// FAN, THE PIECES KEEP THE WINDING OF THE TRIANGLE
+		for (size_t i = 1; i + 1 < size; i++) {
+			setupTriangle(polygon[current][0], polygon[current][i], polygon[current][i + 1], bin);
+		}
+	}
+}
+
+void SoftwareRasterizer::setupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, Bin& bin) {
+	const ClipVertex* corners[3] = { &a, &b, &c };
+	Triangle triangle;
+	for (int i = 0; i < 3; i++) {
+		const glm::vec4& clip = corners[i]->clip;
+		if (clip.w <= 0.0f) return;
+
+		float inverseW = 1.0f / clip.w;
+		// SAME VIEWPORT AS THE PIPELINE, THE PROJECTION ALREADY FLIPPED Y
+		triangle.x[i] = std::round((clip.x * inverseW * 0.5f + 0.5f) * width * 16.0f) / 16.0f;
+		triangle.y[i] = std::round((clip.y * inverseW * 0.5f + 0.5f) * height * 16.0f) / 16.0f;
+		triangle.z[i] = clip.z * inverseW;
+		triangle.inverseW[i] = inverseW;
+		triangle.worldOverW[i] = corners[i]->world * inverseW;
+		triangle.texCoordOverW[i] = corners[i]->texCoord * inverseW;
+	}
+
+	// VULKAN CALLS A TRIANGLE COUNTER CLOCKWISE (FRONT FACING HERE) WHEN THIS IS NEGATIVE
+	float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+	if (area >= 0.0f) return;
+
+	// SWAP TWO CORNERS SO THE INSIDE IS WHERE THE EDGE FUNCTIONS ARE POSITIVE
+	std::swap(triangle.x[1], triangle.x[2]);
+	std::swap(triangle.y[1], triangle.y[2]);
+	std::swap(triangle.z[1], triangle.z[2]);
+	std::swap(triangle.inverseW[1], triangle.inverseW[2]);
+	std::swap(triangle.worldOverW[1], triangle.worldOverW[2]);
+	std::swap(triangle.texCoordOverW[1], triangle.texCoordOverW[2]);
+	area = -area;
+
+	// PIXELS WHOSE CENTER IS IN THE BOUNDING BOX
+	float minX = std::min(triangle.x[0], std::min(triangle.x[1], triangle.x[2]));
+	float maxX = std::max(triangle.x[0], std::max(triangle.x[1], triangle.x[2]));
+	float minY = std::min(triangle.y[0], std::min(triangle.y[1], triangle.y[2]));
+	float maxY = std::max(triangle.y[0], std::max(triangle.y[1], triangle.y[2]));
+	triangle.minX = std::max(0, static_cast<int>(std::ceil(minX - 0.5f)));
+	triangle.maxX = std::min(static_cast<int>(width) - 1, static_cast<int>(std::floor(maxX - 0.5f)));
+	triangle.minY = std::max(0, static_cast<int>(std::ceil(minY - 0.5f)));
+	triangle.maxY = std::min(static_cast<int>(height) - 1, static_cast<int>(std::floor(maxY - 0.5f)));
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) return;
+
+	for (int i = 0; i < 3; i++) {
+		int j = (i + 1) % 3;
+		triangle.edgeA[i] = triangle.y[i] - triangle.y[j];
+		triangle.edgeB[i] = triangle.x[j] - triangle.x[i];
+		// THE INSIDE IS TO THE RIGHT OF A LEFT EDGE AND BELOW A TOP EDGE
+		bool topLeft = triangle.edgeA[i] > 0.0f || (triangle.edgeA[i] == 0.0f && triangle.edgeB[i] > 0.0f);
+		triangle.edgeBias[i] = topLeft ? 0.0f : FLT_MIN;
+	}
+	triangle.inverseArea = 1.0f / area;
+	triangle.minZ = std::max(0.0f, std::min(triangle.z[0], std::min(triangle.z[1], triangle.z[2])));
+
+	glm::vec3 world0 = triangle.worldOverW[0] / triangle.inverseW[0];
+	glm::vec3 world1 = triangle.worldOverW[1] / triangle.inverseW[1];
+	glm::vec3 world2 = triangle.worldOverW[2] / triangle.inverseW[2];
+	triangle.normal = glm::cross(world1 - world0, world2 - world0);
+	float length = glm::length(triangle.normal);
+	triangle.normal = length > 0.0f ? triangle.normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+
+	uint32_t index = static_cast<uint32_t>(bin.triangles.size());
+	bin.triangles.push_back(triangle);
+	bin.triangleCount++;
+
+	// EVERY TILE THE BOUNDING BOX TOUCHES, UNLESS AN EDGE IS NEGATIVE AT ALL ITS CORNERS
+	int firstTileX = triangle.minX / static_cast<int>(TILE_SIZE);
+	int lastTileX = triangle.maxX / static_cast<int>(TILE_SIZE);
+	int firstTileY = triangle.minY / static_cast<int>(TILE_SIZE);
+	int lastTileY = triangle.maxY / static_cast<int>(TILE_SIZE);
+	bool singleTile = firstTileX == lastTileX && firstTileY == lastTileY;
+	for (int tileY = firstTileY; tileY <= lastTileY; tileY++) {
+		for (int tileX = firstTileX; tileX <= lastTileX; tileX++) {
+			if (!singleTile) {
+				float left = tileX * static_cast<float>(TILE_SIZE) + 0.5f;
+				float top = tileY * static_cast<float>(TILE_SIZE) + 0.5f;
+				float right = left + TILE_SIZE - 1;
+				float bottom = top + TILE_SIZE - 1;
+				bool missed = false;
+				for (int i = 0; i < 3 && !missed; i++) {
+					// THE CORNER WHERE THE EDGE FUNCTION IS LARGEST
+					float x = triangle.edgeA[i] > 0.0f ? right : left;
+					float y = triangle.edgeB[i] > 0.0f ? bottom : top;
+					float e = triangle.edgeA[i] * (x - triangle.x[i]) + triangle.edgeB[i] * (y - triangle.y[i]);
+					missed = e < triangle.edgeBias[i];
+				}
+				if (missed) continue;
+			}
+			bin.tiles[tileY * tilesX + tileX].push_back(index);
+		}
+	}
+}
+
+void SoftwareRasterizer::rasterizeTile(uint32_t tile, const SoftwareFrame& frame, TileStats& stats) {
+	stats = TileStats();
+	int tileLeft = static_cast<int>(tile % tilesX * TILE_SIZE);
+	int tileTop = static_cast<int>(tile / tilesX * TILE_SIZE);
+	int tileRight = std::min(tileLeft + static_cast<int>(TILE_SIZE), static_cast<int>(paddedWidth)) - 1;
+	int tileBottom = std::min(tileTop + static_cast<int>(TILE_SIZE), static_cast<int>(paddedHeight)) - 1;
+
+	// EVERY TILE CLEARS ITS OWN PIXELS, BLACK LIKE THE RENDER PASS
+	for (int y = tileTop; y <= tileBottom; y++) {
+		size_t row = static_cast<size_t>(y) * paddedWidth;
+		std::fill(depth.begin() + row + tileLeft, depth.begin() + row + tileRight + 1, 1.0f);
+		for (int x = tileLeft; x <= tileRight; x++) {
+			uint8_t* pixel = &color[(row + x) * 4];
+			pixel[0] = 0;
+			pixel[1] = 0;
+			pixel[2] = 0;
+			pixel[3] = 255;
+		}
+	}
+	for (int blockY = tileTop / static_cast<int>(BLOCK_SIZE); blockY <= tileBottom / static_cast<int>(BLOCK_SIZE); blockY++) {
+		for (int blockX = tileLeft / static_cast<int>(BLOCK_SIZE); blockX <= tileRight / static_cast<int>(BLOCK_SIZE); blockX++) {
+			blockMaxDepth[static_cast<size_t>(blockY) * blocksX + blockX] = 1.0f;
+		}
+	}
+
+	// THE BINS ARE IN SUBMISSION ORDER AND SO ARE THE TRIANGLES IN THEM
+	for (const Bin& bin : bins) {
+		for (uint32_t index : bin.tiles[tile]) {
+			const Triangle& triangle = bin.triangles[index];
+
+			int firstBlockX = std::max(triangle.minX, tileLeft) / static_cast<int>(BLOCK_SIZE);
+			int lastBlockX = std::min(triangle.maxX, tileRight) / static_cast<int>(BLOCK_SIZE);
+			int firstBlockY = std::max(triangle.minY, tileTop) / static_cast<int>(BLOCK_SIZE);
+			int lastBlockY = std::min(triangle.maxY, tileBottom) / static_cast<int>(BLOCK_SIZE);
+
+			for (int blockY = firstBlockY; blockY <= lastBlockY; blockY++) {
+				for (int blockX = firstBlockX; blockX <= lastBlockX; blockX++) {
+					stats.blocks++;
+
+					// PIXEL CENTERS AT THE CORNERS OF THE BLOCK
+					float left = blockX * static_cast<float>(BLOCK_SIZE) + 0.5f;
+					float top = blockY * static_cast<float>(BLOCK_SIZE) + 0.5f;
+					float right = left + BLOCK_SIZE - 1;
+					float bottom = top + BLOCK_SIZE - 1;
+
+					// THE EDGE FUNCTIONS ARE LINEAR, SO THEIR EXTREMES ARE AT THE CORNERS
+					bool missed = false;
+					bool covered = true;
+					float edgeMin[3];
+					for (int i = 0; i < 3; i++) {
+						float a = triangle.edgeA[i];
+						float b = triangle.edgeB[i];
+						float dx0 = left - triangle.x[i];
+						float dx1 = right - triangle.x[i];
+						float dy0 = top - triangle.y[i];
+						float dy1 = bottom - triangle.y[i];
+						float largest = std::max(a * dx0, a * dx1) + std::max(b * dy0, b * dy1);
+						float smallest = std::min(a * dx0, a * dx1) + std::min(b * dy0, b * dy1);
+						missed = missed || largest < triangle.edgeBias[i];
+						covered = covered && smallest >= triangle.edgeBias[i];
+						edgeMin[i] = smallest;
+					}
+					if (missed) continue;
+
+					// THE NEAREST THE TRIANGLE CAN BE IN THE BLOCK: THE DEPTH PLANE AT ITS
+					// SMALLEST, BUT NEVER NEARER THAN THE NEAREST CORNER OF THE TRIANGLE
+					float dz1 = (triangle.z[1] - triangle.z[0]) * triangle.inverseArea;
+					float dz2 = (triangle.z[2] - triangle.z[0]) * triangle.inverseArea;
+					float nearest = triangle.z[0];
+					// z = z0 + dz1 * E2 + dz2 * E0, TAKE EACH EDGE AT ITS MOST FAVOURABLE CORNER
+					nearest += dz1 >= 0.0f ? dz1 * std::max(edgeMin[2], 0.0f) : dz1 * (edgeMin[2] + (BLOCK_SIZE - 1) * (std::abs(triangle.edgeA[2]) + std::abs(triangle.edgeB[2])));
+					nearest += dz2 >= 0.0f ? dz2 * std::max(edgeMin[0], 0.0f) : dz2 * (edgeMin[0] + (BLOCK_SIZE - 1) * (std::abs(triangle.edgeA[0]) + std::abs(triangle.edgeB[0])));
+					nearest = std::max(nearest, triangle.minZ);
+
+					size_t block = static_cast<size_t>(blockY) * blocksX + blockX;
+					if (nearest >= blockMaxDepth[block]) {
+						stats.blocksOccluded++;
+						continue;
+					}
+					if (covered) {
+						stats.blocksCovered++;
+					}
+
+					if (rasterizeBlock(triangle, blockX, blockY, covered, frame)) {
+						// THE FARTHEST DEPTH LEFT IN THE BLOCK
+						simd::Float farthest = simd::set(0.0f);
+						for (uint32_t row = 0; row < BLOCK_SIZE; row++) {
+							const float* line = &depth[(static_cast<size_t>(blockY) * BLOCK_SIZE + row) * paddedWidth + blockX * BLOCK_SIZE];
+							for (uint32_t x = 0; x < BLOCK_SIZE; x += simd::WIDTH) {
+								farthest = simd::max(farthest, simd::load(line + x));
+							}
+						}
+						float lanes[simd::WIDTH];
+						simd::store(lanes, farthest);
+						blockMaxDepth[block] = *std::max_element(lanes, lanes + simd::WIDTH);
+					}
+				}
+			}
+		}
+	}
+}
+
+bool SoftwareRasterizer::rasterizeBlock(const Triangle& triangle, int blockX, int blockY, bool covered, const SoftwareFrame& frame) {
+	int left = blockX * static_cast<int>(BLOCK_SIZE);
+	int top = blockY * static_cast<int>(BLOCK_SIZE);
+
+	RasterBlock block;
+	block.left = left + 0.5f;
+	block.top = top + 0.5f;
+	for (int i = 0; i < 3; i++) {
+		block.x[i] = triangle.x[i];
+		block.y[i] = triangle.y[i];
+		block.edgeA[i] = triangle.edgeA[i];
+		block.edgeB[i] = triangle.edgeB[i];
+		block.edgeBias[i] = triangle.edgeBias[i];
+	}
+	block.z0 = triangle.z[0];
+	block.dz1 = (triangle.z[1] - triangle.z[0]) * triangle.inverseArea;
+	block.dz2 = (triangle.z[2] - triangle.z[0]) * triangle.inverseArea;
+	block.covered = covered;
+	block.depth = &depth[static_cast<size_t>(top) * paddedWidth + left];
+	block.stride = paddedWidth;
+
+	// EVERY PIXEL IS TESTED BEFORE ANY IS SHADED, FINE SINCE A PIXEL'S TEST ONLY READS ITS OWN DEPTH
+	RasterBlockResult result;
+	if (!kernels->testBlock(block, result)) {
+		return false;
+	}
+
+	bool wrote = false;
+	for (uint32_t row = 0; row < BLOCK_SIZE; row++) {
+		uint32_t bits = result.rows[row];
+		while (bits) {
+			uint32_t column = simd::lowestBit(bits);
+			bits &= bits - 1;
+			uint32_t pixel = row * BLOCK_SIZE + column;
+			float l1 = result.e2[pixel] * triangle.inverseArea;
+			float l2 = result.e0[pixel] * triangle.inverseArea;
+			wrote = shadePixel(triangle, left + static_cast<int>(column), top + static_cast<int>(row), l1, l2, result.z[pixel], frame) || wrote;
+		}
+	}
+	return wrote;
+}
+
+bool SoftwareRasterizer::shadePixel(const Triangle& triangle, int x, int y, float l1, float l2, float z, const SoftwareFrame& frame) {
+	// PERSPECTIVE CORRECT: EVERYTHING WAS DIVIDED BY w, SO DIVIDE BY THE INTERPOLATED 1 / w
+	float l0 = 1.0f - l1 - l2;
+	float w = 1.0f / (l0 * triangle.inverseW[0] + l1 * triangle.inverseW[1] + l2 * triangle.inverseW[2]);
+	glm::vec2 texCoord = (triangle.texCoordOverW[0] * l0 + triangle.texCoordOverW[1] * l1 + triangle.texCoordOverW[2] * l2) * w;
+
+	glm::vec4 albedo = sampleTexture(texCoord);
+	if (frame.alphaTest && albedo.a < 0.5f) {
+		return false;
+	}
+
+	size_t pixel = static_cast<size_t>(y) * paddedWidth + x;
+	depth[pixel] = z;
+
+	glm::vec3 world = (triangle.worldOverW[0] * l0 + triangle.worldOverW[1] * l1 + triangle.worldOverW[2] * l2) * w;
+	glm::vec3 normal = triangle.normal;
+	if (glm::dot(normal, frame.cameraPosition - world) < 0.0f) {
+		normal = -normal;
+	}
+
+	glm::vec3 lighting = AMBIENT;
+	if (frame.sunDirection.w > 0.0f) {
+		float sun = std::max(glm::dot(normal, -glm::vec3(frame.sunDirection)), 0.0f);
+		lighting += SUN_COLOR * frame.sunDirection.w * sun;
+	}
+	for (const SoftwareLight& light : frame.lights) {
+		glm::vec3 toLight = light.position - world;
+		float distanceSquared = glm::dot(toLight, toLight);
+		float radiusSquared = light.radius * light.radius;
+		if (distanceSquared >= radiusSquared) {
+			continue;
+		}
+		float falloff = 1.0f - distanceSquared / radiusSquared;
+		float diffuse = std::max(glm::dot(normal, toLight / std::sqrt(distanceSquared)), 0.0f);
+		lighting += light.color * diffuse * falloff * falloff;
+	}
+
+	glm::vec3 result = glm::vec3(albedo) * lighting;
+	uint8_t* out = &color[pixel * 4];
+	out[0] = linearToSrgb(result.r);
+	out[1] = linearToSrgb(result.g);
+	out[2] = linearToSrgb(result.b);
+	out[3] = 255;
+	return true;
+}
+
+glm::vec4 SoftwareRasterizer::sampleTexture(glm::vec2 texCoord) const {
+	if (!texture) {
+		return glm::vec4(1.0f);
+	}
+
+	// BILINEAR AND REPEATING LIKE textureSampler, IN LINEAR SPACE LIKE AN sRGB IMAGE
+	float u = texCoord.x * textureWidth - 0.5f;
+	float v = texCoord.y * textureHeight - 0.5f;
+	float floorU = std::floor(u);
+	float floorV = std::floor(v);
+	float fractionU = u - floorU;
+	float fractionV = v - floorV;
+
+	auto wrap = [](float coordinate, uint32_t size) {
+		int64_t index = static_cast<int64_t>(coordinate) % static_cast<int64_t>(size);
+		return static_cast<uint32_t>(index < 0 ? index + size : index);
+	};
+	uint32_t x0 = wrap(floorU, textureWidth);
+	uint32_t y0 = wrap(floorV, textureHeight);
+	uint32_t x1 = x0 + 1 == textureWidth ? 0 : x0 + 1;
+	uint32_t y1 = y0 + 1 == textureHeight ? 0 : y0 + 1;
+
+	auto texel = [&](uint32_t x, uint32_t y) {
+		const uint8_t* p = texture + (static_cast<size_t>(y) * textureWidth + x) * 4;
+		return glm::vec4(srgbToLinear(p[0]), srgbToLinear(p[1]), srgbToLinear(p[2]), p[3] / 255.0f);
+	};
+	glm::vec4 top = texel(x0, y0) * (1.0f - fractionU) + texel(x1, y0) * fractionU;
+	glm::vec4 bottom = texel(x0, y1) * (1.0f - fractionU) + texel(x1, y1) * fractionU;
+	return top * (1.0f - fractionV) + bottom * fractionV;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "RasterKernels.h"
+
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// CPU RENDERER FOR MACHINES WITHOUT A VULKAN DEVICE (SEE SoftwareRasterizer.cpp)
+// NO VULKAN HERE, SO THE BENCHMARKS PROJECT CAN RUN IT TOO
+
+// WHAT THE VERTEX BUFFER HOLDS, AS ARRAYS
+struct SoftwareMesh {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> texCoords;
+	std::vector<uint32_t> indices;
+};
+
+struct SoftwareLight {
+	glm::vec3 position;
+	float radius;
+	// COLOR TIMES INTENSITY
+	glm::vec3 color;
+};
+
+// EVERYTHING ONE IMAGE NEEDS, THE SAME MATRICES THE VERTEX SHADER GETS
+struct SoftwareFrame {
+	glm::mat4 model = glm::mat4(1.0f);
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 proj = glm::mat4(1.0f);
+	glm::vec3 cameraPosition = glm::vec3(0.0f);
+	// DIRECTION THE LIGHT TRAVELS, W IS THE INTENSITY (0 IS NO SUN)
+	glm::vec4 sunDirection = glm::vec4(0.0f);
+	std::vector<SoftwareLight> lights;
+	// TEXELS WITH ALPHA UNDER ONE HALF ARE NOT DRAWN
+	bool alphaTest = false;
+};
+
+struct SoftwareRasterStats {
+	// AFTER BACKFACE AND FRUSTUM REJECTION, CLIPPED ONES COUNT ONCE PER PIECE
+	uint64_t triangles = 0;
+	// TRIANGLE / TILE PAIRS
+	uint64_t binned = 0;
+	// 8x8 BLOCKS A TRIANGLE TOUCHED, AND HOW THEY WENT
+	uint64_t blocks = 0;
+	uint64_t blocksCovered = 0;
+	uint64_t blocksOccluded = 0;
+};
+
+// TILE BINNED RASTERIZER
+// THE VERTICES ARE TRANSFORMED IN PARALLEL, THEN CHUNKS OF TRIANGLES ARE CLIPPED, SET UP AND
+// SORTED INTO THE 64x64 TILES THEY TOUCH. EVERY TILE IS THEN ONE JOB THAT WALKS ITS TRIANGLES IN
+// SUBMISSION ORDER, SO NO TWO THREADS EVER WRITE THE SAME PIXEL AND THE IMAGE DOES NOT DEPEND ON
+// THE THREAD COUNT. INSIDE A TILE EVERY TRIANGLE IS WALKED IN 8x8 BLOCKS: THE EDGE FUNCTIONS AT THE
+// CORNERS THROW OUT BLOCKS IT MISSES AND SKIP THE PER PIXEL TEST FOR BLOCKS IT COVERS, AND A BLOCK
+// IS ONLY RASTERIZED IF THE TRIANGLE'S NEAREST DEPTH IN IT BEATS THE FARTHEST DEPTH STORED THERE
+// (THE HIERARCHICAL DEPTH BUFFER). EDGES AND DEPTH ARE EVALUATED BY THE RasterKernels, simd::WIDTH
+// PIXELS AT A TIME (A WHOLE BLOCK ROW WITH THE AVX2 ONES), THE PIXELS THAT PASS ARE SHADED ONE BY
+// ONE LIKE Fragment.frag: TEXTURE, FACE NORMAL, AMBIENT, SUN WITHOUT SHADOWS AND EVERY POINT LIGHT
+// (NO CLUSTERS)
+class SoftwareRasterizer {
+public:
+	static constexpr uint32_t TILE_SIZE = 64;
+	// MUST MATCH RasterBlockResult
+	static constexpr uint32_t BLOCK_SIZE = 8;
+
+	// THE FASTEST KERNELS THIS CPU CAN RUN, setKernels() SWAPS THEM (E.G. FOR THE SCALAR ONES)
+	SoftwareRasterizer() : kernels(&bestRasterKernels()) {}
+
+	void setKernels(const RasterKernels& newKernels) { kernels = &newKernels; }
+	const char* kernelName() const { return kernels->name; }
+
+	void resize(uint32_t width, uint32_t height);
+
+	// COPIED, THE NEXT render DRAWS IT
+	void setMesh(SoftwareMesh mesh);
+
+	// RGBA8 IN sRGB, NOT COPIED, HAS TO STAY ALIVE WHILE RENDERING
+	void setTexture(const uint8_t* pixels, uint32_t width, uint32_t height);
+
+	// CLEARS AND DRAWS THE MESH, THE WORK IS SPLIT OVER jobs
+	void render(const SoftwareFrame& frame, JobSystem& jobs);
+
+	// RGBA8 IN sRGB, ROWS ARE stride() BYTES APART
+	const uint8_t* pixels() const { return color.data(); }
+	size_t stride() const { return static_cast<size_t>(paddedWidth) * 4; }
+	uint32_t imageWidth() const { return width; }
+	uint32_t imageHeight() const { return height; }
+
+	// OF THE LAST render
+	SoftwareRasterStats stats() const;
+
+private:
+	struct ClipVertex {
+		glm::vec4 clip;
+		glm::vec3 world;
+		glm::vec2 texCoord;
+	};
+
+	// SCREEN SPACE, INSIDE IS WHERE ALL THREE EDGE FUNCTIONS ARE POSITIVE
+	struct Triangle {
+		// THE VERTICES IN PIXELS, SNAPPED TO 1/16
+		float x[3];
+		float y[3];
+		// EDGE i GOES FROM VERTEX i TO i + 1: E = a * (x - x[i]) + b * (y - y[i])
+		float edgeA[3];
+		float edgeB[3];
+		// 0 FOR TOP AND LEFT EDGES, THE SMALLEST FLOAT OTHERWISE, SO SHARED EDGES ARE DRAWN ONCE
+		float edgeBias[3];
+		float inverseArea;
+		// DEPTH AND 1 / w PER VERTEX, INTERPOLATED LINEARLY IN SCREEN SPACE
+		float z[3];
+		float inverseW[3];
+		float minZ;
+		// PERSPECTIVE CORRECT ATTRIBUTES, ALREADY DIVIDED BY w
+		glm::vec3 worldOverW[3];
+		glm::vec2 texCoordOverW[3];
+		glm::vec3 normal;
+		// PIXEL BOUNDS, INCLUSIVE
+		int minX, minY, maxX, maxY;
+	};
+
+	// ONE PER CHUNK OF TRIANGLES, FILLED BY ONE JOB
+	struct Bin {
+		std::vector<Triangle> triangles;
+		// PER TILE, INDICES INTO triangles
+		std::vector<std::vector<uint32_t>> tiles;
+		uint64_t triangleCount = 0;
+	};
+
+	struct TileStats {
+		uint64_t blocks = 0;
+		uint64_t blocksCovered = 0;
+		uint64_t blocksOccluded = 0;
+	};
+
+	void transformVertices(const SoftwareFrame& frame, JobSystem& jobs);
+	void binTriangles(size_t first, size_t count, Bin& bin);
+	void setupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, Bin& bin);
+	void rasterizeTile(uint32_t tile, const SoftwareFrame& frame, TileStats& stats);
+	// FALSE IF NO PIXEL PASSED
+	bool rasterizeBlock(const Triangle& triangle, int blockX, int blockY, bool covered, const SoftwareFrame& frame);
+	// FALSE IF THE ALPHA TEST THREW THE PIXEL OUT
+	bool shadePixel(const Triangle& triangle, int x, int y, float l1, float l2, float z, const SoftwareFrame& frame);
+	glm::vec4 sampleTexture(glm::vec2 texCoord) const;
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	// BOTH ROUNDED UP TO WHOLE BLOCKS SO THE KERNELS NEVER NEED A TAIL
+	uint32_t paddedWidth = 0;
+	uint32_t paddedHeight = 0;
+	uint32_t tilesX = 0;
+	uint32_t tilesY = 0;
+	uint32_t blocksX = 0;
+
+	std::vector<uint8_t> color;
+	std::vector<float> depth;
+	// FARTHEST DEPTH IN EVERY 8x8 BLOCK
+	std::vector<float> blockMaxDepth;
+
+	SoftwareMesh mesh;
+	std::vector<ClipVertex> transformed;
+
+	const uint8_t* texture = nullptr;
+	uint32_t textureWidth = 0;
+	uint32_t textureHeight = 0;
+
+	std::vector<Bin> bins;
+	std::vector<TileStats> tileStats;
+
+	const RasterKernels* kernels;
+};
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "VulkanRenderer.h"
+#include "StartupGraph.h"
+
+void VulkanRenderer::init() {
+	startupBegin = std::chrono::steady_clock::now();
+
+	StartupGraph graph;
+	auto stage = [&](const std::string& name, void (VulkanRenderer::*step)(), const std::vector<std::string>& dependsOn, JobAffinity affinity = JobAffinity::Any) {
+		graph.addStage(name, [this, step]() { (this->*step)(); }, dependsOn, affinity);
+	};
+
+	// GLFW WINDOW STUFF STAYS ON THE MAIN THREAD
+	stage("initWindow", &VulkanRenderer::initWindow, {}, JobAffinity::MainThread);
+
+	// PURE CPU WORK, NEEDS NOTHING FROM VULKAN SO IT STARTS RIGHT AWAY
+	stage("decodeTextureImage", &VulkanRenderer::decodeTextureImage, {});
+	stage("loadModel", &VulkanRenderer::loadModel, {});
+	// LIGHTS ARE PLACED AROUND THE MODEL
+	stage("createLights", &VulkanRenderer::createLights, { "loadModel" });
+	// EVERY WORLD OBJECT IS DRAWN WITH THE MODEL'S BOUNDS
+	stage("openWorld", &VulkanRenderer::openWorld, { "loadModel" });
+
+	stage("createInstance", &VulkanRenderer::createInstance, { "initWindow" });
+	stage("setupDebugMessenger", &VulkanRenderer::setupDebugMessenger, { "createInstance" });
+	// THE INSTANCE IS EXTERNALLY SYNCHRONIZED FOR THE MESSENGER, SO DO NOT OVERLAP THEM
+	stage("createSurface", &VulkanRenderer::createSurface, { "setupDebugMessenger" }, JobAffinity::MainThread);
+	stage("pickPhisicalDevice", &VulkanRenderer::pickPhisicalDevice, { "createSurface" });
+	stage("createLogicalDevice", &VulkanRenderer::createLogicalDevice, { "pickPhisicalDevice" });
+
+	stage("createSwapChain", &VulkanRenderer::createSwapChain, { "createLogicalDevice" });
+	stage("createImageViews", &VulkanRenderer::createImageViews, { "createSwapChain" });
+	stage("createRenderPass", &VulkanRenderer::createRenderPass, { "createSwapChain" });
+	stage("createDescriptorSetLayout", &VulkanRenderer::createDescriptorSetLayout, { "createLogicalDevice" });
+	// THE TEXTURE DECIDES WHETHER THE VARIANT NEEDS THE ALPHA TEST
+	stage("createGraphicsPipeline", &VulkanRenderer::createGraphicsPipeline, { "createRenderPass", "createDescriptorSetLayout", "loadModel", "decodeTextureImage" });
+	stage("createClusterPipeline", &VulkanRenderer::createClusterPipeline, { "createDescriptorSetLayout" });
+	stage("createOcclusionPipelines", &VulkanRenderer::createOcclusionPipelines, { "createDescriptorSetLayout" });
+	stage("createDepthPrepassRenderPass", &VulkanRenderer::createDepthPrepassRenderPass, { "createLogicalDevice" });
+	stage("createDepthPrepassPipeline", &VulkanRenderer::createDepthPrepassPipeline, { "createGraphicsPipeline", "createDepthPrepassRenderPass" });
+	stage("createShadowRenderPass", &VulkanRenderer::createShadowRenderPass, { "createLogicalDevice" });
+	// LIKE THE DEPTH PREPASS, A CUTOUT TEXTURE GIVES IT THE ALPHA TEST
+	stage("createShadowPipeline", &VulkanRenderer::createShadowPipeline, { "createShadowRenderPass", "createDescriptorSetLayout", "loadModel", "decodeTextureImage" });
+	stage("createParticlePipelines", &VulkanRenderer::createParticlePipelines, { "createLogicalDevice" });
+	stage("createParticleRenderPipeline", &VulkanRenderer::createParticleRenderPipeline, { "createRenderPass", "createDescriptorSetLayout" });
+	// THE SWAPCHAIN DECIDES WHICH VERSION OF THE FUSED PASS
+	stage("createPostPipelines", &VulkanRenderer::createPostPipelines, { "createSwapChain" });
+	stage("createCommandPool", &VulkanRenderer::createCommandPool, { "createLogicalDevice" });
+	stage("createDepthResources", &VulkanRenderer::createDepthResources, { "createSwapChain" });
+	stage("createRenderTarget", &VulkanRenderer::createRenderTarget, { "createSwapChain" });
+	stage("createFramebuffers", &VulkanRenderer::createFramebuffers, { "createImageViews", "createRenderPass", "createDepthResources", "createRenderTarget" });
+	stage("createDepthPrepassFramebuffer", &VulkanRenderer::createDepthPrepassFramebuffer, { "createDepthResources", "createDepthPrepassRenderPass" });
+
+	// UPLOADS GO THROUGH transferCommandPool, A POOL IS NOT THREAD SAFE SO THEY ARE CHAINED
+	stage("createTextureImage", &VulkanRenderer::createTextureImage, { "decodeTextureImage", "createCommandPool" });
+	stage("createTextureSampler", &VulkanRenderer::createTextureSampler, { "createLogicalDevice" });
+	stage("createVertexBuffer", &VulkanRenderer::createVertexBuffer, { "loadModel", "createTextureImage" });
+	stage("createIndexBuffer", &VulkanRenderer::createIndexBuffer, { "createVertexBuffer" });
+	// THESE SUBMIT ONE TIME COMMANDS FROM commandPool, A SECOND CHAIN NEXT TO THE UPLOADS
+	// (THE QUEUES ARE LOCKED BY queueMutex, SO A SHARED FAMILY ONLY TAKES TURNS)
+	stage("createHiZResources", &VulkanRenderer::createHiZResources, { "createCommandPool", "createDepthResources", "createOcclusionPipelines" });
+	stage("createOcclusionBuffer", &VulkanRenderer::createOcclusionBuffer, { "createHiZResources" });
+	stage("createShadowResources", &VulkanRenderer::createShadowResources, { "createOcclusionBuffer", "createShadowRenderPass" });
+	// FROM particleCommandPool ON computeQueue
+	stage("createParticleResources", &VulkanRenderer::createParticleResources, { "createLogicalDevice" });
+
+	stage("createUniformBuffers", &VulkanRenderer::createUniformBuffers, { "createSwapChain" });
+	stage("createClusterBuffers", &VulkanRenderer::createClusterBuffers, { "createSwapChain", "createLights" });
+	stage("createDrawBuffers", &VulkanRenderer::createDrawBuffers, { "createSwapChain" });
+	stage("createShadowBuffers", &VulkanRenderer::createShadowBuffers, { "createSwapChain" });
+	// ALSO RECORDS THE COMPUTE COMMAND BUFFERS
+	stage("createParticleBuffers", &VulkanRenderer::createParticleBuffers, { "createSwapChain", "createParticleResources", "createParticlePipelines" });
+	stage("createTimestampQueries", &VulkanRenderer::createTimestampQueries, { "createSwapChain" });
+	stage("createBatchResources", &VulkanRenderer::createBatchResources, { "createSwapChain" });
+	stage("createPostResources", &VulkanRenderer::createPostResources, { "createImageViews", "createRenderTarget", "createPostPipelines" });
+	stage("createDescriptorPool", &VulkanRenderer::createDescriptorPool, { "createSwapChain" });
+	stage("createDescriptorSets", &VulkanRenderer::createDescriptorSets, { "createDescriptorPool", "createDescriptorSetLayout", "createUniformBuffers", "createClusterBuffers", "createDrawBuffers", "createShadowBuffers", "createOcclusionBuffer", "createShadowResources", "createTextureImage", "createTextureSampler" });
+	// ALSO ALLOCATES FROM commandPool, THE SHADOW RESOURCES ARE ITS LAST ONE TIME SUBMIT
+	stage("createCommandBuffers", &VulkanRenderer::createCommandBuffers, { "createIndexBuffer", "createFramebuffers", "createGraphicsPipeline", "createClusterPipeline", "createOcclusionPipelines", "createDepthPrepassPipeline", "createDepthPrepassFramebuffer", "createShadowPipeline", "createShadowResources", "createParticleResources", "createParticleRenderPipeline", "createParticleBuffers", "createDescriptorSets", "createTimestampQueries", "createBatchResources", "createPostResources" });
+	stage("createSyncObjects", &VulkanRenderer::createSyncObjects, { "createSwapChain" });
+
+	if (serialStartup) {
+		graph.runSerial();
+	}
+	else {
+		graph.run(jobSystem);
+	}
+
+	graph.printTimeline(std::cout);
+}
@@ -0,0 +1,121 @@
+#include "StartupGraph.h"
+
+#include <iomanip>
+#include <stdexcept>
+
+void StartupGraph::addStage(const std::string& name, std::function<void()> function, const std::vector<std::string>& dependsOn, JobAffinity affinity) {
+	auto stage = std::make_unique<Stage>();
+	stage->name = name;
+	stage->profileName = profiler::intern(name);
+	stage->function = std::move(function);
+	stage->affinity = affinity;
+
+	for (const auto& dependency : dependsOn) {
+		size_t found = stages.size();
+		for (size_t i = 0; i < stages.size(); i++) {
+			if (stages[i]->name == dependency) {
+				found = i;
+				break;
+			}
+		}
+		// ONLY EARLIER STAGES CAN BE REFERENCED, SO THE GRAPH CAN NOT HAVE CYCLES
+		if (found == stages.size()) {
+			throw std::runtime_error("startup stage '" + name + "' depends on unknown stage '" + dependency + "'");
+		}
+		stage->dependencies.push_back(found);
+		stages[found]->dependents.push_back(stages.size());
+	}
+
+	stages.push_back(std::move(stage));
+}
+
+void StartupGraph::execute(size_t index) {
+	Stage& stage = *stages[index];
+	stage.thread = JobSystem::currentWorkerIndex();
+	stage.begin = Clock::now();
+	{
+		PROFILE_ZONE(stage.profileName);
+		stage.function();
+	}
+	stage.end = Clock::now();
+	stage.ran = true;
+}
+
+void StartupGraph::launch(JobSystem& jobs, size_t index, JobCounter& allStages) {
+	jobs.run([this, &jobs, &allStages, index]() {
+		execute(index);
+
+		// START EVERY DEPENDENT WHOSE LAST DEPENDENCY WAS US
+		// THIS HAPPENS BEFORE OUR OWN JOB FINISHES SO allStages
+		// CAN NOT HIT ZERO WHILE THERE IS STILL WORK TO START
+		for (size_t dependent : stages[index]->dependents) {
+			if (stages[dependent]->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				launch(jobs, dependent, allStages);
+			}
+		}
+	}, &allStages, nullptr, stages[index]->affinity);
+}
+
+void StartupGraph::run(JobSystem& jobs) {
+	graphBegin = Clock::now();
+
+	for (auto& stage : stages) {
+		stage->remaining.store(static_cast<int>(stage->dependencies.size()));
+		stage->ran = false;
+	}
+
+	JobCounter allStages;
+	for (size_t i = 0; i < stages.size(); i++) {
+		if (stages[i]->dependencies.empty()) {
+			launch(jobs, i, allStages);
+		}
+	}
+	// THE MAIN THREAD RUNS ITS OWN STAGES (AND HELPS WITH OTHERS) WHILE WAITING
+	jobs.wait(allStages);
+
+	graphEnd = Clock::now();
+
+	for (const auto& stage : stages) {
+		if (!stage->ran) {
+			throw std::runtime_error("startup stage '" + stage->name + "' never ran");
+		}
+	}
+}
+
+void StartupGraph::runSerial() {
+	graphBegin = Clock::now();
+	for (size_t i = 0; i < stages.size(); i++) {
+		execute(i);
+	}
+	graphEnd = Clock::now();
+}
+
+void StartupGraph::printTimeline(std::ostream& out) const {
+	auto toMs = [this](Clock::time_point time) {
+		return std::chrono::duration<double, std::milli>(time - graphBegin).count();
+	};
+
+	double total = toMs(graphEnd);
+	const int barWidth = 40;
+
+	out << "startup timeline (" << std::fixed << std::setprecision(2) << total << " ms total)\n";
+	for (const auto& stage : stages) {
+		double begin = toMs(stage->begin);
+		double end = toMs(stage->end);
+
+		int barBegin = total > 0.0 ? static_cast<int>(begin / total * barWidth) : 0;
+		int barEnd = total > 0.0 ? static_cast<int>(end / total * barWidth) : 0;
+		if (barEnd == barBegin) barEnd++;
+		if (barEnd > barWidth) barEnd = barWidth;
+
+		std::string bar(barWidth, ' ');
+		for (int i = barBegin; i < barEnd; i++) bar[i] = '#';
+
+		std::string thread = stage->thread < 0 ? "main" : "worker " + std::to_string(stage->thread);
+
+		out << "  " << std::left << std::setw(26) << stage->name
+			<< std::setw(10) << thread << std::right
+			<< std::setw(9) << begin << " -> " << std::setw(9) << end
+			<< " (" << std::setw(8) << end - begin << " ms) |" << bar << "|\n";
+	}
+}
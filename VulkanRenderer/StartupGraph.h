@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "JobSystem.h"
+#include "Profiler.h"
+
+// INITIALIZATION EXPRESSED AS A DEPENDENCY GRAPH
+// EVERY STAGE STARTS AS SOON AS ALL OF ITS DEPENDENCIES ARE DONE,
+// SO CPU WORK (DECODING, PARSING) OVERLAPS VULKAN OBJECT CREATION
+class StartupGraph {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// DEPENDENCIES ARE REFERENCED BY NAME AND MUST BE ADDED BEFORE THE STAGE
+	void addStage(const std::string& name, std::function<void()> function, const std::vector<std::string>& dependsOn = {}, JobAffinity affinity = JobAffinity::Any);
+
+	// RUNS EVERYTHING ON THE JOB SYSTEM, CALL FROM THE MAIN THREAD
+	// THROWS THE FIRST EXCEPTION A STAGE THREW
+	void run(JobSystem& jobs);
+
+	// RUNS THE STAGES ONE AFTER THE OTHER IN THE ORDER THEY WERE ADDED
+	void runSerial();
+
+	void printTimeline(std::ostream& out) const;
+
+private:
+	struct Stage {
+		std::string name;
+		// SAME AS name, BUT OUTLIVES THE GRAPH FOR THE PROFILER
+		const char* profileName = nullptr;
+		std::function<void()> function;
+		JobAffinity affinity;
+		std::vector<size_t> dependencies;
+		std::vector<size_t> dependents;
+		std::atomic<int> remaining{ 0 };
+		Clock::time_point begin;
+		Clock::time_point end;
+		int thread = -1;
+		bool ran = false;
+	};
+
+	void launch(JobSystem& jobs, size_t index, JobCounter& allStages);
+	void execute(size_t index);
+
+	std::vector<std::unique_ptr<Stage>> stages;
+	Clock::time_point graphBegin;
+	Clock::time_point graphEnd;
+};
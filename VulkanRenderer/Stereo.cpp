@@ -0,0 +1,66 @@
+#include "VulkanRenderer.h"
+
+// SINGLE PASS STEREO
+// WITH --stereo THE MAIN RENDER PASS HAS A VIEW MASK (VK_KHR_multiview, CORE IN 1.1)
+// AND ITS COLOR AND DEPTH ATTACHMENTS ARE 2 LAYER ARRAYS, ONE LAYER PER EYE.
+// EVERY DRAW IS RECORDED AND SUBMITTED ONCE, THE DRIVER RUNS THE VERTEX SHADER
+// FOR BOTH EYES AND vert_multiview.spv PICKS THE EYE'S MATRICES WITH gl_ViewIndex.
+// THE LAYERS ARE BLITTED SIDE BY SIDE INTO THE SWAPCHAIN IMAGE (SEE recordUpscale),
+// SO EACH EYE IS HALF THE WINDOW WIDE (viewExtent)
+// CULLING AND THE LIGHT CLUSTERS USE ONE CAMERA THAT SEES EVERYTHING BOTH EYES SEE,
+// THE DEPTH PREPASS IS OFF BECAUSE ONE EYE'S HI-Z DOES NOT OCCLUDE FOR THE OTHER
+
+bool VulkanRenderer::checkMultiviewSupport() {
+	if (physicalDevice.getProperties().apiVersion < VK_API_VERSION_1_1) {
+		std::cout << "stereo: the device is older than Vulkan 1.1\n";
+		return false;
+	}
+
+	auto features = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceMultiviewFeatures>();
+	if (!features.get<vk::PhysicalDeviceMultiviewFeatures>().multiview) {
+		std::cout << "stereo: the device has no multiview\n";
+		return false;
+	}
+
+	auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceMultiviewProperties>();
+	if (properties.get<vk::PhysicalDeviceMultiviewProperties>().maxMultiviewViewCount < MAX_VIEWS) {
+		std::cout << "stereo: the device can not render " << MAX_VIEWS << " views at once\n";
+		return false;
+	}
+
+	return true;
+}
+
+void VulkanRenderer::updateViews(const FrameSnapshot& snapshot, UniformBufferObject& ubo, float& cullNear, float& cullFar) {
+	// WITHOUT STEREO BOTH VIEWS ARE THE CAMERA, ONLY THE FIRST IS USED
+	for (uint32_t view = 0; view < MAX_VIEWS; view++) {
+		ubo.views[view] = ubo.view;
+		ubo.projections[view] = ubo.proj;
+	}
+	cullNear = nearPlane;
+	cullFar = farPlane;
+
+	if (!stereo) return;
+
+	// PARALLEL EYES HALF THE SEPARATION LEFT AND RIGHT OF THE CAMERA, SAME PROJECTION
+	glm::vec3 front = glm::normalize(snapshot.cameraFront);
+	glm::vec3 right = glm::normalize(glm::cross(front, snapshot.cameraUp));
+	float halfSeparation = eyeSeparation * 0.5f;
+	for (uint32_t view = 0; view < MAX_VIEWS; view++) {
+		glm::vec3 eye = snapshot.cameraPos + right * (view == 0 ? -halfSeparation : halfSeparation);
+		ubo.views[view] = glm::lookAt(eye, eye + front, snapshot.cameraUp);
+	}
+
+	// THE CULLING CAMERA HAS THE SAME ANGLES, PULLED BACK UNTIL ITS LEFT AND RIGHT
+	// PLANES ARE THE LEFT PLANE OF THE LEFT EYE AND THE RIGHT PLANE OF THE RIGHT EYE.
+	// NEAR AND FAR MOVE BACK WITH IT, SO ITS FRUSTUM HOLDS BOTH EYES' FRUSTUMS
+	float tanX = std::tan(glm::radians(snapshot.fov) * 0.5f) * viewExtent.width / (float)viewExtent.height;
+	float back = halfSeparation / tanX;
+	glm::vec3 apex = snapshot.cameraPos - front * back;
+	cullNear = nearPlane + back;
+	cullFar = farPlane + back;
+
+	ubo.view = glm::lookAt(apex, apex + front, snapshot.cameraUp);
+	ubo.proj = glm::perspective(glm::radians(snapshot.fov), viewExtent.width / (float)viewExtent.height, cullNear, cullFar);
+	ubo.proj[1][1] *= -1;
+}
@@ -21,21 +21,39 @@ vk::SurfaceFormatKHR VulkanRenderer::chooseSwapSurfaceFormat(const std::vector<v
 
 vk::PresentModeKHR VulkanRenderer::chooseSwapPresentMode(const std::vector<vk::PresentModeKHR> &availablePresentModes) {
     for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode ==vk::PresentModeKHR::eMailbox ) {
+        if (availablePresentMode == preferredPresentMode) {
             return availablePresentMode;
         }
     }
 
+    // FIFO IS THE ONLY MODE THE SPEC GUARANTEES
+    std::cout << "present mode " << vk::to_string(preferredPresentMode) << " not supported, using FIFO\n";
     return vk::PresentModeKHR::eFifo;
 }
 
+uint32_t VulkanRenderer::chooseSwapImageCount(const vk::SurfaceCapabilitiesKHR& capabilities) {
+    auto imageCount = requestedSwapChainImageCount > 0 ? requestedSwapChainImageCount : capabilities.minImageCount + 1;
+
+    if (imageCount < capabilities.minImageCount) {
+        imageCount = capabilities.minImageCount;
+    }
+
+    // MAX 0 MEANS NO LIMIT
+    if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount) {
+        imageCount = capabilities.maxImageCount;
+    }
+
+    return imageCount;
+}
+
 vk::Extent2D VulkanRenderer::chooseSwapExtent(const vk::SurfaceCapabilitiesKHR &capabilities) {
     if (capabilities.currentExtent.width != UINT32_MAX) {
         return capabilities.currentExtent;
     }
     else {
-        int width, height;
-        glfwGetFramebufferSize(window, &width, &height);
+        // GLFW CAN ONLY BE ASKED FROM THE MAIN THREAD SO USE WHAT IT PUBLISHED
+        int width = framebufferWidth.load(std::memory_order_relaxed);
+        int height = framebufferHeight.load(std::memory_order_relaxed);
 
         vk::Extent2D actualExtent = {
             static_cast<uint32_t>(width),
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// LOCK FREE SINGLE PRODUCER / SINGLE CONSUMER TRIPLE BUFFER
+// THE WRITER FILLS ITS OWN SLOT AND PUBLISHES IT BY SWAPPING IT
+// WITH THE SHARED "MIDDLE" SLOT, THE READER TAKES THE MIDDLE SLOT
+// ONLY IF SOMETHING NEW WAS PUBLISHED. NOBODY EVER WAITS.
+template<typename T>
+class TripleBuffer {
+public:
+	TripleBuffer() = default;
+
+	explicit TripleBuffer(const T& initial) {
+		slots[0] = initial;
+		slots[1] = initial;
+		slots[2] = initial;
+	}
+
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+	// ----- WRITER SIDE -----
+
+	T& writeBuffer() {
+		return slots[writeIndex];
+	}
+
+	void publish() {
+		// HAND OUR SLOT TO THE MIDDLE AND TAKE WHATEVER WAS THERE
+		writeIndex = middle.exchange(static_cast<uint8_t>(writeIndex | DIRTY_BIT), std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	void publish(const T& value) {
+		writeBuffer() = value;
+		publish();
+	}
+
+	// ----- READER SIDE -----
+
+	// RETURNS TRUE IF A NEWER VALUE WAS PICKED UP
+	bool consume() {
+		if ((middle.load(std::memory_order_relaxed) & DIRTY_BIT) == 0) {
+			return false;
+		}
+		// THE EXCHANGE ALSO CLEARS THE DIRTY BIT
+		readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+		return true;
+	}
+
+	const T& read() const {
+		return slots[readIndex];
+	}
+
+private:
+	static constexpr uint8_t INDEX_MASK = 0x3;
+	static constexpr uint8_t DIRTY_BIT = 0x4;
+
+	// KEEP THE SLOTS ON DIFFERENT CACHE LINES SO THE
+	// TWO THREADS DO NOT FIGHT OVER THEM
+	struct alignas(64) Slot {
+		T value;
+	};
+
+	struct Slots {
+		Slot data[3];
+		T& operator[](uint8_t i) { return data[i].value; }
+		const T& operator[](uint8_t i) const { return data[i].value; }
+	} slots;
+
+	alignas(64) std::atomic<uint8_t> middle{ 1 };
+	alignas(64) uint8_t writeIndex = 0;
+	alignas(64) uint8_t readIndex = 2;
+};
@@ -1,12 +1,138 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    mat4 inverseProj;
+    vec4 cameraPosition;
+    uvec4 clusterGrid;
+    vec4 clusterScreen;
+    vec4 clusterDepth;
+    uvec4 cullInfo;
+    vec4 renderScale;
+    mat4 shadowMatrices[4];
+    vec4 shadowSplits;
+    vec4 sunDirection;
+    uvec4 shadowInfo;
+} ubo;
+
+struct PointLight {
+    vec4 positionRadius;
+    vec4 colorIntensity;
+};
+
+layout(binding = 1) uniform sampler2D texSampler;
+
+layout(std430, binding = 2) readonly buffer LightBuffer {
+    PointLight lights[];
+};
+
+// OFFSET AND COUNT INTO lightIndices FOR EVERY CLUSTER
+layout(std430, binding = 3) readonly buffer ClusterBuffer {
+    uvec2 clusters[];
+};
+
+layout(std430, binding = 4) readonly buffer LightIndexBuffer {
+    uint lightIndexCount;
+    uint lightIndexOverflow;
+    uint lightIndices[];
+};
+
+// ONE LAYER PER CASCADE
+layout(binding = 10) uniform sampler2DArrayShadow shadowMap;
+
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
-layout(binding = 1) uniform sampler2D texSampler;
+layout(location = 2) in vec3 fragWorldPos;
+layout(location = 3) in float fragViewDepth;
 
 layout(location = 0) out vec4 outColor;
 
+// FEATURES OF THIS VARIANT (ShaderVariants.h), SET WHEN THE PIPELINE IS BUILT
+// ONE THAT IS OFF IS A CONSTANT false AND EVERYTHING BEHIND IT IS COMPILED OUT
+layout(constant_id = 0) const bool SUN = true;
+layout(constant_id = 1) const bool SHADOWS = true;
+layout(constant_id = 2) const bool POINT_LIGHTS = true;
+layout(constant_id = 3) const bool ALPHA_TEST = false;
+
+const vec3 AMBIENT = vec3(0.1);
+const vec3 SUN_COLOR = vec3(1.0, 0.95, 0.85);
+
+uint clusterIndex() {
+    // THE CLUSTERS BELONG TO ubo.view / ubo.proj, WHICH IS NOT THE EYE THAT DRAWS
+    // US IN STEREO, SO THE TILE AND DEPTH COME FROM PROJECTING THE WORLD POSITION
+    vec4 viewPos = ubo.view * vec4(fragWorldPos, 1.0);
+    vec4 clip = ubo.proj * viewPos;
+    vec2 pixel = (clip.xy / clip.w * 0.5 + 0.5) * ubo.clusterScreen.xy;
+    uvec3 grid = ubo.clusterGrid.xyz;
+    uvec2 tile = min(uvec2(max(pixel / ubo.clusterScreen.zw, vec2(0.0))), grid.xy - 1);
+    // SLICES ARE EXPONENTIAL IN VIEW DEPTH, SAME FORMULA AS cluster.comp
+    float slice = log(max(-viewPos.z, 1e-4)) * ubo.clusterDepth.z - ubo.clusterDepth.w;
+    uint z = min(uint(max(slice, 0.0)), grid.z - 1);
+    return tile.x + grid.x * (tile.y + grid.y * z);
+}
+
+// 1 LIT, 0 IN SHADOW
+float sunShadow() {
+    uint cascade = 0;
+    while (cascade < ubo.shadowInfo.x && fragViewDepth > ubo.shadowSplits[cascade]) {
+        cascade++;
+    }
+    // PAST THE LAST CASCADE
+    if (cascade == ubo.shadowInfo.x) {
+        return 1.0;
+    }
+
+    vec4 shadowPos = ubo.shadowMatrices[cascade] * vec4(fragWorldPos, 1.0);
+    vec2 uv = shadowPos.xy * 0.5 + 0.5;
+    // FOUR TAPS HALF A TEXEL AWAY, EACH ONE ALREADY FILTERED BY THE COMPARE SAMPLER
+    float texel = 1.0 / float(ubo.shadowInfo.y);
+    float lit = 0.0;
+    for (int x = -1; x <= 1; x += 2) {
+        for (int y = -1; y <= 1; y += 2) {
+            lit += texture(shadowMap, vec4(uv + vec2(x, y) * 0.5 * texel, float(cascade), shadowPos.z));
+        }
+    }
+    return lit * 0.25;
+}
+
 void main() {
-    outColor = texture(texSampler, fragTexCoord);
+    vec4 albedo = texture(texSampler, fragTexCoord);
+    if (ALPHA_TEST && albedo.a < 0.5) {
+        discard;
+    }
+
+    // NO NORMALS IN THE VERTEX FORMAT, TAKE THE FACE NORMAL AND TURN IT TO THE CAMERA
+    vec3 normal = normalize(cross(dFdx(fragWorldPos), dFdy(fragWorldPos)));
+    if (dot(normal, ubo.cameraPosition.xyz - fragWorldPos) < 0.0) {
+        normal = -normal;
+    }
+
+    vec3 lighting = AMBIENT;
+    if (SUN && ubo.sunDirection.w > 0.0) {
+        float sun = max(dot(normal, -ubo.sunDirection.xyz), 0.0);
+        if (sun > 0.0) {
+            lighting += SUN_COLOR * ubo.sunDirection.w * sun * (SHADOWS ? sunShadow() : 1.0);
+        }
+    }
+
+    // ONLY THE LIGHTS THE COMPUTE PASS FOUND FOR OUR CLUSTER
+    uvec2 cluster = POINT_LIGHTS ? clusters[clusterIndex()] : uvec2(0);
+    for (uint i = 0; i < cluster.y; i++) {
+        PointLight light = lights[lightIndices[cluster.x + i]];
+        vec3 toLight = light.positionRadius.xyz - fragWorldPos;
+        float distanceSquared = dot(toLight, toLight);
+        float radius = light.positionRadius.w;
+        if (distanceSquared >= radius * radius) {
+            continue;
+        }
+        // SMOOTH WINDOW SO THE LIGHT REACHES EXACTLY ZERO AT ITS RADIUS
+        float falloff = 1.0 - distanceSquared / (radius * radius);
+        float diffuse = max(dot(normal, toLight * inversesqrt(distanceSquared)), 0.0);
+        lighting += light.colorIntensity.rgb * light.colorIntensity.a * diffuse * falloff * falloff;
+    }
+
+    outColor = vec4(albedo.rgb * lighting, albedo.a);
 }
\ No newline at end of file
@@ -1,23 +1,94 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// COMPILED A SECOND TIME WITH -DMULTIVIEW INTO vert_multiview.spv FOR --stereo
+// AND WITH -DDEPTH_ONLY INTO vert_depth.spv FOR THE DEPTH PREPASS, WHICH ONLY BINDS THE POSITIONS
+// (-DDEPTH_ONLY -DALPHA_TEST INTO vert_depth_alpha.spv ALSO PASSES THE TEXCOORD ON TO cutout.frag)
+#ifdef MULTIVIEW
+#extension GL_EXT_multiview : require
+#define VIEW_INDEX gl_ViewIndex
+#else
+#define VIEW_INDEX 0
+#endif
+
 layout(binding = 0) uniform UniformBufferObject {
     mat4 model;
     mat4 view;
     mat4 proj;
+    mat4 inverseProj;
+    vec4 cameraPosition;
+    uvec4 clusterGrid;
+    vec4 clusterScreen;
+    vec4 clusterDepth;
+    uvec4 cullInfo;
+    vec4 renderScale;
+    mat4 shadowMatrices[4];
+    vec4 shadowSplits;
+    vec4 sunDirection;
+    uvec4 shadowInfo;
+    // ONE PER EYE, BOTH ARE view / proj WITHOUT STEREO
+    mat4 views[2];
+    mat4 projections[2];
 } ubo;
 
+struct DrawObject {
+    mat4 model;
+    vec4 center;
+    vec4 extent;
+    uvec4 info;
+};
+
+// EVERYTHING THAT SURVIVED FRUSTUM CULLING THIS FRAME
+layout(std430, binding = 6) readonly buffer ObjectBuffer {
+    DrawObject objects[];
+};
+
+// TWO INDIRECT COMMANDS (5 UINTS EACH) FOLLOWED BY THE INSTANCE LISTS
+// THE OCCLUSION PASS WROTE, EVERY INSTANCE IS AN INDEX INTO objects
+layout(std430, binding = 7) readonly buffer DrawBuffer {
+    uint commands[10];
+    uint drawInstances[];
+};
+
+layout(push_constant) uniform DrawConstants {
+    // WHERE THE INSTANCE LIST OF THIS DRAW STARTS
+    uint instanceOffset;
+} draw;
+
 #extension GL_ARB_separate_shader_objects : enable
 
 layout(location = 0) in vec3 inPosition;
+#if defined(DEPTH_ONLY) && defined(ALPHA_TEST)
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec2 fragTexCoord;
+#endif
+#ifndef DEPTH_ONLY
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 fragWorldPos;
+layout(location = 3) out float fragViewDepth;
+#endif
+
+// THE MAIN PASS TESTS LESS OR EQUAL AGAINST THE PREPASS DEPTH, BOTH VARIANTS MUST GIVE THE SAME BITS
+invariant gl_Position;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    mat4 model = objects[drawInstances[draw.instanceOffset + gl_InstanceIndex]].model;
+    vec4 worldPos = model * vec4(inPosition, 1.0);
+    vec4 viewPos = ubo.views[VIEW_INDEX] * worldPos;
+    gl_Position = ubo.projections[VIEW_INDEX] * viewPos;
+#if defined(DEPTH_ONLY) && defined(ALPHA_TEST)
+    fragTexCoord = inTexCoord;
+#endif
+#ifndef DEPTH_ONLY
     fragColor = inColor;
     fragTexCoord = inTexCoord;
+    // THE FRAGMENT SHADER NEEDS THESE TO FIND ITS CLUSTER AND LIGHT ITSELF
+    fragWorldPos = worldPos.xyz;
+    fragViewDepth = -viewPos.z;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// THE DEPTH PREPASS AND THE SHADOW CASCADES OF A TEXTURE WITH CUT OUT TEXELS
+// DROPS THEM LIKE Fragment.frag DOES WITH ALPHA_TEST, SO THEY WRITE NO DEPTH
+// (NOR HIDE WHAT IS BEHIND THEM FROM THE HI-Z PYRAMID OR THE SUN)
+
+layout(binding = 1) uniform sampler2D texSampler;
+
+layout(location = 0) in vec2 fragTexCoord;
+
+void main() {
+    if (texture(texSampler, fragTexCoord).a < 0.5) {
+        discard;
+    }
+}
\ No newline at end of file
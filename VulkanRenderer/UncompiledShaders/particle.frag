@@ -0,0 +1,17 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// ROUND SOFT SPRITE, ADDED ON TOP OF THE SCENE
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec2 fragCorner;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    float falloff = 1.0 - dot(fragCorner, fragCorner);
+    if (falloff <= 0.0) {
+        discard;
+    }
+    outColor = vec4(fragColor.rgb * fragColor.a * falloff * 0.5, 0.0);
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// GPU PARTICLE BILLBOARDS (Particles.cpp), ONE INSTANCE PER LIVE PARTICLE
+// COMPILED A SECOND TIME WITH -DMULTIVIEW INTO particle_multiview.spv FOR --stereo
+#ifdef MULTIVIEW
+#extension GL_EXT_multiview : require
+#define VIEW_INDEX gl_ViewIndex
+#else
+#define VIEW_INDEX 0
+#endif
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    mat4 inverseProj;
+    vec4 cameraPosition;
+    uvec4 clusterGrid;
+    vec4 clusterScreen;
+    vec4 clusterDepth;
+    uvec4 cullInfo;
+    vec4 renderScale;
+    mat4 shadowMatrices[4];
+    vec4 shadowSplits;
+    vec4 sunDirection;
+    uvec4 shadowInfo;
+    mat4 views[2];
+    mat4 projections[2];
+} ubo;
+
+// PER INSTANCE, WRITTEN BY particle_compact.comp
+layout(location = 0) in vec4 inPositionSize;
+layout(location = 1) in vec4 inColor;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragCorner;
+
+void main() {
+    // A 4 VERTEX STRIP, THE CORNER COMES FROM THE VERTEX INDEX
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1) * 2.0 - 1.0;
+
+    // SPREAD IN VIEW SPACE SO THE QUAD ALWAYS FACES THE EYE
+    vec4 viewPos = ubo.views[VIEW_INDEX] * vec4(inPositionSize.xyz, 1.0);
+    viewPos.xy += corner * inPositionSize.w;
+    gl_Position = ubo.projections[VIEW_INDEX] * viewPos;
+
+    fragColor = inColor;
+    fragCorner = corner;
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// DEPTH ONLY, ONE CASCADE OF THE SUN SHADOW MAP PER DRAW
+// COMPILED A SECOND TIME WITH -DALPHA_TEST INTO shadow_alpha.spv, WHICH PASSES
+// THE TEXCOORD ON SO cutout.frag CAN LET THE LIGHT THROUGH THE HOLES
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    mat4 inverseProj;
+    vec4 cameraPosition;
+    uvec4 clusterGrid;
+    vec4 clusterScreen;
+    vec4 clusterDepth;
+    uvec4 cullInfo;
+    vec4 renderScale;
+    mat4 shadowMatrices[4];
+} ubo;
+
+// MUST MATCH VulkanRenderer.h
+const uint MAX_DRAW_OBJECTS = 4096;
+
+// MODEL MATRICES OF THE CASTERS, MAX_DRAW_OBJECTS PER CASCADE
+layout(std430, binding = 9) readonly buffer ShadowObjectBuffer {
+    mat4 shadowModels[];
+};
+
+layout(push_constant) uniform ShadowConstants {
+    uint cascade;
+} shadow;
+
+layout(location = 0) in vec3 inPosition;
+#ifdef ALPHA_TEST
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec2 fragTexCoord;
+#endif
+
+void main() {
+    mat4 model = shadowModels[shadow.cascade * MAX_DRAW_OBJECTS + gl_InstanceIndex];
+    gl_Position = ubo.shadowMatrices[shadow.cascade] * model * vec4(inPosition, 1.0);
+#ifdef ALPHA_TEST
+    fragTexCoord = inTexCoord;
+#endif
+}
\ No newline at end of file
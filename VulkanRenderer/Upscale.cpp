@@ -0,0 +1,195 @@
+#include "VulkanRenderer.h"
+
+// DYNAMIC RESOLUTION
+// WITH --dynamic-resolution THE MAIN PASS DRAWS INTO sceneColorImage INSTEAD OF
+// THE SWAPCHAIN. EVERYTHING (COLOR, DEPTH, HI-Z) IS SIZED FOR THE FULL SWAPCHAIN
+// EXTENT, THE SCENE ONLY COVERS THE TOP LEFT renderExtent OF IT AND IS BLITTED
+// UP TO THE SWAPCHAIN IMAGE AT THE END OF THE FRAME. CHANGING THE SCALE ONLY
+// CHANGES THE VIEWPORT, SO NOTHING IS REALLOCATED, THE COMMAND BUFFER OF THE
+// IMAGE IS JUST RECORDED AGAIN. THE SCALE COMES FROM ResolutionController,
+// FED WITH GPU TIMESTAMPS TAKEN AT THE START AND END OF EVERY COMMAND BUFFER
+// STEREO (Stereo.cpp) USES THE SAME TARGET WITH ONE LAYER PER EYE AND THE SAME BLIT
+// WITH --post (PostProcess.cpp) THE TARGET IS HDR AND THE FUSED POST PASS REPLACES THE BLIT
+
+bool VulkanRenderer::checkBlitSupport(const vk::SurfaceCapabilitiesKHR& capabilities, vk::Format format) {
+	// THE SWAPCHAIN HAS TO ACCEPT A BLIT
+	if (!(capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst)) {
+		std::cout << "the swapchain can not be a transfer destination\n";
+		return false;
+	}
+
+	vk::FormatProperties properties = physicalDevice.getFormatProperties(format);
+	vk::FormatFeatureFlags needed = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+	if ((properties.optimalTilingFeatures & needed) != needed) {
+		std::cout << vk::to_string(format) << " can not be blitted with a linear filter\n";
+		return false;
+	}
+
+	return true;
+}
+
+bool VulkanRenderer::checkDynamicResolutionSupport(const vk::SurfaceCapabilitiesKHR& capabilities, vk::Format format) {
+	if (!checkBlitSupport(capabilities, format)) {
+		return false;
+	}
+
+	// NO TIMESTAMPS, NO GPU TIME TO DRIVE THE SCALE
+	auto indices = findQueueFamilies(physicalDevice);
+	auto families = physicalDevice.getQueueFamilyProperties();
+	if (families[indices.graphicsFamily.value()].timestampValidBits == 0) {
+		std::cout << "dynamic resolution: the graphics queue has no timestamps\n";
+		return false;
+	}
+
+	return true;
+}
+
+vk::Extent2D VulkanRenderer::scaledExtent(float scale) const {
+	vk::Extent2D extent;
+	extent.width = std::max(static_cast<uint32_t>(std::lround(viewExtent.width * scale)), 1u);
+	extent.height = std::max(static_cast<uint32_t>(std::lround(viewExtent.height * scale)), 1u);
+	extent.width = std::min(extent.width, viewExtent.width);
+	extent.height = std::min(extent.height, viewExtent.height);
+	return extent;
+}
+
+void VulkanRenderer::createRenderTarget() {
+	// WITHOUT DYNAMIC RESOLUTION THE SCALE STAYS AT 1 AND THIS IS THE VIEW EXTENT
+	renderExtent = scaledExtent(resolutionController.scale());
+
+	if (!offscreenTarget()) return;
+
+	// SIZED FOR THE LARGEST SCALE, THE SCALE NEVER GOES ABOVE 1
+	// POST PROCESSING SAMPLES IT AS AN ARRAY, ONE LAYER OR TWO
+	vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
+	if (postProcess) {
+		usage |= vk::ImageUsageFlagBits::eSampled;
+	}
+	createImage(viewExtent.width, viewExtent.height, sceneColorFormat(), vk::ImageTiling::eOptimal, usage, vk::MemoryPropertyFlagBits::eDeviceLocal, sceneColorImage, sceneColorImageMemory, 1, viewCount());
+	sceneColorImageView = createImageView(sceneColorImage, sceneColorFormat(), vk::ImageAspectFlagBits::eColor, 0, 1, stereo || postProcess ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D, 0, viewCount());
+}
+
+void VulkanRenderer::destroyRenderTarget() {
+	if (!offscreenTarget()) return;
+
+	device->destroyImageView(sceneColorImageView);
+	device->destroyImage(sceneColorImage);
+	freeMemory(sceneColorImageMemory);
+}
+
+void VulkanRenderer::createTimestampQueries() {
+	recordedRenderExtents.assign(swapChainImages.size(), vk::Extent2D());
+
+	if (!dynamicResolution) return;
+
+	// TWO PER SWAPCHAIN IMAGE, START AND END OF ITS COMMAND BUFFER
+	vk::QueryPoolCreateInfo poolInfo;
+	poolInfo.queryType = vk::QueryType::eTimestamp;
+	poolInfo.queryCount = static_cast<uint32_t>(2 * swapChainImages.size());
+
+	try {
+		timestampQueryPool = device->createQueryPool(poolInfo);
+	}
+	catch (vk::SystemError err) {
+		throw std::runtime_error("failed to create timestamp Query Pool!");
+	}
+
+	timestampPeriod = physicalDevice.getProperties().limits.timestampPeriod;
+
+	auto indices = findQueueFamilies(physicalDevice);
+	uint32_t validBits = physicalDevice.getQueueFamilyProperties()[indices.graphicsFamily.value()].timestampValidBits;
+	timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	timestampsWritten.assign(swapChainImages.size(), false);
+}
+
+void VulkanRenderer::destroyTimestampQueries() {
+	if (!dynamicResolution) return;
+
+	device->destroyQueryPool(timestampQueryPool);
+	timestampsWritten.clear();
+}
+
+void VulkanRenderer::recordUpscale(vk::CommandBuffer commandBuffer, size_t image) {
+	// THE RENDER PASS LEFT sceneColorImage IN TRANSFER SRC, WAIT FOR ITS WRITES
+	vk::ImageMemoryBarrier sceneBarrier;
+	sceneBarrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+	sceneBarrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+	sceneBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	sceneBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	sceneBarrier.image = sceneColorImage;
+	sceneBarrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, viewCount());
+	sceneBarrier.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+	sceneBarrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer,
+		{},
+		0, nullptr,
+		0, nullptr,
+		1, &sceneBarrier);
+
+	// THE SWAPCHAIN IMAGE IS OVERWRITTEN COMPLETELY, ITS OLD CONTENT DOES NOT MATTER
+	// THE ACQUIRE SEMAPHORE IS WAITED ON AT THE TRANSFER STAGE (SEE drawFrame)
+	vk::ImageMemoryBarrier barrier;
+	barrier.oldLayout = vk::ImageLayout::eUndefined;
+	barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = swapChainImages[image];
+	barrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+	barrier.srcAccessMask = {};
+	barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
+		{},
+		0, nullptr,
+		0, nullptr,
+		1, &barrier);
+
+	// ONE REGION PER VIEW, SIDE BY SIDE, LEFT EYE ON THE LEFT
+	std::array<vk::ImageBlit, MAX_VIEWS> regions;
+	int32_t width = static_cast<int32_t>(swapChainExtent.width);
+	int32_t views = static_cast<int32_t>(viewCount());
+	for (int32_t view = 0; view < views; view++) {
+		vk::ImageBlit& region = regions[view];
+		region.srcSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, view, 1);
+		region.srcOffsets[0] = vk::Offset3D(0, 0, 0);
+		region.srcOffsets[1] = vk::Offset3D(static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1);
+		region.dstSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+		region.dstOffsets[0] = vk::Offset3D(width * view / views, 0, 0);
+		region.dstOffsets[1] = vk::Offset3D(width * (view + 1) / views, static_cast<int32_t>(swapChainExtent.height), 1);
+	}
+
+	commandBuffer.blitImage(sceneColorImage, vk::ImageLayout::eTransferSrcOptimal, swapChainImages[image], vk::ImageLayout::eTransferDstOptimal, viewCount(), regions.data(), vk::Filter::eLinear);
+
+	barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+	barrier.newLayout = vk::ImageLayout::ePresentSrcKHR;
+	barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	barrier.dstAccessMask = {};
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+		{},
+		0, nullptr,
+		0, nullptr,
+		1, &barrier);
+}
+
+void VulkanRenderer::updateRenderScale(uint32_t currentImage) {
+	PROFILE_FUNCTION();
+	if (dynamicResolution && timestampsWritten[currentImage]) {
+		// THE FENCE OF THIS IMAGE WAS ALREADY WAITED ON, SO THE RESULTS ARE THERE
+		uint64_t timestamps[2];
+		vk::Result result = device->getQueryPoolResults(timestampQueryPool, 2 * currentImage, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+
+		if (result == vk::Result::eSuccess) {
+			uint64_t ticks = (timestamps[1] - timestamps[0]) & timestampMask;
+			float gpuMilliseconds = static_cast<float>(ticks * static_cast<double>(timestampPeriod) / 1e6);
+			renderExtent = scaledExtent(resolutionController.update(gpuMilliseconds));
+		}
+	}
+
+	// RECORDED FOR ANOTHER SIZE, THE IMAGE IS IDLE SO IT CAN BE RECORDED AGAIN
+	if (recordedRenderExtents[currentImage] != renderExtent) {
+		recordCommandBuffer(currentImage);
+	}
+}
@@ -1,9 +1,6 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
-
 #include "VulkanRenderer.h"
 #include <filesystem>
 
@@ -12,10 +9,19 @@ void VulkanRenderer::initWindow() {
 
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API); // Not using OpenGL
     glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE); // No resize
+    // BATCH RENDERING NEVER PRESENTS, THE WINDOW IS ONLY THERE FOR THE SURFACE
+    if (batchMode()) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
 
     window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
     glfwSetWindowUserPointer(window, this);
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    framebufferWidth.store(width);
+    framebufferHeight.store(height);
     //glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
 }
 
@@ -74,6 +80,9 @@ void VulkanRenderer::createInstance() {
     try {
         instance = vk::createInstanceUnique(createInfo, nullptr);
     }
+    catch (vk::IncompatibleDriverError err) {
+        throw NoVulkanDeviceError("failed to create instance, no Vulkan driver!");
+    }
     catch (vk::SystemError err) {
         throw std::runtime_error("failed to create instance!");
     }
@@ -121,20 +130,42 @@ void VulkanRenderer::pickPhisicalDevice() {
     auto devices = instance->enumeratePhysicalDevices();
 
     if (devices.size() == 0) {
-        throw std::runtime_error("failed to find GPUs with Vulkan support!");
+        throw NoVulkanDeviceError("failed to find GPUs with Vulkan support!");
     }
 
-    // SEE WHAT DEVICE TO USE
+    // SEE WHAT DEVICE TO USE, THE BEST SCORE OR THE FIRST ONE --gpu= NAMES
+    uint64_t bestScore = 0;
     for (const auto& device : devices) {
-        if (isDeviceSuitable(device)) {
+        auto properties = device.getProperties();
+        if (!isDeviceSuitable(device)) {
+            std::cout << "gpu: " << properties.deviceName << " is not suitable\n";
+            continue;
+        }
+
+        uint64_t score = scorePhysicalDevice(device);
+        std::cout << "gpu: " << properties.deviceName << " (" << vk::to_string(properties.deviceType) << ") score " << score << "\n";
+
+        if (!gpuOverride.empty()) {
+            if (!physicalDevice && matchesGpuOverride(device)) {
+                physicalDevice = device;
+            }
+        }
+        else if (!physicalDevice || score > bestScore) {
             physicalDevice = device;
-            break;
+            bestScore = score;
         }
     }
 
     if (physicalDevice == VK_NULL_HANDLE) {
-        throw std::runtime_error("failed to find a suitable GPU!");
+        if (!gpuOverride.empty()) {
+            throw std::runtime_error("failed to find a suitable GPU matching '" + gpuOverride + "'!");
+        }
+        throw NoVulkanDeviceError("failed to find a suitable GPU!");
     }
+
+    QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+    std::cout << "gpu: using " << physicalDevice.getProperties().deviceName << ", queue families graphics " << indices.graphicsFamily.value()
+        << " compute " << indices.computeFamily.value() << " transfer " << indices.transferFamily.value() << "\n";
 }
 
 void VulkanRenderer::createLogicalDevice() {
@@ -145,7 +176,7 @@ void VulkanRenderer::createLogicalDevice() {
 
     // STRUCTURE FOR QUEUES
     std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value(), indices.computeFamily.value() };
+    std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value(), indices.computeFamily.value(), indices.transferFamily.value() };
 
     // FOR NOW ALL PRIORITES ARE EQUAL
     // FOR FUTURE MAKE DIFFERENT PRIORITIES
@@ -162,6 +193,10 @@ void VulkanRenderer::createLogicalDevice() {
     // STRUCT FOR DEVICE FEATURES
     vk::PhysicalDeviceFeatures deviceFeatures;
     deviceFeatures.samplerAnisotropy = VK_TRUE; 
+    // LETS THE POST PROCESSING WRITE THE SWAPCHAIN IMAGE, WHATEVER ITS FORMAT (SEE choosePostOutputFormat)
+    if (postProcess) {
+        deviceFeatures.shaderStorageImageWriteWithoutFormat = physicalDevice.getFeatures().shaderStorageImageWriteWithoutFormat;
+    }
 
     // STRUCT FOR DEVICE INFO
     vk::DeviceCreateInfo createInfo;
@@ -170,8 +205,26 @@ void VulkanRenderer::createLogicalDevice() {
 
     createInfo.pEnabledFeatures = &deviceFeatures;
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    // SINGLE PASS STEREO NEEDS MULTIVIEW, WITHOUT IT WE DRAW ONE VIEW
+    if (stereo && !checkMultiviewSupport()) {
+        std::cout << "stereo turned off\n";
+        stereo = false;
+    }
+    vk::PhysicalDeviceMultiviewFeatures multiviewFeatures;
+    multiviewFeatures.multiview = VK_TRUE;
+    if (stereo) {
+        createInfo.pNext = &multiviewFeatures;
+    }
+
+    // OPTIONAL EXTENSIONS ARE ONLY TURNED ON WHEN THE DEVICE HAS THEM
+    std::vector<const char*> enabledExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    bool memoryBudget = isDeviceExtensionAvailable(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (memoryBudget) {
+        enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
     if (enableValidationLayers) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -190,6 +243,13 @@ void VulkanRenderer::createLogicalDevice() {
     graphicsQueue = device->getQueue( indices.graphicsFamily.value(), 0);
     presentQueue = device->getQueue(indices.presentFamily.value(), 0);
     computeQueue = device->getQueue(indices.computeFamily.value(), 0);
+    transferQueue = device->getQueue(indices.transferFamily.value(), 0);
+    queueFamilies = indices;
+
+    memoryTracker.init(physicalDevice, memoryBudget);
+    shaderVariants.init(*device, physicalDevice.getProperties(), shaderCachePath);
+    memoryPool.init(*device, &memoryTracker, memoryBlockSize);
+    resourceCache.init([this](const GpuResource& resource) { destroyGpuResource(resource); }, resourceBudget);
 }
 
 void VulkanRenderer::createSwapChain() {
@@ -202,12 +262,7 @@ void VulkanRenderer::createSwapChain() {
     auto extent = chooseSwapExtent(swapChainSupport.capabilities);
 
     // SET THE IMAGE COUNT FOR BAKBF
-    auto imageCount = swapChainSupport.capabilities.minImageCount + 1;
-
-    if (swapChainSupport.capabilities.maxImageCount > 0 
-        && imageCount > swapChainSupport.capabilities.maxImageCount) {
-        imageCount = swapChainSupport.capabilities.maxImageCount;
-    }
+    auto imageCount = chooseSwapImageCount(swapChainSupport.capabilities);
 
     // STRUCT FOR THE SWAP CHAIN
     vk::SwapchainCreateInfoKHR createInfo;
@@ -221,6 +276,31 @@ void VulkanRenderer::createSwapChain() {
     createInfo.imageArrayLayers = 1;
     createInfo.imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
 
+    // WITH DYNAMIC RESOLUTION OR STEREO THE SCENE IS BLITTED INTO THE SWAPCHAIN IMAGE
+    if (dynamicResolution && !checkDynamicResolutionSupport(swapChainSupport.capabilities, surfaceFormat.format)) {
+        std::cout << "dynamic resolution turned off\n";
+        dynamicResolution = false;
+    }
+    if (stereo && !checkBlitSupport(swapChainSupport.capabilities, surfaceFormat.format)) {
+        std::cout << "stereo turned off\n";
+        stereo = false;
+    }
+    // THE POST PROCESSING WRITES THE SWAPCHAIN IMAGE ITSELF IF IT CAN BE A STORAGE IMAGE,
+    // OTHERWISE IT WRITES AN IMAGE OF ITS OWN AND THAT IS BLITTED
+    postDirectOutput = postProcess && choosePostOutputFormat(swapChainSupport, surfaceFormat);
+    if (postProcess && !postDirectOutput && !checkBlitSupport(swapChainSupport.capabilities, surfaceFormat.format)) {
+        std::cout << "post processing turned off\n";
+        postProcess = false;
+    }
+    createInfo.imageFormat = surfaceFormat.format;
+    createInfo.imageColorSpace = surfaceFormat.colorSpace;
+    if (postDirectOutput) {
+        createInfo.imageUsage |= vk::ImageUsageFlagBits::eStorage;
+    }
+    else if (offscreenTarget()) {
+        createInfo.imageUsage |= vk::ImageUsageFlagBits::eTransferDst;
+    }
+
     auto indices = findQueueFamilies(physicalDevice);
     uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
 
@@ -261,6 +341,9 @@ void VulkanRenderer::createSwapChain() {
 
     swapChainImageFormat = surfaceFormat.format;
     swapChainExtent = extent;
+    // IN STEREO THE EYES SHARE THE WINDOW SIDE BY SIDE
+    viewExtent = vk::Extent2D(std::max(extent.width / viewCount(), 1u), extent.height);
+    activePresentMode = presentMode;
 }
 
 void VulkanRenderer::createImageViews() {
@@ -288,10 +371,15 @@ void VulkanRenderer::createRenderPass() {
     depthAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
     depthAttachment.initialLayout = vk::ImageLayout::eUndefined;
     depthAttachment.finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+    // THE DEPTH PREPASS ALREADY FILLED IT (AND THE HI-Z BUILD READ IT)
+    if (depthPrepass) {
+        depthAttachment.loadOp = vk::AttachmentLoadOp::eLoad;
+        depthAttachment.initialLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    }
 
     // DESCRIBE COLOR ATTACHMENT
     vk::AttachmentDescription colorAttachment;
-    colorAttachment.format = swapChainImageFormat;
+    colorAttachment.format = sceneColorFormat();
     colorAttachment.samples = vk::SampleCountFlagBits::e1;
     colorAttachment.loadOp = vk::AttachmentLoadOp::eClear;
     colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
@@ -299,6 +387,14 @@ void VulkanRenderer::createRenderPass() {
     colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
     colorAttachment.initialLayout = vk::ImageLayout::eUndefined;
     colorAttachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+    // DRAWN INTO THE OFFSCREEN TARGET, WHICH IS THEN BLITTED TO THE SWAPCHAIN
+    if (offscreenTarget()) {
+        colorAttachment.finalLayout = vk::ImageLayout::eTransferSrcOptimal;
+    }
+    // OR SAMPLED BY THE POST PROCESSING
+    if (postProcess) {
+        colorAttachment.finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    }
 
     // DESCRIBE A REFERENCE TO THE COLORATTACHMENT 
     // JUST SPECIFY THE INDEX OF THE ATTACHMENT
@@ -327,9 +423,26 @@ void VulkanRenderer::createRenderPass() {
     // WHAT TO WAIT ON UNTIL I START BASICALLY
     // WHAT STAGES OF THE PIPELINE WILL THE SUBPASS BEFORE PRODUCE DATA FOR
     dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests;
+    if (depthPrepass) {
+        dependency.srcStageMask |= vk::PipelineStageFlagBits::eComputeShader;
+    }
+    // THE LAST FRAME'S BLIT MAY STILL BE READING THE OFFSCREEN TARGET
+    if (offscreenTarget()) {
+        dependency.srcStageMask |= vk::PipelineStageFlagBits::eTransfer;
+    }
+    // OR THE LAST FRAME'S POST PROCESSING
+    if (postProcess) {
+        dependency.srcStageMask |= vk::PipelineStageFlagBits::eComputeShader;
+    }
     // WHAT THIS SUBPASS WILL DO, MODIFY ..
     dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests;
     dependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite;
+    // THE LOADED DEPTH IS TESTED AGAINST (AND WRITTEN), SO THE LAYOUT CHANGE OUT OF
+    // THE HI-Z READ HAS TO FINISH BEFORE EITHER FRAGMENT TEST STAGE TOUCHES IT
+    if (depthPrepass) {
+        dependency.dstStageMask |= vk::PipelineStageFlagBits::eLateFragmentTests;
+        dependency.dstAccessMask |= vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    }
 
     // DESCRIBE ACTUAL RENDER PASS
     // USE THESE INDEXES OF THE ATTACHMENTS
@@ -343,6 +456,18 @@ void VulkanRenderer::createRenderPass() {
     renderPassInfo.dependencyCount = 1;
     renderPassInfo.pDependencies = &dependency;
 
+    // STEREO: THE SUBPASS RUNS FOR EVERY VIEW IN THE MASK, ONE ATTACHMENT LAYER EACH
+    // THE EYES SEE NEARLY THE SAME THING, THE CORRELATION MASK LETS THE DRIVER USE THAT
+    uint32_t viewMask = (1u << viewCount()) - 1;
+    vk::RenderPassMultiviewCreateInfo multiviewInfo;
+    multiviewInfo.subpassCount = 1;
+    multiviewInfo.pViewMasks = &viewMask;
+    multiviewInfo.correlationMaskCount = 1;
+    multiviewInfo.pCorrelationMasks = &viewMask;
+    if (stereo) {
+        renderPassInfo.pNext = &multiviewInfo;
+    }
+
     try {
         renderPass = device->createRenderPass(renderPassInfo);
     }
@@ -360,7 +485,8 @@ void VulkanRenderer::createDescriptorSetLayout() {
     uboLayoutBinding.binding = 0;
     uboLayoutBinding.descriptorType = vk::DescriptorType::eUniformBuffer;
     uboLayoutBinding.descriptorCount = 1;
-    uboLayoutBinding.stageFlags = vk::ShaderStageFlagBits::eVertex;
+    // THE LIGHTING ALSO NEEDS THE MATRICES AND THE CLUSTER GRID
+    uboLayoutBinding.stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute;
     uboLayoutBinding.pImmutableSamplers = nullptr; // Optional
 
     // MAKE ANOTHER LAYOUT BINDING FOR THE IMAGES
@@ -371,11 +497,60 @@ void VulkanRenderer::createDescriptorSetLayout() {
     samplerLayoutBinding.pImmutableSamplers = nullptr;
     samplerLayoutBinding.stageFlags = vk::ShaderStageFlagBits::eFragment;
 
+    // LIGHTS, PER CLUSTER (OFFSET, COUNT) AND THE LIGHT INDEX LIST
+    // WRITTEN BY cluster.comp, READ BY THE FRAGMENT SHADER
+    std::array<vk::DescriptorSetLayoutBinding, 3> storageLayoutBindings;
+    for (uint32_t i = 0; i < storageLayoutBindings.size(); i++) {
+        storageLayoutBindings[i].binding = 2 + i;
+        storageLayoutBindings[i].descriptorCount = 1;
+        storageLayoutBindings[i].descriptorType = vk::DescriptorType::eStorageBuffer;
+        storageLayoutBindings[i].pImmutableSamplers = nullptr;
+        storageLayoutBindings[i].stageFlags = vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute;
+    }
+
+    // OCCLUSION CULLING: HI-Z PYRAMID, OBJECTS, INDIRECT COMMANDS + INSTANCE LISTS
+    // AND THE PER OBJECT OCCLUDED FLAGS
+    std::array<vk::DescriptorSetLayoutBinding, 4> occlusionLayoutBindings;
+    occlusionLayoutBindings[0].binding = 5;
+    occlusionLayoutBindings[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+    occlusionLayoutBindings[0].stageFlags = vk::ShaderStageFlagBits::eCompute;
+    occlusionLayoutBindings[1].binding = 6;
+    occlusionLayoutBindings[1].descriptorType = vk::DescriptorType::eStorageBuffer;
+    occlusionLayoutBindings[1].stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eCompute;
+    occlusionLayoutBindings[2].binding = 7;
+    occlusionLayoutBindings[2].descriptorType = vk::DescriptorType::eStorageBuffer;
+    occlusionLayoutBindings[2].stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eCompute;
+    occlusionLayoutBindings[3].binding = 8;
+    occlusionLayoutBindings[3].descriptorType = vk::DescriptorType::eStorageBuffer;
+    occlusionLayoutBindings[3].stageFlags = vk::ShaderStageFlagBits::eCompute;
+    for (auto& binding : occlusionLayoutBindings) {
+        binding.descriptorCount = 1;
+        binding.pImmutableSamplers = nullptr;
+    }
+
+    // SHADOWS: PER CASCADE CASTER MATRICES AND THE CASCADE ARRAY
+    std::array<vk::DescriptorSetLayoutBinding, 2> shadowLayoutBindings;
+    shadowLayoutBindings[0].binding = 9;
+    shadowLayoutBindings[0].descriptorType = vk::DescriptorType::eStorageBuffer;
+    shadowLayoutBindings[0].stageFlags = vk::ShaderStageFlagBits::eVertex;
+    shadowLayoutBindings[1].binding = 10;
+    shadowLayoutBindings[1].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+    shadowLayoutBindings[1].stageFlags = vk::ShaderStageFlagBits::eFragment;
+    for (auto& binding : shadowLayoutBindings) {
+        binding.descriptorCount = 1;
+        binding.pImmutableSamplers = nullptr;
+    }
+
     // HERE IS THE ACTUAL LAYOUT 
     // (BINDINGS CONTAIN SETS)
     // (LAYOUTS CONTAIN BINDINGS)
     vk::DescriptorSetLayoutCreateInfo layoutInfo;
-    std::array<vk::DescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
+    std::array<vk::DescriptorSetLayoutBinding, 11> bindings = {
+        uboLayoutBinding, samplerLayoutBinding,
+        storageLayoutBindings[0], storageLayoutBindings[1], storageLayoutBindings[2],
+        occlusionLayoutBindings[0], occlusionLayoutBindings[1], occlusionLayoutBindings[2], occlusionLayoutBindings[3],
+        shadowLayoutBindings[0], shadowLayoutBindings[1]
+    };
     layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
     layoutInfo.pBindings = bindings.data();
 
@@ -388,13 +563,30 @@ void VulkanRenderer::createDescriptorSetLayout() {
 }
 
 // UUSED IN NEXT FUNCTION
-std::vector<char> readFile(const std::string& filename);
+
+uint32_t VulkanRenderer::sceneShaderFeatures() const {
+    uint32_t features = 0;
+    if (sunIntensity > 0.0f) {
+        features |= SHADER_FEATURE_SUN;
+        if (shadows) {
+            features |= SHADER_FEATURE_SHADOWS;
+        }
+    }
+    if (lightCount > 0) {
+        features |= SHADER_FEATURE_POINT_LIGHTS;
+    }
+    if (textureHasCutout) {
+        features |= SHADER_FEATURE_ALPHA_TEST;
+    }
+    return features;
+}
 
 void VulkanRenderer::createGraphicsPipeline() {
     // READ BINARY SHADER FILES
     //std::system("./compile.bat");
-    auto vertShaderCode = readFile("C:/Users/Alex/Desktop/VulkanRenderer/VulkanRenderer/Shaders/vert.spv");
-    auto fragShaderCode = readFile("C:/Users/Alex/Desktop/VulkanRenderer/VulkanRenderer/Shaders/frag.spv");
+    // THE MULTIVIEW BUILD PICKS THE EYE'S MATRICES WITH gl_ViewIndex
+    auto vertShaderCode = readFile(SHADER_PATH + (stereo ? "vert_multiview.spv" : "vert.spv"));
+    auto fragShaderCode = readFile(SHADER_PATH + "frag.spv");
 
     vk::ShaderModule vertShaderModule = createShaderModule(vertShaderCode);
     vk::ShaderModule fragShaderModule = createShaderModule(fragShaderCode);
@@ -411,20 +603,17 @@ void VulkanRenderer::createGraphicsPipeline() {
     fragShaderStageInfo.module = fragShaderModule;
     fragShaderStageInfo.pName = "main";
 
+    // ONLY THE VARIANT THIS SCENE NEEDS, WHAT IS OFF IS NOT IN THE COMPILED SHADER
+    uint32_t features = sceneShaderFeatures();
+    ShaderSpecialization specialization(features);
+    fragShaderStageInfo.pSpecializationInfo = &specialization.info;
+
     // LIST OF MY SHADER STAGES
     vk::PipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
     // DESCRIBE VERTEX DATA FORMAT
-    vk::PipelineVertexInputStateCreateInfo vertexInputInfo;
-    // GET THE BINDING AND HOW THE STRUCT LOOKS
-
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
-
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+    // THE BINDINGS COME FROM THE MODEL (ONE INTERLEAVED Vertex FOR OBJ, THE ACCESSORS FOR GLB)
+    vk::PipelineVertexInputStateCreateInfo vertexInputInfo = mesh.layout.inputState();
 
     // WHAT KIND OF GEOMETRY WE HAVE
     vk::PipelineInputAssemblyStateCreateInfo inputAssembly;
@@ -435,15 +624,15 @@ void VulkanRenderer::createGraphicsPipeline() {
     vk::Viewport viewport;
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = (float)swapChainExtent.width;
-    viewport.height = (float)swapChainExtent.height;
+    viewport.width = (float)viewExtent.width;
+    viewport.height = (float)viewExtent.height;
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
 
     // DESCRIBE SCISSOR RECTANGLE
     vk::Rect2D scissor;
     scissor.offset = { 0, 0 };
-    scissor.extent = swapChainExtent;
+    scissor.extent = viewExtent;
 
     // COMBINE THE TWO ABOVE IN A VIEWPORT STATE
     vk::PipelineViewportStateCreateInfo viewportState;
@@ -452,6 +641,13 @@ void VulkanRenderer::createGraphicsPipeline() {
     viewportState.scissorCount = 1;
     viewportState.pScissors = &scissor;
 
+    // THE REAL VIEWPORT AND SCISSOR ARE SET WHILE RECORDING
+    // SO DYNAMIC RESOLUTION CAN CHANGE THEM WITHOUT A NEW PIPELINE
+    std::array<vk::DynamicState, 2> dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+    vk::PipelineDynamicStateCreateInfo dynamicState;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
     // DESCRIBE RASTERIZER
     vk::PipelineRasterizationStateCreateInfo rasterizer;
     rasterizer.depthClampEnable = VK_FALSE;
@@ -496,29 +692,24 @@ void VulkanRenderer::createGraphicsPipeline() {
     colorBlending.blendConstants[2] = 0.0f; // Optional
     colorBlending.blendConstants[3] = 0.0f; // Optional
 
-                                            // FILL DINAMIC STATE INFO
-    vk::DynamicState dynamicStates[] = {
-        vk::DynamicState::eViewport,
-        vk::DynamicState::eLineWidth
-    };
-
-    vk::PipelineDynamicStateCreateInfo dynamicState;
-    dynamicState.dynamicStateCount = 2;
-    dynamicState.pDynamicStates = dynamicStates;
-
     // DESCRIBE AND MAKE PIPELINE LAYOUT
     // HOW THE MEMORY LAYOUT LOOKS
+    // THE PUSH CONSTANT SAYS WHICH INSTANCE LIST THE DRAW USES
+    vk::PushConstantRange pushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, sizeof(uint32_t));
     vk::PipelineLayoutCreateInfo pipelineLayoutInfo;
     pipelineLayoutInfo.setLayoutCount = 1; // Optional
     pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout; // Optional
-    pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-    pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
+    pipelineLayoutInfo.pushConstantRangeCount = 1; // Optional
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange; // Optional
 
-    try {
-        pipelineLayout = device->createPipelineLayout(pipelineLayoutInfo);
-    }
-    catch (vk::SystemError err) {
-        throw std::runtime_error("failed to create Pipeline Layout!");
+    // KEPT FOR THE WHOLE RUN, THE CACHED VARIANTS WERE CREATED WITH IT
+    if (!pipelineLayout) {
+        try {
+            pipelineLayout = device->createPipelineLayout(pipelineLayoutInfo);
+        }
+        catch (vk::SystemError err) {
+            throw std::runtime_error("failed to create Pipeline Layout!");
+        }
     }
 
     // USE DEPTH BUFFER SPEC
@@ -528,7 +719,8 @@ void VulkanRenderer::createGraphicsPipeline() {
     depthStencil.depthTestEnable = VK_TRUE;
     depthStencil.depthWriteEnable = VK_TRUE;
 
-    depthStencil.depthCompareOp = vk::CompareOp::eLess;
+    // AFTER A DEPTH PREPASS THE SAME SURFACES COME BACK WITH THE SAME DEPTH
+    depthStencil.depthCompareOp = depthPrepass ? vk::CompareOp::eLessOrEqual : vk::CompareOp::eLess;
 
     depthStencil.depthBoundsTestEnable = VK_FALSE;
     depthStencil.minDepthBounds = 0.0f; // Optional
@@ -551,7 +743,7 @@ void VulkanRenderer::createGraphicsPipeline() {
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = nullptr; // Optional
+    pipelineInfo.pDynamicState = &dynamicState; // Optional
 
     pipelineInfo.layout = pipelineLayout;
 
@@ -561,17 +753,27 @@ void VulkanRenderer::createGraphicsPipeline() {
     pipelineInfo.basePipelineHandle = nullptr; // Optional
     pipelineInfo.basePipelineIndex = -1; // Optional
 
-    vk::Result   result;
-    std::tie(result, graphicsPipeline) = device->createGraphicsPipeline(nullptr, pipelineInfo);
+    // EVERYTHING THAT MAKES ONE VARIANT DIFFERENT FROM ANOTHER, THE VIEWPORT IS DYNAMIC
+    // AND THE RENDER PASS ONLY HAS TO BE COMPATIBLE (SAME FORMATS AND VIEWS)
+    uint64_t key = hashBytes(vertShaderCode.data(), vertShaderCode.size());
+    key = hashBytes(fragShaderCode.data(), fragShaderCode.size(), key);
+    key = hashBytes(vertexInputInfo.pVertexBindingDescriptions, vertexInputInfo.vertexBindingDescriptionCount * sizeof(vk::VertexInputBindingDescription), key);
+    key = hashBytes(vertexInputInfo.pVertexAttributeDescriptions, vertexInputInfo.vertexAttributeDescriptionCount * sizeof(vk::VertexInputAttributeDescription), key);
+    uint32_t state[] = { features, static_cast<uint32_t>(sceneColorFormat()), static_cast<uint32_t>(findDepthFormat()), depthPrepass ? 1u : 0u, viewCount() };
+    key = hashBytes(state, sizeof(state), key);
 
-    switch (result)
-    {
-    case vk::Result::eSuccess: break;
-    case vk::Result::ePipelineCompileRequiredEXT:
-        throw std::runtime_error("failed to create Pipeline!");
-        break;
-    default: assert(false);  // should never happen
-    }
+    graphicsPipeline = shaderVariants.acquire(key, [&](vk::PipelineCache cache) {
+        std::cout << "building main pipeline variant: " << shaderFeatureNames(features) << "\n";
+
+        vk::Result result;
+        vk::Pipeline pipeline;
+        std::tie(result, pipeline) = device->createGraphicsPipeline(cache, pipelineInfo);
+
+        if (result != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create Pipeline!");
+        }
+        return pipeline;
+    });
 
     device->destroyShaderModule(fragShaderModule);
     device->destroyShaderModule(vertShaderModule);
@@ -584,7 +786,8 @@ void VulkanRenderer::createCommandPool() {
     // STRUCT FOR COMMAND POOLS
     vk::CommandPoolCreateInfo poolInfo{};
     poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-    poolInfo.flags = {}; // Optional
+    // COMMAND BUFFERS ARE RECORDED AGAIN WHEN THE RENDER RESOLUTION CHANGES
+    poolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer; // Optional
 
     try {
         commandPool = device->createCommandPool(poolInfo);
@@ -592,15 +795,33 @@ void VulkanRenderer::createCommandPool() {
     catch (vk::SystemError err) {
         throw(std::runtime_error("failed to create Command Pool!"));
     }
+
+    // ONLY ONE TIME UPLOADS COME FROM HERE
+    vk::CommandPoolCreateInfo transferPoolInfo;
+    transferPoolInfo.queueFamilyIndex = queueFamilyIndices.transferFamily.value();
+    transferPoolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+
+    try {
+        transferCommandPool = device->createCommandPool(transferPoolInfo);
+    }
+    catch (vk::SystemError err) {
+        throw(std::runtime_error("failed to create Command Pool!"));
+    }
 }
 
 void VulkanRenderer::createDepthResources() {
     auto depthFormat = findDepthFormat();
 
     // CREATE THE IMAGE
-    createImage(swapChainExtent.width, swapChainExtent.height, depthFormat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment, vk::MemoryPropertyFlagBits::eDeviceLocal, depthImage, depthImageMemory);
+    // THE HI-Z BUILD SAMPLES IT AFTER THE DEPTH PREPASS
+    vk::ImageUsageFlags depthUsage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+    if (depthPrepass) {
+        depthUsage |= vk::ImageUsageFlagBits::eSampled;
+    }
+    // ONE LAYER PER VIEW, AN ARRAY VIEW FOR THE MULTIVIEW FRAMEBUFFER
+    createImage(viewExtent.width, viewExtent.height, depthFormat, vk::ImageTiling::eOptimal, depthUsage, vk::MemoryPropertyFlagBits::eDeviceLocal, depthImage, depthImageMemory, 1, viewCount());
     // CREATE IMAGE VIEW
-    depthImageView = createImageView(depthImage, depthFormat, vk::ImageAspectFlagBits::eDepth);
+    depthImageView = createImageView(depthImage, depthFormat, vk::ImageAspectFlagBits::eDepth, 0, 1, stereo ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D, 0, viewCount());
 }
 
 void VulkanRenderer::createFramebuffers() {
@@ -609,8 +830,9 @@ void VulkanRenderer::createFramebuffers() {
 
     // CREATE A FRAME BUFFER FOR EACH IMAGE IN THE SWAPCHAIN
     for (size_t i = 0; i < swapChainImageViews.size(); i++) {
+        // WITH DYNAMIC RESOLUTION EVERY FRAME DRAWS INTO THE SAME OFFSCREEN TARGET
         std::array<vk::ImageView, 2> attachments = {
-        swapChainImageViews[i],
+        offscreenTarget() ? sceneColorImageView : swapChainImageViews[i],
         depthImageView
         };
 
@@ -619,8 +841,9 @@ void VulkanRenderer::createFramebuffers() {
         framebufferInfo.renderPass = renderPass;
         framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
         framebufferInfo.pAttachments = attachments.data();
-        framebufferInfo.width = swapChainExtent.width;
-        framebufferInfo.height = swapChainExtent.height;
+        framebufferInfo.width = viewExtent.width;
+        framebufferInfo.height = viewExtent.height;
+        // ALSO 1 WITH MULTIVIEW, THE VIEW MASK PICKS THE LAYERS
         framebufferInfo.layers = 1;
 
         try {
@@ -632,21 +855,59 @@ void VulkanRenderer::createFramebuffers() {
     }
 }
 
-void VulkanRenderer::createTextureImage() {
+void VulkanRenderer::decodeTextureImage() {
+    // ONLY CPU WORK HERE SO IT CAN RUN WHILE THE DEVICE IS BEING CREATED
     // LOAD IMG
-    int texWidth, texHeight, texChannels;
+    int texChannels;
     std::vector<std::string> texturesPaths;
 
     for (const auto& entry : std::filesystem::directory_iterator(TEXTURE_PATH))
         texturesPaths.push_back(entry.path().string());
-    std::cout << texturesPaths[0];
-    stbi_uc* pixels = stbi_load(texturesPaths[0].c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    vk::DeviceSize imageSize = texWidth * texHeight * 4;
-
-    if (!pixels) {
+    texturePath = texturesPaths[0];
+    std::cout << texturePath;
+    // HASH THE FILE WE DECODE FROM, THE RESOURCE CACHE SHARES THE IMAGE BY IT
+    auto file = readFile(texturePath);
+    textureHash = hashBytes(file.data(), file.size());
+    texturePixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.data()), static_cast<int>(file.size()), &textureWidth, &textureHeight, &texChannels, STBI_rgb_alpha);
+
+    if (!texturePixels) {
         throw std::runtime_error("failed to load texture image!");
     }
 
+    // MOSTLY TRANSPARENT TEXELS ARE CUT OUT, ONLY THEN IS THE ALPHA TEST BUILT IN
+    textureHasCutout = false;
+    size_t texelCount = static_cast<size_t>(textureWidth) * textureHeight;
+    for (size_t i = 0; i < texelCount; i++) {
+        if (texturePixels[4 * i + 3] < 128) {
+            textureHasCutout = true;
+            break;
+        }
+    }
+}
+
+void VulkanRenderer::createTextureImage() {
+    if (!texturePixels) {
+        decodeTextureImage();
+    }
+    // THE UPLOAD ONLY RUNS IF THE CACHE DOES NOT HAVE THIS FILE YET
+    textureResource = resourceCache.acquire(texturePath, textureHash, [this]() {
+        return uploadTexture();
+    });
+    stbi_image_free(texturePixels);
+    texturePixels = nullptr;
+
+    textureImage = textureResource->image;
+    textureImageView = textureResource->view;
+}
+
+GpuResource VulkanRenderer::uploadTexture() {
+    int texWidth = textureWidth;
+    int texHeight = textureHeight;
+    stbi_uc* pixels = texturePixels;
+    vk::DeviceSize imageSize = texWidth * texHeight * 4;
+    GpuResource texture;
+    texture.bytes = imageSize;
+
     // PREPARE STAGING BUFFER
     // A BUFFER BASICALY INBETWEN
     vk::Buffer stagingBuffer;
@@ -659,24 +920,22 @@ void VulkanRenderer::createTextureImage() {
     memcpy(data, pixels, static_cast<size_t>(imageSize));
     device->unmapMemory(stagingBufferMemory);
 
-    stbi_image_free(pixels);
-
-    createImage(texWidth, texHeight, vk::Format::eR8G8B8A8Srgb, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal, textureImage, textureImageMemory);
+    // FROM THE POOL SO DEFRAGMENTATION CAN MOVE IT, WHICH COPIES IT OUT AS A TRANSFER SOURCE
+    createPooledImage(texWidth, texHeight, vk::Format::eR8G8B8A8Srgb, vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, textureHash, texture);
     // TRANZITIONING IMAGE LAYOUT BEFORE COPYING THE BUFFER
-    transitionImageLayout(textureImage, vk::Format::eR8G8B8A8Srgb, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
-    copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+    transitionImageLayout(texture.image, vk::Format::eR8G8B8A8Srgb, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
+    copyBufferToImage(stagingBuffer, texture.image, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
 
     // TRANSITION NOW INTO A USEFULL LAYOUT
-    transitionImageLayout(textureImage, vk::Format::eR8G8B8A8Srgb, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+    transitionImageLayout(texture.image, vk::Format::eR8G8B8A8Srgb, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
 
 
     // CLEANUP
     device->destroyBuffer(stagingBuffer, nullptr);
-    device->freeMemory(stagingBufferMemory, nullptr);
-}
+    freeMemory(stagingBufferMemory);
 
-void VulkanRenderer::createTextureImageView() {
-    textureImageView = createImageView(textureImage, vk::Format::eR8G8B8A8Srgb, vk::ImageAspectFlagBits::eColor);
+    texture.view = createImageView(texture.image, vk::Format::eR8G8B8A8Srgb, vk::ImageAspectFlagBits::eColor);
+    return texture;
 }
 
 void VulkanRenderer::createTextureSampler() {
@@ -712,85 +971,106 @@ void VulkanRenderer::createTextureSampler() {
 }
 
 void VulkanRenderer::loadModel() {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
-
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH.c_str())) {
-        throw std::runtime_error(warn + err);
+    if (isGlbPath(MODEL_PATH)) {
+        // NO CPU SIDE MESH, THE UPLOAD READS STRAIGHT FROM THE MAPPED FILE
+        glbFile = std::make_unique<GlbFile>(MODEL_PATH);
+        mesh = glbFile->mesh();
     }
+    else {
+        if (nativeObjLoader) {
+            loadObj(MODEL_PATH, jobSystem, vertices, indices);
+        }
+        else {
+            tinyobj::attrib_t attrib;
+            std::vector<tinyobj::shape_t> shapes;
+            std::vector<tinyobj::material_t> materials;
+            std::string warn, err;
 
-    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-
-    for (const auto& shape : shapes) {
-        for (const auto& index : shape.mesh.indices) {
-            Vertex vertex{};
-
-            vertex.pos = {
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2]
-            };
-            if (index.texcoord_index > 0)
-                vertex.texCoord = {
-                    attrib.texcoords[2 * index.texcoord_index + 0],
-                    1 - attrib.texcoords[2 * index.texcoord_index + 1]
-            };
-
-            vertex.color = { 1.0f, 1.0f, 1.0f };
-
-            if (uniqueVertices.count(vertex) == 0) {
-                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                vertices.push_back(vertex);
+            if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH.c_str())) {
+                throw std::runtime_error(warn + err);
             }
 
-            indices.push_back(uniqueVertices[vertex]);
-
+            buildIndexedMesh(attrib, shapes, vertices, indices);
+        }
+        if (splitVertexStreams) {
+            mesh = meshFromSplitVertices(vertices, indices, vertexPositions, vertexAttributes);
+        }
+        else {
+            mesh = meshFromVertices(vertices, indices);
         }
     }
-    std::cout << vertices.size();
+    depthLayout = mesh.layout.positionOnly();
+    cutoutDepthLayout = mesh.layout.positionAndTexCoord();
+
+    // LOCAL BOUNDS FOR CULLING
+    modelBoundsMin = mesh.boundsMin;
+    modelBoundsMax = mesh.boundsMax;
+    modelObject = cullingScene.add(modelBoundsMin, modelBoundsMax, glm::mat4(1.0f));
+    std::cout << mesh.indexCount / 3 << " triangles\n";
 }
 
-void VulkanRenderer::createVertexBuffer() {
-    // ANALOG WITH CREATE TEXTURE IMAGE, FOR EXPLINATIONS 
-    // GO THERE
-    vk::DeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+void VulkanRenderer::openWorld() {
+    if (worldPath.empty()) {
+        return;
+    }
 
-    vk::Buffer stagingBuffer;
-    vk::DeviceMemory stagingBufferMemory;
-    createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingBufferMemory);
+    // EVERY STREAMED OBJECT IS A DRAW SLOT, WHAT IS ALREADY IN THE SCENE KEEPS ITS OWN
+    WorldStreamingSettings settings = worldSettings;
+    settings.objectBudget = std::min<size_t>(settings.objectBudget, MAX_DRAW_OBJECTS - cullingScene.size());
+    worldPartition.open(worldPath, jobSystem, settings, modelBoundsMin, modelBoundsMax);
 
-    auto data = device->mapMemory(stagingBufferMemory, 0, bufferSize);
-    memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
-    device->unmapMemory(stagingBufferMemory);
+    // THE FARTHEST RESIDENT OBJECT IS unloadRadius FROM ITS CELL PLUS THE CELL ITSELF
+    farPlane = std::max(farPlane, worldPartition.settings().unloadRadius + worldPartition.cellWidth() * 1.5f);
+}
 
+ResourceHandle VulkanRenderer::uploadBuffer(const std::string& path, const std::vector<UploadRange>& ranges, vk::DeviceSize size, vk::BufferUsageFlags usage) {
+    // THE SAME BYTES AT THE SAME OFFSETS ARE THE SAME BUFFER
+    uint64_t hash = hashBytes(&size, sizeof(size), static_cast<VkBufferUsageFlags>(usage));
+    for (const auto& range : ranges) {
+        hash = hashBytes(range.data, range.size, hash ^ range.offset);
+    }
 
-    createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, vertexBuffer, vertexBufferMemory);
+    return resourceCache.acquire(path, hash, [&]() {
+        // ANALOG WITH CREATE TEXTURE IMAGE, FOR EXPLINATIONS 
+        // GO THERE
+        GpuResource buffer;
+        buffer.bytes = size;
 
-    copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+        vk::Buffer stagingBuffer;
+        vk::DeviceMemory stagingBufferMemory;
+        createBuffer(size, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingBufferMemory);
 
-    device->destroyBuffer(stagingBuffer, nullptr);
-    device->freeMemory(stagingBufferMemory, nullptr);
-}
+        // ONE COPY PER RANGE, FOR GLB THESE ARE WHOLE BUFFER VIEWS
+        auto data = static_cast<char*>(device->mapMemory(stagingBufferMemory, 0, size));
+        for (const auto& range : ranges) {
+            memcpy(data + range.offset, range.data, range.size);
+        }
+        device->unmapMemory(stagingBufferMemory);
 
-void VulkanRenderer::createIndexBuffer() {
-    vk::DeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+        // FROM THE POOL, TRANSFER SOURCE SO DEFRAGMENTATION CAN COPY IT OUT
+        createPooledBuffer(size, vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst | usage, hash, buffer);
 
-    vk::Buffer stagingBuffer;
-    vk::DeviceMemory stagingBufferMemory;
-    createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingBufferMemory);
+        copyBuffer(stagingBuffer, buffer.buffer, size);
 
-    auto data = device->mapMemory(stagingBufferMemory, 0, bufferSize);
-    memcpy(data, indices.data(), static_cast<size_t>(bufferSize));
-    device->unmapMemory(stagingBufferMemory);
+        device->destroyBuffer(stagingBuffer, nullptr);
+        freeMemory(stagingBufferMemory);
+        return buffer;
+    });
+}
 
-    createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, indexBuffer, indexBufferMemory);
+void VulkanRenderer::createVertexBuffer() {
+    vertexResource = uploadBuffer(MODEL_PATH + "#vertices", mesh.vertexRanges, mesh.vertexBufferSize, vk::BufferUsageFlagBits::eVertexBuffer);
+    vertexBuffer = vertexResource->buffer;
+}
 
-    copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+void VulkanRenderer::createIndexBuffer() {
+    indexResource = uploadBuffer(MODEL_PATH + "#indices", mesh.indexRanges, mesh.indexBufferSize, vk::BufferUsageFlagBits::eIndexBuffer);
+    indexBuffer = indexResource->buffer;
 
-    device->destroyBuffer(stagingBuffer, nullptr);
-    device->freeMemory(stagingBufferMemory, nullptr);
+    // BOTH UPLOADS ARE DONE (createIndexBuffer WAITS FOR createVertexBuffer), UNMAP THE GLB
+    mesh.vertexRanges.clear();
+    mesh.indexRanges.clear();
+    glbFile.reset();
 }
 
 void VulkanRenderer::createUniformBuffers() {
@@ -813,11 +1093,15 @@ void VulkanRenderer::createDescriptorPool() {
     // THE TEXTURE DOESNT CHANGE SO FOR IT WE HAVE ONLY ONE ALLOCATION
     // INSTEAD OF THE NUMBER FO SWAP CHAINS LIKE FOR THE UNIFORMS
     // THIS DOWN DESCRIBES WHAT TIPE OF DESCRIPTORS AND HOW MANY TO MAKE OF EACH
-    std::array<vk::DescriptorPoolSize, 2> poolSizes;
+    std::array<vk::DescriptorPoolSize, 3> poolSizes;
     poolSizes[0].type = vk::DescriptorType::eUniformBuffer;
     poolSizes[0].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
+    // TEXTURE, HI-Z AND SHADOW MAP
     poolSizes[1].type = vk::DescriptorType::eCombinedImageSampler;
-    poolSizes[1].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
+    poolSizes[1].descriptorCount = static_cast<uint32_t>(3 * swapChainImages.size());
+    // LIGHTS, CLUSTERS, LIGHT INDICES, OBJECTS, INDIRECT COMMANDS, OCCLUDED FLAGS, SHADOW CASTERS
+    poolSizes[2].type = vk::DescriptorType::eStorageBuffer;
+    poolSizes[2].descriptorCount = static_cast<uint32_t>(7 * swapChainImages.size());
 
     // YOU BASICALLY NOW CAN MAKE MORE OF EACH LAYOUT THAT YOU MADE EARLIER, I THINK
 
@@ -866,7 +1150,43 @@ void VulkanRenderer::createDescriptorSets() {
         imageInfo.imageView = textureImageView;
         imageInfo.sampler = textureSampler;
 
-        std::array<vk::WriteDescriptorSet, 2> descriptorWrites;
+        // LIGHTING STORAGE BUFFERS
+        std::array<vk::DescriptorBufferInfo, 3> storageInfos;
+        storageInfos[0].buffer = lightBuffers[i];
+        storageInfos[1].buffer = clusterBuffers[i];
+        storageInfos[2].buffer = lightIndexBuffers[i];
+        for (auto& storageInfo : storageInfos) {
+            storageInfo.offset = 0;
+            storageInfo.range = VK_WHOLE_SIZE;
+        }
+
+        // OCCLUSION CULLING
+        vk::DescriptorImageInfo hiZInfo;
+        hiZInfo.imageLayout = vk::ImageLayout::eGeneral;
+        hiZInfo.imageView = hiZImageView;
+        hiZInfo.sampler = hiZSampler;
+
+        std::array<vk::DescriptorBufferInfo, 3> occlusionInfos;
+        occlusionInfos[0].buffer = drawObjectBuffers[i];
+        occlusionInfos[1].buffer = indirectBuffers[i];
+        occlusionInfos[2].buffer = occlusionBuffer;
+        for (auto& occlusionInfo : occlusionInfos) {
+            occlusionInfo.offset = 0;
+            occlusionInfo.range = VK_WHOLE_SIZE;
+        }
+
+        // SHADOWS
+        vk::DescriptorBufferInfo shadowObjectInfo;
+        shadowObjectInfo.buffer = shadowObjectBuffers[i];
+        shadowObjectInfo.offset = 0;
+        shadowObjectInfo.range = VK_WHOLE_SIZE;
+
+        vk::DescriptorImageInfo shadowInfo;
+        shadowInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+        shadowInfo.imageView = shadowImageView;
+        shadowInfo.sampler = shadowSampler;
+
+        std::array<vk::WriteDescriptorSet, 11> descriptorWrites;
         // A DESCRIPTOR SET CONSISTS OF ONE OF EACH OF THESE TWO
 
         // UNIFORM DATA DESTINATION
@@ -885,6 +1205,45 @@ void VulkanRenderer::createDescriptorSets() {
         descriptorWrites[1].descriptorCount = 1;
         descriptorWrites[1].pImageInfo = &imageInfo;
 
+        for (uint32_t j = 0; j < storageInfos.size(); j++) {
+            descriptorWrites[2 + j].dstSet = descriptorSets[i];
+            descriptorWrites[2 + j].dstBinding = 2 + j;
+            descriptorWrites[2 + j].dstArrayElement = 0;
+            descriptorWrites[2 + j].descriptorType = vk::DescriptorType::eStorageBuffer;
+            descriptorWrites[2 + j].descriptorCount = 1;
+            descriptorWrites[2 + j].pBufferInfo = &storageInfos[j];
+        }
+
+        descriptorWrites[5].dstSet = descriptorSets[i];
+        descriptorWrites[5].dstBinding = 5;
+        descriptorWrites[5].dstArrayElement = 0;
+        descriptorWrites[5].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+        descriptorWrites[5].descriptorCount = 1;
+        descriptorWrites[5].pImageInfo = &hiZInfo;
+
+        for (uint32_t j = 0; j < occlusionInfos.size(); j++) {
+            descriptorWrites[6 + j].dstSet = descriptorSets[i];
+            descriptorWrites[6 + j].dstBinding = 6 + j;
+            descriptorWrites[6 + j].dstArrayElement = 0;
+            descriptorWrites[6 + j].descriptorType = vk::DescriptorType::eStorageBuffer;
+            descriptorWrites[6 + j].descriptorCount = 1;
+            descriptorWrites[6 + j].pBufferInfo = &occlusionInfos[j];
+        }
+
+        descriptorWrites[9].dstSet = descriptorSets[i];
+        descriptorWrites[9].dstBinding = 9;
+        descriptorWrites[9].dstArrayElement = 0;
+        descriptorWrites[9].descriptorType = vk::DescriptorType::eStorageBuffer;
+        descriptorWrites[9].descriptorCount = 1;
+        descriptorWrites[9].pBufferInfo = &shadowObjectInfo;
+
+        descriptorWrites[10].dstSet = descriptorSets[i];
+        descriptorWrites[10].dstBinding = 10;
+        descriptorWrites[10].dstArrayElement = 0;
+        descriptorWrites[10].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+        descriptorWrites[10].descriptorCount = 1;
+        descriptorWrites[10].pImageInfo = &shadowInfo;
+
         device->updateDescriptorSets(static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
     }
 
@@ -907,52 +1266,102 @@ void VulkanRenderer::createCommandBuffers() {
 
     // START RECORDING THE COMMAND BUFFER FOR EACH FRAME
     for (size_t i = 0; i < commandBuffers.size(); i++) {
-        // YOU CAN ADD FALGS FOR USE AND SOMETHING WITH INHERETANCE
-        vk::CommandBufferBeginInfo beginInfo;
+        recordCommandBuffer(i);
+    }
+}
+
+void VulkanRenderer::recordCommandBuffer(size_t i) {
+    // YOU CAN ADD FALGS FOR USE AND SOMETHING WITH INHERETANCE
+    vk::CommandBufferBeginInfo beginInfo;
 
-        commandBuffers[i].begin(beginInfo);
+    // BEGIN ALSO RESETS IT IF IT WAS RECORDED BEFORE
+    commandBuffers[i].begin(beginInfo);
 
-        // START RENDER PASS
-        vk::RenderPassBeginInfo renderPassInfo;
-        renderPassInfo.renderPass = renderPass;
-        renderPassInfo.framebuffer = swapChainFramebuffers[i];
+    // GPU TIME OF THE WHOLE FRAME FOR THE RESOLUTION CONTROLLER
+    if (dynamicResolution) {
+        commandBuffers[i].resetQueryPool(timestampQueryPool, static_cast<uint32_t>(2 * i), 2);
+        commandBuffers[i].writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, timestampQueryPool, static_cast<uint32_t>(2 * i));
+    }
 
-        renderPassInfo.renderArea.offset = { 0, 0 };
-        renderPassInfo.renderArea.extent = swapChainExtent;
+    // BIN THE LIGHTS INTO CLUSTERS BEFORE ANYTHING IS SHADED
+    recordLightCulling(commandBuffers[i], i);
 
-        // ONE CLEAR VALUE FOR THE IMAGE AND ONE FOR THE
-        // DEPTH STENCIL
-        std::array<vk::ClearValue, 2> clearValues;
-        clearValues[0].color.setFloat32({ 0.0f, 0.0f, 0.0f, 1.0f });
-        clearValues[1].depthStencil = { 1.0f, 0 };
+    // OCCLUSION CULLING (AND THE DEPTH PREPASS IF IT IS ON)
+    recordVisibility(commandBuffers[i], i);
 
-        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-        renderPassInfo.pClearValues = clearValues.data();
+    // ONLY THE SHADOW CASCADES THAT CHANGED SINCE THEY WERE LAST DRAWN
+    recordShadows(commandBuffers[i], i);
 
-        commandBuffers[i].beginRenderPass(&renderPassInfo, vk::SubpassContents::eInline);
+    // THIS IMAGE'S PARTICLE INSTANCES COME FROM THE COMPUTE QUEUE
+    recordParticleAcquire(commandBuffers[i], i);
 
-        commandBuffers[i].bindPipeline( vk::PipelineBindPoint::eGraphics, graphicsPipeline);
+    // START RENDER PASS
+    vk::RenderPassBeginInfo renderPassInfo;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = swapChainFramebuffers[i];
 
-        vk::Buffer vertexBuffers[] = { vertexBuffer };
-        vk::DeviceSize offsets[] = { 0 };
+    // ONLY THE PART WE ARE GOING TO UPSCALE IS CLEARED AND DRAWN
+    renderPassInfo.renderArea.offset = { 0, 0 };
+    renderPassInfo.renderArea.extent = renderExtent;
 
-        commandBuffers[i].bindVertexBuffers( 0, 1, vertexBuffers, offsets);
+    // ONE CLEAR VALUE FOR THE IMAGE AND ONE FOR THE
+    // DEPTH STENCIL
+    std::array<vk::ClearValue, 2> clearValues;
+    clearValues[0].color.setFloat32({ 0.0f, 0.0f, 0.0f, 1.0f });
+    clearValues[1].depthStencil = { 1.0f, 0 };
 
-        commandBuffers[i].bindIndexBuffer(indexBuffer, 0, vk::IndexType::eUint32);
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
 
-        commandBuffers[i].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr);
+    commandBuffers[i].beginRenderPass(&renderPassInfo, vk::SubpassContents::eInline);
 
-        commandBuffers[i].drawIndexed(static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+    commandBuffers[i].bindPipeline( vk::PipelineBindPoint::eGraphics, graphicsPipeline);
 
-        commandBuffers[i].endRenderPass();
+    vk::Viewport viewport(0.0f, 0.0f, (float)renderExtent.width, (float)renderExtent.height, 0.0f, 1.0f);
+    vk::Rect2D scissor({ 0, 0 }, renderExtent);
+    commandBuffers[i].setViewport(0, 1, &viewport);
+    commandBuffers[i].setScissor(0, 1, &scissor);
 
-        try {
-            commandBuffers[i].end();
-        }
-        catch (vk::SystemError err) {
-            throw(std::runtime_error("failed to end the command buffer recording!"));
-        }
+    // EVERY BINDING IS A WINDOW INTO THE SAME BUFFER
+    std::vector<vk::Buffer> vertexBuffers(mesh.layout.offsets.size(), vertexBuffer);
+
+    commandBuffers[i].bindVertexBuffers( 0, static_cast<uint32_t>(vertexBuffers.size()), vertexBuffers.data(), mesh.layout.offsets.data());
+
+    commandBuffers[i].bindIndexBuffer(indexBuffer, 0, mesh.indexType);
+
+    commandBuffers[i].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr);
+
+    // ONE INSTANCE PER VISIBLE OBJECT, THE COUNT COMES FROM occlusion.comp
+    uint32_t instanceOffset = MAX_DRAW_OBJECTS;
+    commandBuffers[i].pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(instanceOffset), &instanceOffset);
+    commandBuffers[i].drawIndexedIndirect(indirectBuffers[i], sizeof(vk::DrawIndexedIndirectCommand), 1, sizeof(vk::DrawIndexedIndirectCommand));
+
+    // ADDITIVE BILLBOARDS ON TOP OF THE SCENE
+    recordParticleDraw(commandBuffers[i], i);
+
+    commandBuffers[i].endRenderPass();
+
+    if (batchMode()) {
+        recordReadback(commandBuffers[i], i);
     }
+    else if (postProcess) {
+        recordPostProcess(commandBuffers[i], i);
+    }
+    else if (offscreenTarget()) {
+        recordUpscale(commandBuffers[i], i);
+    }
+    if (dynamicResolution) {
+        commandBuffers[i].writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestampQueryPool, static_cast<uint32_t>(2 * i + 1));
+    }
+
+    try {
+        commandBuffers[i].end();
+    }
+    catch (vk::SystemError err) {
+        throw(std::runtime_error("failed to end the command buffer recording!"));
+    }
+
+    recordedRenderExtents[i] = renderExtent;
 }
 
 void VulkanRenderer::createSyncObjects() {
@@ -979,14 +1388,28 @@ void VulkanRenderer::createSyncObjects() {
 }
 
 void VulkanRenderer::drawFrame() {
+    PROFILE_FUNCTION();
+    latencyTracker.markInputSample(inputSampleTime);
+
     // IF OUR FRAME IS IN FLIGHT WAIT FOR IT
-    device->waitForFences( 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    {
+        PROFILE_ZONE("wait frame fence");
+        device->waitForFences( 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    }
+    // THAT FENCE WAS LAST SUBMITTED MAX_FRAMES_IN_FLIGHT FRAMES AGO, SO EVERYTHING
+    // UP TO THAT FRAME IS DONE AND WHAT THE CACHE EVICTED BEFORE IT CAN GO
+    uint64_t framesInFlight = static_cast<uint64_t>(MAX_FRAMES_IN_FLIGHT);
+    resourceCache.beginFrame(frameNumber + 1, frameNumber + 1 > framesInFlight ? frameNumber + 1 - framesInFlight : 0);
 
     
     uint32_t imageIndex;
     // AQUIRE AN IMAGE FROM THE SWAP CHAIN AND SET THE SEMAPHORE THAT WILL BE 
     // SIGNALED WHEN PRESENTATION HAS FINISHED READING FROM IMAGE
-    auto result = device->acquireNextImageKHR(swapChain, static_cast<uint64_t>(UINT64_MAX), imageAvailableSemaphores[currentFrame], nullptr, &imageIndex);
+    vk::Result result;
+    {
+        PROFILE_ZONE("acquireNextImageKHR");
+        result = device->acquireNextImageKHR(swapChain, static_cast<uint64_t>(UINT64_MAX), imageAvailableSemaphores[currentFrame], nullptr, &imageIndex);
+    }
 
     // CASE OF RESIZED WINDOW
     if (result == vk::Result::eErrorOutOfDateKHR) {
@@ -1001,25 +1424,57 @@ void VulkanRenderer::drawFrame() {
     // FROM WHAT I UNDERSTAND THE SEMAPHORE USED EARLYER DOES THE
     // SAME THING BUT IDUNO MAN
     if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+        PROFILE_ZONE("wait image fence");
         device->waitForFences(1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
     }
+    // THE IMAGE'S LAST FRAME IS DONE, ITS LIGHT INDEX POOL CAN GROW
+    checkLightIndexPool(imageIndex);
     // MARK THE IMAGE AS BEING USED BY THIS FRAME
     imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+    latencyTracker.markAcquired();
+    // PICK THE RENDER RESOLUTION FROM THE GPU TIME OF THIS IMAGE'S LAST FRAME
+    updateRenderScale(imageIndex);
     // UPDATE THE UNIFORM BUFFER
     updateUniformBuffer(imageIndex);
+    updateLights(imageIndex);
+    updateDrawObjects(imageIndex);
+    updateParticles(imageIndex);
+    // MOVES SOME CACHED ASSETS, LAST SO THE IMAGE'S COMMAND BUFFER IS RECORDED WITH THE NEW ONES
+    vk::CommandBuffer defragCommandBuffer = defragmentMemory(imageIndex);
 
     // SUBMIT COMMAND BUFFER INFO
     vk::SubmitInfo submitInfo;
     // PUT THE SEMAPHORE THAT WE HAD SET TO BE SIGNALED
     // SO WE KNOW WHEN TO START
-    vk::Semaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
-    vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
+    vk::Semaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame], nullptr };
+    vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput };
+    // THE SWAPCHAIN IMAGE IS FIRST WRITTEN BY THE UPSCALING BLIT
+    if (offscreenTarget()) {
+        waitStages[0] |= vk::PipelineStageFlagBits::eTransfer;
+    }
+    // OR BY THE FUSED POST PASS
+    if (postProcess) {
+        waitStages[0] |= vk::PipelineStageFlagBits::eComputeShader;
+    }
     submitInfo.waitSemaphoreCount = 1;
+    // THE PARTICLES ARE SIMULATED ON THE COMPUTE QUEUE, ONLY THEIR DRAW WAITS FOR IT
+    if (particleCount > 0) {
+        waitSemaphores[1] = submitParticleSimulation(imageIndex);
+        submitInfo.waitSemaphoreCount = 2;
+    }
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
 
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+    // THE COPIES GO FIRST, THE FRAME ALREADY READS WHAT THEY WRITE
+    vk::CommandBuffer submitted[] = { defragCommandBuffer, commandBuffers[imageIndex] };
+    if (defragCommandBuffer) {
+        submitInfo.commandBufferCount = 2;
+        submitInfo.pCommandBuffers = submitted;
+    }
+    else {
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+    }
 
     // SEMAPHORE TO BE SIGNALED WHEN ALL RENDERING HAS FINISHED AND PRESENTATION CAN BEGIN
     vk::Semaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
@@ -1030,8 +1485,16 @@ void VulkanRenderer::drawFrame() {
     device->resetFences(1, &inFlightFences[currentFrame]);
 
     // SUBMIT AND CHOSE THE FENCE THAT WILL BE SET WHEN FRAME HAS FINISHED
-    if (graphicsQueue.submit(1, &submitInfo, inFlightFences[currentFrame]) != vk::Result::eSuccess) {
-        throw std::runtime_error("failed to submit draw command buffer!");
+    {
+        PROFILE_ZONE("queue submit");
+        if (graphicsQueue.submit(1, &submitInfo, inFlightFences[currentFrame]) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to submit draw command buffer!");
+        }
+    }
+    frameNumber++;
+    latencyTracker.markSubmitted();
+    if (dynamicResolution) {
+        timestampsWritten[imageIndex] = true;
     }
 
     // PRESENTATION INFO
@@ -1048,7 +1511,16 @@ void VulkanRenderer::drawFrame() {
 
     presentInfo.pResults = nullptr; // Optional
 
-    result = presentQueue.presentKHR(&presentInfo);
+    {
+        PROFILE_ZONE("presentKHR");
+        result = presentQueue.presentKHR(&presentInfo);
+    }
+    latencyTracker.markPresented();
+
+    if (!firstFramePresented) {
+        firstFramePresented = true;
+        std::cout << "time to first frame: " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count() << " ms\n";
+    }
 
     if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || framebufferResized) {
         framebufferResized = false;
@@ -24,8 +24,29 @@
 #include <string>
 
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
 
 #include "VulkanRendererNeededBuildTypes.h"
+#include "AssetLoading.h"
+#include "FrameLatency.h"
+#include "TripleBuffer.h"
+#include "JobSystem.h"
+#include "Culling.h"
+#include "DynamicResolution.h"
+#include "MemoryStats.h"
+#include "Profiler.h"
+#include "WorldPartition.h"
+#include "ResourceCache.h"
+#include "ShaderVariants.h"
+
+// NO VULKAN DRIVER OR NO DEVICE THAT CAN RUN THE RENDERER, BATCH MODE FALLS BACK TO THE CPU
+class NoVulkanDeviceError : public std::runtime_error {
+public:
+	using std::runtime_error::runtime_error;
+};
 
 class VulkanRenderer {
 public:
@@ -55,10 +76,29 @@ public:
 
 	std::string TEXTURE_PATH = "../Textures/";
 
+	// .obj OR .glb, --model= CHANGES IT
 	std::string MODEL_PATH = "../Models/karanbit.obj";
+	// MAPPED PARALLEL PARSER (ObjLoader.cpp), --tinyobj GOES BACK TO tinyobj
+	bool nativeObjLoader = true;
+	// OBJ VERTICES AS A POSITION STREAM AND AN ATTRIBUTE STREAM, --interleaved-vertices KEEPS ONE
+	bool splitVertexStreams = true;
+
+	std::string SHADER_PATH = "C:/Users/Alex/Desktop/VulkanRenderer/VulkanRenderer/Shaders/";
+
+	// PRESENTATION OPTIONS, CAN BE CHANGED FROM THE COMMAND LINE
+	// IF THE MODE IS NOT SUPPORTED WE FALL BACK TO FIFO
+	vk::PresentModeKHR preferredPresentMode = vk::PresentModeKHR::eMailbox;
+
+	// 0 MEANS minImageCount + 1
+	uint32_t requestedSwapChainImageCount = 0;
 
 	int MAX_FRAMES_IN_FLIGHT = 2;
 
+	// LATENCY MEASUREMENT
+	bool reportLatency = true;
+	FrameLatencyTracker latencyTracker;
+	std::chrono::steady_clock::time_point inputSampleTime;
+
 	// CAMERA
 
 	glm::vec3 cameraPos = glm::vec3(0.5f, 0.50f, 0.50f);
@@ -67,19 +107,125 @@ public:
 	float yaw = -90.0f;
 	float pitch = 0.0f;
 	float fov = 45.0f;
+	float nearPlane = 0.1f;
+	float farPlane = 10.0f;
+
+	// CLUSTERED LIGHTING
+	uint32_t lightCount = 256;
+	// FRACTION OF THE HALF DIAGONAL OF THE BOX THE LIGHTS ARE SCATTERED IN
+	float lightRadius = 0.4f;
+	// TILES ACROSS, TILES DOWN, DEPTH SLICES
+	glm::uvec3 clusterGrid = glm::uvec3(16, 9, 24);
+	// MUST MATCH cluster.comp
+	static constexpr uint32_t CLUSTER_GROUP_SIZE = 128;
+	// LIGHT INDICES THE SHARED POOL HOLDS, 0 SIZES IT FROM THE LIGHT COUNT. GROWS WHEN A FRAME OVERFLOWS IT
+	uint32_t lightIndexCapacity = 0;
+	// lightIndexCount AND lightIndexOverflow IN FRONT OF THE INDICES, MUST MATCH cluster.comp
+	static constexpr vk::DeviceSize LIGHT_INDEX_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+	// DEPTH PREPASS + HI-Z OCCLUSION CULLING
+	bool depthPrepass = false;
+	// MUST MATCH occlusion.comp
+	static constexpr uint32_t MAX_DRAW_OBJECTS = 4096;
+	static constexpr uint32_t OCCLUSION_GROUP_SIZE = 64;
+
+	// CASCADED SHADOW MAPS FOR THE SUN
+	bool shadows = false;
+	// MUST MATCH THE SHADERS
+	static constexpr uint32_t MAX_SHADOW_CASCADES = 4;
+	uint32_t shadowCascadeCount = MAX_SHADOW_CASCADES;
+	uint32_t shadowMapSize = 2048;
+	// VIEW DEPTH THE LAST CASCADE REACHES, 0 MEANS farPlane
+	float shadowDistance = 0.0f;
+	// A CASCADE IS ONLY MOVED WHEN ITS SLICE OF THE VIEW HAS USED UP THIS MUCH BORDER
+	// (FRACTION OF THE SLICE RADIUS), OR THE SUN HAS TURNED MORE THAN THIS MANY DEGREES
+	float shadowCacheMargin = 0.25f;
+	float shadowLightThreshold = 1.0f;
+	// DIRECTION THE SUNLIGHT TRAVELS, IT TURNS AROUND Y AT sunSpeed DEGREES PER SECOND
+	glm::vec3 sunDirection = glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f));
+	float sunIntensity = 1.0f;
+	float sunSpeed = 0.0f;
+
+	// GPU PARTICLES (SEE Particles.cpp), SIMULATED ON THE COMPUTE QUEUE, 0 TURNS THEM OFF
+	uint32_t particleCount = 0;
+	// SECONDS, EACH PARTICLE LIVES BETWEEN HALF OF IT AND ALL OF IT
+	float particleLifetime = 3.0f;
+	// MUST MATCH THE PARTICLE SHADERS
+	static constexpr uint32_t PARTICLE_GROUP_SIZE = 64;
+
+	// COMPUTE POST PROCESSING (SEE PostProcess.cpp): BLOOM, TONEMAP, COLOR GRADING, SHARPENING
+	bool postProcess = false;
+	// LEVELS OF THE BLOOM CHAIN, THE FIRST IS HALF THE VIEW SIZE, EVERY ONE AFTER HALF THE ONE BEFORE
+	uint32_t bloomLevels = 5;
+	// EXPOSURE, BLOOM AND GRADING, THE REST IS FILLED WHILE RECORDING
+	PostConstants postSettings;
+	// MUST MATCH post.comp
+	static constexpr uint32_t POST_TILE_SIZE = 16;
+
+	// BATCH RENDERING (SEE Batch.cpp), A JOB LIST OF MODELS AND CAMERAS INSTEAD OF THE WINDOW
+	std::string batchPath;
+	std::string batchOutput = "batch";
+	// PASSES OVER THE JOB LIST IN LIST ORDER, 0 SORTS THE JOBS BY MODEL AND RUNS THEM ONCE
+	uint32_t batchChurn = 0;
+	// DRAW THE BATCH ON THE CPU EVEN IF THERE IS A GPU, WITHOUT ONE IT IS USED ANYWAY
+	bool softwareRendering = false;
+
+	// SINGLE PASS STEREO (SEE Stereo.cpp), BOTH EYES SIDE BY SIDE IN THE WINDOW
+	bool stereo = false;
+	// MUST MATCH Vertex.vert
+	static constexpr uint32_t MAX_VIEWS = 2;
+	// DISTANCE BETWEEN THE EYES IN WORLD UNITS
+	float eyeSeparation = 0.064f;
+
+	// DYNAMIC RESOLUTION
+	// THE SCENE IS DRAWN AT A FRACTION OF THE WINDOW SIZE THAT FOLLOWS THE GPU TIME
+	bool dynamicResolution = false;
+	float targetFrameRate = 60.0f;
+	float minRenderScale = 0.5f;
+	ResolutionController resolutionController;
+
+	// MEMORY STATISTICS, PRESS M TO WRITE THEM, ALSO WRITTEN ON EXIT IF A PATH IS GIVEN
+	MemoryTracker memoryTracker;
+	std::string memoryReportPath;
+	bool memoryKeyDown = false;
+
+	// ONLINE DEFRAGMENTATION (SEE Defragment.cpp), THE CACHED ASSETS LIVE IN memoryPool BLOCKS
+	// AND EVERY FRAME UP TO defragBudget BYTES OF THEM ARE MOVED OUT OF THE EMPTIEST ONE
+	DeviceMemoryPool memoryPool;
+	vk::DeviceSize memoryBlockSize = vk::DeviceSize(64) * 1024 * 1024;
+	bool defragment = true;
+	vk::DeviceSize defragBudget = vk::DeviceSize(16) * 1024 * 1024;
+
+	// CPU PROFILER TRACE, WRITTEN ON EXIT IF A PATH IS GIVEN (SEE Profiler.h)
+	std::string profilePath;
+
+	// STREAMED WORLD (SEE WorldPartition.h), COPIES OF THE MODEL PLACED CELL BY CELL
+	// ONLY THE MODEL IS DRAWN WITHOUT ONE
+	std::string worldPath;
+	WorldStreamingSettings worldSettings;
 
 	// MOUSE STATE
 	float lastX = WIDTH / 2;
 	float lastY = HEIGHT / 2;
 	float sensitivity = 0.1;
 
-	// TIME
-	float deltaTime = 0;
-	float lastFrame = 0;
+	bool hasLastCursor = false;
+
+	// SIMULATION RUNS ON ITS OWN THREAD AT A FIXED RATE
+	// AND ONLY PUBLISHES SNAPSHOTS TO THE RENDER THREAD
+	double simulationRate = 120.0;
+	uint64_t simulationTick = 0;
+	// HOW OFTEN THE MAIN THREAD WAKES UP TO SAMPLE INPUT
+	double inputPollInterval = 0.001;
 
 	// ----- FUNCTIONS -----
 
 
+	void parseCommandLine(int argc, char* argv[]);
+
+	// RUNS ALL THE create* STEPS BELOW AS A DEPENDENCY GRAPH
+	void init();
+
 	void initWindow();
 
 	void createInstance();
@@ -108,14 +254,19 @@ public:
 
 	void createFramebuffers();
 
-	void createTextureImage();
+	void decodeTextureImage();
 
-	void createTextureImageView();
+	// ALSO CREATES THE VIEW, BOTH ARE CACHED TOGETHER
+	void createTextureImage();
+	// STAGING UPLOAD OF texturePixels, WHAT THE CACHE CALLS ON A MISS
+	GpuResource uploadTexture();
 
 	void createTextureSampler();
 
 	void loadModel();
 
+	void openWorld();
+
 	void createVertexBuffer();
 
 	void createIndexBuffer();
@@ -130,99 +281,370 @@ public:
 
 	void createSyncObjects();
 
+	void createLights();
+
+	void createClusterBuffers();
+
+	void createClusterPipeline();
+
+	void createDepthPrepassRenderPass();
+
+	void createDepthPrepassPipeline();
+
+	void createDepthPrepassFramebuffer();
+
+	void createOcclusionPipelines();
+
+	void createHiZResources();
+
+	void createOcclusionBuffer();
+
+	void createDrawBuffers();
+
+	void createRenderTarget();
+
+	void createTimestampQueries();
+
+	void createBatchResources();
+
+	void createShadowRenderPass();
+
+	void createShadowPipeline();
+
+	void createShadowResources();
+
+	void createShadowBuffers();
+
+	void createParticleResources();
+
+	void createParticlePipelines();
+
+	void createParticleRenderPipeline();
+
+	void createParticleBuffers();
+
+	void createPostPipelines();
+
+	void createPostResources();
+
 	void clean();
 
 	void drawFrame();
 
-	void mainLoop() {
-		while (!glfwWindowShouldClose(window)) {
-			glfwPollEvents();
-
-			// KEY BULLSHIT
-			float cameraSpeed = 2.5 * deltaTime;
-			if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-				cameraPos += cameraSpeed * cameraFront;
-			if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-				cameraPos -= cameraSpeed * cameraFront;
-			if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-				cameraPos -= cameraSpeed * glm::normalize(glm::cross(cameraFront, cameraUp));
-			if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-				cameraPos += cameraSpeed * glm::normalize(glm::cross(cameraFront, cameraUp));
-
-			// MOUSE BULLSHIT
-			double xpos, ypos;
-			glfwGetCursorPos(window, &xpos, &ypos);
-			yaw += (xpos - lastX) * sensitivity;
-			pitch += (lastY - ypos) * sensitivity;
-			lastX = xpos;
-			lastY = ypos;
-			// CORRECT PITCH
-			if (pitch > 89.0f) pitch = 89.0f;
-			if (pitch < -89.0f) pitch = -89.0f;
-			/*
-			cameraFront.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
-			cameraFront.y = sin(glm::radians(pitch));
-			cameraFront.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
-			cameraFront = glm::normalize(cameraFront);
-			*/
-			drawFrame();
-		}
-
-		device->waitIdle();
-	}
+	void mainLoop();
+
+	bool batchMode() const { return !batchPath.empty(); }
 
+	// RENDERS EVERY JOB IN batchPath, RUNS INSTEAD OF mainLoop
+	void runBatch();
+
+	// SAME JOBS DRAWN BY SoftwareRasterizer, RUNS INSTEAD OF init AND runBatch (SEE Batch.cpp)
+	void runSoftwareBatch();
+
+	// clean FOR WHEN THERE IS NO DEVICE, ONLY WHAT init GOT TO IS DESTROYED
+	void cleanSoftware();
 
 	// ----- VARIABLES -----
 
-	GLFWwindow* window;
+	GLFWwindow* window = nullptr;
 	vk::UniqueInstance instance;
-	VkDebugUtilsMessengerEXT debugMessenger;
+	VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE;
 	vk::SurfaceKHR surface;
 	vk::PhysicalDevice physicalDevice;
 	vk::UniqueDevice device;
 	vk::Queue graphicsQueue;
 	vk::Queue presentQueue;
 	vk::Queue computeQueue;
+	// UPLOADS, ON THE COPY ENGINE WHEN THE DEVICE HAS ONE
+	vk::Queue transferQueue;
+	// WHAT THE QUEUES ABOVE WERE TAKEN FROM
+	QueueFamilyIndices queueFamilies;
+	// HELD WHILE A ONE TIME SUBMIT WAITS, SEE queueMutex
+	std::mutex graphicsQueueMutex;
+	std::mutex computeQueueMutex;
+	std::mutex transferQueueMutex;
+	// DEVICE SELECTION
+	// PART OF THE NAME OR THE UUID OF THE DEVICE TO USE, EMPTY PICKS BY SCORE
+	std::string gpuOverride;
+	// FALSE PUTS COMPUTE AND UPLOADS ON THE GRAPHICS FAMILY (FOR COMPARISON)
+	bool dedicatedQueues = true;
 	vk::SwapchainKHR swapChain;
 	vk::SwapchainKHR swapChain2;
 	std::vector<vk::Image> swapChainImages;
 	vk::Format swapChainImageFormat;
 	vk::Extent2D swapChainExtent;
+	// SIZE OF ONE VIEW, THE SCENE TARGETS ARE THIS BIG (HALF THE WIDTH IN STEREO)
+	vk::Extent2D viewExtent;
+	vk::PresentModeKHR activePresentMode;
 	std::vector<vk::ImageView> swapChainImageViews;
 	vk::RenderPass renderPass;
 	vk::DescriptorSetLayout descriptorSetLayout;
 	vk::PipelineLayout pipelineLayout;
 	vk::Pipeline graphicsPipeline;
 	vk::CommandPool commandPool;
+	// FOR beginTransferCommands, ITS OWN POOL SO UPLOADS AND GRAPHICS ONE TIME COMMANDS CAN OVERLAP
+	vk::CommandPool transferCommandPool;
 	vk::Image depthImage;
 	vk::DeviceMemory depthImageMemory;
 	vk::ImageView depthImageView;
 	std::vector<vk::Framebuffer> swapChainFramebuffers;
+	// OWNED BY textureResource
 	vk::Image textureImage;
-	vk::DeviceMemory textureImageMemory;
 	vk::ImageView textureImageView;
 	vk::Sampler textureSampler;
+	// DECODED PIXELS WAITING FOR UPLOAD (stbi_uc*)
+	unsigned char* texturePixels = nullptr;
+	std::string texturePath;
+	// OF THE FILE, NOT THE PIXELS
+	uint64_t textureHash = 0;
+	// SOME TEXELS ARE MEANT TO BE CUT OUT, THE MAIN PIPELINE NEEDS THE ALPHA TEST
+	// AND THE DEPTH ONLY PASSES DRAW WITH cutout.frag
+	bool textureHasCutout = false;
+	int textureWidth = 0;
+	int textureHeight = 0;
 	// MODEL
 	std::vector<Vertex> vertices;
 	std::vector<uint32_t> indices;
+	// THE TWO STREAMS OF vertices WHEN splitVertexStreams, mesh POINTS INTO THEM
+	std::vector<glm::vec3> vertexPositions;
+	std::vector<VertexAttributes> vertexAttributes;
+	// WHAT GOES INTO THE VERTEX / INDEX BUFFERS AND HOW THE PIPELINES READ THEM
+	MeshSource mesh;
+	// mesh.layout WITH ONLY THE POSITIONS, THE DEPTH PREPASS AND THE SHADOWS DRAW WITH IT
+	VertexLayout depthLayout;
+	// THE POSITIONS AND THE TEXCOORDS, WHAT THEY DRAW WITH INSTEAD WHEN textureHasCutout
+	VertexLayout cutoutDepthLayout;
+	// ONLY WHILE A .glb IS BEING UPLOADED, mesh POINTS INTO IT
+	std::unique_ptr<GlbFile> glbFile;
+	glm::vec3 modelBoundsMin = glm::vec3(0.0f);
+	glm::vec3 modelBoundsMax = glm::vec3(0.0f);
 	//------
+	// VISIBILITY
+	CullingScene cullingScene;
+	CullShape cullShape = CullShape::Sphere;
+	uint32_t modelObject = 0;
+	// FILLED EVERY FRAME BY updateUniformBuffer
+	std::vector<uint32_t> visibleObjects;
+	// ADDS AND REMOVES OBJECTS IN cullingScene AS THE CAMERA MOVES
+	WorldPartition worldPartition;
+	// OWNED BY vertexResource / indexResource
 	vk::Buffer vertexBuffer;
-	vk::DeviceMemory vertexBufferMemory;
 	vk::Buffer indexBuffer;
-	vk::DeviceMemory indexBufferMemory;
+	// ASSETS ON THE GPU, SHARED BY PATH AND CONTENT
+	// UNREFERENCED ONES ARE EVICTED WHEN THE CACHE GOES OVER resourceBudget BYTES
+	ResourceCache resourceCache;
+	vk::DeviceSize resourceBudget = vk::DeviceSize(256) * 1024 * 1024;
+	ResourceHandle textureResource;
+	ResourceHandle vertexResource;
+	ResourceHandle indexResource;
+	// PIPELINES BY FEATURES AND STATE, KEPT ON DISK UNDER shaderCachePath (EMPTY TURNS THAT OFF)
+	ShaderVariantCache shaderVariants;
+	std::string shaderCachePath = "ShaderCache/";
 	std::vector<vk::Buffer> uniformBuffers;
 	std::vector<vk::DeviceMemory> uniformBuffersMemory;
+	// LIGHTS
+	std::vector<PointLight> lights;
+	std::vector<float> lightOrbitSpeeds;
+	std::vector<vk::Buffer> lightBuffers;
+	std::vector<vk::DeviceMemory> lightBuffersMemory;
+	std::vector<vk::Buffer> clusterBuffers;
+	std::vector<vk::DeviceMemory> clusterBuffersMemory;
+	std::vector<vk::Buffer> lightIndexBuffers;
+	std::vector<vk::DeviceMemory> lightIndexBuffersMemory;
+	// HOW MANY INDICES EACH IMAGE'S POOL HOLDS, BEHIND lightIndexCapacity UNTIL THE IMAGE IS FREE TO GROW
+	std::vector<uint32_t> lightIndexBufferCapacities;
+	// THE COUNTERS AT THE START OF THE POOL, COPIED BACK EVERY FRAME
+	std::vector<vk::Buffer> lightIndexReadbackBuffers;
+	std::vector<vk::DeviceMemory> lightIndexReadbackBuffersMemory;
+	// LIGHT INDICES THE CLUSTERS COULD NOT STORE, OVER THE WHOLE RUN
+	uint64_t droppedLightIndices = 0;
+	vk::PipelineLayout clusterPipelineLayout;
+	vk::Pipeline clusterPipeline;
+	//------
+	// OCCLUSION
+	vk::RenderPass depthPrepassRenderPass;
+	vk::Framebuffer depthPrepassFramebuffer;
+	vk::Pipeline depthPrepassPipeline;
+	vk::Image hiZImage;
+	vk::DeviceMemory hiZImageMemory;
+	vk::ImageView hiZImageView;
+	std::vector<vk::ImageView> hiZMipViews;
+	vk::Extent2D hiZExtent;
+	uint32_t hiZMipCount = 1;
+	vk::Sampler hiZSampler;
+	vk::DescriptorSetLayout hiZDescriptorSetLayout;
+	vk::DescriptorPool hiZDescriptorPool;
+	std::vector<vk::DescriptorSet> hiZDescriptorSets;
+	vk::PipelineLayout hiZPipelineLayout;
+	vk::Pipeline hiZPipeline;
+	vk::PipelineLayout occlusionPipelineLayout;
+	vk::Pipeline occlusionPipeline;
+	// ONE FLAG PER OBJECT, SHARED BY ALL FRAMES
+	vk::Buffer occlusionBuffer;
+	vk::DeviceMemory occlusionBufferMemory;
+	std::vector<vk::Buffer> drawObjectBuffers;
+	std::vector<vk::DeviceMemory> drawObjectBuffersMemory;
+	std::vector<vk::Buffer> indirectBuffers;
+	std::vector<vk::DeviceMemory> indirectBuffersMemory;
+	//------
+	// CASCADED SHADOW MAPS
+	struct ShadowCascade {
+		bool valid = false;
+		// WHAT THE CASCADE WAS LAST RENDERED FOR
+		glm::vec3 light = glm::vec3(0.0f);
+		glm::vec3 sliceCenter = glm::vec3(0.0f);
+		float sliceRadius = 0.0f;
+		glm::mat4 matrix = glm::mat4(1.0f);
+		// HASH OF THE CASTERS AND THEIR MATRICES
+		uint64_t contents = 0;
+	};
+	std::array<ShadowCascade, MAX_SHADOW_CASCADES> shadowCascades;
+	vk::Image shadowImage;
+	vk::DeviceMemory shadowImageMemory;
+	// ALL CASCADES, FOR SAMPLING
+	vk::ImageView shadowImageView;
+	// ONE PER CASCADE, FOR RENDERING
+	std::vector<vk::ImageView> shadowLayerViews;
+	std::vector<vk::Framebuffer> shadowFramebuffers;
+	vk::RenderPass shadowRenderPass;
+	vk::PipelineLayout shadowPipelineLayout;
+	vk::Pipeline shadowPipeline;
+	vk::Sampler shadowSampler;
+	// PER SWAPCHAIN IMAGE: CASTER MATRICES (MAX_DRAW_OBJECTS PER CASCADE) AND ONE INDIRECT DRAW PER CASCADE
+	std::vector<vk::Buffer> shadowObjectBuffers;
+	std::vector<vk::DeviceMemory> shadowObjectBuffersMemory;
+	std::vector<vk::Buffer> shadowIndirectBuffers;
+	std::vector<vk::DeviceMemory> shadowIndirectBuffersMemory;
+	// CASCADES EACH COMMAND BUFFER RENDERS, ONE BIT PER CASCADE
+	std::vector<uint32_t> shadowRenderMasks;
+	std::vector<uint32_t> shadowCasters;
+	std::vector<glm::mat4> shadowCasterModels;
+	// CASCADES USED AND CASCADES RENDERED, SUMMED OVER ALL FRAMES
+	uint64_t shadowCascadeFrames = 0;
+	uint64_t shadowCascadeRenders = 0;
+	//------
+	// GPU PARTICLES
+	// STATE, COUNTERS AND LISTS ONLY EVER LIVE ON THE COMPUTE QUEUE
+	vk::Buffer particleBuffer;
+	vk::DeviceMemory particleBufferMemory;
+	vk::Buffer particleCounterBuffer;
+	vk::DeviceMemory particleCounterBufferMemory;
+	vk::Buffer particleListBuffer;
+	vk::DeviceMemory particleListBufferMemory;
+	// PER SWAPCHAIN IMAGE, THE INSTANCES AND THEIR DRAW ARE HANDED TO THE GRAPHICS QUEUE
+	std::vector<vk::Buffer> particleParamBuffers;
+	std::vector<vk::DeviceMemory> particleParamBuffersMemory;
+	std::vector<vk::Buffer> particleInstanceBuffers;
+	std::vector<vk::DeviceMemory> particleInstanceBuffersMemory;
+	std::vector<vk::Buffer> particleDrawBuffers;
+	std::vector<vk::DeviceMemory> particleDrawBuffersMemory;
+	vk::DescriptorSetLayout particleDescriptorSetLayout;
+	vk::DescriptorPool particleDescriptorPool;
+	std::vector<vk::DescriptorSet> particleDescriptorSets;
+	vk::PipelineLayout particlePipelineLayout;
+	vk::Pipeline particleEmitPipeline;
+	vk::Pipeline particleSimulatePipeline;
+	vk::Pipeline particleCompactPipeline;
+	vk::PipelineLayout particleRenderPipelineLayout;
+	vk::Pipeline particleRenderPipeline;
+	// ON THE COMPUTE QUEUE FAMILY, TWO COMMAND BUFFERS PER SWAPCHAIN IMAGE (ONE PER PARITY)
+	vk::CommandPool particleCommandPool;
+	std::vector<vk::CommandBuffer> particleCommandBuffers;
+	// PER FRAME IN FLIGHT, SIGNALED BY THE SIMULATION, WAITED ON BY THE FRAME THAT DRAWS IT
+	std::vector<vk::Semaphore> particleSemaphores;
+	// WHICH ALIVE LIST THE NEXT SIMULATION STARTS FROM
+	uint32_t particleParity = 0;
+	// SIMULATION TIME OF THE LAST STEP AND THE FRACTION OF A PARTICLE NOT EMITTED YET
+	double particleTime = 0.0;
+	float particleEmitCarry = 0.0f;
+	//------
+	// DYNAMIC RESOLUTION AND STEREO, ONE LAYER PER VIEW
+	vk::Image sceneColorImage;
+	vk::DeviceMemory sceneColorImageMemory;
+	vk::ImageView sceneColorImageView;
+	// THE TOP LEFT PART OF THE TARGETS THE SCENE IS DRAWN INTO
+	vk::Extent2D renderExtent;
+	// renderExtent AT THE TIME EACH COMMAND BUFFER WAS RECORDED
+	std::vector<vk::Extent2D> recordedRenderExtents;
+	// START AND END OF EVERY COMMAND BUFFER
+	vk::QueryPool timestampQueryPool;
+	std::vector<bool> timestampsWritten;
+	float timestampPeriod = 1.0f;
+	uint64_t timestampMask = ~0ull;
+	//------
+	// POST PROCESSING
+	vk::Sampler postSampler;
+	vk::DescriptorSetLayout bloomDescriptorSetLayout;
+	vk::DescriptorSetLayout postDescriptorSetLayout;
+	vk::PipelineLayout bloomPipelineLayout;
+	vk::PipelineLayout postPipelineLayout;
+	vk::Pipeline bloomDownsamplePipeline;
+	vk::Pipeline bloomUpsamplePipeline;
+	vk::Pipeline postPipeline;
+	// ONE LAYER PER VIEW, ONE VIEW PER LEVEL
+	vk::Image bloomImage;
+	vk::DeviceMemory bloomImageMemory;
+	std::vector<vk::ImageView> bloomLevelViews;
+	std::vector<vk::Extent2D> bloomExtents;
+	// ONLY WHEN THE SWAPCHAIN CAN NOT BE A STORAGE IMAGE, BLITTED INTO IT AFTERWARDS
+	vk::Image postOutputImage;
+	vk::DeviceMemory postOutputImageMemory;
+	vk::ImageView postOutputImageView;
+	// THE FUSED PASS WRITES THE SWAPCHAIN IMAGE ITSELF
+	bool postDirectOutput = false;
+	vk::DescriptorPool postDescriptorPool;
+	std::vector<vk::DescriptorSet> bloomDownsampleSets;
+	std::vector<vk::DescriptorSet> bloomUpsampleSets;
+	// ONE PER SWAPCHAIN IMAGE, THEY ONLY DIFFER IN THE OUTPUT
+	std::vector<vk::DescriptorSet> postDescriptorSets;
+	//------
+	// BATCH, ONE PER FRAME SLOT
+	std::vector<vk::Buffer> readbackBuffers;
+	std::vector<vk::DeviceMemory> readbackBuffersMemory;
+	std::vector<void*> readbackData;
+	std::vector<vk::Fence> batchFences;
+	// defragmentIdle WAITS ON IT
+	vk::Fence defragFence;
+	//------
 	vk::DescriptorPool descriptorPool;
 	std::vector<vk::DescriptorSet> descriptorSets;
 	std::vector<vk::CommandBuffer> commandBuffers;
+	// DEFRAGMENTATION COPIES, ONE PER FRAME IN FLIGHT FROM commandPool
+	std::vector<vk::CommandBuffer> defragCommandBuffers;
+	// PER SWAPCHAIN IMAGE, ITS DESCRIPTOR SET AND COMMAND BUFFER STILL NAME MOVED RESOURCES
+	std::vector<bool> staleImages;
 	std::vector<vk::Semaphore> imageAvailableSemaphores;
 	std::vector<vk::Semaphore> renderFinishedSemaphores;
 	std::vector<vk::Fence> inFlightFences;
 	std::vector<vk::Fence> imagesInFlight;
 
-	int currentFrame;
+	int currentFrame = 0;
+	// FRAMES SUBMITTED SO FAR, THE RESOURCE CACHE DESTROYS BY IT
+	uint64_t frameNumber = 0;
 	bool framebufferResized = false;
 
+	// STARTUP
+	// RUN THE INIT STEPS ONE BY ONE INSTEAD OF AS A GRAPH (FOR COMPARISON)
+	bool serialStartup = false;
+	std::chrono::steady_clock::time_point startupBegin;
+	bool firstFramePresented = false;
+
+	// THREADING
+	// ONE POOL FOR ALL PARALLEL WORK, 0 WORKERS MEANS ONE PER CORE
+	uint32_t workerThreadCount = 0;
+	JobSystem jobSystem;
+	std::atomic<bool> running{ false };
+	std::thread simulationThread;
+	std::thread renderThread;
+	std::exception_ptr renderError;
+	TripleBuffer<InputState> inputBuffer;
+	TripleBuffer<FrameSnapshot> snapshotBuffer;
+	// ONLY TOUCHED BY THE RENDER THREAD
+	FrameSnapshot frameSnapshot;
+	// WRITTEN BY THE MAIN THREAD, GLFW CAN ONLY BE ASKED FROM THERE
+	std::atomic<int> framebufferWidth{ 0 };
+	std::atomic<int> framebufferHeight{ 0 };
+
 private:
 	// ----- FUNCTIONS -----
 	std::vector<const char*> getRequiredExtensions();
@@ -242,19 +664,29 @@ private:
 
 	bool isDeviceSuitable(const vk::PhysicalDevice &device);
 
+	// HIGHER IS BETTER: DEVICE TYPE FIRST, THEN VRAM, THE FEATURES THE OPTIONS WANT AND DEDICATED QUEUES
+	uint64_t scorePhysicalDevice(const vk::PhysicalDevice& device);
+
+	// WHETHER gpuOverride NAMES device
+	bool matchesGpuOverride(const vk::PhysicalDevice& device);
+
 	QueueFamilyIndices findQueueFamilies(const vk::PhysicalDevice &device);
 
 	bool checkDeviceExtensionSupport(const vk::PhysicalDevice &device);
 
+	bool isDeviceExtensionAvailable(const vk::PhysicalDevice& device, const char* name);
+
 	SwapChainSupportDetails querySwapChainSupport(const vk::PhysicalDevice &device);
 
 	vk::SurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& availableFormats);
 
 	vk::PresentModeKHR chooseSwapPresentMode(const std::vector<vk::PresentModeKHR>& availablePresentModes);
 
+	uint32_t chooseSwapImageCount(const vk::SurfaceCapabilitiesKHR& capabilities);
+
 	vk::Extent2D chooseSwapExtent(const vk::SurfaceCapabilitiesKHR& capabilities);
 
-	vk::ImageView createImageView(vk::Image image, vk::Format format, vk::ImageAspectFlags aspectFlags);
+	vk::ImageView createImageView(vk::Image image, vk::Format format, vk::ImageAspectFlags aspectFlags, uint32_t baseMipLevel = 0, uint32_t levelCount = 1, vk::ImageViewType viewType = vk::ImageViewType::e2D, uint32_t baseArrayLayer = 0, uint32_t layerCount = 1);
 
 	vk::Format findDepthFormat();
 
@@ -270,23 +702,60 @@ private:
 		vk::ImageUsageFlags usage,
 		vk::MemoryPropertyFlags properties,
 		vk::Image& image,
-		vk::DeviceMemory& imageMemory);
+		vk::DeviceMemory& imageMemory,
+		uint32_t mipLevels = 1,
+		uint32_t arrayLayers = 1,
+		const std::vector<uint32_t>& sharedFamilies = {});
 
 	void createBuffer(
 		vk::DeviceSize size,
 		vk::BufferUsageFlags usage,
 		vk::MemoryPropertyFlags properties,
 		vk::Buffer& buffer,
-		vk::DeviceMemory& bufferMemory);
+		vk::DeviceMemory& bufferMemory,
+		const std::vector<uint32_t>& sharedFamilies = {});
 
 	uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
 
+	// device->freeMemory PLUS THE BOOKKEEPING FOR memoryTracker
+	void freeMemory(vk::DeviceMemory memory);
+
+	// WHAT THE RESOURCE CACHE CALLS ONCE THE GPU IS DONE WITH A RESOURCE
+	void destroyGpuResource(const GpuResource& resource);
+
+	// DEVICE LOCAL FROM memoryPool FOR WHAT THE RESOURCE CACHE OWNS, owner IS THE CACHE HASH
+	// WITH at THE RANGE IS ALREADY RESERVED (A DEFRAGMENTATION MOVE)
+	void createPooledBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, uint64_t owner, GpuResource& resource, const PoolAllocation& at = PoolAllocation());
+	void createPooledImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageUsageFlags usage, uint64_t owner, GpuResource& resource, const PoolAllocation& at = PoolAllocation());
+
+	// DEVICE LOCAL BUFFER FILLED FROM ranges THROUGH A STAGING BUFFER, CACHED UNDER path
+	ResourceHandle uploadBuffer(const std::string& path, const std::vector<UploadRange>& ranges, vk::DeviceSize size, vk::BufferUsageFlags usage);
+
+	void writeMemoryReport(const std::string& path);
+
 	void transitionImageLayout(vk::Image image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
 
+	// ON graphicsQueue FROM commandPool
 	vk::CommandBuffer beginSingleTimeCommands();
 
 	void endSingleTimeCommands(vk::CommandBuffer commandBuffer);
 
+	// ON transferQueue FROM transferCommandPool, ONLY COPIES AND TRANSFER BARRIERS
+	vk::CommandBuffer beginTransferCommands();
+
+	void endTransferCommands(vk::CommandBuffer commandBuffer);
+
+	vk::CommandBuffer beginOneTimeCommands(vk::CommandPool pool);
+
+	// SUBMITS AND WAITS FOR THE QUEUE, THEN FREES THE COMMAND BUFFER BACK TO pool
+	void submitOneTimeCommands(vk::CommandBuffer commandBuffer, vk::CommandPool pool, vk::Queue queue);
+
+	// THE LOCK FOR SUBMITTING TO queue FROM THE STARTUP JOBS
+	std::mutex& queueMutex(vk::Queue queue);
+
+	// THE FAMILIES AN UPLOADED RESOURCE IS SHARED BY, FOR createBuffer AND createImage
+	std::vector<uint32_t> uploadQueueFamilies();
+
 	void copyBufferToImage(vk::Buffer buffer, vk::Image image, uint32_t width, uint32_t height);
 
 	void copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size);
@@ -297,4 +766,164 @@ private:
 
 	void updateUniformBuffer(uint32_t currentImage);
 
+	void updateLights(uint32_t currentImage);
+
+	// WHERE LIGHT i IS AT tick, SHARED WITH THE SOFTWARE RENDERER
+	glm::vec3 orbitingLightPosition(size_t i, uint64_t tick) const;
+
+	// DIRECTION THE SUNLIGHT TRAVELS AT tick
+	glm::vec3 sunDirectionAt(uint64_t tick) const;
+
+	void recordLightCulling(vk::CommandBuffer commandBuffer, size_t image);
+
+	// READS WHAT THE LAST FRAME OF image DROPPED AND GROWS ITS POOL IF IT IS TOO SMALL
+	// ONLY ONCE THE GPU IS DONE WITH image
+	void checkLightIndexPool(size_t image);
+
+	void createLightIndexBuffer(size_t image);
+
+	// WHAT ONE STORAGE BUFFER DESCRIPTOR CAN HOLD ON THIS GPU
+	uint32_t maxLightIndexCapacity() const;
+
+	void destroyClusterBuffers();
+
+	void destroyHiZResources();
+
+	void destroyDrawBuffers();
+
+	void updateDrawObjects(uint32_t currentImage);
+
+	// EVERYTHING BETWEEN THE LIGHT CULLING AND THE MAIN RENDER PASS
+	void recordVisibility(vk::CommandBuffer commandBuffer, size_t image);
+
+	void recordOcclusionPhase(vk::CommandBuffer commandBuffer, size_t image, uint32_t phase, bool useHiZ);
+
+	void recordDepthPrepass(vk::CommandBuffer commandBuffer, size_t image);
+
+	void recordHiZBuild(vk::CommandBuffer commandBuffer);
+
+	// PICKS THE CASCADES, FILLS THEIR PART OF ubo AND THE CASTER LISTS OF THE ONES THAT CHANGED
+	void updateShadows(uint32_t currentImage, UniformBufferObject& ubo);
+
+	// ONLY THE CASCADES IN shadowRenderMasks[image]
+	void recordShadows(vk::CommandBuffer commandBuffer, size_t image);
+
+	void destroyShadowBuffers();
+
+	void destroyShadowResources();
+
+	// LAYERS OF THE SHADOW MAP, ONE EVEN WITHOUT SHADOWS SO THE DESCRIPTOR HAS AN IMAGE
+	uint32_t shadowLayers() const { return shadows ? shadowCascadeCount : 1; }
+
+	void recordCommandBuffer(size_t image);
+
+	// THE FEATURES OF THE MAIN FRAGMENT SHADER THIS SCENE USES (ShaderFeature BITS)
+	uint32_t sceneShaderFeatures() const;
+
+	bool checkBlitSupport(const vk::SurfaceCapabilitiesKHR& capabilities, vk::Format format);
+
+	bool checkDynamicResolutionSupport(const vk::SurfaceCapabilitiesKHR& capabilities, vk::Format format);
+
+	bool checkMultiviewSupport();
+
+	// PER EYE MATRICES, view / proj BECOME THE CAMERA THAT CULLS AND BUILDS THE CLUSTERS
+	void updateViews(const FrameSnapshot& snapshot, UniformBufferObject& ubo, float& cullNear, float& cullFar);
+
+	uint32_t viewCount() const { return stereo ? MAX_VIEWS : 1; }
+
+	// THE SCENE IS DRAWN INTO sceneColorImage AND BLITTED TO THE SWAPCHAIN (OR READ BACK, OR POST PROCESSED)
+	bool offscreenTarget() const { return dynamicResolution || stereo || batchMode() || postProcess; }
+
+	// HDR WHEN IT IS POST PROCESSED, OTHERWISE IT IS BLITTED SO IT MATCHES THE SWAPCHAIN
+	vk::Format sceneColorFormat() const { return postProcess ? vk::Format::eR16G16B16A16Sfloat : swapChainImageFormat; }
+
+	// A UNORM SURFACE FORMAT THE FUSED PASS CAN WRITE AS A STORAGE IMAGE, IF THERE IS ONE
+	bool choosePostOutputFormat(const SwapChainSupportDetails& support, vk::SurfaceFormatKHR& format);
+
+	// BLOOM CHAIN, THEN THE FUSED TONEMAP / GRADE / SHARPEN PASS INTO THE SWAPCHAIN IMAGE
+	void recordPostProcess(vk::CommandBuffer commandBuffer, size_t image);
+
+	void destroyPostResources();
+
+	void destroyPostPipelines();
+
+	// FILLS THIS IMAGE'S PARAMETERS FOR THE NEXT SIMULATION STEP
+	void updateParticles(uint32_t currentImage);
+
+	// SUBMITS THE STEP TO computeQueue, THE FRAME HAS TO WAIT FOR THE RETURNED SEMAPHORE
+	vk::Semaphore submitParticleSimulation(uint32_t currentImage);
+
+	// EMIT, SIMULATE AND COMPACT FOR ONE IMAGE AND ONE PARITY OF THE ALIVE LISTS
+	void recordParticleSimulation(size_t image, uint32_t parity);
+
+	// OUTSIDE THE RENDER PASS, TAKES THE IMAGE'S INSTANCES OVER FROM THE COMPUTE QUEUE
+	void recordParticleAcquire(vk::CommandBuffer commandBuffer, size_t image);
+
+	// INSIDE THE MAIN RENDER PASS, AFTER THE SCENE
+	void recordParticleDraw(vk::CommandBuffer commandBuffer, size_t image);
+
+	void destroyParticleBuffers();
+
+	void destroyParticleResources();
+
+	// MOST PARTICLES ONE STEP CAN EMIT, THE STEP IS NEVER LONGER THAN A TENTH OF A SECOND
+	uint32_t particleEmitLimit() const { return static_cast<uint32_t>(std::ceil(particleCount * 0.1f / particleLifetime)) + 1; }
+
+	// PLANS AND RECORDS THIS FRAME'S MOVES, THE RETURNED COMMAND BUFFER (OR NULL) IS SUBMITTED
+	// RIGHT BEFORE THE FRAME'S. ALSO FIXES UP currentImage IF IT STILL USES MOVED RESOURCES
+	vk::CommandBuffer defragmentMemory(uint32_t currentImage);
+
+	// THE SAME WHEN NOTHING IS IN FLIGHT (BETWEEN BATCH MODELS): SUBMITS AND WAITS FOR THE COPIES
+	// ITSELF AND FIXES UP EVERY IMAGE, TRUE IF ANYTHING MOVED (EVERY COMMAND BUFFER WAS RECORDED)
+	bool defragmentIdle();
+
+	// ONE OF defragCommandBuffers, ALLOCATED THE FIRST TIME
+	vk::CommandBuffer defragCommandBuffer(size_t index);
+
+	// RECORDS THE COPIES OF moves, RETURNS HOW MANY OWNERS WERE STILL THERE TO BE MOVED
+	size_t recordDefragmentation(const std::vector<DeviceMemoryPool::Move>& moves, vk::CommandBuffer commandBuffer);
+
+	// PICKS UP THE MOVED TEXTURE, VERTEX AND INDEX BUFFER FROM THEIR CACHE HANDLES
+	void useMovedResources();
+
+	// THE NEW RESOURCE BOUND AT to, WITH THE COPY FROM old RECORDED INTO commandBuffer
+	GpuResource moveResource(const GpuResource& old, const PoolAllocation& to, vk::CommandBuffer commandBuffer);
+
+	// POINTS THE IMAGE'S DESCRIPTOR SET AND COMMAND BUFFER AT THE CURRENT RESOURCES
+	void refreshMovedResources(uint32_t currentImage);
+
+	void destroyBatchResources();
+
+	// COPIES THE FINISHED IMAGE INTO THE SLOT'S READBACK BUFFER
+	void recordReadback(vk::CommandBuffer commandBuffer, size_t image);
+
+	// LOADS ANOTHER MODEL BETWEEN BATCH JOBS, THE DEVICE IS IDLED FIRST
+	void switchBatchModel(const std::string& path);
+
+	vk::Extent2D scaledExtent(float scale) const;
+
+	void destroyRenderTarget();
+
+	void destroyTimestampQueries();
+
+	void recordUpscale(vk::CommandBuffer commandBuffer, size_t image);
+
+	// FEEDS THE GPU TIME TO THE CONTROLLER AND RECORDS THE COMMAND BUFFER AGAIN IF THE SIZE CHANGED
+	void updateRenderScale(uint32_t currentImage);
+
+	uint32_t clusterCount() const { return clusterGrid.x * clusterGrid.y * clusterGrid.z; }
+
+	// WHAT THE DEPTH PREPASS AND THE SHADOWS READ, ONLY VALID ONCE THE TEXTURE IS DECODED
+	const VertexLayout& depthPassLayout() const { return textureHasCutout ? cutoutDepthLayout : depthLayout; }
+
+	void sampleInput();
+
+	FrameSnapshot makeSnapshot(std::chrono::steady_clock::time_point inputSampleTime);
+
+	void simulateTick(const InputState& input, float deltaTime);
+
+	void simulationLoop();
+
+	void renderLoop();
+
 };
\ No newline at end of file
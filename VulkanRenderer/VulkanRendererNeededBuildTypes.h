@@ -4,9 +4,11 @@ struct QueueFamilyIndices {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
 	std::optional<uint32_t> computeFamily;
+	// COPIES FROM THE STAGING BUFFERS, THE GRAPHICS FAMILY WHEN THERE IS NO COPY ENGINE
+	std::optional<uint32_t> transferFamily;
 
 	bool isComplete() {
-		return graphicsFamily.has_value() && presentFamily.has_value() && computeFamily.has_value();
+		return graphicsFamily.has_value() && presentFamily.has_value() && computeFamily.has_value() && transferFamily.has_value();
 	}
 };
 
@@ -72,4 +74,117 @@ struct UniformBufferObject {
     glm::mat4 model;
     glm::mat4 view;
     glm::mat4 proj;
+    // EVERYTHING BELOW IS FOR THE CLUSTERED LIGHTING (cluster.comp AND Fragment.frag)
+    glm::mat4 inverseProj;
+    glm::vec4 cameraPosition;
+    // x, y, z CLUSTER COUNTS, w = NUMBER OF LIGHTS
+    glm::uvec4 clusterGrid;
+    // SCREEN WIDTH, HEIGHT AND THE SIZE OF ONE TILE IN PIXELS
+    glm::vec4 clusterScreen;
+    // NEAR, FAR AND THE SCALE / BIAS THAT TURN log(VIEW DEPTH) INTO A SLICE
+    glm::vec4 clusterDepth;
+    // OBJECT COUNT, HI-Z LEVELS, HI-Z WIDTH, HI-Z HEIGHT (occlusion.comp)
+    glm::uvec4 cullInfo;
+    // xy = RENDERED PART OF THE TARGETS, DYNAMIC RESOLUTION DRAWS INTO THE TOP LEFT
+    glm::vec4 renderScale;
+    // CASCADED SHADOW MAPS (Shadows.cpp), WORLD TO SHADOW MAP PER CASCADE
+    glm::mat4 shadowMatrices[4];
+    // VIEW DEPTH WHERE EACH CASCADE ENDS
+    glm::vec4 shadowSplits;
+    // DIRECTION THE SUNLIGHT TRAVELS, w = INTENSITY (0 WITHOUT --shadows)
+    glm::vec4 sunDirection;
+    // x = CASCADES, y = SHADOW MAP SIZE
+    glm::uvec4 shadowInfo;
+    // PER VIEW CAMERA (Stereo.cpp), INDEXED BY gl_ViewIndex. WITHOUT STEREO BOTH ARE view / proj
+    glm::mat4 views[2];
+    glm::mat4 projections[2];
+};
+
+// SAME LAYOUT AS THE std430 STRUCT IN THE SHADERS
+struct PointLight {
+    glm::vec4 positionRadius;
+    glm::vec4 colorIntensity;
+};
+
+// ONE PER OBJECT THAT SURVIVED FRUSTUM CULLING, READ BY Vertex.vert AND occlusion.comp
+struct DrawObject {
+    glm::mat4 model;
+    // WORLD SPACE AABB
+    glm::vec4 center;
+    glm::vec4 extent;
+    // x = OBJECT ID IN THE CULLING SCENE
+    glm::uvec4 info;
+};
+
+// GPU PARTICLES (Particles.cpp), SAME LAYOUTS AS THE PARTICLE SHADERS
+// ONE PER PARTICLE, ONLY THE COMPUTE QUEUE SEES THESE
+struct GpuParticle {
+    // w = AGE IN SECONDS
+    glm::vec4 position;
+    // w = LIFETIME IN SECONDS
+    glm::vec4 velocity;
+};
+
+// ONE PER LIVE PARTICLE, WHAT THE BILLBOARDS ARE DRAWN FROM
+struct ParticleInstance {
+    // w = HALF THE BILLBOARD SIZE
+    glm::vec4 positionSize;
+    // a = BRIGHTNESS
+    glm::vec4 color;
+};
+
+// PER FRAME, std140
+struct ParticleParams {
+    // xyz = WHERE THEY START, w = SPAWN RADIUS
+    glm::vec4 emitter;
+    // xyz = ACCELERATION, w = DRAG
+    glm::vec4 gravity;
+    // x = TO EMIT THIS FRAME, y = MAX PARTICLES, z = RANDOM SEED
+    glm::uvec4 counts;
+    // x = DELTA TIME, y = LIFETIME, z = START SPEED, w = SIZE
+    glm::vec4 timing;
+};
+
+// PUSH CONSTANTS OF THE POST PROCESSING SHADERS (PostProcess.cpp), SAME LAYOUT AS post_*.comp
+struct PostConstants {
+    // renderExtent / viewExtent, THE PART OF THE SCENE TARGET THAT WAS DRAWN
+    glm::vec2 sceneScale;
+    // 1 / SIZE OF WHAT THE DISPATCH READS
+    glm::vec2 texelSize;
+    float exposure = 1.0f;
+    // BLOOM STARTS AT THIS BRIGHTNESS (AFTER THE EXPOSURE)
+    float bloomThreshold = 1.0f;
+    float bloomStrength = 0.05f;
+    float saturation = 1.1f;
+    float contrast = 1.05f;
+    float sharpness = 0.3f;
+    // LEVEL OF THE BLOOM CHAIN BEING WRITTEN
+    uint32_t level;
+    uint32_t views;
+    // 1 WHEN WRITING STRAIGHT INTO A UNORM SWAPCHAIN IMAGE, THE SHADER ENCODES
+    uint32_t encodeSrgb;
+};
+
+// RAW INPUT SAMPLED BY THE MAIN (GLFW) THREAD
+struct InputState {
+    bool forward = false;
+    bool backward = false;
+    bool left = false;
+    bool right = false;
+    double cursorX = 0.0;
+    double cursorY = 0.0;
+    std::chrono::steady_clock::time_point sampleTime;
+};
+
+// IMMUTABLE RESULT OF ONE SIMULATION TICK, THIS IS ALL
+// THE RENDER THREAD IS ALLOWED TO LOOK AT
+struct FrameSnapshot {
+    glm::vec3 cameraPos;
+    glm::vec3 cameraFront;
+    glm::vec3 cameraUp;
+    float yaw = 0.0f;
+    float pitch = 0.0f;
+    float fov = 45.0f;
+    uint64_t tick = 0;
+    std::chrono::steady_clock::time_point inputSampleTime;
 };
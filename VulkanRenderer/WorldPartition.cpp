@@ -0,0 +1,387 @@
+#include "WorldPartition.h"
+#include "Profiler.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+const char* skipSpaces(const char* cursor, const char* end) {
+	while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) cursor++;
+	return cursor;
+}
+
+bool parseFloat(const char*& cursor, const char* end, float& value) {
+	cursor = skipSpaces(cursor, end);
+	auto result = std::from_chars(cursor, end, value);
+	if (result.ec != std::errc()) return false;
+	cursor = result.ptr;
+	return true;
+}
+
+}
+
+void WorldPartition::open(const std::string& indexPath, JobSystem& jobSystem, const WorldStreamingSettings& settings, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	std::ifstream file(indexPath);
+	if (!file) {
+		throw std::runtime_error("failed to open world index " + indexPath + "!");
+	}
+
+	std::filesystem::path directory = std::filesystem::path(indexPath).parent_path();
+	std::vector<std::unique_ptr<Cell>> indexCells;
+	float indexCellSize = 0.0f;
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		std::istringstream words(line);
+		std::string keyword;
+		if (!(words >> keyword) || keyword[0] == '#') continue;
+
+		if (keyword == "cellsize") {
+			words >> indexCellSize;
+		}
+		else if (keyword == "cell") {
+			auto cell = std::make_unique<Cell>();
+			std::string cellFile;
+			if (!(words >> cell->x >> cell->z >> cell->objectCount >> cellFile)) {
+				throw std::runtime_error("failed to read world index " + indexPath + ", bad cell on line " + std::to_string(lineNumber) + "!");
+			}
+			cell->path = (directory / cellFile).string();
+			indexCells.push_back(std::move(cell));
+		}
+		else {
+			throw std::runtime_error("failed to read world index " + indexPath + ", unknown '" + keyword + "' on line " + std::to_string(lineNumber) + "!");
+		}
+	}
+	if (indexCellSize <= 0.0f) {
+		throw std::runtime_error("failed to read world index " + indexPath + ", no cellsize!");
+	}
+
+	cells = std::move(indexCells);
+	cellMap.clear();
+	for (const auto& cell : cells) {
+		cellMap[key(cell->x, cell->z)] = cell.get();
+	}
+
+	jobs = &jobSystem;
+	config = settings;
+	config.unloadRadius = std::max(config.unloadRadius, config.loadRadius);
+	cellSize = indexCellSize;
+	objectBoundsMin = boundsMin;
+	objectBoundsMax = boundsMax;
+	counters = WorldStreamingStats();
+	counters.cells = cells.size();
+}
+
+float WorldPartition::distance(const Cell& cell, const glm::vec3& point) const {
+	float minX = cell.x * cellSize;
+	float minZ = cell.z * cellSize;
+	float dx = std::max(std::max(minX - point.x, point.x - (minX + cellSize)), 0.0f);
+	float dz = std::max(std::max(minZ - point.z, point.z - (minZ + cellSize)), 0.0f);
+	return std::sqrt(dx * dx + dz * dz);
+}
+
+float WorldPartition::prefetchDistance(const Cell& cell) const {
+	// A FEW POINTS ALONG WHERE THE CAMERA IS GOING, CELLS ARE BIG ENOUGH THAT WE DO NOT MISS ANY
+	glm::vec3 horizon = velocity * config.prefetchSeconds;
+	float closest = distance(cell, camera);
+	for (int step = 1; step <= 4; step++) {
+		closest = std::min(closest, distance(cell, camera + horizon * (step / 4.0f)));
+	}
+	return closest;
+}
+
+void WorldPartition::startLoad(Cell& cell) {
+	cell.state.store(CellState::Loading, std::memory_order_relaxed);
+	cell.error.clear();
+	if (!cell.tracked) {
+		cell.tracked = true;
+		active.push_back(&cell);
+	}
+	memoryBytes += cell.bytes();
+	loadsInFlight++;
+	counters.loadsStarted++;
+
+	Cell* target = &cell;
+	jobs->run([target]() {
+		PROFILE_ZONE("load world cell");
+		try {
+			std::ifstream file(target->path, std::ios::binary);
+			if (!file) {
+				throw std::runtime_error("failed to open world cell " + target->path + "!");
+			}
+			std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+			std::vector<Placement> placements;
+			placements.reserve(target->objectCount);
+			const char* cursor = text.data();
+			const char* end = cursor + text.size();
+			while (cursor < end) {
+				const char* lineEnd = std::find(cursor, end, '\n');
+				const char* word = skipSpaces(cursor, lineEnd);
+				if (word < lineEnd && *word == 'o') {
+					// THE INDEX SAID HOW MUCH WE MAY HOLD, THE BUDGETS WERE CHECKED AGAINST THAT
+					if (placements.size() == target->objectCount) {
+						throw std::runtime_error("failed to load world cell " + target->path + ", it has more objects than the index says!");
+					}
+					Placement placement;
+					word++;
+					if (!parseFloat(word, lineEnd, placement.position.x) || !parseFloat(word, lineEnd, placement.position.y) || !parseFloat(word, lineEnd, placement.position.z)
+						|| !parseFloat(word, lineEnd, placement.yaw) || !parseFloat(word, lineEnd, placement.scale)) {
+						throw std::runtime_error("failed to load world cell " + target->path + ", bad object line!");
+					}
+					placements.push_back(placement);
+				}
+				else if (word < lineEnd && *word != '#') {
+					throw std::runtime_error("failed to load world cell " + target->path + ", unknown line!");
+				}
+				cursor = lineEnd + 1;
+			}
+
+			target->placements = std::move(placements);
+			target->state.store(CellState::Loaded, std::memory_order_release);
+		}
+		catch (const std::exception& e) {
+			// NOT RETHROWN, ONE BAD CELL SHOULD NOT TAKE THE FRAME DOWN
+			target->error = e.what();
+			target->state.store(CellState::Failed, std::memory_order_release);
+		}
+	}, &cell.loading);
+}
+
+void WorldPartition::makeResident(Cell& cell, CullingScene& scene) {
+	cell.sceneObjects.reserve(cell.placements.size());
+	for (const Placement& placement : cell.placements) {
+		glm::mat4 world = glm::translate(glm::mat4(1.0f), placement.position);
+		world = glm::rotate(world, glm::radians(placement.yaw), glm::vec3(0.0f, 1.0f, 0.0f));
+		world = glm::scale(world, glm::vec3(placement.scale));
+		cell.sceneObjects.push_back(scene.add(objectBoundsMin, objectBoundsMax, world));
+	}
+	residentObjects += cell.sceneObjects.size();
+}
+
+void WorldPartition::leaveScene(Cell& cell, CullingScene& scene) {
+	for (uint32_t object : cell.sceneObjects) {
+		scene.remove(object);
+	}
+	residentObjects -= cell.sceneObjects.size();
+	cell.sceneObjects.clear();
+}
+
+void WorldPartition::unload(Cell& cell, CullingScene& scene) {
+	leaveScene(cell, scene);
+	cell.placements = std::vector<Placement>();
+	cell.state.store(CellState::Unloaded, std::memory_order_relaxed);
+	memoryBytes -= cell.bytes();
+	counters.unloads++;
+}
+
+void WorldPartition::update(const glm::vec3& cameraPos, CullingScene& scene) {
+	PROFILE_FUNCTION();
+	if (!jobs) return;
+
+	// CAMERA SPEED, SMOOTHED SO ONE LONG FRAME DOES NOT SWING THE HORIZON AROUND
+	auto now = std::chrono::steady_clock::now();
+	if (hasLastUpdate) {
+		float deltaTime = std::chrono::duration<float>(now - lastUpdate).count();
+		if (deltaTime > 0.0f) {
+			glm::vec3 measured = (cameraPos - camera) / deltaTime;
+			measured.y = 0.0f;
+			velocity += (measured - velocity) * std::min(deltaTime * 4.0f, 1.0f);
+		}
+	}
+	hasLastUpdate = true;
+	lastUpdate = now;
+	camera = cameraPos;
+
+	// LOADS THAT FINISHED SINCE THE LAST UPDATE
+	for (Cell* cell : active) {
+		CellState state = cell->state.load(std::memory_order_acquire);
+		if (state == CellState::Failed && cell->tracked) {
+			std::cout << "world: " << cell->error << "\n";
+			counters.loadsFailed++;
+			memoryBytes -= cell->bytes();
+			cell->placements = std::vector<Placement>();
+			// STAYS Failed, SO IT IS NEVER TRIED AGAIN
+			cell->tracked = false;
+		}
+	}
+
+	// TOO FAR AWAY: FIRST OUT OF THE SCENE, THEN OUT OF MEMORY
+	for (Cell* cell : active) {
+		if (!cell->tracked || cell->state.load(std::memory_order_acquire) != CellState::Loaded) continue;
+		if (cell->resident() && distance(*cell, camera) > config.unloadRadius) {
+			leaveScene(*cell, scene);
+		}
+		if (prefetchDistance(*cell) > config.unloadRadius) {
+			unload(*cell, scene);
+		}
+	}
+
+	// loadsInFlight IS RECOUNTED, A LOAD IS DONE WHEN ITS STATE LEAVES Loading
+	loadsInFlight = 0;
+	for (Cell* cell : active) {
+		if (cell->tracked && cell->state.load(std::memory_order_acquire) == CellState::Loading) {
+			loadsInFlight++;
+		}
+	}
+
+	// EVERY CELL WITHIN THE LOAD RADIUS OF THE CAMERA OR ITS HORIZON, NEAREST FIRST
+	std::vector<std::pair<float, Cell*>> wanted;
+	{
+		glm::vec3 horizon = camera + velocity * config.prefetchSeconds;
+		float reach = config.loadRadius;
+		int minX = static_cast<int>(std::floor((std::min(camera.x, horizon.x) - reach) / cellSize));
+		int maxX = static_cast<int>(std::floor((std::max(camera.x, horizon.x) + reach) / cellSize));
+		int minZ = static_cast<int>(std::floor((std::min(camera.z, horizon.z) - reach) / cellSize));
+		int maxZ = static_cast<int>(std::floor((std::max(camera.z, horizon.z) + reach) / cellSize));
+
+		auto consider = [&](Cell* cell) {
+			if (cell->state.load(std::memory_order_acquire) == CellState::Failed) return;
+			float cellDistance = prefetchDistance(*cell);
+			if (cellDistance <= config.loadRadius) {
+				wanted.push_back({ cellDistance, cell });
+			}
+		};
+
+		// A VERY FAST CAMERA MAKES THE BOX BIGGER THAN THE WORLD, THEN JUST WALK THE WORLD
+		double boxCells = (static_cast<double>(maxX) - minX + 1.0) * (static_cast<double>(maxZ) - minZ + 1.0);
+		if (boxCells > static_cast<double>(cells.size())) {
+			for (const auto& cell : cells) consider(cell.get());
+		}
+		else {
+			for (int z = minZ; z <= maxZ; z++) {
+				for (int x = minX; x <= maxX; x++) {
+					auto found = cellMap.find(key(x, z));
+					if (found != cellMap.end()) consider(found->second);
+				}
+			}
+		}
+		std::sort(wanted.begin(), wanted.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+	}
+
+	// THE FARTHEST LOADED CELL THAT IS FARTHER THAN limit, GIVES ROOM TO A NEARER ONE
+	auto farthestLoaded = [&](float limit, bool residentOnly) {
+		Cell* farthest = nullptr;
+		float farthestDistance = limit;
+		for (Cell* cell : active) {
+			if (!cell->tracked || cell->state.load(std::memory_order_acquire) != CellState::Loaded) continue;
+			if (residentOnly && !cell->resident()) continue;
+			float cellDistance = residentOnly ? distance(*cell, camera) : prefetchDistance(*cell);
+			if (cellDistance > farthestDistance) {
+				farthest = cell;
+				farthestDistance = cellDistance;
+			}
+		}
+		return farthest;
+	};
+
+	// START LOADS
+	for (const auto& candidate : wanted) {
+		Cell& cell = *candidate.second;
+		if (cell.state.load(std::memory_order_acquire) != CellState::Unloaded) continue;
+		if (loadsInFlight >= config.maxLoadsInFlight) break;
+
+		while (memoryBytes + cell.bytes() > config.memoryBudget) {
+			Cell* victim = farthestLoaded(candidate.first, false);
+			if (!victim) break;
+			unload(*victim, scene);
+		}
+		if (memoryBytes + cell.bytes() > config.memoryBudget) {
+			counters.budgetMisses++;
+			continue;
+		}
+		startLoad(cell);
+	}
+
+	// INTO THE SCENE: LOADED CELLS AROUND THE CAMERA ITSELF, NEAREST FIRST
+	std::vector<std::pair<float, Cell*>> arriving;
+	for (Cell* cell : active) {
+		if (!cell->tracked || cell->resident() || cell->state.load(std::memory_order_acquire) != CellState::Loaded) continue;
+		float cellDistance = distance(*cell, camera);
+		if (cellDistance <= config.loadRadius && !cell->placements.empty()) {
+			arriving.push_back({ cellDistance, cell });
+		}
+	}
+	std::sort(arriving.begin(), arriving.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+	for (const auto& candidate : arriving) {
+		Cell& cell = *candidate.second;
+		while (residentObjects + cell.placements.size() > config.objectBudget) {
+			Cell* victim = farthestLoaded(candidate.first, true);
+			if (!victim) break;
+			leaveScene(*victim, scene);
+		}
+		if (residentObjects + cell.placements.size() > config.objectBudget) {
+			counters.budgetMisses++;
+			continue;
+		}
+		makeResident(cell, scene);
+	}
+
+	// FORGET CELLS THAT ARE FULLY GONE
+	active.erase(std::remove_if(active.begin(), active.end(), [](Cell* cell) {
+		if (cell->tracked && cell->state.load(std::memory_order_acquire) == CellState::Unloaded) {
+			cell->tracked = false;
+		}
+		return !cell->tracked;
+	}), active.end());
+
+	counters.peakObjects = std::max(counters.peakObjects, residentObjects);
+	counters.peakMemoryBytes = std::max(counters.peakMemoryBytes, memoryBytes);
+}
+
+void WorldPartition::close(CullingScene& scene) {
+	if (!jobs) return;
+
+	for (Cell* cell : active) {
+		jobs->wait(cell->loading);
+	}
+	for (Cell* cell : active) {
+		if (cell->state.load(std::memory_order_acquire) == CellState::Loaded) {
+			unload(*cell, scene);
+		}
+	}
+	active.clear();
+	cellMap.clear();
+	cells.clear();
+	memoryBytes = 0;
+	residentObjects = 0;
+	loadsInFlight = 0;
+	jobs = nullptr;
+}
+
+WorldStreamingStats WorldPartition::stats() const {
+	WorldStreamingStats result = counters;
+	result.loadingCells = 0;
+	result.loadedCells = 0;
+	result.residentCells = 0;
+	for (const Cell* cell : active) {
+		CellState state = cell->state.load(std::memory_order_acquire);
+		if (state == CellState::Loading) result.loadingCells++;
+		if (state == CellState::Loaded) result.loadedCells++;
+		if (cell->resident()) result.residentCells++;
+	}
+	result.residentObjects = residentObjects;
+	result.memoryBytes = memoryBytes;
+	return result;
+}
+
+void WorldPartition::report(std::ostream& out) const {
+	WorldStreamingStats current = stats();
+	out << "world streaming: " << current.cells << " cells, "
+		<< current.loadsStarted << " loads (" << current.loadsFailed << " failed), "
+		<< current.unloads << " unloads, peak " << current.peakObjects << " / " << config.objectBudget << " objects, peak "
+		<< current.peakMemoryBytes / 1024 << " / " << config.memoryBudget / 1024 << " KB of placements, "
+		<< current.budgetMisses << " budget misses\n";
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Culling.h"
+#include "JobSystem.h"
+
+// WORLD PARTITION
+// THE WORLD IS A GRID OF SQUARE CELLS ON THE XZ PLANE AND EVERY CELL IS ITS OWN
+// FILE OF OBJECT PLACEMENTS. CELLS NEAR THE CAMERA, OR NEAR WHERE IT IS HEADING
+// (prefetchSeconds AT THE CURRENT SPEED), ARE READ ON THE JOB SYSTEM. CELLS NEAR
+// THE CAMERA ITSELF GET THEIR OBJECTS ADDED TO THE CULLING SCENE. FAR CELLS ARE
+// TAKEN OUT OF THE SCENE AND THEN OUT OF MEMORY
+//
+// ONLY PLACEMENTS ARE STREAMED: EVERY OBJECT IS A COPY OF THE ONE MODEL LOADED AT STARTUP,
+// WHOSE MESH AND TEXTURE STAY IN THE ResourceCache FOR THE WHOLE RUN, AND memoryBudget COUNTS
+// PLACEMENTS IN SYSTEM MEMORY, NOT GPU BYTES. CELLS WITH THEIR OWN MESHES AND TEXTURES NEED
+// EVERY PASS TO DRAW MORE THAN ONE MESH (TODAY EACH ISSUES ONE INDIRECT DRAW OF mesh)
+//
+// INDEX FILE, PATHS ARE RELATIVE TO IT, # STARTS A COMMENT:
+//   cellsize <size>
+//   cell <x> <z> <object count> <file>
+// CELL FILE, ONE OBJECT PER LINE, YAW IN DEGREES:
+//   o <x> <y> <z> <yaw> <scale>
+
+struct WorldStreamingSettings {
+	// A CELL IS WANTED WHEN IT IS CLOSER THAN THIS (XZ DISTANCE TO ITS SQUARE)
+	float loadRadius = 48.0f;
+	// AND ONLY DROPPED AGAIN WHEN IT IS FARTHER THAN THIS, SO WE DO NOT THRASH ON A BORDER
+	float unloadRadius = 64.0f;
+	// HOW FAR AHEAD (IN SECONDS AT THE CURRENT SPEED) CELLS ARE READ BEFORE THEY ARE NEEDED
+	float prefetchSeconds = 2.0f;
+	// HARD LIMITS
+	// BYTES OF PLACEMENTS IN SYSTEM MEMORY, COUNTING LOADS THAT ARE STILL RUNNING
+	size_t memoryBudget = size_t(16) * 1024 * 1024;
+	// OBJECTS IN THE CULLING SCENE (EVERY ONE IS A DRAW SLOT ON THE GPU)
+	size_t objectBudget = 4096;
+	uint32_t maxLoadsInFlight = 4;
+};
+
+struct WorldStreamingStats {
+	size_t cells = 0;
+	size_t loadingCells = 0;
+	size_t loadedCells = 0;
+	size_t residentCells = 0;
+	size_t residentObjects = 0;
+	size_t memoryBytes = 0;
+	size_t peakObjects = 0;
+	size_t peakMemoryBytes = 0;
+	uint64_t loadsStarted = 0;
+	uint64_t loadsFailed = 0;
+	uint64_t unloads = 0;
+	// CELLS THAT WERE WANTED BUT DID NOT FIT IN A BUDGET (PER update, SUMMED)
+	uint64_t budgetMisses = 0;
+};
+
+class WorldPartition {
+public:
+	WorldPartition() = default;
+
+	WorldPartition(const WorldPartition&) = delete;
+	WorldPartition& operator=(const WorldPartition&) = delete;
+
+	// READS THE INDEX ONLY, NOTHING IS LOADED UNTIL update()
+	// boundsMin / boundsMax ARE THE LOCAL BOUNDS EVERY OBJECT IS DRAWN WITH
+	void open(const std::string& indexPath, JobSystem& jobs, const WorldStreamingSettings& settings, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+	bool isOpen() const { return jobs != nullptr; }
+
+	// ONCE PER FRAME FROM THE THREAD THAT OWNS scene, NEVER WAITS FOR A LOAD
+	void update(const glm::vec3& cameraPos, CullingScene& scene);
+
+	// WAITS FOR THE LOADS STILL RUNNING AND TAKES EVERYTHING OUT OF scene
+	// CALL IT BEFORE THE JOB SYSTEM STOPS, A LOAD JOB WRITES INTO ITS CELL
+	void close(CullingScene& scene);
+
+	const WorldStreamingSettings& settings() const { return config; }
+
+	float cellWidth() const { return cellSize; }
+
+	WorldStreamingStats stats() const;
+
+	void report(std::ostream& out) const;
+
+private:
+	// ONLY THE LOAD JOB MOVES A CELL FROM Loading TO Loaded / Failed, EVERYTHING ELSE IS update()
+	enum class CellState {
+		Unloaded,
+		Loading,
+		Loaded,
+		Failed
+	};
+
+	struct Placement {
+		glm::vec3 position;
+		float yaw;
+		float scale;
+	};
+
+	struct Cell {
+		int x = 0;
+		int z = 0;
+		std::string path;
+		// FROM THE INDEX, THE BUDGETS ARE CHECKED AGAINST IT BEFORE ANYTHING IS READ
+		size_t objectCount = 0;
+
+		std::atomic<CellState> state{ CellState::Unloaded };
+		JobCounter loading;
+		// WRITTEN BY THE LOAD JOB BEFORE state BECOMES Loaded
+		std::vector<Placement> placements;
+		std::string error;
+
+		// IN THE SCENE WHEN NOT EMPTY
+		std::vector<uint32_t> sceneObjects;
+		// IN active
+		bool tracked = false;
+
+		size_t bytes() const { return objectCount * sizeof(Placement); }
+		bool resident() const { return !sceneObjects.empty(); }
+	};
+
+	static uint64_t key(int x, int z) {
+		return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(z);
+	}
+
+	// XZ DISTANCE FROM point TO THE CELL'S SQUARE, 0 INSIDE
+	float distance(const Cell& cell, const glm::vec3& point) const;
+	// CLOSEST THE CAMERA GETS TO THE CELL OVER THE PREFETCH HORIZON
+	float prefetchDistance(const Cell& cell) const;
+
+	void startLoad(Cell& cell);
+	void makeResident(Cell& cell, CullingScene& scene);
+	void leaveScene(Cell& cell, CullingScene& scene);
+	void unload(Cell& cell, CullingScene& scene);
+
+	JobSystem* jobs = nullptr;
+	WorldStreamingSettings config;
+	glm::vec3 objectBoundsMin = glm::vec3(0.0f);
+	glm::vec3 objectBoundsMax = glm::vec3(0.0f);
+	float cellSize = 1.0f;
+
+	std::vector<std::unique_ptr<Cell>> cells;
+	std::unordered_map<uint64_t, Cell*> cellMap;
+	// EVERY CELL THAT IS NOT Unloaded
+	std::vector<Cell*> active;
+
+	// CAMERA MOTION FOR THE PREFETCH HORIZON
+	bool hasLastUpdate = false;
+	std::chrono::steady_clock::time_point lastUpdate;
+	glm::vec3 camera = glm::vec3(0.0f);
+	glm::vec3 velocity = glm::vec3(0.0f);
+
+	// RESERVED WHEN A LOAD STARTS, SO THE BUDGET HOLDS EVEN BEFORE THE DATA ARRIVES
+	size_t memoryBytes = 0;
+	size_t residentObjects = 0;
+	uint32_t loadsInFlight = 0;
+
+	WorldStreamingStats counters;
+};
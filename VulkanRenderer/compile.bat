@@ -1,3 +1,26 @@
-C:\VulkanSDK\1.2.148.1\Bin\glslc.exe .\UncompiledShaders\Vertex.vert -o .\Shaders\vert.spv
-C:\VulkanSDK\1.2.148.1\Bin\glslc.exe .\UncompiledShaders\Fragment.frag -o .\Shaders\frag.spv
+@rem THE PROJECT RUNS THESE ON EVERY BUILD (CustomBuild IN VulkanRenderer.vcxproj), THIS IS FOR EDITING SHADERS WITHOUT A REBUILD
+set GLSLC=C:\VulkanSDK\1.2.148.1\Bin\glslc.exe
+if not "%VULKAN_SDK%"=="" set GLSLC=%VULKAN_SDK%\Bin\glslc.exe
+if not exist .\Shaders mkdir .\Shaders
+"%GLSLC%" .\UncompiledShaders\Vertex.vert -o .\Shaders\vert.spv
+"%GLSLC%" -DMULTIVIEW .\UncompiledShaders\Vertex.vert -o .\Shaders\vert_multiview.spv
+"%GLSLC%" -DDEPTH_ONLY .\UncompiledShaders\Vertex.vert -o .\Shaders\vert_depth.spv
+"%GLSLC%" -DDEPTH_ONLY -DALPHA_TEST .\UncompiledShaders\Vertex.vert -o .\Shaders\vert_depth_alpha.spv
+"%GLSLC%" .\UncompiledShaders\Fragment.frag -o .\Shaders\frag.spv
+"%GLSLC%" .\UncompiledShaders\cluster.comp -o .\Shaders\cluster.spv
+"%GLSLC%" .\UncompiledShaders\hiz.comp -o .\Shaders\hiz.spv
+"%GLSLC%" .\UncompiledShaders\occlusion.comp -o .\Shaders\occlusion.spv
+"%GLSLC%" .\UncompiledShaders\shadow.vert -o .\Shaders\shadow.spv
+"%GLSLC%" -DALPHA_TEST .\UncompiledShaders\shadow.vert -o .\Shaders\shadow_alpha.spv
+"%GLSLC%" .\UncompiledShaders\cutout.frag -o .\Shaders\cutout_frag.spv
+"%GLSLC%" .\UncompiledShaders\particle_emit.comp -o .\Shaders\particle_emit.spv
+"%GLSLC%" .\UncompiledShaders\particle_simulate.comp -o .\Shaders\particle_simulate.spv
+"%GLSLC%" .\UncompiledShaders\particle_compact.comp -o .\Shaders\particle_compact.spv
+"%GLSLC%" .\UncompiledShaders\particle.vert -o .\Shaders\particle_vert.spv
+"%GLSLC%" -DMULTIVIEW .\UncompiledShaders\particle.vert -o .\Shaders\particle_vert_multiview.spv
+"%GLSLC%" .\UncompiledShaders\particle.frag -o .\Shaders\particle_frag.spv
+"%GLSLC%" .\UncompiledShaders\post_bloom_down.comp -o .\Shaders\post_bloom_down.spv
+"%GLSLC%" .\UncompiledShaders\post_bloom_up.comp -o .\Shaders\post_bloom_up.spv
+"%GLSLC%" .\UncompiledShaders\post.comp -o .\Shaders\post.spv
+"%GLSLC%" -DSWAPCHAIN_OUTPUT .\UncompiledShaders\post.comp -o .\Shaders\post_swapchain.spv
 pause
\ No newline at end of file
@@ -3,38 +3,44 @@
 #include <iostream>
 
 
-int main() {
+int main(int argc, char* argv[]) {
+    profiler::setThreadName("main");
     VulkanRenderer app;
     int wait;
     try {
-        app.initWindow();
-        app.createInstance();
-        app.setupDebugMessenger();
-        app.createSurface();
-        app.pickPhisicalDevice();
-        app.createLogicalDevice();
-        app.createSwapChain();
-        app.createImageViews();
-        app.createRenderPass();
-        app.createDescriptorSetLayout();
-        app.createGraphicsPipeline();
-        app.createCommandPool();
-        app.createDepthResources();
-        app.createFramebuffers();
-        app.createTextureImage();
-        app.createTextureImageView();
-        app.createTextureSampler();
-        app.loadModel();
-        app.createVertexBuffer();
-        app.createIndexBuffer();
-        app.createUniformBuffers();
-        app.createDescriptorPool();
-        app.createDescriptorSets();
-        app.createCommandBuffers();
-        app.createSyncObjects();
-
-        app.mainLoop();
-        app.clean();
+        app.parseCommandLine(argc, argv);
+        app.jobSystem.start(app.workerThreadCount);
+
+        // WITHOUT A VULKAN DEVICE THE BATCH IS STILL RENDERED, ON THE CPU
+        bool software = app.softwareRendering;
+        if (!software) {
+            try {
+                app.init();
+            }
+            catch (const NoVulkanDeviceError& e) {
+                if (!app.batchMode()) throw;
+                std::cout << e.what() << " rendering the batch on the CPU\n";
+                software = true;
+            }
+        }
+
+        if (software) {
+            app.runSoftwareBatch();
+            app.cleanSoftware();
+        }
+        else {
+            if (app.batchMode()) {
+                app.runBatch();
+            }
+            else {
+                app.mainLoop();
+            }
+            app.clean();
+        }
+
+        if (!app.profilePath.empty()) {
+            profiler::writeChromeTrace(app.profilePath);
+        }
     }
     catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;